@@ -0,0 +1,292 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "debug_controller.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "http_util.h"
+#include "json_buffer.h"
+#include "plc_trace.h"
+#include "deferred_log.h"
+#include "plc_uart_capture.h"
+#include "cJSON.h"
+#ifdef POWERLINE_MICROBENCH
+#include <xtensa/hal.h>
+#include "microbench.h"
+#endif
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#ifdef POWERLINE_MICROBENCH
+/* Duração mínima de cada caso, em ciclos (~100 ms a 240 MHz) */
+#define BENCH_MIN_CYCLES  (24 * 1000 * 1000)
+#endif
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+#ifdef POWERLINE_MICROBENCH
+static uint64_t bench_cycles(void);
+#endif
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Envia traces das últimas requisições, do mais recente ao mais antigo.
+ * Durações em microssegundos
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t debug_controller_get_traces(httpd_req_t * req)
+{
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_write(&writer, "{\"traces\":[", 11);
+
+  plcTrace_t trace;
+  for (uint32_t idx = 0; plc_trace_get(idx, &trace); idx++)
+  {
+    http_util_chunk_printf(&writer, "%s{\"id\":%u,\"uri\":\"%s\",\"start\":%u,\"result\":%s,"
+                           "\"retries\":%u,\"total\":%u,\"stages\":{",
+                           idx == 0 ? "" : ",", trace.id, trace.uri,
+                           (uint32_t)(trace.startUs / 1000), trace.result ? "true" : "false",
+                           trace.retries, trace.totalUs);
+    for (uint32_t stage = 0; stage < PLC_TRACE_STAGE_COUNT; stage++)
+    {
+      http_util_chunk_printf(&writer, "%s\"%s\":%u", stage == 0 ? "" : ",",
+                             plc_trace_stage_name(stage), trace.stageUs[stage]);
+    }
+    http_util_chunk_write(&writer, "}}", 2);
+  }
+
+  http_util_chunk_write(&writer, "]}", 2);
+
+  return http_util_chunk_end(&writer);
+}
+
+/**
+ * Altera nível do log adiado de um módulo em tempo de execução.
+ * Body: {"module": "plc_uart", "level": 0 (nenhum) .. 5 (verbose)}
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t debug_controller_post_log(httpd_req_t * req)
+{
+  esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+
+  if (result != ESP_OK)
+  {
+    /* Falha recuperação body */
+    http_util_send_response(req, HTTPD_500, "Error reading request body");
+    return result;
+  }
+
+  char module[16];
+  uint32_t level;
+  cJSON * root = cJSON_Parse(json_buffer_get());
+  result = get_json_string_value(root, "module", module, sizeof(module) - 1);
+  if (result == ESP_OK)
+  {
+    result = get_json_int_value(root, "level", &level);
+  }
+  cJSON_Delete(root);
+
+  if ((result != ESP_OK) || (deferred_log_set_level(module, level) == false))
+  {
+    /* Body formatado incorretamente, módulo ou nível desconhecido */
+    http_util_send_response(req, HTTPD_400, "Error decoding request body");
+    return ESP_FAIL;
+  }
+
+  http_util_send_response(req, HTTPD_200, "OK");
+  return ESP_OK;
+}
+
+/**
+ * Inicia ou encerra captura do tráfego UART PLC.
+ * Body: {"enable": true, "spill": false}, spill opcional
+ * Resposta: estado da captura
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t debug_controller_post_uart_capture(httpd_req_t * req)
+{
+  esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+
+  if (result != ESP_OK)
+  {
+    /* Falha recuperação body */
+    http_util_send_response(req, HTTPD_500, "Error reading request body");
+    return result;
+  }
+
+  cJSON * root = cJSON_Parse(json_buffer_get());
+  cJSON * enable = cJSON_GetObjectItem(root, "enable");
+  cJSON * spill = cJSON_GetObjectItem(root, "spill");
+  const bool validBody = cJSON_IsBool(enable) && ((spill == NULL) || cJSON_IsBool(spill));
+  const bool enableValue = cJSON_IsTrue(enable);
+  const bool spillValue = cJSON_IsTrue(spill);
+  cJSON_Delete(root);
+
+  if (validBody == false)
+  {
+    /* Body formatado incorretamente */
+    http_util_send_response(req, HTTPD_400, "Error decoding request body");
+    return ESP_FAIL;
+  }
+
+  if (enableValue == false)
+  {
+    plc_uart_capture_stop();
+  }
+  else if (plc_uart_capture_start(spillValue) == false)
+  {
+    /* Spill solicitado sem partição de captura */
+    http_util_send_response(req, HTTPD_400, "Capture partition not available");
+    return ESP_FAIL;
+  }
+
+  plcUartCaptureStatus_t status;
+  plc_uart_capture_get_status(&status);
+  snprintf(json_buffer_get(), json_buffer_get_size(),
+           "{\"enabled\":%s,\"spill\":%s,\"start\":%u,\"records\":%u,\"dropped\":%u,"
+           "\"ram\":%u,\"flash\":%u}",
+           status.enabled ? "true" : "false", status.spill ? "true" : "false", status.startTime,
+           status.records, status.dropped, status.ramBytes, status.flashBytes);
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  return httpd_resp_sendstr(req, json_buffer_get());
+}
+
+/**
+ * Envia arquivo de captura do tráfego UART PLC, formato descrito em
+ * plc_uart_capture.h. Captura pode continuar ativa durante o download
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t debug_controller_get_uart_capture(httpd_req_t * req)
+{
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"uart.plcu\"");
+
+  esp_err_t result = ESP_OK;
+  plcUartCaptureReader_t reader;
+  plc_uart_capture_read_begin(&reader);
+
+  size_t length;
+  while ((result == ESP_OK) &&
+         ((length = plc_uart_capture_read(&reader, (uint8_t *)json_buffer_get(), json_buffer_get_size())) != 0))
+  {
+    result = httpd_resp_send_chunk(req, json_buffer_get(), length);
+  }
+
+  plc_uart_capture_read_end(&reader);
+
+  if (result != ESP_OK)
+  {
+    /* Conexão encerrada durante o envio */
+    return result;
+  }
+
+  return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+#ifdef POWERLINE_MICROBENCH
+/**
+ * Executa os microbenchmarks das funções auxiliares e envia o custo por
+ * operação em ciclos da CPU. Bloqueia o servidor HTTP durante a medição
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t debug_controller_get_bench(httpd_req_t * req)
+{
+  /* Medição antes da escrita, os casos utilizam o json_buffer */
+  const uint32_t count = microbench_case_count();
+  microbenchResult_t * resultsPtr = calloc(count, sizeof(microbenchResult_t));
+  if (resultsPtr == NULL)
+  {
+    http_util_send_response(req, HTTPD_500, "Out of memory");
+    return ESP_FAIL;
+  }
+
+  for (uint32_t idx = 0; idx < count; idx++)
+  {
+    microbench_run(microbench_case_get(idx), bench_cycles, BENCH_MIN_CYCLES, &resultsPtr[idx]);
+  }
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_write(&writer, "{\"unit\":\"cycles\",\"cases\":[", 26);
+  for (uint32_t idx = 0; idx < count; idx++)
+  {
+    http_util_chunk_printf(&writer, "%s{\"name\":\"%s\",\"iterations\":%u,\"perOp\":%.1f,"
+                           "\"allocsPerOp\":%.2f,\"leakedPerOp\":%.2f}",
+                           idx == 0 ? "" : ",", resultsPtr[idx].namePtr, resultsPtr[idx].iterations,
+                           resultsPtr[idx].perOp, resultsPtr[idx].allocsPerOp, resultsPtr[idx].leakedPerOp);
+  }
+  http_util_chunk_write(&writer, "]}", 2);
+  free(resultsPtr);
+
+  return http_util_chunk_end(&writer);
+}
+#endif
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+#ifdef POWERLINE_MICROBENCH
+/**
+ * Relógio dos microbenchmarks, contador de ciclos do núcleo atual
+ * 
+ * @return uint64_t ciclos
+ */
+static uint64_t bench_cycles(void)
+{
+  /* CCOUNT é 32 bits, estendido pelo overflow observado entre leituras */
+  static uint32_t last;
+  static uint64_t high;
+  const uint32_t now = xthal_get_ccount();
+  if (now < last)
+  {
+    high += 1ULL << 32;
+  }
+  last = now;
+  return high | now;
+}
+#endif
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,37 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef DEBUG_CONTROLLER_H
+#define DEBUG_CONTROLLER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <esp_http_server.h>
+
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t debug_controller_get_traces(httpd_req_t * req);
+esp_err_t debug_controller_post_log(httpd_req_t * req);
+esp_err_t debug_controller_post_uart_capture(httpd_req_t * req);
+esp_err_t debug_controller_get_uart_capture(httpd_req_t * req);
+#ifdef POWERLINE_MICROBENCH
+esp_err_t debug_controller_get_bench(httpd_req_t * req);
+#endif
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
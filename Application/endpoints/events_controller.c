@@ -0,0 +1,522 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "events_controller.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include "plc_events.h"
+#include "http_util.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Maior frame aceito do cliente WebSocket, canal somente de envio */
+#define WS_RECV_SIZE      32
+/* Campos "id: <boot>-<seq>\ndata: " e "\n\n" do evento SSE */
+#define SSE_OVERHEAD      32
+#if EVENTS_CLIENT_QUEUE >= PLC_EVENTS_RING_SIZE
+#error "EVENTS_CLIENT_QUEUE deve ser menor que PLC_EVENTS_RING_SIZE"
+#endif
+
+/* Transporte do cliente */
+typedef enum clientTransport_t
+{
+  TRANSPORT_WS = 0,
+  TRANSPORT_SSE,
+} clientTransport_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/*
+ * Cliente de eventos, a fila do cliente é o intervalo [nextSeq, próximo
+ * evento) do anel. A posição é o contexto da sessão HTTP e é liberada
+ * quando o servidor encerra a sessão
+ */
+typedef struct eventsClient_t
+{
+  bool used;
+  /* Encerramento solicitado, aguardando o servidor liberar a sessão */
+  bool closing;
+  clientTransport_t transport;
+  int fd;
+  uint32_t nextSeq;
+  /* Fim dos eventos perdidos na reconexão SSE, fora do limite EVENTS_CLIENT_QUEUE */
+  uint32_t backlogSeq;
+} eventsClient_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "EVENTS_CONTROLLER";
+
+/* Evento SSE de eventos perdidos, cliente deve recarregar /plc/topology */
+static const char sseResync[] = "event: resync\ndata: {}\n\n";
+
+/* Cabeçalho da resposta SSE, corpo delimitado pelo fim da conexão */
+static const char sseHeader[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "X-Accel-Buffering: no\r\n"
+  "\r\n";
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static httpd_handle_t serverHandle;
+/* Clientes e contadores acessados somente na task do servidor HTTP */
+static eventsClient_t clients[EVENTS_MAX_CLIENTS];
+static eventsStats_t stats;
+/* Frame em envio, copiado do anel, e sua forma SSE */
+static char frame[PLC_EVENTS_FRAME_SIZE];
+static char sseFrame[PLC_EVENTS_FRAME_SIZE + SSE_OVERHEAD];
+/* Lidos pelas tasks que publicam eventos */
+static uint32_t clientCount;
+static bool pushQueued;
+/* Nova tentativa para clientes com frames pendentes */
+static esp_timer_handle_t retryTimer;
+/* Identificador da execução, prefixo do id SSE */
+static uint32_t bootId;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void events_listener(uint32_t seq);
+static void retry_callback(void * arg);
+static void push_schedule(void);
+static void push_work(void * arg);
+static eventsClient_t * client_add(httpd_req_t * req, clientTransport_t transport, uint32_t nextSeq,
+                                   uint32_t backlogSeq);
+static void client_session_closed(void * ctxPtr);
+static void client_drop(eventsClient_t * clientPtr, uint32_t * counterPtr);
+static void client_send_next(eventsClient_t * clientPtr);
+static int32_t sse_format(uint32_t seq, const char * framePtr, int32_t length);
+static bool socket_writable(int fd);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa canais de eventos e assina o anel de eventos PLC
+ * 
+ * @param server  servidor HTTP que atende os endpoints
+ */
+void events_controller_init(httpd_handle_t server)
+{
+  serverHandle = server;
+  bzero(clients, sizeof(clients));
+  bzero(&stats, sizeof(stats));
+  bootId = esp_random();
+
+  const esp_timer_create_args_t retryArgs = {
+    .callback = retry_callback,
+    .name = "events_retry",
+  };
+  esp_timer_create(&retryArgs, &retryTimer);
+
+  plc_events_init();
+  if (plc_events_add_listener(events_listener) == false)
+  {
+    ESP_LOGE(TAG, "No event listener available");
+  }
+}
+
+/**
+ * Endpoint WebSocket de eventos PLC. Após o handshake o cliente recebe um
+ * frame texto por evento publicado (formato em plc_events.h), o mesmo frame
+ * codificado é enviado a todos os clientes. Cliente lento, com mais de
+ * EVENTS_CLIENT_QUEUE frames pendentes, é desconectado e deve reconectar
+ * 
+ * @param req         requisição a ser respondida, handshake ou frame recebido
+ * @return esp_err_t  resultado da operação, falha encerra a sessão
+ */
+esp_err_t events_controller_ws(httpd_req_t * req)
+{
+  if (req->method == HTTP_GET)
+  {
+    /* Handshake concluído */
+    const uint32_t headSeq = plc_events_next_seq();
+    return (client_add(req, TRANSPORT_WS, headSeq, headSeq) != NULL) ? ESP_OK : ESP_FAIL;
+  }
+
+  /* Canal somente de envio, frames recebidos são descartados */
+  httpd_ws_frame_t wsFrame = { 0 };
+  esp_err_t result = httpd_ws_recv_frame(req, &wsFrame, 0);
+  if ((result != ESP_OK) || (wsFrame.len == 0))
+  {
+    return result;
+  }
+
+  if (wsFrame.len > WS_RECV_SIZE)
+  {
+    return ESP_FAIL;
+  }
+
+  uint8_t payload[WS_RECV_SIZE];
+  wsFrame.payload = payload;
+  return httpd_ws_recv_frame(req, &wsFrame, sizeof(payload));
+}
+
+/**
+ * Endpoint Server-Sent Events de eventos PLC, mesmos eventos do WebSocket:
+ *   id: 5f3a09c1-12
+ *   data: {"seq":12,"type":"join",...}
+ * O id é "<boot>-<seq>", boot sorteado a cada inicialização do gateway.
+ * Reconexão com Last-Event-ID recebe os eventos perdidos ainda no anel,
+ * enviados pela fila do cliente como os demais. Eventos já sobrescritos, id
+ * de outra inicialização ou malformado geram o evento "resync": o cliente
+ * deve recarregar /plc/topology e segue recebendo os eventos a partir dali
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, falha encerra a sessão
+ */
+esp_err_t events_controller_get_sse(httpd_req_t * req)
+{
+  const uint32_t headSeq = plc_events_next_seq();
+  uint32_t resumeSeq = headSeq;
+  bool resync = false;
+
+  char lastEventId[24];
+  const esp_err_t idResult = httpd_req_get_hdr_value_str(req, "Last-Event-ID", lastEventId, sizeof(lastEventId));
+  if (idResult != ESP_ERR_NOT_FOUND)
+  {
+    /* Sequência reinicia com o gateway, somente id da mesma execução retoma */
+    char * seqPtr = lastEventId;
+    const bool sameBoot = (idResult == ESP_OK) && (strtoul(lastEventId, &seqPtr, 16) == bootId) && (*seqPtr == '-');
+    const uint32_t lastSeq = sameBoot ? strtoul(seqPtr + 1, NULL, 10) : 0;
+    resync = (sameBoot == false) || (lastSeq >= headSeq) || ((lastSeq + 1) < plc_events_oldest_seq());
+    if (resync)
+    {
+      stats.sseResync++;
+    }
+    else
+    {
+      resumeSeq = lastSeq + 1;
+      stats.sseResumed++;
+    }
+  }
+
+  /* Eventos perdidos e os publicados a partir daqui seguem pela fila do cliente */
+  eventsClient_t * clientPtr = client_add(req, TRANSPORT_SSE, resumeSeq, headSeq);
+  if (clientPtr == NULL)
+  {
+    char retryAfter[12];
+    snprintf(retryAfter, sizeof(retryAfter), "%u", EVENTS_SSE_RETRY_MS / 1000);
+    httpd_resp_set_hdr(req, "Retry-After", retryAfter);
+    return http_util_send_response(req, HTTPD_503, "Too many event clients");
+  }
+
+  const int32_t length = snprintf(sseFrame, sizeof(sseFrame), "retry: %u\n\n%s", EVENTS_SSE_RETRY_MS,
+                                  resync ? sseResync : "");
+  const bool result = (httpd_send(req, sseHeader, sizeof(sseHeader) - 1) >= 0) &&
+                      (httpd_send(req, sseFrame, length) >= 0);
+
+  if (result == false)
+  {
+    /* Sessão encerrada pela falha, posição liberada aqui */
+    req->sess_ctx = NULL;
+    req->free_ctx = NULL;
+    client_session_closed(clientPtr);
+    return ESP_FAIL;
+  }
+
+  /* Resposta segue aberta, eventos enviados pela fila do cliente */
+  if (resumeSeq != headSeq)
+  {
+    push_schedule();
+  }
+  return ESP_OK;
+}
+
+/**
+ * Recupera contadores dos canais, chamada na task do servidor HTTP
+ * 
+ * @param statsPtr  estrutura de escrita
+ */
+void events_controller_get_stats(eventsStats_t * statsPtr)
+{
+  *statsPtr = stats;
+  for (uint32_t idx = 0; idx < EVENTS_MAX_CLIENTS; idx++)
+  {
+    if (clients[idx].used)
+    {
+      statsPtr->wsClients += (clients[idx].transport == TRANSPORT_WS) ? 1 : 0;
+      statsPtr->sseClients += (clients[idx].transport == TRANSPORT_SSE) ? 1 : 0;
+    }
+  }
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Notificação de evento publicado, executada na task do publicador
+ * 
+ * @param seq   sequência do evento
+ */
+static void events_listener(uint32_t seq)
+{
+  push_schedule();
+}
+
+/**
+ * Nova tentativa de envio aos clientes com frames pendentes
+ * 
+ * @param arg   não utilizado
+ */
+static void retry_callback(void * arg)
+{
+  push_schedule();
+}
+
+/**
+ * Agenda envio na task do servidor HTTP, publicações seguidas geram um
+ * único agendamento
+ * 
+ */
+static void push_schedule(void)
+{
+  if ((__atomic_load_n(&clientCount, __ATOMIC_RELAXED) == 0) ||
+      __atomic_exchange_n(&pushQueued, true, __ATOMIC_ACQ_REL))
+  {
+    return;
+  }
+
+  if (httpd_queue_work(serverHandle, push_work, NULL) != ESP_OK)
+  {
+    __atomic_store_n(&pushQueued, false, __ATOMIC_RELEASE);
+  }
+}
+
+/**
+ * Envia frames pendentes a cada cliente, sem bloquear a task do servidor
+ * HTTP: cliente com socket sem espaço de envio mantém os frames no anel
+ * até a próxima tentativa
+ * 
+ * @param arg   não utilizado
+ */
+static void push_work(void * arg)
+{
+  /* Eventos publicados a partir daqui geram novo agendamento */
+  __atomic_store_n(&pushQueued, false, __ATOMIC_RELEASE);
+
+  const uint32_t headSeq = plc_events_next_seq();
+  bool pending = false;
+
+  for (uint32_t idx = 0; idx < EVENTS_MAX_CLIENTS; idx++)
+  {
+    eventsClient_t * clientPtr = &clients[idx];
+    if ((clientPtr->used == false) || clientPtr->closing)
+    {
+      continue;
+    }
+
+    /* Eventos perdidos na reconexão não contam no atraso do cliente */
+    const bool inBacklog = (int32_t)(clientPtr->backlogSeq - clientPtr->nextSeq) > 0;
+    if ((headSeq - (inBacklog ? clientPtr->backlogSeq : clientPtr->nextSeq)) > EVENTS_CLIENT_QUEUE)
+    {
+      ESP_LOGW(TAG, "Dropping slow client %d", clientPtr->fd);
+      client_drop(clientPtr, &stats.droppedSlow);
+      continue;
+    }
+
+    while ((clientPtr->closing == false) && (clientPtr->nextSeq != headSeq) && socket_writable(clientPtr->fd))
+    {
+      client_send_next(clientPtr);
+    }
+
+    pending |= (clientPtr->closing == false) && (clientPtr->nextSeq != headSeq);
+  }
+
+  if (pending)
+  {
+    /* Falha quando já agendada */
+    esp_timer_start_once(retryTimer, EVENTS_RETRY_MS * 1000);
+  }
+}
+
+/**
+ * Registra cliente como contexto da sessão HTTP
+ * 
+ * @param req                 requisição do cliente
+ * @param transport           transporte do cliente
+ * @param nextSeq             primeiro evento enviado pela fila do cliente
+ * @param backlogSeq          fim dos eventos perdidos na reconexão, nextSeq = nenhum
+ * @return eventsClient_t*    cliente registrado, NULL = todos ocupados
+ */
+static eventsClient_t * client_add(httpd_req_t * req, clientTransport_t transport, uint32_t nextSeq,
+                                   uint32_t backlogSeq)
+{
+  eventsClient_t * clientPtr = NULL;
+  for (uint32_t idx = 0; (idx < EVENTS_MAX_CLIENTS) && (clientPtr == NULL); idx++)
+  {
+    if (clients[idx].used == false)
+    {
+      clientPtr = &clients[idx];
+    }
+  }
+
+  if (clientPtr == NULL)
+  {
+    ESP_LOGW(TAG, "Client limit reached");
+    return NULL;
+  }
+
+  clientPtr->used = true;
+  clientPtr->closing = false;
+  clientPtr->transport = transport;
+  clientPtr->fd = httpd_req_to_sockfd(req);
+  clientPtr->nextSeq = nextSeq;
+  clientPtr->backlogSeq = backlogSeq;
+  __atomic_fetch_add(&clientCount, 1, __ATOMIC_RELAXED);
+
+  /* Liberado pelo servidor ao encerrar a sessão, por qualquer motivo */
+  req->sess_ctx = clientPtr;
+  req->free_ctx = client_session_closed;
+  return clientPtr;
+}
+
+/**
+ * Libera posição do cliente, executada pelo servidor ao encerrar a sessão
+ * 
+ * @param ctxPtr  cliente da sessão
+ */
+static void client_session_closed(void * ctxPtr)
+{
+  eventsClient_t * clientPtr = ctxPtr;
+  clientPtr->used = false;
+  __atomic_fetch_sub(&clientCount, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Solicita encerramento da sessão do cliente
+ * 
+ * @param clientPtr   cliente
+ * @param counterPtr  contador do motivo
+ */
+static void client_drop(eventsClient_t * clientPtr, uint32_t * counterPtr)
+{
+  clientPtr->closing = true;
+  (*counterPtr)++;
+  httpd_sess_trigger_close(serverHandle, clientPtr->fd);
+}
+
+/**
+ * Envia próximo frame pendente do cliente
+ * 
+ * @param clientPtr   cliente
+ */
+static void client_send_next(eventsClient_t * clientPtr)
+{
+  const int32_t length = plc_events_read(clientPtr->nextSeq, frame, sizeof(frame));
+  if (length < 0)
+  {
+    /*
+     * Sobrescrito no anel antes do envio, somente nos eventos perdidos da
+     * reconexão (atraso limitado a EVENTS_CLIENT_QUEUE). Segue do evento
+     * mais antigo ainda no anel, cliente SSE avisado com "resync"
+     */
+    uint32_t oldestSeq = plc_events_oldest_seq();
+    if ((int32_t)(oldestSeq - clientPtr->nextSeq) <= 0)
+    {
+      client_drop(clientPtr, &stats.droppedSlow);
+      return;
+    }
+
+    if ((clientPtr->transport == TRANSPORT_SSE) &&
+        (httpd_socket_send(serverHandle, clientPtr->fd, sseResync, sizeof(sseResync) - 1, 0) !=
+         (int)(sizeof(sseResync) - 1)))
+    {
+      client_drop(clientPtr, &stats.droppedError);
+      return;
+    }
+
+    clientPtr->nextSeq = oldestSeq;
+    if (clientPtr->transport == TRANSPORT_SSE)
+    {
+      stats.sseResync++;
+    }
+    return;
+  }
+
+  bool sent;
+  if (clientPtr->transport == TRANSPORT_WS)
+  {
+    httpd_ws_frame_t wsFrame = {
+      .final = true,
+      .type = HTTPD_WS_TYPE_TEXT,
+      .payload = (uint8_t *)frame,
+      .len = length,
+    };
+    sent = httpd_ws_send_frame_async(serverHandle, clientPtr->fd, &wsFrame) == ESP_OK;
+  }
+  else
+  {
+    const int32_t sseLength = sse_format(clientPtr->nextSeq, frame, length);
+    sent = httpd_socket_send(serverHandle, clientPtr->fd, sseFrame, sseLength, 0) == sseLength;
+  }
+
+  if (sent == false)
+  {
+    client_drop(clientPtr, &stats.droppedError);
+    return;
+  }
+
+  clientPtr->nextSeq++;
+  stats.framesSent++;
+}
+
+/**
+ * Monta evento SSE em sseFrame
+ * 
+ * @param seq       sequência do evento, id do evento SSE com o boot
+ * @param framePtr  frame JSON do evento
+ * @param length    tamanho do frame, <= 0 = evento indisponível
+ * @return int32_t  tamanho do evento SSE, -1 = evento indisponível
+ */
+static int32_t sse_format(uint32_t seq, const char * framePtr, int32_t length)
+{
+  if (length <= 0)
+  {
+    return -1;
+  }
+
+  return snprintf(sseFrame, sizeof(sseFrame), "id: %08x-%u\ndata: %.*s\n\n", bootId, seq,
+                  (int)length, framePtr);
+}
+
+/**
+ * Verifica, sem bloquear, se o socket aceita novos dados
+ * 
+ * @param fd      socket da sessão
+ * @return true   espaço de envio disponível
+ * @return false  buffer de envio cheio, cliente não está consumindo
+ */
+static bool socket_writable(int fd)
+{
+  fd_set writeSet;
+  FD_ZERO(&writeSet);
+  FD_SET(fd, &writeSet);
+  struct timeval timeout = { 0 };
+
+  return select(fd + 1, NULL, &writeSet, NULL, &timeout) > 0;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
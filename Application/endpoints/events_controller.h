@@ -0,0 +1,66 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef EVENTS_CONTROLLER_H
+#define EVENTS_CONTROLLER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <esp_http_server.h>
+#include <stdint.h>
+
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Clientes simultâneos, WebSocket e SSE somados. Cada cliente ocupa uma
+ * sessão do servidor (max_open_sockets), com lru_purge_enable o cliente
+ * ocioso mais antigo pode ser desconectado quando as sessões acabam
+ */
+#define EVENTS_MAX_CLIENTS    3
+/*
+ * Frames pendentes por cliente, lidos do anel de eventos compartilhado.
+ * Cliente mais atrasado que isso é desconectado, deve ser menor que
+ * PLC_EVENTS_RING_SIZE para o atraso ser detectado antes da sobrescrita
+ */
+#define EVENTS_CLIENT_QUEUE   16
+/* Nova tentativa de envio aos clientes com frames pendentes, em milissegundos */
+#define EVENTS_RETRY_MS       100
+/* Intervalo de reconexão sugerido aos clientes SSE, em milissegundos */
+#define EVENTS_SSE_RETRY_MS   2000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Contadores dos canais de eventos */
+typedef struct eventsStats_t
+{
+  uint32_t wsClients;
+  uint32_t sseClients;
+  uint32_t framesSent;
+  /* Reconexões SSE atendidas a partir do Last-Event-ID */
+  uint32_t sseResumed;
+  /* Reconexões SSE com eventos perdidos, cliente deve recarregar o estado */
+  uint32_t sseResync;
+  /* Desconectados por atraso acima de EVENTS_CLIENT_QUEUE */
+  uint32_t droppedSlow;
+  /* Desconectados por falha de envio */
+  uint32_t droppedError;
+} eventsStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void events_controller_init(httpd_handle_t server);
+esp_err_t events_controller_ws(httpd_req_t * req);
+esp_err_t events_controller_get_sse(httpd_req_t * req);
+void events_controller_get_stats(eventsStats_t * statsPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -11,6 +11,7 @@
 *******************************************************************************/
 #include "http_util.h"
 #include "json_buffer.h"
+#include <stdio.h>
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
@@ -30,6 +31,7 @@
 /*******************************************************************************
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
+static esp_err_t chunk_send(httpChunkWriter_t * writerPtr, const char * dataPtr, size_t length);
 
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
@@ -174,10 +176,235 @@ bool close_json(cJSON * root, char *bufferOutPtr, size_t sizeBufferOut)
 
   return result;
 }
+
+/**
+ * Inicializa escritor de resposta em blocos
+ * 
+ * @param writerPtr   escritor a ser inicializado
+ * @param reqPtr      requisição a ser respondida
+ * @param bufferPtr   buffer de acumulação dos dados
+ * @param bufferSize  tamanho disponível no buffer
+ */
+void http_util_chunk_begin(httpChunkWriter_t * writerPtr, httpd_req_t * reqPtr, char * bufferPtr, size_t bufferSize)
+{
+  writerPtr->reqPtr = reqPtr;
+  writerPtr->serverHandle = NULL;
+  writerPtr->fd = -1;
+  writerPtr->bufferPtr = bufferPtr;
+  writerPtr->bufferSize = bufferSize;
+  writerPtr->used = 0;
+  writerPtr->result = ESP_OK;
+}
+
+/**
+ * Inicializa escritor de resposta em blocos enviada diretamente no socket de
+ * uma sessão, fora do handler da requisição. Linha de status e cabeçalhos
+ * (com Transfer-Encoding: chunked) já enviados pelo chamador
+ * 
+ * @param writerPtr     escritor a ser inicializado
+ * @param serverHandle  servidor dono da sessão
+ * @param fd            socket da sessão
+ * @param bufferPtr     buffer de acumulação dos dados
+ * @param bufferSize    tamanho disponível no buffer
+ */
+void http_util_chunk_begin_socket(httpChunkWriter_t * writerPtr, httpd_handle_t serverHandle, int fd,
+                                  char * bufferPtr, size_t bufferSize)
+{
+  http_util_chunk_begin(writerPtr, NULL, bufferPtr, bufferSize);
+  writerPtr->serverHandle = serverHandle;
+  writerPtr->fd = fd;
+}
+
+/**
+ * Acumula dados no buffer, enviando um bloco somente quando não há espaço
+ * 
+ * @param writerPtr   escritor em uso
+ * @param dataPtr     dados a serem escritos
+ * @param length      tamanho dos dados
+ * @return esp_err_t  resultado acumulado dos envios, sucesso = ESP_OK
+ */
+esp_err_t http_util_chunk_write(httpChunkWriter_t * writerPtr, const char * dataPtr, size_t length)
+{
+  while ((writerPtr->result == ESP_OK) && (length != 0))
+  {
+    size_t available = writerPtr->bufferSize - writerPtr->used;
+    if (available == 0)
+    {
+      /* Buffer cheio, envia bloco acumulado */
+      writerPtr->result = chunk_send(writerPtr, writerPtr->bufferPtr, writerPtr->used);
+      writerPtr->used = 0;
+      continue;
+    }
+
+    size_t toCopy = length < available ? length : available;
+    memcpy(&writerPtr->bufferPtr[writerPtr->used], dataPtr, toCopy);
+    writerPtr->used += toCopy;
+    dataPtr += toCopy;
+    length -= toCopy;
+  }
+
+  return writerPtr->result;
+}
+
+/**
+ * Formata dados diretamente no buffer do escritor, enviando bloco caso necessário
+ * 
+ * @param writerPtr   escritor em uso
+ * @param formatPtr   formato no padrão printf
+ * @return esp_err_t  resultado acumulado dos envios, sucesso = ESP_OK
+ */
+esp_err_t http_util_chunk_printf(httpChunkWriter_t * writerPtr, const char * formatPtr, ...)
+{
+  for (uint32_t attempt = 0; (writerPtr->result == ESP_OK) && (attempt < 2); attempt++)
+  {
+    size_t available = writerPtr->bufferSize - writerPtr->used;
+    va_list args;
+    va_start(args, formatPtr);
+    int32_t length = vsnprintf(&writerPtr->bufferPtr[writerPtr->used], available, formatPtr, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+      writerPtr->result = ESP_FAIL;
+      break;
+    }
+
+    if ((size_t)length < available)
+    {
+      /* Formatado por completo no espaço restante */
+      writerPtr->used += length;
+      break;
+    }
+
+    if (writerPtr->used == 0)
+    {
+      /* Não cabe nem com o buffer vazio */
+      writerPtr->result = ESP_FAIL;
+      break;
+    }
+
+    /* Sem espaço, envia bloco acumulado e formata novamente */
+    writerPtr->result = chunk_send(writerPtr, writerPtr->bufferPtr, writerPtr->used);
+    writerPtr->used = 0;
+  }
+
+  return writerPtr->result;
+}
+
+/**
+ * Escreve texto como string JSON, entre aspas e com caracteres de controle,
+ * aspas e barra invertida escapados
+ * 
+ * @param writerPtr   escritor em uso
+ * @param textPtr     texto a ser escrito
+ * @return esp_err_t  resultado acumulado dos envios, sucesso = ESP_OK
+ */
+esp_err_t http_util_chunk_json_string(httpChunkWriter_t * writerPtr, const char * textPtr)
+{
+  http_util_chunk_write(writerPtr, "\"", 1);
+  for (const char * runPtr = textPtr; *textPtr != '\0'; runPtr = textPtr)
+  {
+    /* Trecho sem escape copiado de uma vez */
+    while ((*textPtr != '\0') && (*textPtr != '"') && (*textPtr != '\\') && ((uint8_t)*textPtr >= 0x20))
+    {
+      textPtr++;
+    }
+    http_util_chunk_write(writerPtr, runPtr, textPtr - runPtr);
+
+    if (*textPtr != '\0')
+    {
+      http_util_chunk_printf(writerPtr, ((*textPtr == '"') || (*textPtr == '\\')) ? "\\%c" : "\\u%04x",
+                             (uint8_t)*textPtr);
+      textPtr++;
+    }
+  }
+
+  return http_util_chunk_write(writerPtr, "\"", 1);
+}
+
+/**
+ * Escreve body JSON de mensagem, mesmo formato de http_util_send_response
+ * 
+ * @param writerPtr     escritor em uso
+ * @param httpCode      código HTTP da mensagem
+ * @param messagePtr    mensagem a ser inserida no body JSON
+ * @return const char*  código HTTP recebido, para retorno direto
+ */
+const char * http_util_chunk_message(httpChunkWriter_t * writerPtr, const char * httpCode, const char * messagePtr)
+{
+  http_util_chunk_write(writerPtr, "{\"message\":", 11);
+  http_util_chunk_json_string(writerPtr, messagePtr);
+  http_util_chunk_write(writerPtr, "}", 1);
+  return httpCode;
+}
+
+/**
+ * Envia dados acumulados imediatamente, sem finalizar a resposta
+ * 
+ * @param writerPtr   escritor em uso
+ * @return esp_err_t  resultado acumulado dos envios, sucesso = ESP_OK
+ */
+esp_err_t http_util_chunk_flush(httpChunkWriter_t * writerPtr)
+{
+  if ((writerPtr->result == ESP_OK) && (writerPtr->used != 0))
+  {
+    writerPtr->result = chunk_send(writerPtr, writerPtr->bufferPtr, writerPtr->used);
+    writerPtr->used = 0;
+  }
+
+  return writerPtr->result;
+}
+
+/**
+ * Envia dados pendentes e finaliza resposta em blocos
+ * 
+ * @param writerPtr   escritor em uso
+ * @return esp_err_t  resultado acumulado dos envios, sucesso = ESP_OK
+ */
+esp_err_t http_util_chunk_end(httpChunkWriter_t * writerPtr)
+{
+  http_util_chunk_flush(writerPtr);
+
+  if (writerPtr->result == ESP_OK)
+  {
+    /* Bloco vazio sinaliza fim da resposta */
+    writerPtr->result = chunk_send(writerPtr, NULL, 0);
+  }
+
+  return writerPtr->result;
+}
 /*******************************************************************************
 * FUNÇÕES LOCAIS
 *******************************************************************************/
 
+/**
+ * Envia um bloco pela requisição ou, sem requisição, com o enquadramento
+ * chunked diretamente no socket da sessão
+ * 
+ * @param writerPtr   escritor em uso
+ * @param dataPtr     dados do bloco
+ * @param length      tamanho do bloco, 0 = fim da resposta
+ * @return esp_err_t  resultado do envio, sucesso = ESP_OK
+ */
+static esp_err_t chunk_send(httpChunkWriter_t * writerPtr, const char * dataPtr, size_t length)
+{
+  if (writerPtr->reqPtr != NULL)
+  {
+    return httpd_resp_send_chunk(writerPtr->reqPtr, dataPtr, length);
+  }
+
+  char sizeLine[12];
+  const int32_t sizeLength = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned int)length);
+  bool sent = httpd_socket_send(writerPtr->serverHandle, writerPtr->fd, sizeLine, sizeLength, 0) == sizeLength;
+  if (sent && (length != 0))
+  {
+    sent = httpd_socket_send(writerPtr->serverHandle, writerPtr->fd, dataPtr, length, 0) == (int)length;
+  }
+  sent = sent && (httpd_socket_send(writerPtr->serverHandle, writerPtr->fd, "\r\n", 2, 0) == 2);
+
+  return sent ? ESP_OK : ESP_FAIL;
+}
+
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
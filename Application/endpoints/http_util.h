@@ -14,13 +14,47 @@
 #include <esp_http_server.h>
 #include "cJSON.h"
 #include <stdbool.h>
+#include <stdarg.h>
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Códigos HTTP sem definição no esp_http_server */
+#ifndef HTTPD_202
+#define HTTPD_202   "202 Accepted"
+#endif
+#ifndef HTTPD_409
+#define HTTPD_409   "409 Conflict"
+#endif
+#ifndef HTTPD_422
+#define HTTPD_422   "422 Unprocessable Entity"
+#endif
+#ifndef HTTPD_503
+#define HTTPD_503   "503 Service Unavailable"
+#endif
+#ifndef HTTPD_504
+#define HTTPD_504   "504 Gateway Timeout"
+#endif
 
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
+/* Escritor de resposta HTTP em blocos (chunked) sobre um buffer estático */
+typedef struct httpChunkWriter_t
+{
+  /* Requisição a ser respondida, NULL = envio direto no socket da sessão */
+  httpd_req_t * reqPtr;
+  /* Servidor e socket da sessão, resposta enviada fora do handler */
+  httpd_handle_t serverHandle;
+  int fd;
+  /* Buffer de acumulação dos dados antes do envio */
+  char * bufferPtr;
+  /* Tamanho total do buffer */
+  size_t bufferSize;
+  /* Quantidade de bytes acumulados e ainda não enviados */
+  size_t used;
+  /* Resultado acumulado dos envios, sucesso = ESP_OK */
+  esp_err_t result;
+} httpChunkWriter_t;
 
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
@@ -30,6 +64,15 @@ esp_err_t http_read_body(httpd_req_t * req, char * bufferOutPtr, size_t bufferOu
 esp_err_t get_json_string_value(cJSON * root, const char * key, char * fieldPtr, size_t sizeField);
 esp_err_t get_json_int_value(cJSON * root, const char * key, uint32_t * fieldPtr);
 bool close_json(cJSON * root, char *bufferOutPtr, size_t sizeBufferOut);
+void http_util_chunk_begin(httpChunkWriter_t * writerPtr, httpd_req_t * reqPtr, char * bufferPtr, size_t bufferSize);
+void http_util_chunk_begin_socket(httpChunkWriter_t * writerPtr, httpd_handle_t serverHandle, int fd,
+                                  char * bufferPtr, size_t bufferSize);
+esp_err_t http_util_chunk_write(httpChunkWriter_t * writerPtr, const char * dataPtr, size_t length);
+esp_err_t http_util_chunk_printf(httpChunkWriter_t * writerPtr, const char * formatPtr, ...);
+esp_err_t http_util_chunk_json_string(httpChunkWriter_t * writerPtr, const char * textPtr);
+const char * http_util_chunk_message(httpChunkWriter_t * writerPtr, const char * httpCode, const char * messagePtr);
+esp_err_t http_util_chunk_flush(httpChunkWriter_t * writerPtr);
+esp_err_t http_util_chunk_end(httpChunkWriter_t * writerPtr);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -0,0 +1,307 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "idempotency.h"
+#include <string.h>
+#include "http_util.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Maior URI guardada junto da chave */
+#define URI_SIZE        32
+/* Hash FNV-1a 32 bits do body */
+#define FNV_OFFSET      2166136261U
+#define FNV_PRIME       16777619U
+
+typedef enum entryState_t
+{
+  ENTRY_FREE = 0,
+  /* Requisição original em execução */
+  ENTRY_IN_FLIGHT,
+  /* Resultado guardado até IDEMPOTENCY_TTL_MS */
+  ENTRY_DONE,
+} entryState_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct cacheEntry_t
+{
+  entryState_t state;
+  /* Incrementado a cada reserva, invalida repetições de uma reserva anterior */
+  uint32_t generation;
+  int64_t completedUs;
+  int64_t lastUsedUs;
+  char uri[URI_SIZE];
+  char key[IDEMPOTENCY_KEY_SIZE];
+  /* Hash do body da requisição original, repetição com outro body recusada */
+  uint32_t bodyHash;
+  /* Código e tipo apontam para constantes, body copiado */
+  const char * statusPtr;
+  const char * typePtr;
+  bool bodyValid;
+  char body[IDEMPOTENCY_BODY_SIZE];
+} cacheEntry_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static cacheEntry_t entries[IDEMPOTENCY_CACHE_SIZE];
+static SemaphoreHandle_t cacheMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static cacheEntry_t * entry_find(const char * uriPtr, const char * keyPtr, int64_t now);
+static cacheEntry_t * entry_reserve(int64_t now);
+static esp_err_t entry_replay(httpd_req_t * req, const cacheEntry_t * entryPtr);
+static uint32_t body_hash(const char * bodyPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa cache
+ * 
+ */
+void idempotency_init(void)
+{
+  bzero(entries, sizeof(entries));
+  cacheMutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * Verifica Idempotency-Key da requisição antes da execução, após a leitura
+ * do body. Sem chave, ou com o cache ocupado por requisições em andamento,
+ * executa sem cache
+ * 
+ * @param req         requisição recebida
+ * @param bodyPtr     body lido da requisição
+ * @param ticketPtr   reserva a ser finalizada com idempotency_finish
+ * @return true       requisição deve ser executada
+ * @return false      resposta já enviada: resultado guardado, chave inválida ou reutilizada
+ */
+bool idempotency_begin(httpd_req_t * req, const char * bodyPtr, idempotencyTicket_t * ticketPtr)
+{
+  ticketPtr->slot = -1;
+
+  const size_t keyLength = httpd_req_get_hdr_value_len(req, IDEMPOTENCY_HEADER);
+  if ((keyLength == 0) || (cacheMutex == NULL))
+  {
+    return true;
+  }
+
+  char key[IDEMPOTENCY_KEY_SIZE];
+  if ((keyLength >= sizeof(key)) || (strlen(req->uri) >= URI_SIZE) ||
+      (httpd_req_get_hdr_value_str(req, IDEMPOTENCY_HEADER, key, sizeof(key)) != ESP_OK))
+  {
+    http_util_send_response(req, HTTPD_400, "Invalid Idempotency-Key");
+    return false;
+  }
+
+  const uint32_t bodyHash = body_hash(bodyPtr);
+  const int64_t now = esp_timer_get_time();
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  cacheEntry_t * entryPtr = entry_find(req->uri, key, now);
+  if (entryPtr != NULL)
+  {
+    if (entryPtr->bodyHash != bodyHash)
+    {
+      /* Mesma chave com outra requisição, resultado guardado não corresponde */
+      xSemaphoreGive(cacheMutex);
+      http_util_send_response(req, HTTPD_422, "Idempotency-Key reused with a different body");
+      return false;
+    }
+
+    entryPtr->lastUsedUs = now;
+    if (entryPtr->state == ENTRY_DONE)
+    {
+      /* Resultado guardado, body copiado para a resposta fora do mutex */
+      const cacheEntry_t copy = *entryPtr;
+      xSemaphoreGive(cacheMutex);
+      entry_replay(req, &copy);
+      return false;
+    }
+
+    /*
+     * Em andamento: o servidor HTTP atende uma requisição por vez e os
+     * handlers finalizam a reserva antes de retornar, caminho mantido
+     * somente contra uma reserva não finalizada
+     */
+    xSemaphoreGive(cacheMutex);
+    http_util_send_response(req, HTTPD_409, "Request with this Idempotency-Key not completed");
+    return false;
+  }
+
+  entryPtr = entry_reserve(now);
+  if (entryPtr != NULL)
+  {
+    entryPtr->state = ENTRY_IN_FLIGHT;
+    entryPtr->generation++;
+    entryPtr->lastUsedUs = now;
+    entryPtr->bodyValid = false;
+    entryPtr->bodyHash = bodyHash;
+    strcpy(entryPtr->uri, req->uri);
+    strcpy(entryPtr->key, key);
+    ticketPtr->slot = entryPtr - entries;
+    ticketPtr->generation = entryPtr->generation;
+  }
+  xSemaphoreGive(cacheMutex);
+
+  return true;
+}
+
+/**
+ * Guarda resultado de uma requisição executada após idempotency_begin.
+ * Chamada após o envio da resposta, em todos os caminhos de retorno
+ * 
+ * @param ticketPtr   reserva da requisição
+ * @param statusPtr   código HTTP enviado, constante
+ * @param typePtr     tipo do conteúdo enviado, constante, NULL = padrão
+ * @param bodyPtr     body enviado
+ */
+void idempotency_finish(idempotencyTicket_t * ticketPtr, const char * statusPtr, const char * typePtr,
+                        const char * bodyPtr)
+{
+  if (ticketPtr->slot < 0)
+  {
+    return;
+  }
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  cacheEntry_t * entryPtr = &entries[ticketPtr->slot];
+  if (entryPtr->generation == ticketPtr->generation)
+  {
+    entryPtr->statusPtr = statusPtr;
+    entryPtr->typePtr = typePtr;
+    entryPtr->bodyValid = strlen(bodyPtr) < sizeof(entryPtr->body);
+    if (entryPtr->bodyValid)
+    {
+      strcpy(entryPtr->body, bodyPtr);
+    }
+
+    /* Falhas do servidor ou do módulo podem ser repetidas com a mesma chave */
+    entryPtr->completedUs = esp_timer_get_time();
+    entryPtr->state = (entryPtr->bodyValid && (statusPtr[0] != '5')) ? ENTRY_DONE : ENTRY_FREE;
+  }
+  xSemaphoreGive(cacheMutex);
+
+  ticketPtr->slot = -1;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Localiza chave válida no cache, chamada com cacheMutex
+ * 
+ * @param uriPtr          URI da requisição
+ * @param keyPtr          chave da requisição
+ * @param now             tempo atual
+ * @return cacheEntry_t*  entrada em andamento ou concluída, NULL = não encontrada
+ */
+static cacheEntry_t * entry_find(const char * uriPtr, const char * keyPtr, int64_t now)
+{
+  for (uint32_t slot = 0; slot < IDEMPOTENCY_CACHE_SIZE; slot++)
+  {
+    cacheEntry_t * entryPtr = &entries[slot];
+    const bool expired = (entryPtr->state == ENTRY_DONE) &&
+                         ((now - entryPtr->completedUs) >= ((int64_t)IDEMPOTENCY_TTL_MS * 1000));
+    if (((entryPtr->state == ENTRY_IN_FLIGHT) || ((entryPtr->state == ENTRY_DONE) && (expired == false))) &&
+        (strcmp(entryPtr->key, keyPtr) == 0) && (strcmp(entryPtr->uri, uriPtr) == 0))
+    {
+      return entryPtr;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Seleciona entrada para uma nova chave: livre ou expirada, senão a
+ * concluída usada há mais tempo. Chamada com cacheMutex
+ * 
+ * @param now             tempo atual
+ * @return cacheEntry_t*  entrada selecionada, NULL = todas em andamento
+ */
+static cacheEntry_t * entry_reserve(int64_t now)
+{
+  cacheEntry_t * selectedPtr = NULL;
+  for (uint32_t slot = 0; slot < IDEMPOTENCY_CACHE_SIZE; slot++)
+  {
+    cacheEntry_t * entryPtr = &entries[slot];
+    if (entryPtr->state == ENTRY_IN_FLIGHT)
+    {
+      continue;
+    }
+
+    if ((entryPtr->state != ENTRY_DONE) ||
+        ((now - entryPtr->completedUs) >= ((int64_t)IDEMPOTENCY_TTL_MS * 1000)))
+    {
+      return entryPtr;
+    }
+
+    if ((selectedPtr == NULL) || (entryPtr->lastUsedUs < selectedPtr->lastUsedUs))
+    {
+      selectedPtr = entryPtr;
+    }
+  }
+
+  return selectedPtr;
+}
+
+/**
+ * Envia resultado guardado
+ * 
+ * @param req         requisição repetida
+ * @param entryPtr    cópia da entrada concluída
+ * @return esp_err_t  resultado do envio, sucesso = ESP_OK
+ */
+static esp_err_t entry_replay(httpd_req_t * req, const cacheEntry_t * entryPtr)
+{
+  httpd_resp_set_status(req, entryPtr->statusPtr);
+  if (entryPtr->typePtr != NULL)
+  {
+    httpd_resp_set_type(req, entryPtr->typePtr);
+  }
+  httpd_resp_set_hdr(req, "Idempotent-Replayed", "true");
+  return httpd_resp_send(req, entryPtr->body, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * Calcula hash FNV-1a do body da requisição
+ * 
+ * @param bodyPtr     body lido da requisição
+ * @return uint32_t   hash do body
+ */
+static uint32_t body_hash(const char * bodyPtr)
+{
+  uint32_t hash = FNV_OFFSET;
+  for (; *bodyPtr != '\0'; bodyPtr++)
+  {
+    hash = (hash ^ (uint8_t)*bodyPtr) * FNV_PRIME;
+  }
+
+  return hash;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
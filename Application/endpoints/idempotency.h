@@ -0,0 +1,56 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef IDEMPOTENCY_H
+#define IDEMPOTENCY_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <esp_http_server.h>
+#include <stdint.h>
+#include <stdbool.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Cache de resultados por header Idempotency-Key, escopo da chave = URI.
+ * Repetição de uma requisição já concluída, com o mesmo body, recebe o
+ * resultado guardado sem novo envio na UART; com outro body recebe 422.
+ * Resultados 5xx não são guardados, a repetição executa de novo
+ */
+#define IDEMPOTENCY_HEADER        "Idempotency-Key"
+/* Entradas do cache, substituídas por LRU */
+#define IDEMPOTENCY_CACHE_SIZE    16
+/* Maior chave aceita, com terminador */
+#define IDEMPOTENCY_KEY_SIZE      64
+/* Maior body guardado, com terminador. Respostas maiores não são guardadas */
+#define IDEMPOTENCY_BODY_SIZE     256
+/* Validade de um resultado guardado */
+#define IDEMPOTENCY_TTL_MS        120000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Entrada reservada por uma requisição com chave, slot < 0 = sem chave */
+typedef struct idempotencyTicket_t
+{
+  int32_t slot;
+  uint32_t generation;
+} idempotencyTicket_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void idempotency_init(void);
+bool idempotency_begin(httpd_req_t * req, const char * bodyPtr, idempotencyTicket_t * ticketPtr);
+void idempotency_finish(idempotencyTicket_t * ticketPtr, const char * statusPtr, const char * typePtr,
+                        const char * bodyPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,603 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "metrics_controller.h"
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "http_util.h"
+#include "json_buffer.h"
+#include "plc_uart.h"
+#include "plc_uart_stats.h"
+#include "plc_health.h"
+#include "plc_io_queue.h"
+#include "plc_events.h"
+#include "events_controller.h"
+#include "udp_server.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Faixas do histograma de latência HTTP, em milissegundos. +Inf implícito */
+#define HTTP_LATENCY_BUCKETS  10
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Métricas de um endpoint, atualizadas com operações atômicas */
+typedef struct endpointMetrics_t
+{
+  uint32_t buckets[HTTP_LATENCY_BUCKETS];
+  uint32_t requests;
+  uint32_t errors;
+  /* Recusadas pelo controle de admissão, fora das demais métricas */
+  uint32_t rejected;
+  uint64_t latencySumUs;
+} endpointMetrics_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+/* Limite superior de cada faixa, em milissegundos */
+static const uint32_t latencyBucketsMs[HTTP_LATENCY_BUCKETS] = {
+  1, 5, 10, 25, 50, 100, 250, 500, 1000, 2500
+};
+
+/* Tasks monitoradas pela marca d'água da pilha */
+static const char * const taskNames[] = {
+  "plc_uart_task",
+  "plc_uart_task_1",
+  "plc_health_task",
+  "plc_io_queue_task",
+  "plc_jobs_task",
+  "plc_topology_task",
+  "udp_server_task",
+  "plc_app_task",
+  "wifi_app_task",
+  "wifi_config_task",
+};
+
+/* Percentis exportados das etapas UART, em milésimos, e seus rótulos */
+static const uint32_t uartQuantiles[] = { 500, 900, 990 };
+static const char * const uartQuantileLabels[] = { "0.5", "0.9", "0.99" };
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Tabela de endpoints registrada no servidor HTTP */
+static const httpd_uri_t * endpointTablePtr;
+static uint32_t endpointTableCount;
+static endpointMetrics_t endpointMetrics[METRICS_MAX_ENDPOINTS];
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void http_metrics_write(httpChunkWriter_t * writerPtr);
+static void uart_metrics_write(httpChunkWriter_t * writerPtr);
+static void health_metrics_write(httpChunkWriter_t * writerPtr);
+static void io_queue_metrics_write(httpChunkWriter_t * writerPtr);
+static void events_metrics_write(httpChunkWriter_t * writerPtr);
+static void udp_metrics_write(httpChunkWriter_t * writerPtr);
+static void system_metrics_write(httpChunkWriter_t * writerPtr);
+static void seconds_write(httpChunkWriter_t * writerPtr, uint64_t valueUs);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Associa tabela de endpoints às métricas, índice da tabela identifica o endpoint
+ * 
+ * @param endpointsPtr    tabela de endpoints do servidor HTTP
+ * @param endpointCount   quantidade de endpoints na tabela
+ */
+void metrics_controller_init(const httpd_uri_t * endpointsPtr, uint32_t endpointCount)
+{
+  endpointTablePtr = endpointsPtr;
+  endpointTableCount = endpointCount < METRICS_MAX_ENDPOINTS ? endpointCount : METRICS_MAX_ENDPOINTS;
+}
+
+/**
+ * Contabiliza requisição atendida por um endpoint
+ * 
+ * @param endpointIndex   índice do endpoint na tabela
+ * @param elapsedUs       duração do tratamento em microssegundos
+ * @param result          retorno do handler
+ */
+void metrics_controller_record_request(uint32_t endpointIndex, int64_t elapsedUs, esp_err_t result)
+{
+  if (endpointIndex >= endpointTableCount)
+  {
+    return;
+  }
+
+  endpointMetrics_t * metricsPtr = &endpointMetrics[endpointIndex];
+  __atomic_fetch_add(&metricsPtr->requests, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&metricsPtr->latencySumUs, (uint64_t)elapsedUs, __ATOMIC_RELAXED);
+  if (result != ESP_OK)
+  {
+    __atomic_fetch_add(&metricsPtr->errors, 1, __ATOMIC_RELAXED);
+  }
+
+  for (uint32_t idx = 0; idx < HTTP_LATENCY_BUCKETS; idx++)
+  {
+    if (elapsedUs <= ((int64_t)latencyBucketsMs[idx] * 1000))
+    {
+      __atomic_fetch_add(&metricsPtr->buckets[idx], 1, __ATOMIC_RELAXED);
+      break;
+    }
+  }
+}
+
+/**
+ * Contabiliza requisição recusada pelo controle de admissão
+ * 
+ * @param endpointIndex   índice do endpoint na tabela
+ */
+void metrics_controller_record_rejected(uint32_t endpointIndex)
+{
+  if (endpointIndex < endpointTableCount)
+  {
+    __atomic_fetch_add(&endpointMetrics[endpointIndex].rejected, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * Envia métricas no formato texto do Prometheus, escritas em blocos
+ * sobre o buffer estático, sem alocação
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t metrics_controller_get(httpd_req_t * req)
+{
+  httpd_resp_set_type(req, "text/plain; version=0.0.4");
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_metrics_write(&writer);
+  uart_metrics_write(&writer);
+  health_metrics_write(&writer);
+  io_queue_metrics_write(&writer);
+  events_metrics_write(&writer);
+  udp_metrics_write(&writer);
+  system_metrics_write(&writer);
+
+  return http_util_chunk_end(&writer);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Escreve contadores e histogramas de latência por endpoint
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void http_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_http_requests_total Requisicoes atendidas por endpoint\n"
+                         "# TYPE powerline_http_requests_total counter\n");
+  for (uint32_t idx = 0; idx < endpointTableCount; idx++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_http_requests_total{uri=\"%s\",method=\"%s\"} %u\n",
+                           endpointTablePtr[idx].uri, http_method_str(endpointTablePtr[idx].method),
+                           endpointMetrics[idx].requests);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_http_request_errors_total Requisicoes com falha no handler\n"
+                         "# TYPE powerline_http_request_errors_total counter\n");
+  for (uint32_t idx = 0; idx < endpointTableCount; idx++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_http_request_errors_total{uri=\"%s\",method=\"%s\"} %u\n",
+                           endpointTablePtr[idx].uri, http_method_str(endpointTablePtr[idx].method),
+                           endpointMetrics[idx].errors);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_http_requests_rejected_total Requisicoes recusadas pelo controle de admissao\n"
+                         "# TYPE powerline_http_requests_rejected_total counter\n");
+  for (uint32_t idx = 0; idx < endpointTableCount; idx++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_http_requests_rejected_total{uri=\"%s\",method=\"%s\"} %u\n",
+                           endpointTablePtr[idx].uri, http_method_str(endpointTablePtr[idx].method),
+                           endpointMetrics[idx].rejected);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_http_request_duration_seconds Duracao do tratamento por endpoint\n"
+                         "# TYPE powerline_http_request_duration_seconds histogram\n");
+  for (uint32_t idx = 0; idx < endpointTableCount; idx++)
+  {
+    const char * uriPtr = endpointTablePtr[idx].uri;
+    const char * methodPtr = http_method_str(endpointTablePtr[idx].method);
+    const endpointMetrics_t * metricsPtr = &endpointMetrics[idx];
+
+    /* Faixas acumuladas, conforme formato Prometheus */
+    uint32_t accumulated = 0;
+    for (uint32_t bucket = 0; bucket < HTTP_LATENCY_BUCKETS; bucket++)
+    {
+      accumulated += metricsPtr->buckets[bucket];
+      http_util_chunk_printf(writerPtr,
+                             "powerline_http_request_duration_seconds_bucket{uri=\"%s\",method=\"%s\",le=\"%u.%03u\"} %u\n",
+                             uriPtr, methodPtr, latencyBucketsMs[bucket] / 1000,
+                             latencyBucketsMs[bucket] % 1000, accumulated);
+    }
+    http_util_chunk_printf(writerPtr,
+                           "powerline_http_request_duration_seconds_bucket{uri=\"%s\",method=\"%s\",le=\"+Inf\"} %u\n"
+                           "powerline_http_request_duration_seconds_sum{uri=\"%s\",method=\"%s\"} ",
+                           uriPtr, methodPtr, metricsPtr->requests, uriPtr, methodPtr);
+    seconds_write(writerPtr, metricsPtr->latencySumUs);
+    http_util_chunk_printf(writerPtr,
+                           "\npowerline_http_request_duration_seconds_count{uri=\"%s\",method=\"%s\"} %u\n",
+                           uriPtr, methodPtr, metricsPtr->requests);
+  }
+}
+
+/**
+ * Escreve desfechos, retries, profundidade de fila e latências da UART PLC
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void uart_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_uart_commands_total Comandos UART por desfecho\n"
+                         "# TYPE powerline_uart_commands_total counter\n");
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
+  {
+    const plcUartCommandStats_t * statsPtr = plc_uart_stats_get(cls);
+    const char * namePtr = plc_uart_stats_class_name(cls);
+    http_util_chunk_printf(writerPtr,
+                           "powerline_uart_commands_total{command=\"%s\",outcome=\"success\"} %u\n"
+                           "powerline_uart_commands_total{command=\"%s\",outcome=\"fail\"} %u\n"
+                           "powerline_uart_commands_total{command=\"%s\",outcome=\"timeout\"} %u\n"
+                           "powerline_uart_commands_total{command=\"%s\",outcome=\"expired\"} %u\n",
+                           namePtr, statsPtr->success, namePtr, statsPtr->fail,
+                           namePtr, statsPtr->timeout, namePtr, statsPtr->expired);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_uart_retries_skipped_total Reenvios cancelados pelo prazo da requisicao\n"
+                         "# TYPE powerline_uart_retries_skipped_total counter\n");
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_uart_retries_skipped_total{command=\"%s\"} %u\n",
+                           plc_uart_stats_class_name(cls), plc_uart_stats_get(cls)->retriesSkipped);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_uart_retries_total Reenvios por tempo de resposta esgotado\n"
+                         "# TYPE powerline_uart_retries_total counter\n");
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_uart_retries_total{command=\"%s\"} %u\n",
+                           plc_uart_stats_class_name(cls), plc_uart_stats_get(cls)->retries);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_uart_stage_latency_seconds Percentis por etapa do comando\n"
+                         "# TYPE powerline_uart_stage_latency_seconds gauge\n");
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
+  {
+    const plcUartCommandStats_t * statsPtr = plc_uart_stats_get(cls);
+    for (uint32_t stage = 0; stage < PLC_UART_STAGE_COUNT; stage++)
+    {
+      for (uint32_t idx = 0; idx < (sizeof(uartQuantiles) / sizeof(uartQuantiles[0])); idx++)
+      {
+        http_util_chunk_printf(writerPtr,
+                               "powerline_uart_stage_latency_seconds{command=\"%s\",stage=\"%s\",quantile=\"%s\"} ",
+                               plc_uart_stats_class_name(cls), plc_uart_stats_stage_name(stage),
+                               uartQuantileLabels[idx]);
+        seconds_write(writerPtr, latency_histogram_percentile(&statsPtr->stages[stage], uartQuantiles[idx]));
+        http_util_chunk_write(writerPtr, "\n", 1);
+      }
+    }
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_uart_pending_commands Comandos aguardando ou em andamento na UART\n"
+                         "# TYPE powerline_uart_pending_commands gauge\n"
+                         "powerline_uart_pending_commands %u\n"
+                         "# HELP powerline_uart_command_service_seconds Media movel do tempo de UART por comando\n"
+                         "# TYPE powerline_uart_command_service_seconds gauge\n"
+                         "powerline_uart_command_service_seconds %u.%06u\n"
+                         "# HELP powerline_uart_backlog_seconds Backlog estimado usado no controle de admissao\n"
+                         "# TYPE powerline_uart_backlog_seconds gauge\n"
+                         "powerline_uart_backlog_seconds %u.%03u\n"
+                         "# HELP powerline_uart_event_queue_depth Eventos do driver UART pendentes\n"
+                         "# TYPE powerline_uart_event_queue_depth gauge\n",
+                         plc_uart_stats_get_pending(),
+                         plc_uart_stats_get_service_us() / 1000000, plc_uart_stats_get_service_us() % 1000000,
+                         plc_uart_stats_get_backlog_ms() / 1000, plc_uart_stats_get_backlog_ms() % 1000);
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_uart_event_queue_depth{port=\"%u\"} %u\n",
+                           port, plc_uart_get_event_queue_depth(port));
+  }
+}
+
+/**
+ * Escreve estado do watchdog e tempo de recuperação dos módulos PLC
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void health_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  plcHealthStatus_t status[PLC_UART_PORT_COUNT];
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    plc_health_get(port, &status[port]);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_module_up Modulo PLC respondendo em modo AT\n"
+                         "# TYPE powerline_plc_module_up gauge\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_plc_module_up{port=\"%u\"} %u\n", port, status[port].up);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_heartbeats_total Heartbeats enviados e sem resposta\n"
+                         "# TYPE powerline_plc_heartbeats_total counter\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr,
+                           "powerline_plc_heartbeats_total{port=\"%u\",outcome=\"sent\"} %u\n"
+                           "powerline_plc_heartbeats_total{port=\"%u\",outcome=\"failed\"} %u\n",
+                           port, status[port].heartbeats, port, status[port].heartbeatFailures);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_reset_notifications_total Notificacoes de reinicio do modulo\n"
+                         "# TYPE powerline_plc_reset_notifications_total counter\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_plc_reset_notifications_total{port=\"%u\"} %u\n",
+                           port, status[port].resetNotifications);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_recovery_attempts_total Execucoes da sequencia de modo AT\n"
+                         "# TYPE powerline_plc_recovery_attempts_total counter\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_plc_recovery_attempts_total{port=\"%u\"} %u\n",
+                           port, status[port].recoveryAttempts);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_recovery_seconds Tempo da deteccao da falha ao modulo pronto\n"
+                         "# TYPE powerline_plc_recovery_seconds summary\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_plc_recovery_seconds_sum{port=\"%u\"} ", port);
+    seconds_write(writerPtr, status[port].totalRecoveryUs);
+    http_util_chunk_printf(writerPtr, "\npowerline_plc_recovery_seconds_count{port=\"%u\"} %u\n",
+                           port, status[port].recoveries);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_last_recovery_seconds Duracao da ultima recuperacao\n"
+                         "# TYPE powerline_plc_last_recovery_seconds gauge\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr, "powerline_plc_last_recovery_seconds{port=\"%u\"} ", port);
+    seconds_write(writerPtr, status[port].lastRecoveryUs);
+    http_util_chunk_write(writerPtr, "\n", 1);
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_plc_held_commands_total Comandos retidos durante a recuperacao\n"
+                         "# TYPE powerline_plc_held_commands_total counter\n");
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    http_util_chunk_printf(writerPtr,
+                           "powerline_plc_held_commands_total{port=\"%u\",outcome=\"released\"} %u\n"
+                           "powerline_plc_held_commands_total{port=\"%u\",outcome=\"expired\"} %u\n",
+                           port, status[port].held - status[port].holdTimeouts,
+                           port, status[port].holdTimeouts);
+  }
+}
+
+/**
+ * Escreve estado da fila de escritas IO adiadas
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void io_queue_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  plcIoQueueStats_t stats;
+  plc_io_queue_get_stats(&stats);
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_io_queue_depth Escritas IO pendentes na fila\n"
+                         "# TYPE powerline_io_queue_depth gauge\n"
+                         "powerline_io_queue_depth %u\n"
+                         "# HELP powerline_io_queue_jobs_total Escritas IO adiadas por resultado\n"
+                         "# TYPE powerline_io_queue_jobs_total counter\n"
+                         "powerline_io_queue_jobs_total{outcome=\"enqueued\"} %u\n"
+                         "powerline_io_queue_jobs_total{outcome=\"rejected\"} %u\n"
+                         "powerline_io_queue_jobs_total{outcome=\"done\"} %u\n"
+                         "powerline_io_queue_jobs_total{outcome=\"failed\"} %u\n"
+                         "powerline_io_queue_jobs_total{outcome=\"expired\"} %u\n"
+                         "powerline_io_queue_jobs_total{outcome=\"superseded\"} %u\n",
+                         stats.depth, stats.enqueued, stats.rejected, stats.done,
+                         stats.failed, stats.expired, stats.superseded);
+}
+
+/**
+ * Escreve eventos publicados e estado dos canais WebSocket e SSE
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void events_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  eventsStats_t stats;
+  events_controller_get_stats(&stats);
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_events_published_total Eventos PLC publicados\n"
+                         "# TYPE powerline_events_published_total counter\n"
+                         "powerline_events_published_total %u\n"
+                         "# HELP powerline_events_clients Clientes de eventos conectados por transporte\n"
+                         "# TYPE powerline_events_clients gauge\n"
+                         "powerline_events_clients{transport=\"ws\"} %u\n"
+                         "powerline_events_clients{transport=\"sse\"} %u\n"
+                         "# HELP powerline_events_frames_sent_total Frames de eventos enviados\n"
+                         "# TYPE powerline_events_frames_sent_total counter\n"
+                         "powerline_events_frames_sent_total %u\n",
+                         plc_events_next_seq() - 1, stats.wsClients, stats.sseClients, stats.framesSent);
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_events_sse_reconnects_total Reconexoes SSE com Last-Event-ID\n"
+                         "# TYPE powerline_events_sse_reconnects_total counter\n"
+                         "powerline_events_sse_reconnects_total{outcome=\"resumed\"} %u\n"
+                         "powerline_events_sse_reconnects_total{outcome=\"resync\"} %u\n"
+                         "# HELP powerline_events_dropped_total Clientes de eventos desconectados por motivo\n"
+                         "# TYPE powerline_events_dropped_total counter\n"
+                         "powerline_events_dropped_total{reason=\"slow\"} %u\n"
+                         "powerline_events_dropped_total{reason=\"error\"} %u\n",
+                         stats.sseResumed, stats.sseResync, stats.droppedSlow, stats.droppedError);
+}
+
+/**
+ * Escreve mensagens e custo por mensagem do protocolo UDP de controle
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void udp_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  udpServerStats_t stats;
+  udp_server_get_stats(&stats);
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_udp_messages_total Mensagens UDP recebidas por tipo\n"
+                         "# TYPE powerline_udp_messages_total counter\n"
+                         "powerline_udp_messages_total{type=\"con\"} %u\n"
+                         "powerline_udp_messages_total{type=\"non\"} %u\n"
+                         "powerline_udp_messages_total{type=\"duplicate\"} %u\n"
+                         "powerline_udp_messages_total{type=\"malformed\"} %u\n"
+                         "powerline_udp_messages_total{type=\"unknown\"} %u\n",
+                         stats.confirmable, stats.nonConfirmable, stats.duplicates, stats.malformed, stats.unknown);
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_udp_requests_total Requisicoes UDP atendidas\n"
+                         "# TYPE powerline_udp_requests_total counter\n");
+  for (uint32_t op = 0; op < UDP_SERVER_OP_COUNT; op++)
+  {
+    for (uint32_t type = 0; type < UDP_SERVER_TYPE_COUNT; type++)
+    {
+      http_util_chunk_printf(writerPtr, "powerline_udp_requests_total{op=\"%s\",type=\"%s\"} %u\n",
+                             udp_server_op_name(op), udp_server_type_name(type), stats.ops[op][type].messages);
+    }
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_udp_request_errors_total Requisicoes UDP respondidas com erro\n"
+                         "# TYPE powerline_udp_request_errors_total counter\n");
+  for (uint32_t op = 0; op < UDP_SERVER_OP_COUNT; op++)
+  {
+    for (uint32_t type = 0; type < UDP_SERVER_TYPE_COUNT; type++)
+    {
+      http_util_chunk_printf(writerPtr, "powerline_udp_request_errors_total{op=\"%s\",type=\"%s\"} %u\n",
+                             udp_server_op_name(op), udp_server_type_name(type), stats.ops[op][type].errors);
+    }
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_udp_request_seconds_sum Tempo das requisicoes UDP por parte, "
+                         "server = decodificacao, resposta e envio\n"
+                         "# TYPE powerline_udp_request_seconds_sum counter\n");
+  for (uint32_t op = 0; op < UDP_SERVER_OP_COUNT; op++)
+  {
+    for (uint32_t type = 0; type < UDP_SERVER_TYPE_COUNT; type++)
+    {
+      const udpServerOpStats_t * opStatsPtr = &stats.ops[op][type];
+      http_util_chunk_printf(writerPtr, "powerline_udp_request_seconds_sum{op=\"%s\",type=\"%s\",part=\"server\"} ",
+                             udp_server_op_name(op), udp_server_type_name(type));
+      seconds_write(writerPtr, opStatsPtr->serverUsSum);
+      http_util_chunk_printf(writerPtr, "\npowerline_udp_request_seconds_sum{op=\"%s\",type=\"%s\",part=\"plc\"} ",
+                             udp_server_op_name(op), udp_server_type_name(type));
+      seconds_write(writerPtr, opStatsPtr->plcUsSum);
+      http_util_chunk_write(writerPtr, "\n", 1);
+    }
+  }
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_udp_request_server_seconds_max Maior tempo no servidor por requisicao\n"
+                         "# TYPE powerline_udp_request_server_seconds_max gauge\n");
+  for (uint32_t op = 0; op < UDP_SERVER_OP_COUNT; op++)
+  {
+    for (uint32_t type = 0; type < UDP_SERVER_TYPE_COUNT; type++)
+    {
+      http_util_chunk_printf(writerPtr, "powerline_udp_request_server_seconds_max{op=\"%s\",type=\"%s\"} ",
+                             udp_server_op_name(op), udp_server_type_name(type));
+      seconds_write(writerPtr, stats.ops[op][type].serverUsMax);
+      http_util_chunk_write(writerPtr, "\n", 1);
+    }
+  }
+}
+
+/**
+ * Escreve uso de heap e marca d'água da pilha das tasks
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ */
+static void system_metrics_write(httpChunkWriter_t * writerPtr)
+{
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_heap_free_bytes Heap livre\n"
+                         "# TYPE powerline_heap_free_bytes gauge\n"
+                         "powerline_heap_free_bytes %u\n"
+                         "# HELP powerline_heap_min_free_bytes Menor heap livre desde a inicializacao\n"
+                         "# TYPE powerline_heap_min_free_bytes gauge\n"
+                         "powerline_heap_min_free_bytes %u\n"
+                         "# HELP powerline_heap_largest_free_block_bytes Maior bloco livre do heap\n"
+                         "# TYPE powerline_heap_largest_free_block_bytes gauge\n"
+                         "powerline_heap_largest_free_block_bytes %u\n",
+                         heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                         heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                         heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+  http_util_chunk_printf(writerPtr,
+                         "# HELP powerline_task_stack_free_min_bytes Menor pilha livre da task\n"
+                         "# TYPE powerline_task_stack_free_min_bytes gauge\n");
+  for (uint32_t idx = 0; idx < (sizeof(taskNames) / sizeof(taskNames[0])); idx++)
+  {
+    TaskHandle_t taskHandle = xTaskGetHandle(taskNames[idx]);
+    if (taskHandle == NULL)
+    {
+      /* Task não criada */
+      continue;
+    }
+
+    http_util_chunk_printf(writerPtr, "powerline_task_stack_free_min_bytes{task=\"%s\"} %u\n",
+                           taskNames[idx], uxTaskGetStackHighWaterMark(taskHandle));
+  }
+}
+
+/**
+ * Escreve valor em segundos com resolução de microssegundos
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ * @param valueUs     valor em microssegundos
+ */
+static void seconds_write(httpChunkWriter_t * writerPtr, uint64_t valueUs)
+{
+  http_util_chunk_printf(writerPtr, "%u.%06u", (uint32_t)(valueUs / 1000000), (uint32_t)(valueUs % 1000000));
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,37 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef METRICS_CONTROLLER_H
+#define METRICS_CONTROLLER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <esp_http_server.h>
+#include <stdint.h>
+
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Quantidade máxima de endpoints instrumentados */
+#define METRICS_MAX_ENDPOINTS  32
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void metrics_controller_init(const httpd_uri_t * endpointsPtr, uint32_t endpointCount);
+void metrics_controller_record_request(uint32_t endpointIndex, int64_t elapsedUs, esp_err_t result);
+void metrics_controller_record_rejected(uint32_t endpointIndex);
+esp_err_t metrics_controller_get(httpd_req_t * req);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -17,14 +17,68 @@
 #include "json_buffer.h"
 #include "plc_uart.h"
 #include "http_util.h"
+#include "plc_history.h"
+#include "plc_telemetry.h"
+#include "plc_stats.h"
+#include "plc_uart_stats.h"
+#include "plc_trace.h"
+#include "plc_health.h"
+#include "plc_io_queue.h"
+#include "idempotency.h"
+#include "plc_jobs.h"
+#include "plc_events.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Tamanho máximo do fragmento JSON pré-renderizado de um node */
+#define NODE_FRAGMENT_SIZE  96
+/* Prefixo das rotas por node, formato /plc/nodes/{mac}/<recurso> */
+#define NODE_URI_PREFIX     "/plc/nodes/"
+/* Prefixo da consulta de jobs de escrita IO, formato /plc/io/jobs/{id} */
+#define IO_JOB_URI_PREFIX   "/plc/io/jobs/"
+/* Prefixo da consulta de comandos assíncronos, formato /plc/jobs/{id} */
+#define JOB_URI_PREFIX      "/plc/jobs/"
+/* Prazo dos comandos UART por endpoint, em ms, reduzido pelo header do cliente */
+#define COMMAND_BUDGET_MS   5000
+#define IO_BUDGET_MS        3000
+/* Header com o tempo que o cliente ainda aguarda a resposta, em ms */
+#define TIMEOUT_HEADER      "X-Request-Timeout"
+/* Espera por linha do stream antes de verificar a conclusão do comando */
+#define STREAM_POLL_MS      50
+/* Tipo da saída de POST /plc/command, em stream ou não */
+#define COMMAND_OUTPUT_TYPE "text/plain"
+/* Consultas aguardando a conclusão de um job (long-poll) ao mesmo tempo */
+#define JOB_WAITERS         4
+/* Backlog estimado da UART a partir do qual requisições que ocupam a UART são
+   recusadas, abaixo dos prazos dos endpoints acima */
+#define ADMISSION_MAX_BACKLOG_MS  2000
 
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
 
+/**
+ * Fragmento JSON pré-renderizado de um node da topologia
+ * 
+ */
+typedef struct nodeFragment_t
+{
+  /* Cópia dos campos usados na última renderização */
+  node_t node;
+  /* Fragmento já renderizado ao menos uma vez */
+  bool valid;
+  /* Tamanho do fragmento renderizado */
+  size_t length;
+  /* Objeto JSON do node */
+  char json[NODE_FRAGMENT_SIZE];
+} nodeFragment_t;
+
 /**
  * Estrutura JSON para recepção de um comando de manipulação de um pino de uma estação (STA)
  * 
@@ -33,28 +87,156 @@ typedef struct ioDto_t
 {
   char mac [19];
   uint32_t value;
+  /* Rede da estação, PLC_UART_MODEL_NETWORK_AUTO quando omitida */
+  int32_t network;
+  /* Prazo da escrita quando adiada, 0 = PLC_IO_QUEUE_TTL_MS */
+  uint32_t ttl;
 } ioDto_t;
 
+/* Contexto de escrita das amostras de telemetria */
+typedef struct telemetryWriteContext_t
+{
+  httpChunkWriter_t * writerPtr;
+  uint32_t count;
+} telemetryWriteContext_t;
+
+/*
+ * Consulta aguardando a conclusão de um job, respondida fora do handler.
+ * A posição é o contexto da sessão HTTP, liberada na resposta ou quando o
+ * servidor encerra a sessão
+ */
+typedef struct jobWaiter_t
+{
+  bool used;
+  int fd;
+  uint32_t jobId;
+  /* Fim da espera (esp_timer_get_time), responde o estado atual */
+  int64_t deadlineUs;
+} jobWaiter_t;
+
 /*******************************************************************************
 * CONSTANTES
 *******************************************************************************/
 /* Identificador LOG */
 static const char *TAG = "PLC_CONTROLLER";
+/* Cabeçalho da resposta de uma consulta aguardada, corpo em blocos */
+static const char jobWaitHeader[] =
+  "HTTP/1.1 %s\r\n"
+  "Content-Type: " HTTPD_TYPE_JSON "\r\n"
+  "Transfer-Encoding: chunked\r\n"
+  "\r\n";
 /*******************************************************************************
 * VARIÁVEIS
 *******************************************************************************/
+/* Fragmentos em cache indexados pelo slot do node na tabela da topologia */
+static nodeFragment_t nodeFragments[PLC_TOPOLOGY_MAX_NODES];
+/* Renderizados na task da atualização da topologia, lidos pelo servidor HTTP */
+static SemaphoreHandle_t fragmentMutex;
+/* Cópia de job consultado, grande demais para a pilha da task do servidor */
+static plcJob_t jobCopy;
+/* Linha lida do stream de um comando */
+static char streamLine[PLC_JOBS_LINE_SIZE];
+static httpd_handle_t serverHandle;
+/* Consultas aguardando, acessadas somente na task do servidor HTTP */
+static jobWaiter_t jobWaiters[JOB_WAITERS];
+/* Lido pela task dos jobs e pelo timer */
+static bool waitQueued;
+/* Fim de espera mais próximo das consultas aguardando */
+static esp_timer_handle_t waitTimer;
 
 /*******************************************************************************
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
-static bool topology_serialize(const topology_t * topologyPtr, char * jsonBufferPtr, size_t sizeJsonBuffer);
-static void node_to_dto(cJSON * root, char * keyName, const node_t * nodeBufferPtr, uint32_t nodeCount);
-static esp_err_t dto_to_command(const char * bufferInPtr, char * bufferOutPtr, size_t bufferOutSize);
+static esp_err_t topology_write(httpChunkWriter_t * writerPtr, const topology_t * topologyPtr);
+static void node_list_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                            const node_t * nodeBufferPtr, uint32_t nodeCount);
+static bool node_equals(const node_t * nodeAPtr, const node_t * nodeBPtr);
+static void node_fragment_render(nodeFragment_t * fragmentPtr, const node_t * nodePtr);
+static void node_fragment_get(const node_t * nodePtr, nodeFragment_t * fragmentPtr);
+static void topology_updated_listener(uint32_t slot, const node_t * nodePtr);
+static bool node_uri_parse(const char * uriPtr, uint8_t * macOutPtr, const char ** resourcePtr);
+static esp_err_t node_history_send(httpd_req_t * req, const uint8_t * macPtr);
+static esp_err_t node_telemetry_send(httpd_req_t * req, const uint8_t * macPtr);
+static bool telemetry_sample_write(const plcHistorySample_t * samplePtr, void * contextPtr);
+static void stats_node_list_write(httpChunkWriter_t * writerPtr, const char * keyName, const char * valueName,
+                                  const plcStatsNode_t * nodeBufferPtr, uint32_t nodeCount, bool withAverage);
+static void uart_stage_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                             const latencyHistogram_t * histogramPtr, bool first);
+static void history_raw_write(httpChunkWriter_t * writerPtr, uint32_t slot);
+static void history_rollup_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                                 uint32_t slot, plcHistoryResolution_t resolution);
+static void trace_finish(httpd_req_t * req, plcTrace_t * tracePtr, bool result,
+                         char * serverTimingPtr, size_t serverTimingSize);
+static esp_err_t dto_to_command(const char * bufferInPtr, char * bufferOutPtr, size_t bufferOutSize,
+                                int32_t * networkPtr);
 static esp_err_t dto_to_io_command(const char * bufferInPtr, ioDto_t * dtoPtr);
+static esp_err_t io_dto_decode(cJSON * root, ioDto_t * dtoPtr);
+static bool io_execute(ioDto_t * dtoPtr, int64_t deadlineUs, plcTrace_t * tracePtr, uint32_t * jobIdPtr);
+static esp_err_t dto_to_network(cJSON * root, int32_t defaultNetwork, int32_t * networkPtr);
+static esp_err_t job_accepted_send(httpd_req_t * req, const char * uriPrefixPtr, uint32_t jobId);
+static bool job_uri_parse(const char * uriPtr, const char * uriPrefixPtr, uint32_t * idPtr);
+static void job_output_write(httpChunkWriter_t * writerPtr, char * outputPtr);
+static void job_write(httpChunkWriter_t * writerPtr, plcJob_t * jobPtr);
+static bool job_wait_add(httpd_req_t * req, uint32_t jobId, uint32_t waitMs);
+static void job_wait_session_closed(void * ctxPtr);
+static void job_completed_listener(uint32_t id);
+static void job_wait_timer_callback(void * arg);
+static void job_wait_schedule(void);
+static void job_wait_work(void * arg);
+static void job_wait_respond(jobWaiter_t * waiterPtr, bool found);
+static int64_t request_deadline(httpd_req_t * req, uint32_t budgetMs);
+static esp_err_t command_stream_send(httpd_req_t * req, uint32_t jobId, httpChunkWriter_t * writerPtr,
+                                     plcTrace_t * tracePtr, char * serverTimingPtr, size_t serverTimingSize,
+                                     bool * streamedPtr);
+static esp_err_t ticket_respond(httpd_req_t * req, idempotencyTicket_t * ticketPtr, const char * httpCode,
+                                const char * messagePtr);
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 
+/**
+ * Inicializa consultas aguardadas de jobs, respondidas na conclusão do job
+ * pela task do servidor HTTP
+ * 
+ * @param server  servidor HTTP que atende os endpoints
+ */
+void plc_controller_init(httpd_handle_t server)
+{
+  serverHandle = server;
+  bzero(jobWaiters, sizeof(jobWaiters));
+
+  const esp_timer_create_args_t waitArgs = {
+    .callback = job_wait_timer_callback,
+    .name = "job_wait",
+  };
+  esp_timer_create(&waitArgs, &waitTimer);
+
+  plc_jobs_set_listener(job_completed_listener);
+
+  /* Fragmentos dos nodes renderizados a cada atualização da topologia */
+  fragmentMutex = xSemaphoreCreateMutex();
+  plc_topology_set_listener(topology_updated_listener);
+}
+
+/**
+ * Controle de admissão das requisições que ocupam a UART: com o backlog
+ * estimado acima de ADMISSION_MAX_BACKLOG_MS a requisição deve ser recusada
+ * (503 com Retry-After), mantendo limitada a latência das aceitas
+ * 
+ * @return uint32_t   0 = aceita, senão segundos estimados para o backlog
+ *                    voltar ao limite, mínimo 1
+ */
+uint32_t plc_controller_admission_retry(void)
+{
+  const uint32_t backlogMs = plc_uart_stats_get_backlog_ms();
+  if (backlogMs <= ADMISSION_MAX_BACKLOG_MS)
+  {
+    return 0;
+  }
+
+  return ((backlogMs - ADMISSION_MAX_BACKLOG_MS) + 999) / 1000;
+}
+
 /**
  * Serviço Web para recuperar tolologia PLC
  * 
@@ -65,214 +247,1475 @@ esp_err_t plc_controller_get_topology(httpd_req_t * req)
 {
   topology_t topology;
 
-  plc_topology_get(&topology);
-
-  if (topology_serialize(&topology, json_buffer_get(), json_buffer_get_size()) == false)
-  {
-    /* Falha em criar objeto de resposta da topologia */
-    http_util_send_response(req, HTTPD_500, "Failed to serialize the response");
-    return ESP_FAIL;
-  }
+  plc_topology_get(&topology, PLC_TOPOLOGY_MAX_AGE_MS);
 
+  /* Resposta montada a partir dos fragmentos em cache, enviada em blocos */
   httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-  httpd_resp_send(req, json_buffer_get(), HTTPD_RESP_USE_STRLEN);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
 
-  return ESP_OK;
+  topology_write(&writer, &topology);
+  return http_util_chunk_end(&writer);
 }
 
 /**
- * Serviço Web para enviar comando para módulo PLC
+ * Serviço Web para enviar comando para módulo PLC.
+ * Body: {"command": "AT+...", "network": 0 (opcional, rede padrão)}
+ * Cada linha da resposta do módulo é enviada ao cliente assim que recebida,
+ * em blocos (chunked), sem limite de tamanho. Comando cancelado pelo prazo
+ * (COMMAND_BUDGET_MS ou X-Request-Timeout) responde 504
  * 
  * @param req         requisição a ser respondida
  * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
 esp_err_t plc_controller_post_command(httpd_req_t * req)
 {
+  const int64_t deadlineUs = request_deadline(req, COMMAND_BUDGET_MS);
+  plcTrace_t trace;
+  char serverTiming[PLC_TRACE_SERVER_TIMING_SIZE];
+  plc_trace_begin(&trace, req->uri);
+
   esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+  plc_trace_mark(&trace, PLC_TRACE_STAGE_READ);
 
   if (result != ESP_OK)
   {
     /* Falha leitura body do comando a ser utilizado */
+    trace_finish(req, &trace, false, serverTiming, sizeof(serverTiming));
     http_util_send_response(req, HTTPD_500, "Error reading request body");
     return result;
   }
 
-  char command[256] = "\0";
-  result = dto_to_command(json_buffer_get(), command, sizeof(command));
+  idempotencyTicket_t ticket;
+  if (idempotency_begin(req, json_buffer_get(), &ticket) == false)
+  {
+    /* Repetição respondida com o resultado da requisição original */
+    return ESP_OK;
+  }
+
+  char command[PLC_JOBS_COMMAND_SIZE] = "\0";
+  int32_t network;
+  result = dto_to_command(json_buffer_get(), command, sizeof(command), &network);
+  plc_trace_mark(&trace, PLC_TRACE_STAGE_DECODE);
 
   if (result != ESP_OK)
   {
     /* Body formatado incorretamente */
-    http_util_send_response(req, HTTPD_400, "Error decoding request body");
+    trace_finish(req, &trace, false, serverTiming, sizeof(serverTiming));
+    ticket_respond(req, &ticket, HTTPD_400, "Error decoding request body");
     return result;
   }
 
-  uartPlcResponse_t response;
-  bzero(&response, sizeof(uartPlcResponse_t));
-  /* Envia comando para módulo PLC */
-  plc_uart_send(command, &response);
+  /* Comando executado pela task de jobs, linhas lidas do stream */
+  const uint32_t jobId = plc_jobs_submit_stream(network, command, deadlineUs);
+  if (jobId == 0)
+  {
+    /* Comando anterior, abandonado pelo cliente, ainda em execução */
+    trace_finish(req, &trace, false, serverTiming, sizeof(serverTiming));
+    ticket_respond(req, &ticket, HTTPD_503, "PLC command in progress");
+    return ESP_FAIL;
+  }
+
+  httpChunkWriter_t writer;
+  bool streamed = false;
+  result = command_stream_send(req, jobId, &writer, &trace, serverTiming, sizeof(serverTiming), &streamed);
+  plc_jobs_stream_close(jobId);
 
-  if (response.result == false)
+  if (plc_jobs_get(jobId, &jobCopy) == false)
   {
-    /* Módulo PLC indisponível */
-    http_util_send_response(req, HTTPD_500, "Error sending command to PLC module");
-    return result;
+    /* Entrada reaproveitada, resultado desconhecido */
+    bzero(&jobCopy, sizeof(plcJob_t));
+    jobCopy.state = PLC_JOB_FAILED;
   }
 
-  /* Copia resposta */
-  strcpy(json_buffer_get(), response.data);
-  httpd_resp_sendstr(req, json_buffer_get());
-  
-  return ESP_OK;
+  if (streamed == false)
+  {
+    /* Nenhuma linha enviada, código HTTP conforme o resultado */
+    trace_finish(req, &trace, jobCopy.state == PLC_JOB_DONE, serverTiming, sizeof(serverTiming));
+    if (jobCopy.state == PLC_JOB_EXPIRED)
+    {
+      /* Prazo esgotado antes do envio ou dos reenvios */
+      ticket_respond(req, &ticket, HTTPD_504, "PLC command deadline exceeded");
+      return ESP_FAIL;
+    }
+
+    if (jobCopy.state != PLC_JOB_DONE)
+    {
+      /* Módulo PLC indisponível */
+      ticket_respond(req, &ticket, HTTPD_500, "Error sending command to PLC module");
+      return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, COMMAND_OUTPUT_TYPE);
+    httpd_resp_sendstr(req, jobCopy.output);
+  }
+  else if (result == ESP_OK)
+  {
+    /* Código HTTP já enviado, falha após a primeira linha indicada como no módulo */
+    if (jobCopy.state != PLC_JOB_DONE)
+    {
+      http_util_chunk_write(&writer, "ERROR\n", 6);
+    }
+    result = http_util_chunk_end(&writer);
+  }
+
+  /* Repetição somente com a saída completa, entregue sem descarte */
+  const bool complete = (result == ESP_OK) && (jobCopy.state == PLC_JOB_DONE) &&
+                        (jobCopy.truncated == false) && (jobCopy.streamDropped == 0);
+  idempotency_finish(&ticket, complete ? HTTPD_200 : HTTPD_500, COMMAND_OUTPUT_TYPE, jobCopy.output);
+
+  return result;
 }
 
 /**
- * Serviço Web para chavear carga nas estações
+ * Serviço Web para chavear carga nas estações.
+ * Body: {"mac": "XX:XX:XX:XX:XX:XX", "value": 0 .. 100, "network": 0 (opcional,
+ * rede onde o MAC foi visto na topologia), "ttl": ms (opcional, prazo quando adiada)}
+ * 
+ * Com o módulo em recuperação, escrita pendente para o mesmo MAC ou falha
+ * no envio, a escrita é adiada na fila e a resposta é 202 com o job,
+ * consultado em GET /plc/io/jobs/{id}
  * 
  * @param req         requisição a ser respondida
  * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
 esp_err_t plc_controller_post_io(httpd_req_t * req)
 {
+  const int64_t deadlineUs = request_deadline(req, IO_BUDGET_MS);
+  plcTrace_t trace;
+  char serverTiming[PLC_TRACE_SERVER_TIMING_SIZE];
+  plc_trace_begin(&trace, req->uri);
+
   esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+  plc_trace_mark(&trace, PLC_TRACE_STAGE_READ);
 
   if (result != ESP_OK)
   {
     /* Falha recuperação body */
+    trace_finish(req, &trace, false, serverTiming, sizeof(serverTiming));
     http_util_send_response(req, HTTPD_500, "Error reading request body");
     return result;
   }
 
+  idempotencyTicket_t ticket;
+  if (idempotency_begin(req, json_buffer_get(), &ticket) == false)
+  {
+    /* Repetição respondida com o resultado da requisição original */
+    return ESP_OK;
+  }
+
   ioDto_t dto;
   result = dto_to_io_command(json_buffer_get(), &dto);
+  plc_trace_mark(&trace, PLC_TRACE_STAGE_DECODE);
 
   if (result != ESP_OK)
   {
     /* Body formatado incorretamente */
-    http_util_send_response(req, HTTPD_400, "Error decoding request body");
+    trace_finish(req, &trace, false, serverTiming, sizeof(serverTiming));
+    ticket_respond(req, &ticket, HTTPD_400, "Error decoding request body");
     return result;
   }
 
-  /* Envia comando */
-  if (plc_uart_model_io(dto.mac, dto.value) == false)
+  uint32_t jobId;
+  const bool ioResult = io_execute(&dto, deadlineUs, &trace, &jobId);
+  trace_finish(req, &trace, ioResult, serverTiming, sizeof(serverTiming));
+
+  if (ioResult == false)
   {
-    /* Módulo PLC indisponível */
-    http_util_send_response(req, HTTPD_500, "Communication with PLC module failed");
-    return ESP_FAIL;
+    if (jobId == 0)
+    {
+      /* Fila cheia, módulo PLC indisponível */
+      ticket_respond(req, &ticket, HTTPD_503, "Communication with PLC module failed");
+      return ESP_FAIL;
+    }
+
+    result = job_accepted_send(req, IO_JOB_URI_PREFIX, jobId);
+    idempotency_finish(&ticket, HTTPD_202, HTTPD_TYPE_JSON, json_buffer_get());
+    return result;
   }
 
   /* Comunicação OK, envia sucesso */
-  http_util_send_response(req, HTTPD_200, "OK");
+  ticket_respond(req, &ticket, HTTPD_200, "OK");
   return ESP_OK;
 }
 
+/**
+ * Serviço Web para consulta de uma escrita IO adiada, GET /plc/io/jobs/{id}
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t plc_controller_get_io_job(httpd_req_t * req)
+{
+  uint32_t id;
+  plcIoJob_t job;
+  if ((job_uri_parse(req->uri, IO_JOB_URI_PREFIX, &id) == false) || (plc_io_queue_get_job(id, &job) == false))
+  {
+    http_util_send_response(req, HTTPD_404, "Job not found");
+    return ESP_FAIL;
+  }
+
+  const int64_t endUs = (job.state == PLC_IO_JOB_QUEUED) ? esp_timer_get_time() : job.finishedUs;
+  snprintf(json_buffer_get(), json_buffer_get_size(),
+           "{\"job\":%u,\"status\":\"%s\",\"network\":%u,\"mac\":\"%s\",\"value\":%u,"
+           "\"attempts\":%u,\"age\":%u}",
+           job.id, plc_io_queue_state_name(job.state), job.port, job.mac, job.value,
+           job.attempts, (uint32_t)((endUs - job.createdUs) / 1000));
 
-/*******************************************************************************
-* FUNÇÕES LOCAIS
-*******************************************************************************/
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  return httpd_resp_send(req, json_buffer_get(), HTTPD_RESP_USE_STRLEN);
+}
 
 /**
- * Transforma estrutura topologia em body JSON
+ * Serviço Web para criar comando AT assíncrono, responde 202 com o id do job
+ * sem aguardar o módulo PLC
  * 
- * @param topologyPtr       estrutura a ser manipulada
- * @param jsonBufferPtr     buffer escrita JSON
- * @param sizeJsonBuffer    tamanho disponível para escrita
- * @return true             sucesso na transformação
- * @return false            falha transformação
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
-static bool topology_serialize(const topology_t * topologyPtr, char * jsonBufferPtr, size_t sizeJsonBuffer)
+esp_err_t plc_controller_post_job(httpd_req_t * req)
 {
-  cJSON * root = cJSON_CreateObject();
-  /* Trata módulos do tipo concentrador (CCO) */
-  node_to_dto(root, "cco", &topologyPtr->cco, topologyPtr->ccoCount);
-  /* Trata módulos do tipo estação (STA) */
-  node_to_dto(root, "sta", &topologyPtr->sta, topologyPtr->staCount);
-	return close_json(root, jsonBufferPtr, sizeJsonBuffer);
+  esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+  if (result != ESP_OK)
+  {
+    /* Falha leitura body do comando a ser utilizado */
+    http_util_send_response(req, HTTPD_500, "Error reading request body");
+    return result;
+  }
+
+  idempotencyTicket_t ticket;
+  if (idempotency_begin(req, json_buffer_get(), &ticket) == false)
+  {
+    /* Repetição respondida com o resultado da requisição original */
+    return ESP_OK;
+  }
+
+  char command[PLC_JOBS_COMMAND_SIZE] = "\0";
+  int32_t network;
+  result = dto_to_command(json_buffer_get(), command, sizeof(command), &network);
+  if (result != ESP_OK)
+  {
+    /* Body formatado incorretamente ou comando maior que o aceito */
+    ticket_respond(req, &ticket, HTTPD_400, "Error decoding request body");
+    return result;
+  }
+
+  const uint32_t jobId = plc_jobs_submit(network, command);
+  if (jobId == 0)
+  {
+    /* Todos os jobs em andamento ou com resultado ainda válido */
+    ticket_respond(req, &ticket, HTTPD_503, "PLC job table full");
+    return ESP_FAIL;
+  }
+
+  result = job_accepted_send(req, JOB_URI_PREFIX, jobId);
+  idempotency_finish(&ticket, HTTPD_202, HTTPD_TYPE_JSON, json_buffer_get());
+  return result;
 }
 
 /**
- * Cria array de objetos JSON para certo tipo de módulo 
- *      
- * @param root            estrutura JSON a ser utilizada para inserção do array de objeto 
- * @param keyName         nome a ser dado para array
- * @param nodeBufferPtr   buffer de node a ser consumido
- * @param nodeCount       quantidade de nodes a serem expostos 
+ * Serviço Web para consultar comando AT assíncrono, /plc/jobs/{id}.
+ * Com ?wait=ms a resposta aguarda a conclusão do job até o tempo informado,
+ * limitado a PLC_JOBS_MAX_WAIT_MS. A espera não ocupa a task do servidor:
+ * a consulta é registrada e respondida na conclusão do job ou no fim do
+ * prazo. Com JOB_WAITERS consultas aguardando, responde o estado atual
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
-static void node_to_dto(cJSON * root, char * keyName, const node_t * nodeBufferPtr, uint32_t nodeCount)
+esp_err_t plc_controller_get_job(httpd_req_t * req)
 {
-  cJSON * nodeListJson = cJSON_AddArrayToObject(root, keyName);
+  uint32_t id;
+  if (job_uri_parse(req->uri, JOB_URI_PREFIX, &id) == false)
+  {
+    http_util_send_response(req, HTTPD_404, "Job not found");
+    return ESP_FAIL;
+  }
 
-  for(uint32_t idx = 0; idx < nodeCount; idx++)
+  /* Long-poll opcional, limitado em PLC_JOBS_MAX_WAIT_MS */
+  char query[24] = "";
+  char value[12] = "";
+  uint32_t waitMs = 0;
+  if ((httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) &&
+      (httpd_query_key_value(query, "wait", value, sizeof(value)) == ESP_OK))
   {
-    cJSON * nodeItem = cJSON_CreateObject();
+    waitMs = strtoul(value, NULL, 10);
+  }
 
-    char mac[20] = "";
-    uint8_t * macPtr = nodeBufferPtr[idx].mac;
-    /* Formata MAC */
-    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X",macPtr[0],macPtr[1],macPtr[2],macPtr[3],macPtr[4],macPtr[5]);
-    cJSON_AddStringToObject(nodeItem, "mac", mac);
+  if (plc_jobs_get(id, &jobCopy) == false)
+  {
+    http_util_send_response(req, HTTPD_404, "Job not found");
+    return ESP_FAIL;
+  }
 
-    cJSON_AddNumberToObject(nodeItem, "id", nodeBufferPtr[idx].id);
-    cJSON_AddNumberToObject(nodeItem, "atenuation", nodeBufferPtr[idx].atenuation);
-    cJSON_AddNumberToObject(nodeItem, "snr", nodeBufferPtr[idx].snr);
-    cJSON_AddNumberToObject(nodeItem, "phase", nodeBufferPtr[idx].phase);
-    cJSON_AddItemToArray(nodeListJson, nodeItem);
+  if ((waitMs != 0) && (plc_jobs_finished(&jobCopy) == false) && job_wait_add(req, id, waitMs))
+  {
+    /* Resposta enviada por job_wait_work */
+    return ESP_OK;
   }
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  job_write(&writer, &jobCopy);
+  return http_util_chunk_end(&writer);
 }
 
 /**
- * Transformação do body JSON recebido para identificação de um comando UART
+ * Serviço Web para recursos de um node, rotas:
  * 
- * @param bufferInPtr     estrutura JSON a ser lida
- * @param bufferOutPtr    buffer de escrita do comando recebido
- * @param bufferOutSize   tamanho do buffer disponível para escrita 
- * @return esp_err_t      resultado da operação, sucesso = ESP_OK
+ * GET /plc/nodes/{mac}/history?resolution=raw|minute|hour
+ * GET /plc/nodes/{mac}/telemetry?from=<s>&to=<s>
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
-static esp_err_t dto_to_command(const char * bufferInPtr, char * bufferOutPtr, size_t bufferOutSize)
+esp_err_t plc_controller_get_node(httpd_req_t * req)
 {
-  cJSON * root = cJSON_Parse(bufferInPtr);
-  if (root == NULL)
+  uint8_t mac[6];
+  const char * resourcePtr = NULL;
+  if (node_uri_parse(req->uri, mac, &resourcePtr) == false)
   {
+    /* Rota fora do formato esperado */
+    http_util_send_response(req, HTTPD_404, "Resource not found");
     return ESP_FAIL;
   }
 
-  return get_json_string_value(root, "command", bufferOutPtr, bufferOutSize);
+  if (strncmp(resourcePtr, "history", strlen("history")) == 0)
+  {
+    return node_history_send(req, mac);
+  }
+
+  if (strncmp(resourcePtr, "telemetry", strlen("telemetry")) == 0)
+  {
+    return node_telemetry_send(req, mac);
+  }
+
+  http_util_send_response(req, HTTPD_404, "Resource not found");
+  return ESP_FAIL;
 }
 
+/**
+ * Serviço Web para recuperar agregados de saúde da rede PLC
+ * 
+ * Agregados mantidos a cada atualização da topologia, custo da consulta 
+ * independente da quantidade de nodes
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t plc_controller_get_stats(httpd_req_t * req)
+{
+  plcStats_t stats;
+  plc_stats_get(&stats);
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_printf(&writer, "{\"nodes\":%u,\"snrHistogram\":[", stats.nodeCount);
+  for (uint32_t idx = 0; idx < PLC_STATS_SNR_BUCKETS; idx++)
+  {
+    /* Última faixa sem limite superior */
+    const bool last = idx == (PLC_STATS_SNR_BUCKETS - 1);
+    http_util_chunk_printf(&writer, "%s{\"from\":%u,\"to\":%d,\"count\":%u}",
+                           idx == 0 ? "" : ",", idx * PLC_STATS_SNR_BUCKET_WIDTH,
+                           last ? -1 : (int32_t)(((idx + 1) * PLC_STATS_SNR_BUCKET_WIDTH) - 1),
+                           stats.snrHistogram[idx]);
+  }
+
+  http_util_chunk_write(&writer, "],\"phases\":[", 12);
+  for (uint32_t idx = 0; idx < PLC_STATS_PHASES; idx++)
+  {
+    http_util_chunk_printf(&writer, "%s%u", idx == 0 ? "" : ",", stats.phaseCount[idx]);
+  }
+  http_util_chunk_write(&writer, "]", 1);
+
+  stats_node_list_write(&writer, "worstAtenuation", "atenuation",
+                        stats.worstAtenuation, stats.worstAtenuationCount, false);
+  stats_node_list_write(&writer, "snrDrops", "snr",
+                        stats.snrDrops, stats.snrDropCount, true);
+  http_util_chunk_write(&writer, "}", 1);
+
+  return http_util_chunk_end(&writer);
+}
 
 /**
- * Transformação do body JSON recebido para identificação da manipulação de carga nas estações
+ * Envia contadores e percentis de latência da UART por classe de comando,
+ * tempos em microssegundos
  * 
- * @param bufferInPtr     estrutura JSON a ser lida
- * @param dtoPtr    buffer de escrita do comando recebido
- * @return esp_err_t      resultado da operação, sucesso = ESP_OK
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
  */
-static esp_err_t dto_to_io_command(const char * bufferInPtr, ioDto_t * dtoPtr)
+esp_err_t plc_controller_get_uart_stats(httpd_req_t * req)
 {
-  cJSON * root = cJSON_Parse(bufferInPtr);
-  if (root == NULL)
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_write(&writer, "{\"commands\":[", 13);
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
   {
-    return ESP_FAIL;
+    const plcUartCommandStats_t * statsPtr = plc_uart_stats_get(cls);
+    http_util_chunk_printf(&writer, "%s{\"command\":\"%s\",\"sent\":%u,\"success\":%u,"
+                           "\"fail\":%u,\"timeout\":%u,\"retries\":%u,\"expired\":%u,"
+                           "\"retriesSkipped\":%u,\"stages\":{",
+                           cls == 0 ? "" : ",", plc_uart_stats_class_name(cls),
+                           statsPtr->sent, statsPtr->success, statsPtr->fail,
+                           statsPtr->timeout, statsPtr->retries, statsPtr->expired,
+                           statsPtr->retriesSkipped);
+    for (uint32_t stage = 0; stage < PLC_UART_STAGE_COUNT; stage++)
+    {
+      uart_stage_write(&writer, plc_uart_stats_stage_name(stage), &statsPtr->stages[stage], stage == 0);
+    }
+    http_util_chunk_write(&writer, "}}", 2);
   }
+  http_util_chunk_write(&writer, "]}", 2);
 
-  /* Recupera MAC da estação a ser manipulada */
-  esp_err_t result = get_json_string_value(root, "mac", dtoPtr->mac, sizeof(dtoPtr->mac));
+  return http_util_chunk_end(&writer);
+}
 
-  if (result != ESP_OK)
+/**
+ * Zera contadores e histogramas de latência da UART
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t plc_controller_delete_uart_stats(httpd_req_t * req)
+{
+  plc_uart_stats_reset();
+  ESP_LOGI(TAG, "Métricas UART zeradas");
+  return http_util_send_response(req, HTTPD_200, "{\"result\": true}");
+}
+
+/**
+ * Chamada GET /plc/topology do lote /rpc
+ * 
+ * @param bodyPtr       body da chamada, não utilizado
+ * @param writerPtr     escritor do resultado
+ * @return const char*  código HTTP do resultado
+ */
+const char * plc_controller_rpc_topology(cJSON * bodyPtr, httpChunkWriter_t * writerPtr)
+{
+  topology_t topology;
+
+  plc_topology_get(&topology, PLC_TOPOLOGY_MAX_AGE_MS);
+  topology_write(writerPtr, &topology);
+  return HTTPD_200;
+}
+
+/**
+ * Chamada POST /plc/io do lote /rpc, mesmo body e resultados do endpoint.
+ * Prazo da escrita direta IO_BUDGET_MS a partir do início da chamada
+ * 
+ * @param bodyPtr       body da chamada, {"mac": "...", "value": 0..100}
+ * @param writerPtr     escritor do resultado
+ * @return const char*  código HTTP do resultado
+ */
+const char * plc_controller_rpc_io(cJSON * bodyPtr, httpChunkWriter_t * writerPtr)
+{
+  ioDto_t dto;
+  if ((bodyPtr == NULL) || (io_dto_decode(bodyPtr, &dto) != ESP_OK))
   {
-    return result;
+    return http_util_chunk_message(writerPtr, HTTPD_400, "Error decoding request body");
+  }
+
+  uint32_t jobId;
+  const int64_t deadlineUs = esp_timer_get_time() + ((int64_t)IO_BUDGET_MS * 1000);
+  if (io_execute(&dto, deadlineUs, NULL, &jobId))
+  {
+    return http_util_chunk_message(writerPtr, HTTPD_200, "OK");
   }
 
-  /* Recupera valor a ser enviado ao pino da estação */
-  result = get_json_int_value(root, "value", &dtoPtr->value); 
+  if (jobId == 0)
+  {
+    /* Fila cheia, módulo PLC indisponível */
+    return http_util_chunk_message(writerPtr, HTTPD_503, "Communication with PLC module failed");
+  }
 
-  if (result != ESP_OK)
+  http_util_chunk_printf(writerPtr, "{\"message\":\"Queued\",\"job\":%u}", jobId);
+  return HTTPD_202;
+}
+
+/**
+ * Escrita IO de outros transportes (udp_server.h), mesmo pipeline e
+ * validação de POST /plc/io. Prazo da escrita direta IO_BUDGET_MS
+ * 
+ * @param macPtr                    MAC da estação, 6 bytes
+ * @param value                     valor do pino, 0..100
+ * @param network                   rede da estação, PLC_UART_MODEL_NETWORK_AUTO = automática
+ * @param jobIdPtr                  id do job quando adiada
+ * @return plcControllerIoResult_t  resultado da escrita
+ */
+plcControllerIoResult_t plc_controller_io(const uint8_t * macPtr, uint32_t value, int32_t network,
+                                          uint32_t * jobIdPtr)
+{
+  if ((value > 100) || (network >= PLC_UART_PORT_COUNT) ||
+      ((network < 0) && (network != PLC_UART_MODEL_NETWORK_AUTO)))
   {
-    return result;
+    return PLC_CONTROLLER_IO_INVALID;
   }
 
-  /* Valida se valor do pino está no range adequado */
-  return (dtoPtr->value >= 0 && dtoPtr->value <= 100) ? ESP_OK : ESP_FAIL;
+  ioDto_t dto = {
+    .value = value,
+    .network = network,
+    .ttl = 0,
+  };
+  snprintf(dto.mac, sizeof(dto.mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+           macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5]);
+
+  const int64_t deadlineUs = esp_timer_get_time() + ((int64_t)IO_BUDGET_MS * 1000);
+  if (io_execute(&dto, deadlineUs, NULL, jobIdPtr))
+  {
+    return PLC_CONTROLLER_IO_DONE;
+  }
+
+  return (*jobIdPtr != 0) ? PLC_CONTROLLER_IO_QUEUED : PLC_CONTROLLER_IO_UNAVAILABLE;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Escreve body JSON da topologia a partir dos fragmentos de cada node
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ * @param topologyPtr estrutura a ser manipulada
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t topology_write(httpChunkWriter_t * writerPtr, const topology_t * topologyPtr)
+{
+  http_util_chunk_write(writerPtr, "{", 1);
+  /* Trata módulos do tipo concentrador (CCO) */
+  node_list_write(writerPtr, "cco", topologyPtr->cco, topologyPtr->ccoCount);
+  http_util_chunk_write(writerPtr, ",", 1);
+  /* Trata módulos do tipo estação (STA) */
+  node_list_write(writerPtr, "sta", topologyPtr->sta, topologyPtr->staCount);
+  return http_util_chunk_write(writerPtr, "}", 1);
+}
+
+/**
+ * Escreve array JSON de um tipo de módulo a partir dos fragmentos em cache
+ *      
+ * @param writerPtr       escritor da resposta em blocos
+ * @param keyName         nome a ser dado para array
+ * @param nodeBufferPtr   buffer de node a ser consumido
+ * @param nodeCount       quantidade de nodes a serem expostos 
+ */
+static void node_list_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                            const node_t * nodeBufferPtr, uint32_t nodeCount)
+{
+  http_util_chunk_write(writerPtr, "\"", 1);
+  http_util_chunk_write(writerPtr, keyName, strlen(keyName));
+  http_util_chunk_write(writerPtr, "\":[", 3);
+
+  for(uint32_t idx = 0; idx < nodeCount; idx++)
+  {
+    nodeFragment_t fragment;
+    node_fragment_get(&nodeBufferPtr[idx], &fragment);
+
+    if (idx != 0)
+    {
+      http_util_chunk_write(writerPtr, ",", 1);
+    }
+    http_util_chunk_write(writerPtr, fragment.json, fragment.length);
+  }
+
+  http_util_chunk_write(writerPtr, "]", 1);
+}
+
+/**
+ * Compara campos expostos pela API de dois nodes
+ * 
+ * @param nodeAPtr  primeiro node
+ * @param nodeBPtr  segundo node
+ * @return true     campos iguais
+ * @return false    algum campo diferente
+ */
+static bool node_equals(const node_t * nodeAPtr, const node_t * nodeBPtr)
+{
+  return (memcmp(nodeAPtr->mac, nodeBPtr->mac, sizeof(nodeAPtr->mac)) == 0) &&
+         (nodeAPtr->id == nodeBPtr->id) &&
+         (nodeAPtr->snr == nodeBPtr->snr) &&
+         (nodeAPtr->atenuation == nodeBPtr->atenuation) &&
+         (nodeAPtr->phase == nodeBPtr->phase) &&
+         (nodeAPtr->network == nodeBPtr->network);
+}
+
+/**
+ * Renderiza objeto JSON de um node no cache de fragmentos
+ * 
+ * @param fragmentPtr   fragmento a ser escrito
+ * @param nodePtr       node a ser renderizado
+ */
+static void node_fragment_render(nodeFragment_t * fragmentPtr, const node_t * nodePtr)
+{
+  const uint8_t * macPtr = nodePtr->mac;
+  int32_t length = snprintf(fragmentPtr->json, sizeof(fragmentPtr->json),
+                            "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"id\":%u,"
+                            "\"atenuation\":%u,\"snr\":%u,\"phase\":%u,\"network\":%u}",
+                            macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5],
+                            nodePtr->id, nodePtr->atenuation, nodePtr->snr, nodePtr->phase,
+                            nodePtr->network);
+
+  fragmentPtr->node = *nodePtr;
+  fragmentPtr->length = (length > 0) ? (size_t)length : 0;
+  fragmentPtr->valid = true;
+}
+
+/**
+ * Copia fragmento de um node renderizado na atualização da topologia. Node
+ * não acompanhado ou alterado desde a renderização é renderizado na cópia
+ * 
+ * @param nodePtr       node a ser escrito
+ * @param fragmentPtr   cópia do fragmento
+ */
+static void node_fragment_get(const node_t * nodePtr, nodeFragment_t * fragmentPtr)
+{
+  const int32_t slot = plc_topology_find_slot(nodePtr->mac);
+  bool found = false;
+
+  if (slot >= 0)
+  {
+    xSemaphoreTake(fragmentMutex, portMAX_DELAY);
+    found = nodeFragments[slot].valid && node_equals(&nodeFragments[slot].node, nodePtr);
+    if (found)
+    {
+      *fragmentPtr = nodeFragments[slot];
+    }
+    xSemaphoreGive(fragmentMutex);
+  }
+
+  if (found == false)
+  {
+    node_fragment_render(fragmentPtr, nodePtr);
+  }
+}
+
+/**
+ * Renderiza fragmento de node lido na atualização da topologia, somente
+ * quando novo no slot ou com campos alterados
+ * 
+ * @param slot      slot do node na tabela da topologia
+ * @param nodePtr   leitura atual do node
+ */
+static void topology_updated_listener(uint32_t slot, const node_t * nodePtr)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  xSemaphoreTake(fragmentMutex, portMAX_DELAY);
+  const bool unchanged = nodeFragments[slot].valid && node_equals(&nodeFragments[slot].node, nodePtr);
+  xSemaphoreGive(fragmentMutex);
+
+  if (unchanged)
+  {
+    return;
+  }
+
+  nodeFragment_t fragment;
+  node_fragment_render(&fragment, nodePtr);
+
+  xSemaphoreTake(fragmentMutex, portMAX_DELAY);
+  nodeFragments[slot] = fragment;
+  xSemaphoreGive(fragmentMutex);
+}
+
+/**
+ * Decodifica rota por node no formato /plc/nodes/{mac}/<recurso>
+ * 
+ * @param uriPtr        URI da requisição
+ * @param macOutPtr     MAC decodificado, 6 bytes
+ * @param resourcePtr   início do recurso solicitado após o MAC
+ * @return true         rota válida
+ * @return false        rota ou MAC inválido
+ */
+static bool node_uri_parse(const char * uriPtr, uint8_t * macOutPtr, const char ** resourcePtr)
+{
+  if (strncmp(uriPtr, NODE_URI_PREFIX, strlen(NODE_URI_PREFIX)) != 0)
+  {
+    return false;
+  }
+
+  /* MAC aceito com ou sem separador ":" */
+  const char * cursorPtr = &uriPtr[strlen(NODE_URI_PREFIX)];
+  uint32_t digits = 0;
+  bzero(macOutPtr, 6);
+  for (; (*cursorPtr != '/') && (*cursorPtr != '\0'); cursorPtr++)
+  {
+    if (*cursorPtr == ':')
+    {
+      continue;
+    }
+
+    const char digit = *cursorPtr;
+    uint8_t nibble;
+    if (digit >= '0' && digit <= '9')
+    {
+      nibble = digit - '0';
+    }
+    else if (digit >= 'a' && digit <= 'f')
+    {
+      nibble = digit - 'a' + 10;
+    }
+    else if (digit >= 'A' && digit <= 'F')
+    {
+      nibble = digit - 'A' + 10;
+    }
+    else
+    {
+      return false;
+    }
+
+    if (digits >= 12)
+    {
+      return false;
+    }
+    macOutPtr[digits / 2] |= (digits % 2 == 0) ? (nibble << 4) : nibble;
+    digits++;
+  }
+
+  if ((digits != 12) || (*cursorPtr != '/'))
+  {
+    return false;
+  }
+
+  *resourcePtr = cursorPtr + 1;
+  return true;
+}
+
+/**
+ * Envia histórico em RAM da qualidade do enlace de um node
+ * 
+ * @param req         requisição a ser respondida
+ * @param macPtr      MAC do node, 6 bytes
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t node_history_send(httpd_req_t * req, const uint8_t * macPtr)
+{
+  int32_t slot = plc_topology_find_slot(macPtr);
+  if (slot < 0)
+  {
+    /* Node nunca visto ou descartado da tabela */
+    http_util_send_response(req, HTTPD_404, "Node not found");
+    return ESP_FAIL;
+  }
+
+  /* Filtro opcional de resolução */
+  char query[32] = "";
+  char resolution[8] = "";
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    httpd_query_key_value(query, "resolution", resolution, sizeof(resolution));
+  }
+  const bool allResolutions = resolution[0] == '\0';
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_printf(&writer, "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\"",
+                         macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5]);
+  if (allResolutions || (strcmp(resolution, "raw") == 0))
+  {
+    history_raw_write(&writer, slot);
+  }
+  if (allResolutions || (strcmp(resolution, "minute") == 0))
+  {
+    history_rollup_write(&writer, "minute", slot, PLC_HISTORY_MINUTE);
+  }
+  if (allResolutions || (strcmp(resolution, "hour") == 0))
+  {
+    history_rollup_write(&writer, "hour", slot, PLC_HISTORY_HOUR);
+  }
+  http_util_chunk_write(&writer, "}", 1);
+
+  return http_util_chunk_end(&writer);
+}
+
+/**
+ * Envia telemetria persistida na flash de um node, lida sob demanda
+ * 
+ * @param req         requisição a ser respondida
+ * @param macPtr      MAC do node, 6 bytes
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t node_telemetry_send(httpd_req_t * req, const uint8_t * macPtr)
+{
+  /* Intervalo opcional, em segundos do relógio do sistema */
+  char query[48] = "";
+  char value[12] = "";
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK)
+    {
+      from = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK)
+    {
+      to = strtoul(value, NULL, 10);
+    }
+  }
+
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_printf(&writer, "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"samples\":[",
+                         macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5]);
+  telemetryWriteContext_t context = { .writerPtr = &writer, .count = 0 };
+  plc_telemetry_query(macPtr, from, to, telemetry_sample_write, &context);
+  http_util_chunk_write(&writer, "]}", 2);
+
+  return http_util_chunk_end(&writer);
+}
+
+/**
+ * Callback de consulta da telemetria, escreve amostra no corpo da resposta
+ * 
+ * @param samplePtr   amostra encontrada
+ * @param contextPtr  contexto de escrita, telemetryWriteContext_t
+ * @return true       continua consulta
+ * @return false      falha no envio, interrompe consulta
+ */
+static bool telemetry_sample_write(const plcHistorySample_t * samplePtr, void * contextPtr)
+{
+  telemetryWriteContext_t * writeContextPtr = contextPtr;
+  return http_util_chunk_printf(writeContextPtr->writerPtr,
+                                "%s{\"timestamp\":%u,\"snr\":%u,\"atenuation\":%u,\"phase\":%u}",
+                                writeContextPtr->count++ == 0 ? "" : ",",
+                                samplePtr->timestamp, samplePtr->snr,
+                                samplePtr->atenuation, samplePtr->phase) == ESP_OK;
+}
+
+/**
+ * Escreve array JSON de uma lista de destaque dos agregados
+ * 
+ * @param writerPtr       escritor da resposta em blocos
+ * @param keyName         nome a ser dado para array
+ * @param valueName       nome do campo de valor de cada node
+ * @param nodeBufferPtr   nodes da lista
+ * @param nodeCount       quantidade de nodes
+ * @param withAverage     inclui SNR médio
+ */
+static void stats_node_list_write(httpChunkWriter_t * writerPtr, const char * keyName, const char * valueName,
+                                  const plcStatsNode_t * nodeBufferPtr, uint32_t nodeCount, bool withAverage)
+{
+  http_util_chunk_printf(writerPtr, ",\"%s\":[", keyName);
+
+  for (uint32_t idx = 0; idx < nodeCount; idx++)
+  {
+    const uint8_t * macPtr = nodeBufferPtr[idx].mac;
+    http_util_chunk_printf(writerPtr, "%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"%s\":%u",
+                           idx == 0 ? "" : ",",
+                           macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5],
+                           valueName, nodeBufferPtr[idx].value);
+    if (withAverage)
+    {
+      http_util_chunk_printf(writerPtr, ",\"average\":%u", nodeBufferPtr[idx].average);
+    }
+    http_util_chunk_write(writerPtr, "}", 1);
+  }
+
+  http_util_chunk_write(writerPtr, "]", 1);
+}
+
+/**
+ * Escreve objeto JSON com percentis de uma etapa
+ * 
+ * @param writerPtr     escritor da resposta em blocos
+ * @param keyName       nome da etapa
+ * @param histogramPtr  histograma da etapa
+ * @param first         primeiro campo do objeto, sem separador
+ */
+static void uart_stage_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                             const latencyHistogram_t * histogramPtr, bool first)
+{
+  http_util_chunk_printf(writerPtr, "%s\"%s\":{\"count\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+                         first ? "" : ",", keyName, histogramPtr->total,
+                         latency_histogram_percentile(histogramPtr, 500),
+                         latency_histogram_percentile(histogramPtr, 900),
+                         latency_histogram_percentile(histogramPtr, 990),
+                         histogramPtr->max);
+}
+
+/**
+ * Escreve array JSON das amostras brutas de um node
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ * @param slot        slot do node na tabela da topologia
+ */
+static void history_raw_write(httpChunkWriter_t * writerPtr, uint32_t slot)
+{
+  http_util_chunk_write(writerPtr, ",\"raw\":[", 8);
+
+  plcHistorySample_t sample;
+  for (uint32_t idx = 0; plc_history_get_sample(slot, idx, &sample); idx++)
+  {
+    http_util_chunk_printf(writerPtr, "%s{\"timestamp\":%u,\"snr\":%u,\"atenuation\":%u,\"phase\":%u}",
+                           idx == 0 ? "" : ",", sample.timestamp, sample.snr,
+                           sample.atenuation, sample.phase);
+  }
+
+  http_util_chunk_write(writerPtr, "]", 1);
+}
+
+/**
+ * Escreve array JSON dos agregados de um node em uma resolução
+ * 
+ * @param writerPtr   escritor da resposta em blocos
+ * @param keyName     nome a ser dado para array
+ * @param slot        slot do node na tabela da topologia
+ * @param resolution  resolução dos agregados
+ */
+static void history_rollup_write(httpChunkWriter_t * writerPtr, const char * keyName,
+                                 uint32_t slot, plcHistoryResolution_t resolution)
+{
+  http_util_chunk_printf(writerPtr, ",\"%s\":[", keyName);
+
+  plcHistoryRollup_t rollup;
+  for (uint32_t idx = 0; plc_history_get_rollup(slot, resolution, idx, &rollup); idx++)
+  {
+    http_util_chunk_printf(writerPtr, "%s{\"timestamp\":%u,\"count\":%u,"
+                           "\"snr\":{\"min\":%u,\"max\":%u,\"mean\":%u},"
+                           "\"atenuation\":{\"min\":%u,\"max\":%u,\"mean\":%u}}",
+                           idx == 0 ? "" : ",", rollup.timestamp, rollup.count,
+                           rollup.snrMin, rollup.snrMax, rollup.snrMean,
+                           rollup.atenuationMin, rollup.atenuationMax, rollup.atenuationMean);
+  }
+
+  http_util_chunk_write(writerPtr, "]", 1);
+}
+
+/**
+ * Finaliza trace da requisição e define header Server-Timing da resposta
+ * 
+ * @param req               requisição a ser respondida
+ * @param tracePtr          trace da requisição
+ * @param result            resultado da requisição
+ * @param serverTimingPtr   buffer do header, válido até o envio da resposta
+ * @param serverTimingSize  tamanho do buffer do header
+ */
+static void trace_finish(httpd_req_t * req, plcTrace_t * tracePtr, bool result,
+                         char * serverTimingPtr, size_t serverTimingSize)
+{
+  plc_trace_end(tracePtr, result);
+  plc_trace_server_timing(tracePtr, serverTimingPtr, serverTimingSize);
+  httpd_resp_set_hdr(req, "Server-Timing", serverTimingPtr);
+}
+
+/**
+ * Transformação do body JSON recebido para identificação de um comando UART
+ * 
+ * @param bufferInPtr     estrutura JSON a ser lida
+ * @param bufferOutPtr    buffer de escrita do comando recebido
+ * @param bufferOutSize   tamanho do buffer disponível para escrita 
+ * @param networkPtr      rede de destino do comando
+ * @return esp_err_t      resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t dto_to_command(const char * bufferInPtr, char * bufferOutPtr, size_t bufferOutSize,
+                                int32_t * networkPtr)
+{
+  cJSON * root = cJSON_Parse(bufferInPtr);
+  if (root == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  esp_err_t result = get_json_string_value(root, "command", bufferOutPtr, bufferOutSize);
+  if (result == ESP_OK)
+  {
+    result = dto_to_network(root, PLC_UART_PORT_DEFAULT, networkPtr);
+  }
+
+  cJSON_Delete(root);
+  return result;
+}
+
+
+/**
+ * Transformação do body JSON recebido para identificação da manipulação de carga nas estações
+ * 
+ * @param bufferInPtr     estrutura JSON a ser lida
+ * @param dtoPtr    buffer de escrita do comando recebido
+ * @return esp_err_t      resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t dto_to_io_command(const char * bufferInPtr, ioDto_t * dtoPtr)
+{
+  cJSON * root = cJSON_Parse(bufferInPtr);
+  if (root == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  const esp_err_t result = io_dto_decode(root, dtoPtr);
+  cJSON_Delete(root);
+  return result;
+}
+
+/**
+ * Decodifica objeto JSON de escrita IO, body de /plc/io ou de uma chamada
+ * do lote /rpc
+ * 
+ * @param root        objeto JSON
+ * @param dtoPtr      estrutura de escrita da requisição
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t io_dto_decode(cJSON * root, ioDto_t * dtoPtr)
+{
+  /* Recupera MAC da estação a ser manipulada */
+  esp_err_t result = get_json_string_value(root, "mac", dtoPtr->mac, sizeof(dtoPtr->mac));
+
+  if (result == ESP_OK)
+  {
+    /* Recupera valor a ser enviado ao pino da estação */
+    result = get_json_int_value(root, "value", &dtoPtr->value); 
+  }
+
+  if (result == ESP_OK)
+  {
+    result = dto_to_network(root, PLC_UART_MODEL_NETWORK_AUTO, &dtoPtr->network);
+  }
+
+  /* Prazo opcional da escrita adiada */
+  dtoPtr->ttl = 0;
+  if ((result == ESP_OK) && (cJSON_GetObjectItem(root, "ttl") != NULL))
+  {
+    result = get_json_int_value(root, "ttl", &dtoPtr->ttl);
+    result = (dtoPtr->ttl <= PLC_IO_QUEUE_MAX_TTL_MS) ? result : ESP_FAIL;
+  }
+
+  if (result != ESP_OK)
+  {
+    return result;
+  }
+
+  /* Valida se valor do pino está no range adequado */
+  return (dtoPtr->value >= 0 && dtoPtr->value <= 100) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * Executa escrita IO. Adiada para a fila (plc_io_queue.h) com o módulo
+ * indisponível, com escrita pendente para o mesmo MAC ou se a escrita falhar
+ * 
+ * @param dtoPtr      escrita decodificada, MAC normalizado sem separadores
+ * @param deadlineUs  prazo absoluto da escrita direta
+ * @param tracePtr    trace da requisição, NULL = sem trace
+ * @param jobIdPtr    id do job quando adiada, 0 = fila cheia
+ * @return true       escrita concluída no módulo
+ * @return false      escrita adiada ou recusada, ver jobIdPtr
+ */
+static bool io_execute(ioDto_t * dtoPtr, int64_t deadlineUs, plcTrace_t * tracePtr, uint32_t * jobIdPtr)
+{
+  *jobIdPtr = 0;
+
+  /* Envia comando, exceto se for necessário adiar */
+  const uint32_t port = plc_uart_model_resolve_network(dtoPtr->network, dtoPtr->mac);
+  const bool defer = (plc_health_is_up(port) == false) || plc_io_queue_pending(dtoPtr->mac);
+  if ((defer == false) && plc_uart_model_io(port, dtoPtr->mac, dtoPtr->value, deadlineUs, tracePtr))
+  {
+    plc_events_io_ack(dtoPtr->mac, dtoPtr->value, 0);
+    return true;
+  }
+
+  *jobIdPtr = plc_io_queue_submit(port, dtoPtr->mac, dtoPtr->value, dtoPtr->ttl);
+  return false;
+}
+
+/**
+ * Recupera campo opcional "network" do body
+ * 
+ * @param root            JSON a ser lido
+ * @param defaultNetwork  rede quando o campo é omitido
+ * @param networkPtr      rede lida
+ * @return esp_err_t      resultado da operação, rede inexistente = ESP_FAIL
+ */
+static esp_err_t dto_to_network(cJSON * root, int32_t defaultNetwork, int32_t * networkPtr)
+{
+  if (cJSON_GetObjectItem(root, "network") == NULL)
+  {
+    *networkPtr = defaultNetwork;
+    return ESP_OK;
+  }
+
+  uint32_t network;
+  esp_err_t result = get_json_int_value(root, "network", &network);
+  if ((result != ESP_OK) || (network >= PLC_UART_PORT_COUNT))
+  {
+    return ESP_FAIL;
+  }
+
+  *networkPtr = network;
+  return ESP_OK;
+}
+
+/**
+ * Responde 202 para operação adiada, Location aponta para o job
+ * 
+ * @param req           requisição a ser respondida
+ * @param uriPrefixPtr  prefixo da rota de consulta do job
+ * @param jobId         id do job
+ * @return esp_err_t    resultado da operação, sucesso = ESP_OK
+ */
+static esp_err_t job_accepted_send(httpd_req_t * req, const char * uriPrefixPtr, uint32_t jobId)
+{
+  char location[32];
+  snprintf(location, sizeof(location), "%s%u", uriPrefixPtr, jobId);
+  snprintf(json_buffer_get(), json_buffer_get_size(),
+           "{\"message\":\"Queued\",\"job\":%u}", jobId);
+
+  httpd_resp_set_status(req, HTTPD_202);
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpd_resp_set_hdr(req, "Location", location);
+  return httpd_resp_send(req, json_buffer_get(), HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * Extrai id numérico do job do fim da URI, /prefixo/{id}[?query]
+ * 
+ * @param uriPtr        URI da requisição
+ * @param uriPrefixPtr  prefixo da rota, já validado pelo roteamento
+ * @param idPtr         id do job extraído
+ * @return true         URI válida
+ * @return false        id ausente ou com caracteres inválidos
+ */
+static bool job_uri_parse(const char * uriPtr, const char * uriPrefixPtr, uint32_t * idPtr)
+{
+  char * endPtr = NULL;
+  const char * idStartPtr = uriPtr + strlen(uriPrefixPtr);
+  *idPtr = strtoul(idStartPtr, &endPtr, 10);
+
+  return (endPtr != idStartPtr) && ((*endPtr == '\0') || (*endPtr == '?'));
+}
+
+/**
+ * Escreve saída de um job como itens de array JSON, uma string por linha
+ * 
+ * @param writerPtr   escritor da resposta
+ * @param outputPtr   linhas separadas por "\n", modificado durante a escrita
+ */
+static void job_output_write(httpChunkWriter_t * writerPtr, char * outputPtr)
+{
+  char * linePtr = outputPtr;
+  bool first = true;
+  while (*linePtr != '\0')
+  {
+    char * endPtr = strchr(linePtr, '\n');
+    if (endPtr != NULL)
+    {
+      *endPtr = '\0';
+    }
+
+    if (!first)
+    {
+      http_util_chunk_write(writerPtr, ",", 1);
+    }
+    http_util_chunk_json_string(writerPtr, linePtr);
+    first = false;
+
+    if (endPtr == NULL)
+    {
+      break;
+    }
+    linePtr = endPtr + 1;
+  }
+}
+
+/**
+ * Escreve JSON de um job: estado, comando, linhas da resposta e tempos
+ * 
+ * @param writerPtr   escritor em uso
+ * @param jobPtr      cópia do job, saída alterada durante a escrita
+ */
+static void job_write(httpChunkWriter_t * writerPtr, plcJob_t * jobPtr)
+{
+  http_util_chunk_printf(writerPtr, "{\"job\":%u,\"status\":\"%s\",\"network\":%u,\"command\":",
+                         jobPtr->id, plc_jobs_state_name(jobPtr->state), jobPtr->network);
+  http_util_chunk_json_string(writerPtr, jobPtr->command);
+  http_util_chunk_write(writerPtr, ",\"lines\":[", 10);
+  job_output_write(writerPtr, jobPtr->output);
+
+  /* Tempos em us: espera na fila, até a primeira linha, execução e total */
+  const int64_t nowUs = esp_timer_get_time();
+  const int64_t startedUs = (jobPtr->startedUs != 0) ? jobPtr->startedUs : nowUs;
+  const int64_t finishedUs = (jobPtr->finishedUs != 0) ? jobPtr->finishedUs : nowUs;
+  const int64_t firstLineUs = (jobPtr->firstLineUs != 0) ? (jobPtr->firstLineUs - startedUs) : 0;
+  const int64_t executionUs = (jobPtr->startedUs != 0) ? (finishedUs - startedUs) : 0;
+  http_util_chunk_printf(writerPtr, "],\"truncated\":%s,\"timing\":{\"queue\":%u,\"firstLine\":%u,"
+                         "\"execution\":%u,\"total\":%u}}",
+                         jobPtr->truncated ? "true" : "false", (uint32_t)(startedUs - jobPtr->createdUs),
+                         (uint32_t)firstLineUs, (uint32_t)executionUs, (uint32_t)(finishedUs - jobPtr->createdUs));
+}
+
+/**
+ * Registra consulta aguardando a conclusão de um job como contexto da
+ * sessão HTTP, o handler retorna sem responder
+ * 
+ * @param req     requisição aguardando
+ * @param jobId   job consultado
+ * @param waitMs  espera máxima, limitada a PLC_JOBS_MAX_WAIT_MS
+ * @return true   consulta registrada
+ * @return false  sem posição livre ou sessão com outro contexto, responder agora
+ */
+static bool job_wait_add(httpd_req_t * req, uint32_t jobId, uint32_t waitMs)
+{
+  jobWaiter_t * waiterPtr = NULL;
+  for (uint32_t idx = 0; (idx < JOB_WAITERS) && (waiterPtr == NULL); idx++)
+  {
+    if (jobWaiters[idx].used == false)
+    {
+      waiterPtr = &jobWaiters[idx];
+    }
+  }
+
+  if ((waiterPtr == NULL) || (req->sess_ctx != NULL))
+  {
+    return false;
+  }
+
+  waitMs = (waitMs < PLC_JOBS_MAX_WAIT_MS) ? waitMs : PLC_JOBS_MAX_WAIT_MS;
+  waiterPtr->used = true;
+  waiterPtr->fd = httpd_req_to_sockfd(req);
+  waiterPtr->jobId = jobId;
+  waiterPtr->deadlineUs = esp_timer_get_time() + ((int64_t)waitMs * 1000);
+
+  /* Liberada pelo servidor se a sessão encerrar antes da resposta */
+  req->sess_ctx = waiterPtr;
+  req->free_ctx = job_wait_session_closed;
+
+  /* Job concluído entre a consulta e o registro, ou novo prazo mais próximo */
+  job_wait_schedule();
+  return true;
+}
+
+/**
+ * Libera posição da consulta, executada pelo servidor ao encerrar a sessão
+ * ou ao remover o contexto após a resposta
+ * 
+ * @param ctxPtr  consulta da sessão
+ */
+static void job_wait_session_closed(void * ctxPtr)
+{
+  jobWaiter_t * waiterPtr = ctxPtr;
+  waiterPtr->used = false;
+}
+
+/**
+ * Notificação de conclusão de job, executada na task dos jobs
+ * 
+ * @param id  job concluído
+ */
+static void job_completed_listener(uint32_t id)
+{
+  job_wait_schedule();
+}
+
+/**
+ * Fim de espera de uma consulta
+ * 
+ * @param arg   não utilizado
+ */
+static void job_wait_timer_callback(void * arg)
+{
+  job_wait_schedule();
+}
+
+/**
+ * Agenda verificação das consultas na task do servidor HTTP, notificações
+ * seguidas geram um único agendamento
+ * 
+ */
+static void job_wait_schedule(void)
+{
+  if (__atomic_exchange_n(&waitQueued, true, __ATOMIC_ACQ_REL))
+  {
+    return;
+  }
+
+  if (httpd_queue_work(serverHandle, job_wait_work, NULL) != ESP_OK)
+  {
+    __atomic_store_n(&waitQueued, false, __ATOMIC_RELEASE);
+  }
+}
+
+/**
+ * Responde consultas com job concluído ou prazo esgotado e programa o timer
+ * para o fim de espera mais próximo das restantes
+ * 
+ * @param arg   não utilizado
+ */
+static void job_wait_work(void * arg)
+{
+  /* Notificações a partir daqui geram novo agendamento */
+  __atomic_store_n(&waitQueued, false, __ATOMIC_RELEASE);
+
+  const int64_t nowUs = esp_timer_get_time();
+  int64_t nextDeadlineUs = INT64_MAX;
+  for (uint32_t idx = 0; idx < JOB_WAITERS; idx++)
+  {
+    jobWaiter_t * waiterPtr = &jobWaiters[idx];
+    if (waiterPtr->used == false)
+    {
+      continue;
+    }
+
+    const bool found = plc_jobs_get(waiterPtr->jobId, &jobCopy);
+    if (found && (plc_jobs_finished(&jobCopy) == false) && (nowUs < waiterPtr->deadlineUs))
+    {
+      nextDeadlineUs = (waiterPtr->deadlineUs < nextDeadlineUs) ? waiterPtr->deadlineUs : nextDeadlineUs;
+      continue;
+    }
+
+    job_wait_respond(waiterPtr, found);
+  }
+
+  esp_timer_stop(waitTimer);
+  if (nextDeadlineUs != INT64_MAX)
+  {
+    esp_timer_start_once(waitTimer, nextDeadlineUs - nowUs);
+  }
+}
+
+/**
+ * Envia resposta de uma consulta aguardada, job em jobCopy, e libera a
+ * posição. Falha de envio encerra a sessão
+ * 
+ * @param waiterPtr   consulta a ser respondida
+ * @param found       job encontrado, false = entrada reaproveitada
+ */
+static void job_wait_respond(jobWaiter_t * waiterPtr, bool found)
+{
+  const int fd = waiterPtr->fd;
+  char header[sizeof(jobWaitHeader) + 32];
+  const int32_t headerLength = snprintf(header, sizeof(header), jobWaitHeader, found ? HTTPD_200 : HTTPD_404);
+
+  httpChunkWriter_t writer;
+  http_util_chunk_begin_socket(&writer, serverHandle, fd, json_buffer_get(), json_buffer_get_size());
+  if (httpd_socket_send(serverHandle, fd, header, headerLength, 0) != headerLength)
+  {
+    writer.result = ESP_FAIL;
+  }
+
+  if (found)
+  {
+    job_write(&writer, &jobCopy);
+  }
+  else
+  {
+    http_util_chunk_message(&writer, HTTPD_404, "Job not found");
+  }
+  const esp_err_t result = http_util_chunk_end(&writer);
+
+  /* Sessão segue aberta (keep-alive) sem o contexto da consulta */
+  waiterPtr->used = false;
+  httpd_sess_set_ctx(serverHandle, fd, NULL, NULL);
+  if (result != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Job wait response failed on %d", fd);
+    httpd_sess_trigger_close(serverHandle, fd);
+  }
+}
+
+/**
+ * Envia cada linha do stream de um comando assim que recebida, até a
+ * conclusão do job. Cabeçalhos enviados somente com a primeira linha, sem
+ * linhas o código HTTP fica a cargo do chamador
+ * 
+ * @param req               requisição a ser respondida
+ * @param jobId             job dono do stream
+ * @param writerPtr         escritor da resposta, iniciado na primeira linha
+ * @param tracePtr          trace da requisição, finalizado na primeira linha
+ * @param serverTimingPtr   buffer do header Server-Timing
+ * @param serverTimingSize  tamanho do buffer
+ * @param streamedPtr       indica se alguma linha foi enviada
+ * @return esp_err_t        resultado dos envios, ESP_FAIL = cliente desconectado
+ */
+static esp_err_t command_stream_send(httpd_req_t * req, uint32_t jobId, httpChunkWriter_t * writerPtr,
+                                     plcTrace_t * tracePtr, char * serverTimingPtr, size_t serverTimingSize,
+                                     bool * streamedPtr)
+{
+  *streamedPtr = false;
+
+  for (;;)
+  {
+    const int32_t length = plc_jobs_stream_read(jobId, streamLine, sizeof(streamLine), STREAM_POLL_MS);
+    if (length < 0)
+    {
+      /* Job concluído, todas as linhas entregues */
+      return ESP_OK;
+    }
+
+    if (length == 0)
+    {
+      continue;
+    }
+
+    if (*streamedPtr == false)
+    {
+      /* Server-Timing com o tempo até o primeiro byte ao cliente */
+      plc_trace_mark(tracePtr, PLC_TRACE_STAGE_MODULE);
+      trace_finish(req, tracePtr, true, serverTimingPtr, serverTimingSize);
+      httpd_resp_set_type(req, COMMAND_OUTPUT_TYPE);
+      http_util_chunk_begin(writerPtr, req, json_buffer_get(), json_buffer_get_size());
+      *streamedPtr = true;
+    }
+
+    http_util_chunk_write(writerPtr, streamLine, length);
+    http_util_chunk_write(writerPtr, "\n", 1);
+    if (http_util_chunk_flush(writerPtr) != ESP_OK)
+    {
+      /* Cliente desconectado, job segue até a conclusão */
+      return ESP_FAIL;
+    }
+  }
+}
+
+/**
+ * Calcula prazo absoluto dos comandos UART de uma requisição: orçamento do
+ * endpoint, ou o tempo informado pelo cliente em X-Request-Timeout se menor
+ * 
+ * @param req         requisição em tratamento
+ * @param budgetMs    orçamento do endpoint
+ * @return int64_t    prazo absoluto (esp_timer_get_time)
+ */
+static int64_t request_deadline(httpd_req_t * req, uint32_t budgetMs)
+{
+  char value[12];
+  if (httpd_req_get_hdr_value_str(req, TIMEOUT_HEADER, value, sizeof(value)) == ESP_OK)
+  {
+    char * endPtr = NULL;
+    const uint32_t clientMs = strtoul(value, &endPtr, 10);
+    if ((endPtr != value) && (clientMs < budgetMs))
+    {
+      budgetMs = clientMs;
+    }
+  }
+
+  return esp_timer_get_time() + ((int64_t)budgetMs * 1000);
+}
+
+/**
+ * Envia resposta JSON e guarda o resultado para repetições com a mesma
+ * Idempotency-Key
+ * 
+ * @param req         requisição a ser respondida
+ * @param ticketPtr   reserva da requisição no cache de idempotência
+ * @param httpCode    código HTTP para inserir na reposta
+ * @param messagePtr  mensagem a ser inserida no body JSON
+ * @return esp_err_t  retorno da operação, sucesso = ESP_OK
+ */
+static esp_err_t ticket_respond(httpd_req_t * req, idempotencyTicket_t * ticketPtr, const char * httpCode,
+                                const char * messagePtr)
+{
+  const esp_err_t result = http_util_send_response(req, httpCode, messagePtr);
+  idempotency_finish(ticketPtr, httpCode, HTTPD_TYPE_JSON, json_buffer_get());
+  return result;
 }
 
 
@@ -12,10 +12,22 @@
 * INCLUDES
 *******************************************************************************/
 #include <esp_http_server.h>
+#include "http_util.h"
 
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Resultado de uma escrita IO recebida fora do HTTP */
+typedef enum plcControllerIoResult_t
+{
+  PLC_CONTROLLER_IO_DONE = 0,
+  /* Adiada para a fila de escritas, id do job retornado */
+  PLC_CONTROLLER_IO_QUEUED,
+  /* Fila cheia, módulo PLC indisponível */
+  PLC_CONTROLLER_IO_UNAVAILABLE,
+  /* Valor ou rede fora do range */
+  PLC_CONTROLLER_IO_INVALID,
+} plcControllerIoResult_t;
 
 /*******************************************************************************
 * TYPEDEFS
@@ -24,9 +36,22 @@
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
+void plc_controller_init(httpd_handle_t server);
+uint32_t plc_controller_admission_retry(void);
 esp_err_t plc_controller_get_topology(httpd_req_t * req);
 esp_err_t plc_controller_post_command(httpd_req_t * req);
 esp_err_t plc_controller_post_io(httpd_req_t * req);
+esp_err_t plc_controller_get_io_job(httpd_req_t * req);
+esp_err_t plc_controller_post_job(httpd_req_t * req);
+esp_err_t plc_controller_get_job(httpd_req_t * req);
+esp_err_t plc_controller_get_node(httpd_req_t * req);
+esp_err_t plc_controller_get_stats(httpd_req_t * req);
+esp_err_t plc_controller_get_uart_stats(httpd_req_t * req);
+esp_err_t plc_controller_delete_uart_stats(httpd_req_t * req);
+const char * plc_controller_rpc_topology(cJSON * bodyPtr, httpChunkWriter_t * writerPtr);
+const char * plc_controller_rpc_io(cJSON * bodyPtr, httpChunkWriter_t * writerPtr);
+plcControllerIoResult_t plc_controller_io(const uint8_t * macPtr, uint32_t value, int32_t network,
+                                          uint32_t * jobIdPtr);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -0,0 +1,243 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "rpc_controller.h"
+#include <string.h>
+#include <stdlib.h>
+#include "json_buffer.h"
+#include "plc_controller.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Alinhamento das alocações na memória do lote */
+#define ARENA_ALIGN   8
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static const rpcRoute_t * routeTablePtr;
+static uint32_t routeTableCount;
+/* Memória da árvore JSON do lote, reiniciada a cada lote */
+static uint8_t arena[RPC_ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+static size_t arenaUsed;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static cJSON * batch_parse(const char * bodyPtr);
+static void call_execute(httpChunkWriter_t * writerPtr, cJSON * callPtr);
+static const rpcRoute_t * route_find(const char * methodPtr, const char * uriPtr);
+static void * arena_malloc(size_t size);
+static void arena_free(void * ptr);
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Define rotas disponíveis no lote
+ * 
+ * @param routesPtr   tabela de rotas
+ * @param routeCount  quantidade de rotas
+ */
+void rpc_controller_init(const rpcRoute_t * routesPtr, uint32_t routeCount)
+{
+  routeTablePtr = routesPtr;
+  routeTableCount = routeCount;
+}
+
+/**
+ * Serviço Web para executar lote de chamadas, formato em rpc_controller.h.
+ * Chamadas executadas em sequência, cada resultado enviado ao cliente ao
+ * fim da sua chamada
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  resultado da operação, sucesso = ESP_OK
+ */
+esp_err_t rpc_controller_post(httpd_req_t * req)
+{
+  esp_err_t result = http_read_body(req, json_buffer_get(), json_buffer_get_size());
+  if (result != ESP_OK)
+  {
+    /* Resposta de erro enviada na leitura */
+    return result;
+  }
+
+  cJSON * batchPtr = batch_parse(json_buffer_get());
+  if ((cJSON_IsArray(batchPtr) == false) || (cJSON_GetArraySize(batchPtr) > RPC_MAX_CALLS))
+  {
+    /* JSON inválido, maior que a memória do lote ou com chamadas demais */
+    http_util_send_response(req, HTTPD_400, "Error decoding request body");
+    return ESP_FAIL;
+  }
+
+  /* Strings copiadas para a árvore, buffer do body reutilizado na resposta */
+  httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
+
+  http_util_chunk_write(&writer, "[", 1);
+  cJSON * callPtr;
+  cJSON_ArrayForEach(callPtr, batchPtr)
+  {
+    if (callPtr != batchPtr->child)
+    {
+      http_util_chunk_write(&writer, ",", 1);
+    }
+    call_execute(&writer, callPtr);
+
+    if (http_util_chunk_flush(&writer) != ESP_OK)
+    {
+      /* Cliente desconectado, chamadas restantes não executadas */
+      return ESP_FAIL;
+    }
+  }
+  http_util_chunk_write(&writer, "]", 1);
+
+  return http_util_chunk_end(&writer);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Decodifica lote na memória estática. cJSON usado somente na task do
+ * servidor HTTP, alocação trocada apenas durante a decodificação. A árvore
+ * não deve ser liberada com cJSON_Delete, vale até o próximo lote
+ * 
+ * @param bodyPtr   body recebido
+ * @return cJSON*   árvore do lote, NULL = JSON inválido ou memória esgotada
+ */
+static cJSON * batch_parse(const char * bodyPtr)
+{
+  cJSON_Hooks hooks = { .malloc_fn = arena_malloc, .free_fn = arena_free };
+
+  arenaUsed = 0;
+  cJSON_InitHooks(&hooks);
+  cJSON * batchPtr = cJSON_Parse(bodyPtr);
+  cJSON_InitHooks(NULL);
+
+  return batchPtr;
+}
+
+/**
+ * Executa uma chamada do lote e escreve seu resultado
+ * 
+ * @param writerPtr   escritor da resposta
+ * @param callPtr     chamada, {"id", "method", "uri", "body"}
+ */
+static void call_execute(httpChunkWriter_t * writerPtr, cJSON * callPtr)
+{
+  /* Identificador devolvido como recebido, número ou string */
+  const cJSON * idPtr = cJSON_GetObjectItem(callPtr, "id");
+  http_util_chunk_write(writerPtr, "{\"id\":", 6);
+  if (cJSON_IsNumber(idPtr))
+  {
+    http_util_chunk_printf(writerPtr, "%d", idPtr->valueint);
+  }
+  else if (cJSON_IsString(idPtr))
+  {
+    http_util_chunk_json_string(writerPtr, idPtr->valuestring);
+  }
+  else
+  {
+    http_util_chunk_write(writerPtr, "null", 4);
+  }
+  http_util_chunk_write(writerPtr, ",\"body\":", 8);
+
+  const cJSON * methodPtr = cJSON_GetObjectItem(callPtr, "method");
+  const cJSON * uriPtr = cJSON_GetObjectItem(callPtr, "uri");
+  const char * statusPtr;
+  if ((cJSON_IsString(methodPtr) == false) || (cJSON_IsString(uriPtr) == false))
+  {
+    statusPtr = http_util_chunk_message(writerPtr, HTTPD_400, "Missing method or uri");
+  }
+  else
+  {
+    const rpcRoute_t * routePtr = route_find(methodPtr->valuestring, uriPtr->valuestring);
+    if (routePtr == NULL)
+    {
+      statusPtr = http_util_chunk_message(writerPtr, HTTPD_404, "Not found");
+    }
+    else if (routePtr->usesUart && (plc_controller_admission_retry() != 0))
+    {
+      /* Mesmo controle de admissão do endpoint equivalente */
+      statusPtr = http_util_chunk_message(writerPtr, HTTPD_503, "PLC module busy");
+    }
+    else
+    {
+      statusPtr = routePtr->handler(cJSON_GetObjectItem(callPtr, "body"), writerPtr);
+    }
+  }
+
+  /* Código numérico do status HTTP, ex. "200 OK" */
+  http_util_chunk_printf(writerPtr, ",\"status\":%u}", (uint32_t)strtoul(statusPtr, NULL, 10));
+}
+
+/**
+ * Localiza rota do lote pelo método e URI
+ * 
+ * @param methodPtr           método HTTP, ex. "GET"
+ * @param uriPtr              URI do endpoint
+ * @return const rpcRoute_t*  rota, NULL = inexistente
+ */
+static const rpcRoute_t * route_find(const char * methodPtr, const char * uriPtr)
+{
+  for (uint32_t idx = 0; idx < routeTableCount; idx++)
+  {
+    const rpcRoute_t * routePtr = &routeTablePtr[idx];
+    if ((strcmp(routePtr->uri, uriPtr) == 0) && (strcmp(http_method_str(routePtr->method), methodPtr) == 0))
+    {
+      return routePtr;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Alocação sequencial na memória do lote
+ * 
+ * @param size    tamanho solicitado
+ * @return void*  memória alocada, NULL = memória do lote esgotada
+ */
+static void * arena_malloc(size_t size)
+{
+  const size_t alignedSize = (size + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+  if (alignedSize > (sizeof(arena) - arenaUsed))
+  {
+    return NULL;
+  }
+
+  void * ptr = &arena[arenaUsed];
+  arenaUsed += alignedSize;
+  return ptr;
+}
+
+/**
+ * Liberação individual sem efeito, memória reiniciada a cada lote
+ * 
+ * @param ptr   memória alocada por arena_malloc
+ */
+static void arena_free(void * ptr)
+{
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,61 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef RPC_CONTROLLER_H
+#define RPC_CONTROLLER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <esp_http_server.h>
+#include <stdint.h>
+#include "http_util.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Lote de chamadas em uma requisição, POST /rpc:
+ *   [{"id": 1, "method": "GET", "uri": "/plc/topology"},
+ *    {"id": 2, "method": "POST", "uri": "/plc/io", "body": {"mac": "...", "value": 50}}]
+ * Resposta em blocos, um resultado por chamada na ordem do lote, enviado ao
+ * fim de cada chamada:
+ *   [{"id": 1, "body": {...}, "status": 200}, ...]
+ * Chamadas que ocupam a UART seguem o controle de admissão dos endpoints,
+ * recusadas individualmente com status 503
+ * A árvore JSON do lote fica em memória estática, sem alocação no heap
+ */
+/* Maior quantidade de chamadas por lote */
+#define RPC_MAX_CALLS     16
+/* Memória da árvore JSON do lote, cerca de 370 bytes por chamada /plc/io.
+   Lote maior responde 400 */
+#define RPC_ARENA_SIZE    8192
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Executa uma chamada: escreve o body do resultado e retorna o código HTTP */
+typedef const char * (*rpcHandler_t)(cJSON * bodyPtr, httpChunkWriter_t * writerPtr);
+
+/* Rota disponível no lote, mesma URI e método do endpoint equivalente */
+typedef struct rpcRoute_t
+{
+  const char * uri;
+  httpd_method_t method;
+  rpcHandler_t handler;
+  /* Ocupa a UART, recusada com 503 pelo controle de admissão */
+  bool usesUart;
+} rpcRoute_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void rpc_controller_init(const rpcRoute_t * routesPtr, uint32_t routeCount);
+esp_err_t rpc_controller_post(httpd_req_t * req);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,163 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "udp_protocol.h"
+#include <string.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static size_t encode_nodes(uint8_t * bufferPtr, const node_t * nodesPtr, uint32_t count);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Decodifica cabeçalho de uma mensagem recebida
+ * 
+ * @param dataPtr     mensagem recebida
+ * @param length      tamanho da mensagem
+ * @param headerPtr   cabeçalho decodificado
+ * @return true       cabeçalho válido
+ * @return false      mensagem curta, versão ou tipo desconhecido
+ */
+bool udp_protocol_decode_header(const uint8_t * dataPtr, size_t length, udpHeader_t * headerPtr)
+{
+  if ((length < UDP_PROTOCOL_HEADER_SIZE) || (dataPtr[0] != UDP_PROTOCOL_VERSION) || (dataPtr[1] > UDP_TYPE_ACK))
+  {
+    return false;
+  }
+
+  headerPtr->type = dataPtr[1];
+  headerPtr->messageId = ((uint16_t)dataPtr[2] << 8) | dataPtr[3];
+  headerPtr->code = dataPtr[4];
+  return true;
+}
+
+/**
+ * Decodifica payload da requisição IO
+ * 
+ * @param dataPtr   payload, após o cabeçalho
+ * @param length    tamanho do payload
+ * @param ioPtr     requisição decodificada
+ * @return true     payload válido
+ * @return false    tamanho incorreto
+ */
+bool udp_protocol_decode_io(const uint8_t * dataPtr, size_t length, udpIoRequest_t * ioPtr)
+{
+  if (length != UDP_PROTOCOL_IO_SIZE)
+  {
+    return false;
+  }
+
+  memcpy(ioPtr->mac, dataPtr, sizeof(ioPtr->mac));
+  ioPtr->value = dataPtr[6];
+  ioPtr->network = dataPtr[7];
+  return true;
+}
+
+/**
+ * Escreve cabeçalho da resposta: ACK para CON, NON para NON
+ * 
+ * @param bufferPtr   buffer de escrita, UDP_PROTOCOL_HEADER_SIZE bytes
+ * @param requestPtr  cabeçalho da requisição
+ * @param code        código da resposta
+ * @return size_t     bytes escritos
+ */
+size_t udp_protocol_encode_response(uint8_t * bufferPtr, const udpHeader_t * requestPtr, udpCode_t code)
+{
+  bufferPtr[0] = UDP_PROTOCOL_VERSION;
+  bufferPtr[1] = (requestPtr->type == UDP_TYPE_CON) ? UDP_TYPE_ACK : UDP_TYPE_NON;
+  bufferPtr[2] = requestPtr->messageId >> 8;
+  bufferPtr[3] = requestPtr->messageId & 0xFF;
+  bufferPtr[4] = code;
+  return UDP_PROTOCOL_HEADER_SIZE;
+}
+
+/**
+ * Escreve inteiro de 32 bits
+ * 
+ * @param bufferPtr   buffer de escrita, 4 bytes
+ * @param value       valor
+ * @return size_t     bytes escritos
+ */
+size_t udp_protocol_encode_u32(uint8_t * bufferPtr, uint32_t value)
+{
+  bufferPtr[0] = value >> 24;
+  bufferPtr[1] = (value >> 16) & 0xFF;
+  bufferPtr[2] = (value >> 8) & 0xFF;
+  bufferPtr[3] = value & 0xFF;
+  return sizeof(uint32_t);
+}
+
+/**
+ * Escreve payload da topologia, concentradores seguidos das estações
+ * 
+ * @param bufferPtr     buffer de escrita, até UDP_PROTOCOL_MAX_RESPONSE - UDP_PROTOCOL_HEADER_SIZE bytes
+ * @param topologyPtr   topologia
+ * @return size_t       bytes escritos
+ */
+size_t udp_protocol_encode_topology(uint8_t * bufferPtr, const topology_t * topologyPtr)
+{
+  bufferPtr[0] = topologyPtr->ccoCount + topologyPtr->staCount;
+  size_t length = 1;
+  length += encode_nodes(&bufferPtr[length], topologyPtr->cco, topologyPtr->ccoCount);
+  length += encode_nodes(&bufferPtr[length], topologyPtr->sta, topologyPtr->staCount);
+  return length;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Escreve lista de nodes da topologia
+ * 
+ * @param bufferPtr   buffer de escrita
+ * @param nodesPtr    nodes
+ * @param count       quantidade de nodes
+ * @return size_t     bytes escritos
+ */
+static size_t encode_nodes(uint8_t * bufferPtr, const node_t * nodesPtr, uint32_t count)
+{
+  for (uint32_t idx = 0; idx < count; idx++)
+  {
+    uint8_t * nodeBufferPtr = &bufferPtr[idx * UDP_PROTOCOL_NODE_SIZE];
+    memcpy(nodeBufferPtr, nodesPtr[idx].mac, sizeof(nodesPtr[idx].mac));
+    nodeBufferPtr[6] = nodesPtr[idx].role;
+    nodeBufferPtr[7] = nodesPtr[idx].snr;
+    nodeBufferPtr[8] = nodesPtr[idx].atenuation;
+    nodeBufferPtr[9] = nodesPtr[idx].phase;
+    nodeBufferPtr[10] = nodesPtr[idx].network;
+  }
+
+  return count * UDP_PROTOCOL_NODE_SIZE;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
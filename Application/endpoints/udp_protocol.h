@@ -0,0 +1,105 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef UDP_PROTOCOL_H
+#define UDP_PROTOCOL_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "plc_topology.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Protocolo UDP compacto de controle, para controladores locais com alta
+ * taxa de escritas. Modelo de mensagens do CoAP (RFC 7252), sem opções:
+ * mensagem confirmável (CON) recebe ACK com o mesmo message id, CON repetido
+ * recebe a mesma resposta sem nova escrita; mensagem não confirmável (NON)
+ * não recebe resposta, exceto a consulta de topologia. Inteiros em big-endian
+ * 
+ * Cabeçalho, 5 bytes:
+ *   versão (u8 = 1) | tipo (u8: 0 = CON, 1 = NON, 2 = ACK) |
+ *   message id (u16) | código (u8)
+ * Requisições:
+ *   0x01 IO, mesmo pipeline de POST /plc/io, payload 8 bytes:
+ *     mac (6 bytes) | valor (u8, 0..100) | rede (u8, 0xFF = automática)
+ *   0x02 TOPOLOGY, mesmo conteúdo de GET /plc/topology, sem payload
+ * Respostas, códigos CoAP:
+ *   0x44 (2.04) IO escrita
+ *   0x41 (2.01) IO adiada, payload job (u32), consulta em GET /plc/io/jobs/{id}
+ *   0x45 (2.05) topologia, payload quantidade (u8) e por node 11 bytes:
+ *     mac (6) | papel (u8, 1 = STA, 4 = CCO) | snr | atenuação | fase | rede
+ *   0x80 (4.00) payload inválido
+ *   0x84 (4.04) requisição desconhecida
+ *   0xA3 (5.03) fila cheia, módulo indisponível ou UART sobrecarregada
+ */
+#define UDP_PROTOCOL_VERSION        1
+#define UDP_PROTOCOL_HEADER_SIZE    5
+#define UDP_PROTOCOL_IO_SIZE        8
+#define UDP_PROTOCOL_NODE_SIZE      11
+/* Rede automática na requisição IO */
+#define UDP_PROTOCOL_NETWORK_AUTO   0xFF
+/* Maior resposta, topologia completa */
+#define UDP_PROTOCOL_MAX_RESPONSE   (UDP_PROTOCOL_HEADER_SIZE + 1 + \
+                                     ((MAX_CCO_NUM + MAX_STA_NUM) * UDP_PROTOCOL_NODE_SIZE))
+
+/* Tipos de mensagem */
+typedef enum udpMessageType_t
+{
+  UDP_TYPE_CON = 0,
+  UDP_TYPE_NON = 1,
+  UDP_TYPE_ACK = 2,
+} udpMessageType_t;
+
+/* Códigos de requisição e resposta */
+typedef enum udpCode_t
+{
+  UDP_CODE_IO = 0x01,
+  UDP_CODE_TOPOLOGY = 0x02,
+  UDP_CODE_CREATED = 0x41,
+  UDP_CODE_CHANGED = 0x44,
+  UDP_CODE_CONTENT = 0x45,
+  UDP_CODE_BAD_REQUEST = 0x80,
+  UDP_CODE_NOT_FOUND = 0x84,
+  UDP_CODE_UNAVAILABLE = 0xA3,
+} udpCode_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Cabeçalho decodificado */
+typedef struct udpHeader_t
+{
+  udpMessageType_t type;
+  uint16_t messageId;
+  uint8_t code;
+} udpHeader_t;
+
+/* Requisição IO decodificada */
+typedef struct udpIoRequest_t
+{
+  uint8_t mac[6];
+  uint8_t value;
+  uint8_t network;
+} udpIoRequest_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+bool udp_protocol_decode_header(const uint8_t * dataPtr, size_t length, udpHeader_t * headerPtr);
+bool udp_protocol_decode_io(const uint8_t * dataPtr, size_t length, udpIoRequest_t * ioPtr);
+size_t udp_protocol_encode_response(uint8_t * bufferPtr, const udpHeader_t * requestPtr, udpCode_t code);
+size_t udp_protocol_encode_u32(uint8_t * bufferPtr, uint32_t value);
+size_t udp_protocol_encode_topology(uint8_t * bufferPtr, const topology_t * topologyPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -40,10 +40,9 @@ static const char *TAG = "WIFI_API_CONTROLLER";
 /*******************************************************************************
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
-static bool info_serialize(char * bufferOutPtr, size_t sizeBufferOut);
 static bool ap_serialize(char * bufferOutPtr, size_t sizeBufferOut);
 static void ap_to_dto(cJSON * root);
-static void info_to_dto(cJSON * root);
+static void info_write(httpChunkWriter_t * writerPtr);
 static esp_err_t dto_to_wifi_config(const char * bufferInPtr, size_t bufferInSize, wifi_config_t * wifiConfigPtr);
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
@@ -57,18 +56,12 @@ static esp_err_t dto_to_wifi_config(const char * bufferInPtr, size_t bufferInSiz
  */
 esp_err_t wifi_controller_get_info(httpd_req_t * req)
 {
-  
-  if (info_serialize(json_buffer_get(), json_buffer_get_size()) == false)
-  {
-    /* Falha criação dados */
-    http_util_send_response(req, HTTPD_500, "Failed to serialize the response");
-    return ESP_FAIL;
-  };
-
   httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-  httpd_resp_send(req, json_buffer_get(), HTTPD_RESP_USE_STRLEN);
+  httpChunkWriter_t writer;
+  http_util_chunk_begin(&writer, req, json_buffer_get(), json_buffer_get_size());
 
-  return ESP_OK;
+  info_write(&writer);
+  return http_util_chunk_end(&writer);
 }
 
 /**
@@ -148,25 +141,23 @@ esp_err_t wifi_controller_delete_connect(httpd_req_t * req)
   return ESP_OK;
 }
 
-/*******************************************************************************
-* FUNÇÕES LOCAIS
-*******************************************************************************/
-
 /**
- * Cria body JSON para informações rede Wi-Fi
+ * Chamada GET /wifi/info do lote /rpc
  * 
- * @param bufferOutPtr    buffer a ser escrito body JSON
- * @param sizeBufferOut   tamanho disponível para escrita
- * @return true           Criação com sucesso
- * @return false          Falha criação
+ * @param bodyPtr       body da chamada, não utilizado
+ * @param writerPtr     escritor do resultado
+ * @return const char*  código HTTP do resultado
  */
-static bool info_serialize(char * bufferOutPtr, size_t sizeBufferOut)
+const char * wifi_controller_rpc_info(cJSON * bodyPtr, httpChunkWriter_t * writerPtr)
 {
-  cJSON * root = cJSON_CreateObject();
-  info_to_dto(root);
-	return close_json(root, bufferOutPtr, sizeBufferOut);
+  info_write(writerPtr);
+  return HTTPD_200;
 }
 
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
 /**
  * Cria body JSON para informações redes disponíveis para conexão
  * 
@@ -218,11 +209,11 @@ static esp_err_t dto_to_wifi_config(const char * bufferInPtr, size_t bufferInSiz
 }
 
 /**
- * Transforma configuração de Wi-Fi em estrutura JSON
+ * Escreve informações da rede Wi-Fi como objeto JSON, sem alocação
  * 
- * @param root  estrutura JSON a ser escrita
+ * @param writerPtr   escritor da resposta
  */
-static void info_to_dto(cJSON * root)
+static void info_write(httpChunkWriter_t * writerPtr)
 {
   wifi_config_t wifiConfig;
   wifi_config_get(WIFI_IF_STA, &wifiConfig);
@@ -230,9 +221,13 @@ static void info_to_dto(cJSON * root)
   tcpip_adapter_ip_info_t wifiInterface;
   tcpip_adapter_get_ip_info(TCPIP_ADAPTER_IF_STA, &wifiInterface);
 
-  cJSON_AddStringToObject(root, "ssid", &wifiConfig.sta.ssid);
-  cJSON_AddStringToObject(root, "password", &wifiConfig.sta.password);  
-  cJSON_AddStringToObject(root, "ip", ip4addr_ntoa(&wifiInterface.ip));
+  http_util_chunk_write(writerPtr, "{\"ssid\":", 8);
+  http_util_chunk_json_string(writerPtr, (const char *)wifiConfig.sta.ssid);
+  http_util_chunk_write(writerPtr, ",\"password\":", 12);
+  http_util_chunk_json_string(writerPtr, (const char *)wifiConfig.sta.password);
+  http_util_chunk_write(writerPtr, ",\"ip\":", 6);
+  http_util_chunk_json_string(writerPtr, ip4addr_ntoa(&wifiInterface.ip));
+  http_util_chunk_write(writerPtr, "}", 1);
 }
 
 /**
@@ -12,6 +12,7 @@
 * INCLUDES
 *******************************************************************************/
 #include <esp_http_server.h>
+#include "http_util.h"
 
 /*******************************************************************************
 * DEFINES E ENUMS
@@ -28,6 +29,7 @@ esp_err_t wifi_controller_get_info(httpd_req_t * req);
 esp_err_t wifi_controller_get_ap(httpd_req_t * req);
 esp_err_t wifi_controller_post_connect(httpd_req_t * req);
 esp_err_t wifi_controller_delete_connect(httpd_req_t * req);
+const char * wifi_controller_rpc_info(cJSON * bodyPtr, httpChunkWriter_t * writerPtr);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -15,10 +15,26 @@
 #include "esp_log.h"
 #include "wifi_controller.h"
 #include "plc_controller.h"
+#include "metrics_controller.h"
+#include "debug_controller.h"
+#include "idempotency.h"
+#include "rpc_controller.h"
+#include "events_controller.h"
+#include "esp_timer.h"
 #include "mdns.h"
+#include "http_util.h"
+#include <stdio.h>
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Marca no user_ctx dos endpoints que ocupam a UART, sujeitos ao controle de
+   admissão. O handler original não recebe o user_ctx da tabela */
+#define USES_UART       ((void *)true)
+
+/* Quantidade de endpoints da tabela, sem o terminador */
+#define ENDPOINT_COUNT  ((sizeof(endpoints) / sizeof(endpoints[0])) - 1)
+/* Quantidade de rotas do lote /rpc */
+#define RPC_ROUTE_COUNT (sizeof(rpcRoutes) / sizeof(rpcRoutes[0]))
 
 /*******************************************************************************
 * TYPEDEFS
@@ -36,12 +52,38 @@ static const httpd_uri_t endpoints[] =
     { .uri = "/wifi/ap", .method = HTTP_GET, .handler = wifi_controller_get_ap, },
     { .uri = "/wifi/connect", .method = HTTP_POST, .handler = wifi_controller_post_connect, },
     { .uri = "/wifi/connect", .method = HTTP_DELETE, .handler = wifi_controller_delete_connect, },
-    { .uri = "/plc/topology", .method = HTTP_GET, .handler = plc_controller_get_topology, },
-    { .uri = "/plc/command", .method = HTTP_POST, .handler = plc_controller_post_command, },
-    { .uri = "/plc/io", .method = HTTP_POST, .handler = plc_controller_post_io, },
+    { .uri = "/plc/topology", .method = HTTP_GET, .handler = plc_controller_get_topology, .user_ctx = USES_UART, },
+    { .uri = "/plc/command", .method = HTTP_POST, .handler = plc_controller_post_command, .user_ctx = USES_UART, },
+    { .uri = "/plc/io", .method = HTTP_POST, .handler = plc_controller_post_io, .user_ctx = USES_UART, },
+    { .uri = "/plc/io/jobs/*", .method = HTTP_GET, .handler = plc_controller_get_io_job, },
+    { .uri = "/plc/jobs", .method = HTTP_POST, .handler = plc_controller_post_job, .user_ctx = USES_UART, },
+    { .uri = "/plc/jobs/*", .method = HTTP_GET, .handler = plc_controller_get_job, },
+    { .uri = "/plc/stats", .method = HTTP_GET, .handler = plc_controller_get_stats, },
+    { .uri = "/plc/uart/stats", .method = HTTP_GET, .handler = plc_controller_get_uart_stats, },
+    { .uri = "/plc/uart/stats", .method = HTTP_DELETE, .handler = plc_controller_delete_uart_stats, },
+    { .uri = "/plc/nodes/*", .method = HTTP_GET, .handler = plc_controller_get_node, },
+    { .uri = "/rpc", .method = HTTP_POST, .handler = rpc_controller_post, },
+    { .uri = "/events", .method = HTTP_GET, .handler = events_controller_get_sse, },
+    { .uri = "/events/ws", .method = HTTP_GET, .handler = events_controller_ws, .is_websocket = true, },
+    { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_controller_get, },
+    { .uri = "/debug/traces", .method = HTTP_GET, .handler = debug_controller_get_traces, },
+    { .uri = "/debug/log", .method = HTTP_POST, .handler = debug_controller_post_log, },
+    { .uri = "/debug/uart/capture", .method = HTTP_POST, .handler = debug_controller_post_uart_capture, },
+    { .uri = "/debug/uart/capture", .method = HTTP_GET, .handler = debug_controller_get_uart_capture, },
+#ifdef POWERLINE_MICROBENCH
+    { .uri = "/debug/bench", .method = HTTP_GET, .handler = debug_controller_get_bench, },
+#endif
     { .uri = NULL }
 };
 
+/* Endpoints disponíveis no lote /rpc, mesma lógica e admissão dos handlers acima */
+static const rpcRoute_t rpcRoutes[] =
+{
+    { .uri = "/wifi/info", .method = HTTP_GET, .handler = wifi_controller_rpc_info, },
+    { .uri = "/plc/topology", .method = HTTP_GET, .handler = plc_controller_rpc_topology, .usesUart = true, },
+    { .uri = "/plc/io", .method = HTTP_POST, .handler = plc_controller_rpc_io, .usesUart = true, },
+};
+
 /*******************************************************************************
 * VARIÁVEIS
 *******************************************************************************/
@@ -52,6 +94,8 @@ static httpd_handle_t server = NULL;
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
 static void initialise_mdns(void);
+static esp_err_t instrumented_handler(httpd_req_t * req);
+static bool admission_reject(httpd_req_t * req, const httpd_uri_t * endpointPtr);
 
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
@@ -65,15 +109,28 @@ void http_server_start(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
+    /* Permite rotas com parâmetros no caminho, ex: /plc/nodes/{mac}/<recurso> */
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    /* Capacidade para todos os endpoints da tabela */
+    config.max_uri_handlers = ENDPOINT_COUNT;
 
     ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
     if (httpd_start(&server, &config) == ESP_OK)
     {
         /* Registra endpoints */
         ESP_LOGI(TAG, "Registering URI handlers");
+        metrics_controller_init(endpoints, ENDPOINT_COUNT);
+        idempotency_init();
+        rpc_controller_init(rpcRoutes, RPC_ROUTE_COUNT);
+        events_controller_init(server);
+        plc_controller_init(server);
         for (uint32_t idx = 0; endpoints[idx].uri != NULL; idx++)
         {
-            httpd_register_uri_handler(server, &endpoints[idx]);
+            /* Handler instrumentado, índice na tabela identifica endpoint original */
+            httpd_uri_t endpoint = endpoints[idx];
+            endpoint.handler = instrumented_handler;
+            endpoint.user_ctx = (void *)(uintptr_t)idx;
+            httpd_register_uri_handler(server, &endpoint);
         }
     }
 
@@ -110,6 +167,68 @@ static void initialise_mdns(void)
     ESP_ERROR_CHECK(mdns_service_add("PowerLine HTTP Server", "_http", "_tcp", 80, serviceTxtData,
                                      sizeof(serviceTxtData) / sizeof(serviceTxtData[0])));
 }
+
+/**
+ * Executa handler do endpoint e contabiliza requisição e duração. Nos
+ * endpoints WebSocket contabiliza somente o handshake
+ * 
+ * @param req         requisição a ser respondida
+ * @return esp_err_t  retorno do handler do endpoint
+ */
+static esp_err_t instrumented_handler(httpd_req_t * req)
+{
+    const uint32_t endpointIndex = (uint32_t)(uintptr_t)req->user_ctx;
+
+    if (endpoints[endpointIndex].is_websocket && (req->method != HTTP_GET))
+    {
+        /* Frame de conexão WebSocket aberta, somente o handshake conta como requisição */
+        return endpoints[endpointIndex].handler(req);
+    }
+
+    const int64_t startUs = esp_timer_get_time();
+
+    if (admission_reject(req, &endpoints[endpointIndex]))
+    {
+        /* Recusada antes de ocupar a UART, conexão mantida */
+        metrics_controller_record_rejected(endpointIndex);
+        return ESP_OK;
+    }
+
+    esp_err_t result = endpoints[endpointIndex].handler(req);
+
+    metrics_controller_record_request(endpointIndex, esp_timer_get_time() - startUs, result);
+    return result;
+}
+
+/**
+ * Controle de admissão dos endpoints marcados com USES_UART: com o backlog
+ * da UART acima do limite (plc_controller_admission_retry) responde 503 com
+ * Retry-After. Chamadas do lote /rpc verificadas por rota (rpcRoutes)
+ * 
+ * @param req           requisição recebida
+ * @param endpointPtr   endpoint da requisição
+ * @return true         requisição recusada, resposta enviada
+ * @return false        requisição aceita
+ */
+static bool admission_reject(httpd_req_t * req, const httpd_uri_t * endpointPtr)
+{
+    if (endpointPtr->user_ctx != USES_UART)
+    {
+        return false;
+    }
+
+    const uint32_t retrySeconds = plc_controller_admission_retry();
+    if (retrySeconds == 0)
+    {
+        return false;
+    }
+
+    char retryAfter[12];
+    snprintf(retryAfter, sizeof(retryAfter), "%u", retrySeconds);
+    httpd_resp_set_hdr(req, "Retry-After", retryAfter);
+    http_util_send_response(req, HTTPD_503, "PLC module busy");
+    return true;
+}
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
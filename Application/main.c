@@ -12,6 +12,7 @@
 #include "nvs_service.h"
 #include "wifi_app.h"
 #include "plc_app.h"
+#include "deferred_log.h"
 
 /*******************************************************************************
 * DEFINES E ENUMS
@@ -47,9 +48,11 @@
  */
 void app_main(void)
 {
+    deferred_log_init();
     nvs_service_init();
-    wifi_app_connect();
+    /* Serviços PLC prontos antes dos servidores HTTP e UDP, módulos configurados em paralelo ao Wi-Fi */
     plc_app_init();
+    wifi_app_connect();
 }
 /*******************************************************************************
 * END OF FILE
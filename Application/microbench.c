@@ -0,0 +1,272 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "microbench.h"
+#ifdef POWERLINE_MICROBENCH
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "http_util.h"
+#include "json_buffer.h"
+#include "plc_uart_parser.h"
+#include "udp_protocol.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Iterações iniciais da calibração, dobradas até atingir o tempo mínimo */
+#define INITIAL_ITERATIONS  16
+#define MAX_ITERATIONS      (1U << 24)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+/* Entradas representativas do tráfego real */
+static const char topoinfoLine[] = "+TOPOINFO:0012A3B4C5D6,2,0,0,1,31,41,2";
+static const char notificationLine[] = "+JOIN 0012A3B4C5D6";
+static const char ioBody[] = "{\"mac\":\"00:12:A3:B4:C5:D6\",\"value\":1}";
+/* Mesma escrita de ioBody no protocolo UDP, CON */
+static const uint8_t ioMessage[] = { 1, 0, 0x12, 0x34, 0x01, 0x00, 0x12, 0xA3, 0xB4, 0xC5, 0xD6, 1, 0xFF };
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Evita que o compilador descarte o resultado das operações */
+static volatile uint32_t sink;
+static uint32_t allocCount;
+static uint32_t freeCount;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void * counting_malloc(size_t size);
+static void counting_free(void * ptr);
+static void bench_parse_result(uint32_t iterations);
+static void bench_parse_response(uint32_t iterations);
+static void bench_parse_notification(uint32_t iterations);
+static void bench_get_json_string_value(uint32_t iterations);
+static void bench_io_dto_decode(uint32_t iterations);
+static void bench_close_json(uint32_t iterations);
+static void bench_udp_io_decode(uint32_t iterations);
+
+static const microbenchCase_t cases[] = {
+  { "parse_result", bench_parse_result },
+  { "parse_response", bench_parse_response },
+  { "parse_notification", bench_parse_notification },
+  { "get_json_string_value", bench_get_json_string_value },
+  { "io_dto_decode", bench_io_dto_decode },
+  { "close_json", bench_close_json },
+  { "udp_io_decode", bench_udp_io_decode },
+};
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Quantidade de casos disponíveis
+ * 
+ * @return uint32_t quantidade
+ */
+uint32_t microbench_case_count(void)
+{
+  return sizeof(cases) / sizeof(cases[0]);
+}
+
+/**
+ * Recupera caso pelo índice
+ * 
+ * @param index                     índice do caso
+ * @return const microbenchCase_t*  caso, NULL = índice inválido
+ */
+const microbenchCase_t * microbench_case_get(uint32_t index)
+{
+  return index < microbench_case_count() ? &cases[index] : NULL;
+}
+
+/**
+ * Mede um caso, dobrando as iterações até o tempo mínimo. Alocações do
+ * cJSON são contadas durante a medição
+ * 
+ * @param casePtr     caso a ser medido
+ * @param clock       relógio da medição
+ * @param minUnits    duração mínima, em unidades do relógio
+ * @param resultPtr   estrutura de escrita
+ */
+void microbench_run(const microbenchCase_t * casePtr, microbenchClock_t clock, uint64_t minUnits,
+                    microbenchResult_t * resultPtr)
+{
+  cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = counting_free };
+  cJSON_InitHooks(&hooks);
+
+  /* Aquecimento: caches e caminhos de primeira execução */
+  casePtr->run(INITIAL_ITERATIONS);
+
+  uint32_t iterations = INITIAL_ITERATIONS;
+  uint64_t elapsed = 0;
+  for (;;)
+  {
+    allocCount = 0;
+    freeCount = 0;
+    const uint64_t start = clock();
+    casePtr->run(iterations);
+    elapsed = clock() - start;
+
+    if ((elapsed >= minUnits) || (iterations >= MAX_ITERATIONS))
+    {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  cJSON_InitHooks(NULL);
+
+  resultPtr->namePtr = casePtr->namePtr;
+  resultPtr->iterations = iterations;
+  resultPtr->perOp = (double)elapsed / iterations;
+  resultPtr->allocsPerOp = (double)allocCount / iterations;
+  resultPtr->leakedPerOp = (double)(allocCount - freeCount) / iterations;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+static void * counting_malloc(size_t size)
+{
+  allocCount++;
+  return malloc(size);
+}
+
+static void counting_free(void * ptr)
+{
+  freeCount++;
+  free(ptr);
+}
+
+/**
+ * Linha de resultado "OK", caminho de todo comando
+ * 
+ * @param iterations  repetições
+ */
+static void bench_parse_result(uint32_t iterations)
+{
+  uartPlcResponse_t response = {0};
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    sink += plc_uart_parser_line("OK", &response);
+  }
+}
+
+/**
+ * Linha de dados do AT+TOPOINFO
+ * 
+ * @param iterations  repetições
+ */
+static void bench_parse_response(uint32_t iterations)
+{
+  uartPlcResponse_t response = {0};
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    response.lineCounter = 0;
+    sink += plc_uart_parser_line(topoinfoLine, &response);
+  }
+}
+
+/**
+ * Notificação espontânea do módulo
+ * 
+ * @param iterations  repetições
+ */
+static void bench_parse_notification(uint32_t iterations)
+{
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    sink += plc_uart_parser_line(notificationLine, NULL);
+  }
+}
+
+/**
+ * Leitura de campo string de um JSON já decodificado
+ * 
+ * @param iterations  repetições
+ */
+static void bench_get_json_string_value(uint32_t iterations)
+{
+  char mac[19];
+  cJSON * root = cJSON_Parse(ioBody);
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    sink += get_json_string_value(root, "mac", mac, sizeof(mac));
+  }
+  cJSON_Delete(root);
+}
+
+/**
+ * Decodificação do body de POST /plc/io, mesma sequência do plc_controller
+ * 
+ * @param iterations  repetições
+ */
+static void bench_io_dto_decode(uint32_t iterations)
+{
+  char mac[19];
+  uint32_t value;
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    cJSON * root = cJSON_Parse(ioBody);
+    sink += get_json_string_value(root, "mac", mac, sizeof(mac));
+    sink += get_json_int_value(root, "value", &value);
+    cJSON_Delete(root);
+  }
+}
+
+/**
+ * Montagem e serialização de resposta pequena, como http_util_send_response.
+ * Usa o json_buffer, não executar durante escrita de uma resposta
+ * 
+ * @param iterations  repetições
+ */
+static void bench_close_json(uint32_t iterations)
+{
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    cJSON * root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "message", "OK");
+    sink += close_json(root, json_buffer_get(), json_buffer_get_size());
+  }
+}
+
+/**
+ * Decodificação da escrita IO do protocolo UDP e montagem do ACK, para
+ * comparação com io_dto_decode e close_json
+ * 
+ * @param iterations  repetições
+ */
+static void bench_udp_io_decode(uint32_t iterations)
+{
+  udpHeader_t header;
+  udpIoRequest_t io;
+  uint8_t response[UDP_PROTOCOL_HEADER_SIZE];
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    sink += udp_protocol_decode_header(ioMessage, sizeof(ioMessage), &header);
+    sink += udp_protocol_decode_io(&ioMessage[UDP_PROTOCOL_HEADER_SIZE], sizeof(ioMessage) - UDP_PROTOCOL_HEADER_SIZE,
+                                   &io);
+    sink += udp_protocol_encode_response(response, &header, UDP_CODE_CHANGED);
+  }
+}
+#endif
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,61 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Microbenchmarks das funções auxiliares executadas a cada requisição.
+ * Compilado somente com -DPOWERLINE_MICROBENCH: no ESP32 expõe
+ * GET /debug/bench (ciclos da CPU), no host é usado por Tools/microbench
+ * (nanossegundos)
+ */
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Relógio da medição, unidade definida pelo chamador */
+typedef uint64_t (*microbenchClock_t)(void);
+
+/* Caso medido, executa a operação "iterations" vezes */
+typedef struct microbenchCase_t
+{
+  const char * namePtr;
+  void (*run)(uint32_t iterations);
+} microbenchCase_t;
+
+typedef struct microbenchResult_t
+{
+  const char * namePtr;
+  uint32_t iterations;
+  /* Unidades do relógio por operação */
+  double perOp;
+  /* Alocações cJSON por operação */
+  double allocsPerOp;
+  /* Alocações não liberadas por operação, != 0 indica vazamento */
+  double leakedPerOp;
+} microbenchResult_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+uint32_t microbench_case_count(void);
+const microbenchCase_t * microbench_case_get(uint32_t index);
+void microbench_run(const microbenchCase_t * casePtr, microbenchClock_t clock, uint64_t minUnits,
+                    microbenchResult_t * resultPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -11,6 +11,9 @@
 *******************************************************************************/
 #include "plc_app.h"
 #include "plc_config.h"
+#include "plc_health.h"
+#include "plc_uart.h"
+#include "plc_topology.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -37,6 +40,7 @@ typedef struct plcAppSignalStruct_t
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
 static void app_task(void * param);
+static void topology_task(void * param);
 static void init_signals(void);
 static void plc_error_init(void);
 /*******************************************************************************
@@ -59,28 +63,25 @@ static EventGroupHandle_t plcAppSignal;
 static EventBits_t uxBits;
 /* Variáveis de leitura de todos os sinais da aplicação */
 static plcAppSignal_t ALL_SIGNALS;
+/* Portas com falha na configuração inicial, bit n = porta n */
+static uint32_t initFailedPorts;
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 
 /**
- * Inicializa aplicação da estrutura PLC
+ * Inicializa aplicação da estrutura PLC. Serviços prontos no retorno,
+ * configuração dos módulos segue em plc_app_task sem atrasar o Wi-Fi
  * 
  */
 void plc_app_init(void)
 {
-  /* Cria sinais e taks de controle dos eventos */
-  init_signals();
-  xTaskCreate(app_task, "plc_app_task", 4096, NULL, 3, NULL);
-
   /* Configura estrutura ESP para lidar com módulo PLC */
   plc_config_init();
 
-  /* Configura módulo para modo desejado */
-  if (plc_configure_module() == false)
-  {
-    plc_app_set(PLC_APP_ERROR_INIT);
-  }
+  /* Cria sinais e taks de controle dos eventos */
+  init_signals();
+  xTaskCreate(app_task, "plc_app_task", 4096, NULL, 3, NULL);
 }
 
 /**
@@ -96,12 +97,23 @@ void plc_app_set(plcAppSignal_t signal)
 * FUNÇÕES LOCAIS
 *******************************************************************************/
 /**
- * Task de controle da comunicação 
+ * Task de controle da comunicação, configura os módulos antes de tratar
+ * os sinais
  * 
  * @param parm 
  */
 static void app_task(void * param)
 {
+  /* Configura módulo para modo desejado, bloqueia somente esta task */
+  initFailedPorts = plc_configure_module();
+  if (initFailedPorts != 0)
+  {
+    plc_app_set(PLC_APP_ERROR_INIT);
+  }
+
+  /* Topologia lida periodicamente, sem depender das consultas dos clientes */
+  xTaskCreate(topology_task, "plc_topology_task", 4096, NULL, 3, NULL);
+
   while (true)
   {
     /* Aguarda set dos bits de sinais */
@@ -126,6 +138,22 @@ static void app_task(void * param)
   }
 }
 
+/**
+ * Task de atualização periódica da topologia, alimenta eventos, histórico,
+ * telemetria e estatísticas por node a cada PLC_TOPOLOGY_REFRESH_MS
+ * 
+ * @param param   não utilizado
+ */
+static void topology_task(void * param)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  while (true)
+  {
+    plc_topology_refresh();
+    vTaskDelayUntil(&lastWake, PLC_TOPOLOGY_REFRESH_MS / portTICK_PERIOD_MS);
+  }
+}
+
 /**
  * Inicializa estrutura de sinais aplicação 
  * 
@@ -141,12 +169,20 @@ static void init_signals(void)
 }
 
 /**
- * Handler para tratamento de falha na inicialização 
+ * Handler para tratamento de falha na inicialização, novas tentativas
+ * ficam com o watchdog até o módulo responder. Somente as portas com
+ * falha são recuperadas, as demais seguem em operação
  * 
  */
 static void plc_error_init(void)
 {
-  plc_configure_module();
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    if (initFailedPorts & BIT(port))
+    {
+      plc_health_request_recovery(port);
+    }
+  }
 }
 /*******************************************************************************
 * END OF FILE
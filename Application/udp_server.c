@@ -0,0 +1,432 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "udp_server.h"
+#include <string.h>
+#include <errno.h>
+#include "udp_protocol.h"
+#include "plc_controller.h"
+#include "plc_topology.h"
+#include "plc_uart_model.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Maior requisição aceita, cabeçalho e payload IO */
+#define REQUEST_SIZE  (UDP_PROTOCOL_HEADER_SIZE + UDP_PROTOCOL_IO_SIZE)
+/* Maior resposta IO guardada para CON repetido, cabeçalho e job */
+#define DEDUP_RESPONSE_SIZE (UDP_PROTOCOL_HEADER_SIZE + sizeof(uint32_t))
+/* Espera após falha do socket */
+#define SOCKET_RETRY_MS 1000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Resposta IO enviada a um CON */
+typedef struct dedupEntry_t
+{
+  bool used;
+  uint32_t address;
+  uint16_t port;
+  uint16_t messageId;
+  int64_t timeUs;
+  uint8_t length;
+  uint8_t response[DEDUP_RESPONSE_SIZE];
+} dedupEntry_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "UDP_SERVER";
+
+/* Nome da requisição nas métricas, indexado por udpServerOp_t */
+static const char * const opNames[] =
+{
+  [UDP_SERVER_OP_IO] = "io",
+  [UDP_SERVER_OP_TOPOLOGY] = "topology",
+};
+
+/* Nome do tipo de mensagem nas métricas, indexado por udpServerType_t */
+static const char * const typeNames[] =
+{
+  [UDP_SERVER_TYPE_CON] = "con",
+  [UDP_SERVER_TYPE_NON] = "non",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Buffers e respostas guardadas, acessados somente pela task do servidor.
+   Byte extra identifica payload maior que o esperado */
+static uint8_t request[REQUEST_SIZE + 1];
+static uint8_t response[UDP_PROTOCOL_MAX_RESPONSE];
+static dedupEntry_t dedup[UDP_SERVER_DEDUP_SIZE];
+static udpServerStats_t stats;
+/* Proteção dos contadores, lidos pelas métricas */
+static SemaphoreHandle_t statsMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void server_task(void * param);
+static int server_socket_open(void);
+static size_t message_handle(size_t length, const struct sockaddr_in * sourcePtr, int32_t * opPtr,
+                             udpServerType_t * typePtr, int64_t * plcUsPtr);
+static size_t io_handle(const udpHeader_t * headerPtr, size_t payloadLength, int64_t * plcUsPtr);
+static size_t topology_handle(const udpHeader_t * headerPtr);
+static dedupEntry_t * dedup_find(const struct sockaddr_in * sourcePtr, uint16_t messageId, int64_t now);
+static void dedup_store(const struct sockaddr_in * sourcePtr, uint16_t messageId, int64_t now, size_t length);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa servidor do protocolo UDP de controle, ao lado do servidor HTTP
+ * 
+ */
+void udp_server_start(void)
+{
+  bzero(dedup, sizeof(dedup));
+  bzero(&stats, sizeof(stats));
+  statsMutex = xSemaphoreCreateMutex();
+  xTaskCreate(server_task, "udp_server_task", 4096, NULL, 5, NULL);
+}
+
+/**
+ * Recupera contadores e custo das mensagens
+ * 
+ * @param statsPtr  estrutura de escrita
+ */
+void udp_server_get_stats(udpServerStats_t * statsPtr)
+{
+  xSemaphoreTake(statsMutex, portMAX_DELAY);
+  *statsPtr = stats;
+  xSemaphoreGive(statsMutex);
+}
+
+/**
+ * Recupera nome da requisição
+ * 
+ * @param op            requisição
+ * @return const char*  nome da requisição
+ */
+const char * udp_server_op_name(udpServerOp_t op)
+{
+  return (op < UDP_SERVER_OP_COUNT) ? opNames[op] : "";
+}
+
+/**
+ * Recupera nome do tipo de mensagem
+ * 
+ * @param type          tipo de mensagem
+ * @return const char*  nome do tipo
+ */
+const char * udp_server_type_name(udpServerType_t type)
+{
+  return (type < UDP_SERVER_TYPE_COUNT) ? typeNames[type] : "";
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task do servidor, atende uma mensagem por vez. CON retransmitido durante
+ * uma escrita aguarda no socket e é respondido pelas respostas guardadas
+ * 
+ * @param param   não utilizado
+ */
+static void server_task(void * param)
+{
+  int sock = -1;
+  for (;;)
+  {
+    if (sock < 0)
+    {
+      sock = server_socket_open();
+      if (sock < 0)
+      {
+        vTaskDelay(SOCKET_RETRY_MS / portTICK_PERIOD_MS);
+        continue;
+      }
+    }
+
+    struct sockaddr_in source;
+    socklen_t sourceLength = sizeof(source);
+    const int length = recvfrom(sock, request, sizeof(request), 0, (struct sockaddr *)&source, &sourceLength);
+    if (length < 0)
+    {
+      ESP_LOGE(TAG, "Receive failed: errno %d", errno);
+      close(sock);
+      sock = -1;
+      continue;
+    }
+
+    const int64_t startUs = esp_timer_get_time();
+    int32_t op = -1;
+    udpServerType_t type = UDP_SERVER_TYPE_CON;
+    int64_t plcUs = 0;
+    const size_t responseLength = message_handle(length, &source, &op, &type, &plcUs);
+    if (responseLength > 0)
+    {
+      sendto(sock, response, responseLength, 0, (struct sockaddr *)&source, sizeof(source));
+    }
+
+    /* Custo do servidor separado do tempo no módulo PLC */
+    const uint32_t serverUs = (esp_timer_get_time() - startUs) - plcUs;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (op >= 0)
+    {
+      udpServerOpStats_t * opStatsPtr = &stats.ops[op][type];
+      opStatsPtr->messages++;
+      /* Último byte do cabeçalho, código da resposta, montada também quando NON não é respondido */
+      const uint8_t code = response[UDP_PROTOCOL_HEADER_SIZE - 1];
+      opStatsPtr->errors += (code >= UDP_CODE_BAD_REQUEST) ? 1 : 0;
+      opStatsPtr->serverUsSum += serverUs;
+      opStatsPtr->serverUsMax = (serverUs > opStatsPtr->serverUsMax) ? serverUs : opStatsPtr->serverUsMax;
+      opStatsPtr->plcUsSum += plcUs;
+    }
+    xSemaphoreGive(statsMutex);
+  }
+}
+
+/**
+ * Abre socket do servidor em UDP_SERVER_PORT
+ * 
+ * @return int  socket, -1 = falha
+ */
+static int server_socket_open(void)
+{
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+  if (sock < 0)
+  {
+    ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+    return -1;
+  }
+
+  struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = htons(UDP_SERVER_PORT),
+    .sin_addr.s_addr = htonl(INADDR_ANY),
+  };
+  if (bind(sock, (struct sockaddr *)&address, sizeof(address)) < 0)
+  {
+    ESP_LOGE(TAG, "Unable to bind socket: errno %d", errno);
+    close(sock);
+    return -1;
+  }
+
+  ESP_LOGI(TAG, "Listening on port %d", UDP_SERVER_PORT);
+  return sock;
+}
+
+/**
+ * Trata mensagem recebida e monta a resposta
+ * 
+ * @param length      tamanho da mensagem
+ * @param sourcePtr   origem da mensagem
+ * @param opPtr       requisição medida, -1 = mensagem descartada, repetida ou desconhecida
+ * @param typePtr     tipo da mensagem medida
+ * @param plcUsPtr    tempo na escrita PLC
+ * @return size_t     tamanho da resposta, 0 = sem resposta
+ */
+static size_t message_handle(size_t length, const struct sockaddr_in * sourcePtr, int32_t * opPtr,
+                             udpServerType_t * typePtr, int64_t * plcUsPtr)
+{
+  udpHeader_t header;
+  if ((udp_protocol_decode_header(request, length, &header) == false) || (header.type == UDP_TYPE_ACK))
+  {
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    stats.malformed++;
+    xSemaphoreGive(statsMutex);
+    return 0;
+  }
+
+  const bool confirmable = header.type == UDP_TYPE_CON;
+  *typePtr = confirmable ? UDP_SERVER_TYPE_CON : UDP_SERVER_TYPE_NON;
+  const int64_t now = esp_timer_get_time();
+  dedupEntry_t * entryPtr = confirmable ? dedup_find(sourcePtr, header.messageId, now) : NULL;
+
+  xSemaphoreTake(statsMutex, portMAX_DELAY);
+  stats.confirmable += confirmable ? 1 : 0;
+  stats.nonConfirmable += confirmable ? 0 : 1;
+  stats.duplicates += (entryPtr != NULL) ? 1 : 0;
+  stats.unknown += ((header.code != UDP_CODE_IO) && (header.code != UDP_CODE_TOPOLOGY)) ? 1 : 0;
+  xSemaphoreGive(statsMutex);
+
+  if (entryPtr != NULL)
+  {
+    /* Retransmissão de CON já atendido */
+    memcpy(response, entryPtr->response, entryPtr->length);
+    return entryPtr->length;
+  }
+
+  const size_t payloadLength = length - UDP_PROTOCOL_HEADER_SIZE;
+  size_t responseLength;
+  switch (header.code)
+  {
+    case UDP_CODE_IO:
+      *opPtr = UDP_SERVER_OP_IO;
+      responseLength = io_handle(&header, payloadLength, plcUsPtr);
+      if (confirmable)
+      {
+        dedup_store(sourcePtr, header.messageId, now, responseLength);
+      }
+      break;
+
+    case UDP_CODE_TOPOLOGY:
+      /* Leitura, respondida também para NON */
+      *opPtr = UDP_SERVER_OP_TOPOLOGY;
+      return topology_handle(&header);
+
+    default:
+      responseLength = udp_protocol_encode_response(response, &header, UDP_CODE_NOT_FOUND);
+      break;
+  }
+
+  return confirmable ? responseLength : 0;
+}
+
+/**
+ * Executa requisição IO pelo mesmo pipeline de POST /plc/io
+ * 
+ * @param headerPtr       cabeçalho da requisição
+ * @param payloadLength   tamanho do payload
+ * @param plcUsPtr        tempo na escrita PLC
+ * @return size_t         tamanho da resposta
+ */
+static size_t io_handle(const udpHeader_t * headerPtr, size_t payloadLength, int64_t * plcUsPtr)
+{
+  udpIoRequest_t io;
+  if (udp_protocol_decode_io(&request[UDP_PROTOCOL_HEADER_SIZE], payloadLength, &io) == false)
+  {
+    return udp_protocol_encode_response(response, headerPtr, UDP_CODE_BAD_REQUEST);
+  }
+
+  /* Mesmo controle de admissão das requisições HTTP que ocupam a UART */
+  if (plc_controller_admission_retry() != 0)
+  {
+    return udp_protocol_encode_response(response, headerPtr, UDP_CODE_UNAVAILABLE);
+  }
+
+  const int32_t network = (io.network == UDP_PROTOCOL_NETWORK_AUTO) ? PLC_UART_MODEL_NETWORK_AUTO : io.network;
+  uint32_t jobId = 0;
+  const int64_t startUs = esp_timer_get_time();
+  const plcControllerIoResult_t result = plc_controller_io(io.mac, io.value, network, &jobId);
+  *plcUsPtr = esp_timer_get_time() - startUs;
+
+  switch (result)
+  {
+    case PLC_CONTROLLER_IO_DONE:
+      return udp_protocol_encode_response(response, headerPtr, UDP_CODE_CHANGED);
+
+    case PLC_CONTROLLER_IO_QUEUED:
+    {
+      const size_t length = udp_protocol_encode_response(response, headerPtr, UDP_CODE_CREATED);
+      return length + udp_protocol_encode_u32(&response[length], jobId);
+    }
+
+    case PLC_CONTROLLER_IO_INVALID:
+      return udp_protocol_encode_response(response, headerPtr, UDP_CODE_BAD_REQUEST);
+
+    default:
+      return udp_protocol_encode_response(response, headerPtr, UDP_CODE_UNAVAILABLE);
+  }
+}
+
+/**
+ * Responde topologia, mesmo conteúdo e admissão de GET /plc/topology. Servida
+ * do cache (PLC_TOPOLOGY_MAX_AGE_MS), requisições seguidas não ocupam a UART
+ * nem alimentam a telemetria na flash
+ * 
+ * @param headerPtr   cabeçalho da requisição
+ * @return size_t     tamanho da resposta
+ */
+static size_t topology_handle(const udpHeader_t * headerPtr)
+{
+  if (plc_controller_admission_retry() != 0)
+  {
+    return udp_protocol_encode_response(response, headerPtr, UDP_CODE_UNAVAILABLE);
+  }
+
+  topology_t topology;
+  plc_topology_get(&topology, PLC_TOPOLOGY_MAX_AGE_MS);
+
+  const size_t length = udp_protocol_encode_response(response, headerPtr, UDP_CODE_CONTENT);
+  return length + udp_protocol_encode_topology(&response[length], &topology);
+}
+
+/**
+ * Procura resposta guardada de um CON
+ * 
+ * @param sourcePtr       origem da mensagem
+ * @param messageId       message id
+ * @param now             tempo atual
+ * @return dedupEntry_t*  resposta guardada, NULL = mensagem nova
+ */
+static dedupEntry_t * dedup_find(const struct sockaddr_in * sourcePtr, uint16_t messageId, int64_t now)
+{
+  for (uint32_t idx = 0; idx < UDP_SERVER_DEDUP_SIZE; idx++)
+  {
+    dedupEntry_t * entryPtr = &dedup[idx];
+    if (entryPtr->used && (entryPtr->messageId == messageId) &&
+        (entryPtr->address == sourcePtr->sin_addr.s_addr) && (entryPtr->port == sourcePtr->sin_port) &&
+        ((now - entryPtr->timeUs) < ((int64_t)UDP_SERVER_DEDUP_MS * 1000)))
+    {
+      return entryPtr;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Guarda resposta de um CON, substituindo a mais antiga
+ * 
+ * @param sourcePtr   origem da mensagem
+ * @param messageId   message id
+ * @param now         tempo atual
+ * @param length      tamanho da resposta em response
+ */
+static void dedup_store(const struct sockaddr_in * sourcePtr, uint16_t messageId, int64_t now, size_t length)
+{
+  dedupEntry_t * oldestPtr = &dedup[0];
+  for (uint32_t idx = 0; idx < UDP_SERVER_DEDUP_SIZE; idx++)
+  {
+    if ((dedup[idx].used == false) || (dedup[idx].timeUs < oldestPtr->timeUs))
+    {
+      oldestPtr = &dedup[idx];
+    }
+
+    if (dedup[idx].used == false)
+    {
+      break;
+    }
+  }
+
+  oldestPtr->used = true;
+  oldestPtr->address = sourcePtr->sin_addr.s_addr;
+  oldestPtr->port = sourcePtr->sin_port;
+  oldestPtr->messageId = messageId;
+  oldestPtr->timeUs = now;
+  oldestPtr->length = length;
+  memcpy(oldestPtr->response, response, length);
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
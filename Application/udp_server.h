@@ -0,0 +1,81 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef UDP_SERVER_H
+#define UDP_SERVER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Porta do protocolo UDP de controle (udp_protocol.h) */
+#define UDP_SERVER_PORT           5690
+/* Respostas IO guardadas para CON repetido, chave = origem e message id */
+#define UDP_SERVER_DEDUP_SIZE     8
+/* Tempo em que um message id repetido é tratado como retransmissão */
+#define UDP_SERVER_DEDUP_MS       30000
+
+/* Requisições medidas */
+typedef enum udpServerOp_t
+{
+  UDP_SERVER_OP_IO = 0,
+  UDP_SERVER_OP_TOPOLOGY,
+  UDP_SERVER_OP_COUNT,
+} udpServerOp_t;
+
+/* Tipos de mensagem medidos separadamente, NON sem resposta de escrita */
+typedef enum udpServerType_t
+{
+  UDP_SERVER_TYPE_CON = 0,
+  UDP_SERVER_TYPE_NON,
+  UDP_SERVER_TYPE_COUNT,
+} udpServerType_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Custo das mensagens de uma requisição e tipo */
+typedef struct udpServerOpStats_t
+{
+  uint32_t messages;
+  /* Respostas de erro, 4.xx e 5.xx */
+  uint32_t errors;
+  /* Tempo no servidor sem a escrita PLC: decodificação, resposta e envio */
+  uint64_t serverUsSum;
+  uint32_t serverUsMax;
+  /* Tempo na escrita PLC, UART e fila */
+  uint64_t plcUsSum;
+} udpServerOpStats_t;
+
+/* Contadores do servidor UDP */
+typedef struct udpServerStats_t
+{
+  udpServerOpStats_t ops[UDP_SERVER_OP_COUNT][UDP_SERVER_TYPE_COUNT];
+  uint32_t confirmable;
+  uint32_t nonConfirmable;
+  /* CON repetidos respondidos sem nova escrita */
+  uint32_t duplicates;
+  /* Cabeçalho inválido ou tipo ACK */
+  uint32_t malformed;
+  /* Cabeçalho válido com código de requisição desconhecido, respondido 4.04 */
+  uint32_t unknown;
+} udpServerStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void udp_server_start(void);
+void udp_server_get_stats(udpServerStats_t * statsPtr);
+const char * udp_server_op_name(udpServerOp_t op);
+const char * udp_server_type_name(udpServerType_t type);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -19,9 +19,13 @@
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "http_server.h"
+#include "udp_server.h"
+#include "esp_sntp.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Servidor de horário, relógio usado nos timestamps da telemetria */
+#define SNTP_SERVER   "pool.ntp.org"
 
 /*******************************************************************************
 * TYPEDEFS
@@ -48,6 +52,7 @@ static void wifi_reconnect(void);
 static void wifi_restart_config(void);
 static void init_signals(void);
 static void wifi_sta_erase(void);
+static void time_sync_start(void);
 /*******************************************************************************
 * CONSTANTES
 *******************************************************************************/
@@ -109,6 +114,7 @@ void wifi_app_connect(void)
   xTaskCreate(app_task, "wifi_app_task", 4096, NULL, 3, NULL);
   wifi_app_set(WIFI_APP_CONNECT_SIGNAL);
   http_server_start();
+  udp_server_start();
 }
 
 /**
@@ -186,6 +192,7 @@ static void wifi_connected(void)
   ESP_LOGI(TAG, "Start HTTPs Server");
   reconnectCounter = 0;
   wifi_config_save();
+  time_sync_start();
 }
 
 /**
@@ -251,6 +258,25 @@ static void wifi_sta_erase(void)
   }
 }
 
+/**
+ * Inicia acerto periódico do relógio por SNTP na primeira conexão, usado
+ * nos timestamps da telemetria
+ * 
+ */
+static void time_sync_start(void)
+{
+  if (sntp_enabled())
+  {
+    /* Já iniciado, segue sincronizando após reconexões */
+    return;
+  }
+
+  ESP_LOGI(TAG, "Start SNTP '%s'", SNTP_SERVER);
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, SNTP_SERVER);
+  sntp_init();
+}
+
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -0,0 +1,335 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "deferred_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define RING_MASK               (DEFERRED_LOG_RING_SIZE - 1)
+/* Máximo de argumentos inteiros por registro */
+#define MAX_ARGS                3
+/* Intervalo entre esvaziamentos dos buffers */
+#define DRAIN_PERIOD_MS         20
+/* Tamanho da linha formatada */
+#define LINE_SIZE               160
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Célula do buffer circular, sequência controla posse produtor / consumidor */
+typedef struct logRecord_t
+{
+  uint32_t sequence;
+  const char * formatPtr;
+  uint32_t timestamp;
+  uint32_t args[MAX_ARGS];
+  uint8_t module;
+  uint8_t level;
+  uint8_t argCount;
+  bool hasText;
+  char text[DEFERRED_LOG_TEXT_SIZE];
+} logRecord_t;
+
+/*
+ * Fila limitada MPMC (Vyukov): produtores disputam a posição com CAS,
+ * uma task migrada entre cores continua correta, o buffer por core só
+ * reduz a disputa
+ */
+typedef struct logRing_t
+{
+  logRecord_t records[DEFERRED_LOG_RING_SIZE];
+  uint32_t enqueuePosition;
+  uint32_t dequeuePosition;
+} logRing_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "DEFERRED_LOG";
+
+static const char * const moduleNames[DEFERRED_LOG_MODULE_COUNT] = {
+  [DEFERRED_LOG_MODULE_PLC_UART] = "plc_uart",
+};
+
+static const char levelLetters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static logRing_t rings[portNUM_PROCESSORS];
+static uint8_t moduleLevels[DEFERRED_LOG_MODULE_COUNT];
+/* Registros descartados por buffer cheio */
+static uint32_t droppedRecords;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void drain_task(void *pvParameters);
+static bool ring_pop(logRing_t * ringPtr, logRecord_t * recordPtr);
+static void record_print(const logRecord_t * recordPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa buffers e task de escrita dos logs
+ * 
+ */
+void deferred_log_init(void)
+{
+  for (uint32_t core = 0; core < portNUM_PROCESSORS; core++)
+  {
+    for (uint32_t idx = 0; idx < DEFERRED_LOG_RING_SIZE; idx++)
+    {
+      rings[core].records[idx].sequence = idx;
+    }
+  }
+
+  for (uint32_t module = 0; module < DEFERRED_LOG_MODULE_COUNT; module++)
+  {
+    moduleLevels[module] = ESP_LOG_INFO;
+  }
+
+  xTaskCreate(drain_task, "deferred_log_task", 3072, NULL, 1, NULL);
+}
+
+/**
+ * Registra log sem formatação. Preferir macros DEFERRED_LOGx
+ * 
+ * @param module      módulo de origem
+ * @param level       nível do log
+ * @param formatPtr   formato literal, ver restrições no header
+ * @param textPtr     texto do %s final, NULL = sem texto
+ * @param argCount    quantidade de argumentos inteiros
+ * @param ...         argumentos inteiros
+ */
+void deferred_log_write(deferredLogModule_t module, esp_log_level_t level, const char * formatPtr,
+                        const char * textPtr, uint32_t argCount, ...)
+{
+  if (level > __atomic_load_n(&moduleLevels[module], __ATOMIC_RELAXED))
+  {
+    return;
+  }
+
+  logRing_t * ringPtr = &rings[xPortGetCoreID()];
+  logRecord_t * recordPtr;
+
+  /* Reserva posição */
+  uint32_t position = __atomic_load_n(&ringPtr->enqueuePosition, __ATOMIC_RELAXED);
+  for (;;)
+  {
+    recordPtr = &ringPtr->records[position & RING_MASK];
+    const uint32_t sequence = __atomic_load_n(&recordPtr->sequence, __ATOMIC_ACQUIRE);
+    const int32_t difference = (int32_t)(sequence - position);
+
+    if (difference == 0)
+    {
+      if (__atomic_compare_exchange_n(&ringPtr->enqueuePosition, &position, position + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+        break;
+      }
+    }
+    else if (difference < 0)
+    {
+      /* Buffer cheio, descarta */
+      __atomic_fetch_add(&droppedRecords, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    else
+    {
+      /* Posição tomada por outro produtor */
+      position = __atomic_load_n(&ringPtr->enqueuePosition, __ATOMIC_RELAXED);
+    }
+  }
+
+  recordPtr->formatPtr = formatPtr;
+  recordPtr->timestamp = esp_log_timestamp();
+  recordPtr->module = module;
+  recordPtr->level = level;
+  recordPtr->argCount = argCount > MAX_ARGS ? MAX_ARGS : argCount;
+
+  va_list args;
+  va_start(args, argCount);
+  for (uint32_t idx = 0; idx < recordPtr->argCount; idx++)
+  {
+    recordPtr->args[idx] = va_arg(args, uint32_t);
+  }
+  va_end(args);
+
+  recordPtr->hasText = textPtr != NULL;
+  if (recordPtr->hasText)
+  {
+    strncpy(recordPtr->text, textPtr, sizeof(recordPtr->text) - 1);
+    recordPtr->text[sizeof(recordPtr->text) - 1] = '\0';
+  }
+
+  /* Publica registro para o consumidor */
+  __atomic_store_n(&recordPtr->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Altera nível de log de um módulo
+ * 
+ * @param moduleNamePtr nome do módulo
+ * @param level         novo nível
+ * @return true         nível alterado
+ * @return false        módulo ou nível inválido
+ */
+bool deferred_log_set_level(const char * moduleNamePtr, esp_log_level_t level)
+{
+  if (level > ESP_LOG_VERBOSE)
+  {
+    return false;
+  }
+
+  for (uint32_t module = 0; module < DEFERRED_LOG_MODULE_COUNT; module++)
+  {
+    if (strcmp(moduleNamePtr, moduleNames[module]) == 0)
+    {
+      __atomic_store_n(&moduleLevels[module], level, __ATOMIC_RELAXED);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Recupera nível de log de um módulo
+ * 
+ * @param module            módulo
+ * @return esp_log_level_t  nível atual
+ */
+esp_log_level_t deferred_log_get_level(deferredLogModule_t module)
+{
+  return __atomic_load_n(&moduleLevels[module], __ATOMIC_RELAXED);
+}
+
+/**
+ * Nome de exibição de um módulo
+ * 
+ * @param module        módulo
+ * @return const char*  nome
+ */
+const char * deferred_log_module_name(deferredLogModule_t module)
+{
+  return moduleNames[module];
+}
+
+/**
+ * Recupera total de registros descartados por buffer cheio
+ * 
+ * @return uint32_t registros descartados
+ */
+uint32_t deferred_log_get_dropped(void)
+{
+  return __atomic_load_n(&droppedRecords, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task de formatação e escrita dos registros
+ * 
+ * @param pvParameters
+ */
+static void drain_task(void *pvParameters)
+{
+  logRecord_t record;
+  uint32_t reportedDropped = 0;
+  while (true)
+  {
+    for (uint32_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+      while (ring_pop(&rings[core], &record))
+      {
+        record_print(&record);
+      }
+    }
+
+    const uint32_t dropped = deferred_log_get_dropped();
+    if (dropped != reportedDropped)
+    {
+      ESP_LOGI(TAG, "%u records dropped", dropped - reportedDropped);
+      reportedDropped = dropped;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+  }
+}
+
+/**
+ * Retira registro mais antigo do buffer, consumidor único
+ * 
+ * @param ringPtr     buffer circular
+ * @param recordPtr   estrutura de escrita
+ * @return true       registro copiado
+ * @return false      buffer vazio
+ */
+static bool ring_pop(logRing_t * ringPtr, logRecord_t * recordPtr)
+{
+  const uint32_t position = ringPtr->dequeuePosition;
+  logRecord_t * cellPtr = &ringPtr->records[position & RING_MASK];
+  const uint32_t sequence = __atomic_load_n(&cellPtr->sequence, __ATOMIC_ACQUIRE);
+
+  if ((int32_t)(sequence - (position + 1)) < 0)
+  {
+    return false;
+  }
+
+  *recordPtr = *cellPtr;
+  ringPtr->dequeuePosition = position + 1;
+
+  /* Libera célula para a próxima volta */
+  __atomic_store_n(&cellPtr->sequence, position + DEFERRED_LOG_RING_SIZE, __ATOMIC_RELEASE);
+  return true;
+}
+
+/**
+ * Formata e escreve registro no console
+ * 
+ * @param recordPtr   registro a ser escrito
+ */
+static void record_print(const logRecord_t * recordPtr)
+{
+  char line[LINE_SIZE];
+  const uint32_t * args = recordPtr->args;
+  const char * textPtr = recordPtr->text;
+
+  /* Texto, quando presente, é sempre o último argumento do formato */
+  switch ((recordPtr->argCount << 1) | (recordPtr->hasText ? 1 : 0))
+  {
+    case 0: snprintf(line, sizeof(line), recordPtr->formatPtr); break;
+    case 1: snprintf(line, sizeof(line), recordPtr->formatPtr, textPtr); break;
+    case 2: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0]); break;
+    case 3: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0], textPtr); break;
+    case 4: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0], args[1]); break;
+    case 5: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0], args[1], textPtr); break;
+    case 6: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0], args[1], args[2]); break;
+    default: snprintf(line, sizeof(line), recordPtr->formatPtr, args[0], args[1], args[2], textPtr); break;
+  }
+
+  esp_log_write(recordPtr->level, moduleNames[recordPtr->module], "%c (%u) %s: %s\n",
+                levelLetters[recordPtr->level], recordPtr->timestamp,
+                moduleNames[recordPtr->module], line);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
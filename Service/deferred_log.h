@@ -0,0 +1,75 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Log adiado: o chamador registra ponteiro do formato e argumentos brutos
+ * em um buffer circular sem bloqueio, a formatação e a escrita no console
+ * ficam para uma task de baixa prioridade.
+ * 
+ * Restrições do formato:
+ *   - até 3 argumentos inteiros de 32 bits;
+ *   - no máximo um texto (%s), sempre o último argumento do formato,
+ *     copiado no registro (limitado a DEFERRED_LOG_TEXT_SIZE - 1);
+ *   - o formato deve ser literal, somente o ponteiro é armazenado.
+ */
+
+/* Registros por core, potência de 2 */
+#ifndef DEFERRED_LOG_RING_SIZE
+#define DEFERRED_LOG_RING_SIZE  32
+#endif
+/* Texto copiado por registro, incluindo terminador */
+#ifndef DEFERRED_LOG_TEXT_SIZE
+#define DEFERRED_LOG_TEXT_SIZE  72
+#endif
+
+/* Módulos com nível de log configurável em tempo de execução */
+typedef enum deferredLogModule_t
+{
+  DEFERRED_LOG_MODULE_PLC_UART = 0,
+  DEFERRED_LOG_MODULE_COUNT,
+} deferredLogModule_t;
+
+/* Quantidade de argumentos inteiros, de 0 a 3 */
+#define DEFERRED_LOG_NARGS(...)                     DEFERRED_LOG_NARGS_(0, ##__VA_ARGS__, 3, 2, 1, 0)
+#define DEFERRED_LOG_NARGS_(_0, _1, _2, _3, N, ...) N
+
+/* Registra log. text = NULL quando o formato não tem %s */
+#define DEFERRED_LOG(module, level, format, text, ...)                                      \
+  deferred_log_write(module, level, format, text, DEFERRED_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__)
+#define DEFERRED_LOGI(module, format, text, ...)  DEFERRED_LOG(module, ESP_LOG_INFO, format, text, ##__VA_ARGS__)
+#define DEFERRED_LOGD(module, format, text, ...)  DEFERRED_LOG(module, ESP_LOG_DEBUG, format, text, ##__VA_ARGS__)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void deferred_log_init(void);
+void deferred_log_write(deferredLogModule_t module, esp_log_level_t level, const char * formatPtr,
+                        const char * textPtr, uint32_t argCount, ...);
+bool deferred_log_set_level(const char * moduleNamePtr, esp_log_level_t level);
+esp_log_level_t deferred_log_get_level(deferredLogModule_t module);
+const char * deferred_log_module_name(deferredLogModule_t module);
+uint32_t deferred_log_get_dropped(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,157 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "latency_histogram.h"
+#include <stdbool.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Faixas lineares por potência de 2 */
+#define SUB_BUCKETS       (1 << LATENCY_HISTOGRAM_SUB_BITS)
+/* Maior valor representável sem saturação */
+#define MAX_VALUE         ((1UL << LATENCY_HISTOGRAM_MAX_BITS) - 1)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static uint32_t bucket_index(uint32_t value);
+static uint32_t bucket_upper_value(uint32_t index);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Registra uma amostra de latência
+ * 
+ * @param histogramPtr  histograma a ser atualizado
+ * @param valueUs       latência em microssegundos
+ */
+void latency_histogram_record(latencyHistogram_t * histogramPtr, uint32_t valueUs)
+{
+  __atomic_fetch_add(&histogramPtr->counts[bucket_index(valueUs)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogramPtr->total, 1, __ATOMIC_RELAXED);
+
+  uint32_t currentMax = __atomic_load_n(&histogramPtr->max, __ATOMIC_RELAXED);
+  while ((valueUs > currentMax) &&
+         (__atomic_compare_exchange_n(&histogramPtr->max, &currentMax, valueUs, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false))
+  {
+    /* Outro escritor atualizou o máximo, compara novamente */
+  }
+}
+
+/**
+ * Calcula percentil, retornando limite superior da faixa encontrada
+ * 
+ * @param histogramPtr  histograma a ser consultado
+ * @param permille      percentil em milésimos, ex: 990 = p99
+ * @return uint32_t     latência em microssegundos, 0 = sem amostras
+ */
+uint32_t latency_histogram_percentile(const latencyHistogram_t * histogramPtr, uint32_t permille)
+{
+  const uint32_t total = __atomic_load_n(&histogramPtr->total, __ATOMIC_RELAXED);
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  /* Posição da amostra do percentil, arredondada para cima */
+  const uint32_t target = (uint32_t)((((uint64_t)total * permille) + 999) / 1000);
+  uint32_t accumulated = 0;
+  for (uint32_t idx = 0; idx < LATENCY_HISTOGRAM_BUCKETS; idx++)
+  {
+    accumulated += __atomic_load_n(&histogramPtr->counts[idx], __ATOMIC_RELAXED);
+    if (accumulated >= target)
+    {
+      const uint32_t upper = bucket_upper_value(idx);
+      const uint32_t max = __atomic_load_n(&histogramPtr->max, __ATOMIC_RELAXED);
+      return upper < max ? upper : max;
+    }
+  }
+
+  return __atomic_load_n(&histogramPtr->max, __ATOMIC_RELAXED);
+}
+
+/**
+ * Zera histograma. Amostras concorrentes à limpeza podem ser perdidas
+ * 
+ * @param histogramPtr  histograma a ser zerado
+ */
+void latency_histogram_reset(latencyHistogram_t * histogramPtr)
+{
+  for (uint32_t idx = 0; idx < LATENCY_HISTOGRAM_BUCKETS; idx++)
+  {
+    __atomic_store_n(&histogramPtr->counts[idx], 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&histogramPtr->total, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&histogramPtr->max, 0, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+/**
+ * Faixa de um valor: bits mais significativos definem a potência de 2,
+ * os SUB_BITS seguintes a faixa linear dentro dela
+ * 
+ * @param value     valor em microssegundos
+ * @return uint32_t índice da faixa
+ */
+static uint32_t bucket_index(uint32_t value)
+{
+  if (value > MAX_VALUE)
+  {
+    value = MAX_VALUE;
+  }
+
+  if (value < SUB_BUCKETS)
+  {
+    return value;
+  }
+
+  const uint32_t magnitude = 31 - __builtin_clz(value);
+  const uint32_t shift = magnitude - LATENCY_HISTOGRAM_SUB_BITS;
+  return ((shift + 1) << LATENCY_HISTOGRAM_SUB_BITS) + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+/**
+ * Maior valor contido em uma faixa
+ * 
+ * @param index     índice da faixa
+ * @return uint32_t valor em microssegundos
+ */
+static uint32_t bucket_upper_value(uint32_t index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index;
+  }
+
+  const uint32_t shift = (index >> LATENCY_HISTOGRAM_SUB_BITS) - 1;
+  const uint32_t base = (SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << shift;
+  return base + ((1UL << shift) - 1);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,47 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Histograma no estilo HDR: cada potência de 2 é dividida em 2^SUB_BITS
+ * faixas lineares, erro relativo máximo de 1 / 2^SUB_BITS (12,5%).
+ * Valores em microssegundos, saturados em 2^MAX_BITS (~8,4 s).
+ */
+#define LATENCY_HISTOGRAM_SUB_BITS  3
+#define LATENCY_HISTOGRAM_MAX_BITS  23
+#define LATENCY_HISTOGRAM_BUCKETS   (((LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BITS) + 1) << LATENCY_HISTOGRAM_SUB_BITS)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Contadores atualizados com operações atômicas, sem bloqueio na escrita */
+typedef struct latencyHistogram_t
+{
+  uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+  uint32_t total;
+  uint32_t max;
+} latencyHistogram_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void latency_histogram_record(latencyHistogram_t * histogramPtr, uint32_t valueUs);
+uint32_t latency_histogram_percentile(const latencyHistogram_t * histogramPtr, uint32_t permille);
+void latency_histogram_reset(latencyHistogram_t * histogramPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -11,8 +11,15 @@
 *******************************************************************************/
 #include "plc_config.h"
 #include "plc_uart.h"
+#include "plc_topology.h"
+#include "plc_trace.h"
+#include "plc_health.h"
+#include "plc_io_queue.h"
+#include "plc_jobs.h"
+#include "plc_events.h"
 #include <stddef.h>
 #include <string.h>
+#include "esp_bit_defs.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
@@ -43,16 +50,45 @@
  */
 void plc_config_init(void)
 {
+  plc_events_init();
+  plc_trace_init();
   plc_uart_init();
+  plc_topology_init();
+  plc_health_init();
+  plc_io_queue_init();
+  plc_jobs_init();
 }
 
 /**
- * Configura módulo para modo AT
+ * Configura módulos de todas as portas para modo AT
  * 
+ * @return uint32_t   portas com falha na configuração, bit n = porta n,
+ *                    0 = todos os módulos configurados
+ */
+uint32_t plc_configure_module(void)
+{
+  uint32_t failedPorts = 0;
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    /* Demais módulos configurados mesmo com falha em um deles */
+    if (plc_configure_port(port) == false)
+    {
+      failedPorts |= BIT(port);
+    }
+  }
+
+  return failedPorts;
+}
+
+/**
+ * Configura módulo de uma porta para modo AT, também usada pelo watchdog
+ * na recuperação do módulo
+ * 
+ * @param port    porta do módulo
  * @return true   configuração com sucesso
  * @return false  falha configuração 
  */
-bool plc_configure_module(void)
+bool plc_configure_port(uint32_t port)
 {
   uartPlcResponse_t response;
 
@@ -60,7 +96,7 @@ bool plc_configure_module(void)
   response.result = false;
 
   /* Altera comando para modelo AT */
-  plc_uart_send("++", &response);
+  plc_uart_send(port, "++", &response);
 
   if (response.result == false) {
     return false;
@@ -70,7 +106,7 @@ bool plc_configure_module(void)
   response.result = false;
   
   /* Envia comando para definir padrão como AT */
-  plc_uart_send("AT+MODE=2\r\n", &response);
+  plc_uart_send(port, "AT+MODE=2\r\n", &response);
 
   return response.result;
 }
@@ -12,6 +12,7 @@
 * INCLUDES
 *******************************************************************************/
 #include "stdbool.h"
+#include <stdint.h>
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
@@ -24,7 +25,8 @@
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 void plc_config_init(void);
-bool plc_configure_module(void);
+uint32_t plc_configure_module(void);
+bool plc_configure_port(uint32_t port);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -0,0 +1,285 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_events.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Endereço MAC normalizado, somente dígitos hexadecimais */
+#define MAC_DIGITS  12
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Evento codificado no anel */
+typedef struct eventSlot_t
+{
+  uint32_t seq;
+  uint16_t length;
+  char frame[PLC_EVENTS_FRAME_SIZE];
+} eventSlot_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+/* Nome do tipo no frame, indexado por plcEventType_t */
+static const char * const typeNames[] =
+{
+  [PLC_EVENT_NODE_JOIN] = "join",
+  [PLC_EVENT_NODE_LEAVE] = "leave",
+  [PLC_EVENT_NODE_SNR] = "snr",
+  [PLC_EVENT_IO_ACK] = "io",
+  [PLC_EVENT_MODULE_RESET] = "reset",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Anel de eventos, seq ocupa a posição seq % PLC_EVENTS_RING_SIZE */
+static eventSlot_t ring[PLC_EVENTS_RING_SIZE];
+/* Sequência do próximo evento publicado */
+static uint32_t nextSeq;
+/* Assinantes registrados */
+static plcEventsListener_t listeners[PLC_EVENTS_MAX_LISTENERS];
+/* Proteção do anel */
+static SemaphoreHandle_t eventsMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static uint32_t publish(plcEventType_t type, const char * formatPtr, ...);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa anel de eventos. Chamada pelos módulos que publicam e que
+ * assinam, somente a primeira chamada tem efeito
+ * 
+ */
+void plc_events_init(void)
+{
+  if (eventsMutex != NULL)
+  {
+    return;
+  }
+
+  bzero(ring, sizeof(ring));
+  bzero(listeners, sizeof(listeners));
+  nextSeq = 1;
+  eventsMutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * Registra assinante notificado a cada evento publicado
+ * 
+ * @param listener  função de notificação
+ * @return true     assinante registrado
+ * @return false    todos os assinantes ocupados
+ */
+bool plc_events_add_listener(plcEventsListener_t listener)
+{
+  bool result = false;
+
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+  for (uint32_t idx = 0; (idx < PLC_EVENTS_MAX_LISTENERS) && (result == false); idx++)
+  {
+    if (listeners[idx] == NULL)
+    {
+      listeners[idx] = listener;
+      result = true;
+    }
+  }
+  xSemaphoreGive(eventsMutex);
+
+  return result;
+}
+
+/**
+ * Publica evento de node: entrada, saída ou variação de SNR
+ * 
+ * @param type      PLC_EVENT_NODE_JOIN, PLC_EVENT_NODE_LEAVE ou PLC_EVENT_NODE_SNR
+ * @param nodePtr   leitura do node
+ * @return uint32_t sequência do evento
+ */
+uint32_t plc_events_node(plcEventType_t type, const node_t * nodePtr)
+{
+  const uint8_t * macPtr = nodePtr->mac;
+  if (type == PLC_EVENT_NODE_LEAVE)
+  {
+    return publish(type, ",\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"network\":%u",
+                   macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5], nodePtr->network);
+  }
+
+  return publish(type, ",\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"network\":%u,\"snr\":%u",
+                 macPtr[0], macPtr[1], macPtr[2], macPtr[3], macPtr[4], macPtr[5],
+                 nodePtr->network, nodePtr->snr);
+}
+
+/**
+ * Publica escrita de IO confirmada pelo módulo
+ * 
+ * @param macPtr    MAC normalizado do módulo, somente dígitos
+ * @param value     valor escrito
+ * @param jobId     job da fila de escritas, 0 = escrita direta
+ * @return uint32_t sequência do evento
+ */
+uint32_t plc_events_io_ack(const char * macPtr, uint32_t value, uint32_t jobId)
+{
+  /* Mesmo formato de MAC dos eventos de topologia */
+  char mac[MAC_DIGITS + (MAC_DIGITS / 2)];
+  if (strlen(macPtr) == MAC_DIGITS)
+  {
+    for (uint32_t idx = 0; idx < (MAC_DIGITS / 2); idx++)
+    {
+      mac[idx * 3] = macPtr[idx * 2];
+      mac[(idx * 3) + 1] = macPtr[(idx * 2) + 1];
+      mac[(idx * 3) + 2] = ':';
+    }
+    mac[sizeof(mac) - 1] = '\0';
+  }
+  else
+  {
+    snprintf(mac, sizeof(mac), "%s", macPtr);
+  }
+
+  return publish(PLC_EVENT_IO_ACK, ",\"mac\":\"%s\",\"value\":%u,\"job\":%u", mac, value, jobId);
+}
+
+/**
+ * Publica notificação de reinício do módulo de uma porta
+ * 
+ * @param port      porta do módulo
+ * @return uint32_t sequência do evento
+ */
+uint32_t plc_events_module_reset(uint32_t port)
+{
+  return publish(PLC_EVENT_MODULE_RESET, ",\"network\":%u", port);
+}
+
+/**
+ * Recupera sequência do próximo evento, assinante novo começa a partir dela
+ * 
+ * @return uint32_t sequência do próximo evento
+ */
+uint32_t plc_events_next_seq(void)
+{
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+  const uint32_t seq = nextSeq;
+  xSemaphoreGive(eventsMutex);
+
+  return seq;
+}
+
+/**
+ * Recupera sequência do evento mais antigo ainda no anel
+ * 
+ * @return uint32_t sequência do evento mais antigo, igual à próxima com o anel vazio
+ */
+uint32_t plc_events_oldest_seq(void)
+{
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+  const uint32_t seq = (nextSeq > PLC_EVENTS_RING_SIZE) ? (nextSeq - PLC_EVENTS_RING_SIZE) : 1;
+  xSemaphoreGive(eventsMutex);
+
+  return seq;
+}
+
+/**
+ * Copia frame codificado de um evento
+ * 
+ * @param seq         sequência do evento
+ * @param bufferPtr   buffer de escrita, sem terminador
+ * @param bufferSize  tamanho do buffer, PLC_EVENTS_FRAME_SIZE comporta qualquer frame
+ * @return int32_t    tamanho do frame, 0 = ainda não publicado, -1 = sobrescrito
+ */
+int32_t plc_events_read(uint32_t seq, char * bufferPtr, size_t bufferSize)
+{
+  int32_t result = 0;
+
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+  /* Distância até o próximo evento, <= 0 = ainda não publicado */
+  const int32_t age = (int32_t)(nextSeq - seq);
+  if ((seq == 0) || (age > PLC_EVENTS_RING_SIZE))
+  {
+    result = -1;
+  }
+  else if (age > 0)
+  {
+    const eventSlot_t * slotPtr = &ring[seq % PLC_EVENTS_RING_SIZE];
+    result = (slotPtr->length <= bufferSize) ? slotPtr->length : bufferSize;
+    memcpy(bufferPtr, slotPtr->frame, result);
+  }
+  xSemaphoreGive(eventsMutex);
+
+  return result;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Codifica evento no anel e notifica assinantes
+ * 
+ * @param type      tipo do evento
+ * @param formatPtr campos do evento após seq e type, iniciando por ','
+ * @return uint32_t sequência do evento
+ */
+static uint32_t publish(plcEventType_t type, const char * formatPtr, ...)
+{
+  xSemaphoreTake(eventsMutex, portMAX_DELAY);
+
+  const uint32_t seq = nextSeq++;
+  eventSlot_t * slotPtr = &ring[seq % PLC_EVENTS_RING_SIZE];
+  slotPtr->seq = seq;
+
+  /* Reserva o fechamento do objeto, campos excedentes são truncados */
+  const size_t capacity = sizeof(slotPtr->frame) - 1;
+  int length = snprintf(slotPtr->frame, capacity, "{\"seq\":%u,\"type\":\"%s\"", seq, typeNames[type]);
+
+  va_list args;
+  va_start(args, formatPtr);
+  length += vsnprintf(&slotPtr->frame[length], capacity - length, formatPtr, args);
+  va_end(args);
+
+  if (length >= (int)capacity)
+  {
+    length = capacity - 1;
+  }
+  slotPtr->frame[length++] = '}';
+  slotPtr->length = length;
+
+  plcEventsListener_t listenersCopy[PLC_EVENTS_MAX_LISTENERS];
+  memcpy(listenersCopy, listeners, sizeof(listeners));
+
+  xSemaphoreGive(eventsMutex);
+
+  for (uint32_t idx = 0; idx < PLC_EVENTS_MAX_LISTENERS; idx++)
+  {
+    if (listenersCopy[idx] != NULL)
+    {
+      listenersCopy[idx](seq);
+    }
+  }
+
+  return seq;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
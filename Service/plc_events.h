@@ -0,0 +1,74 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_EVENTS_H
+#define PLC_EVENTS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "plc_topology.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Eventos da rede PLC, codificados uma única vez como JSON compacto em um
+ * anel de tamanho fixo e numerados por sequência crescente (primeiro = 1).
+ * Assinantes leem o anel pela sequência, sem cópia por assinante:
+ *   {"seq":7,"type":"join","mac":"00:11:22:33:44:55","network":0,"snr":31}
+ *   {"seq":8,"type":"leave","mac":"00:11:22:33:44:55","network":0}
+ *   {"seq":9,"type":"snr","mac":"00:11:22:33:44:55","network":0,"snr":27}
+ *   {"seq":10,"type":"io","mac":"00:11:22:33:44:55","value":1,"job":0}
+ *   {"seq":11,"type":"reset","network":1}
+ * Evento sobrescrito antes de lido é perdido para o assinante atrasado
+ */
+/* Eventos mantidos no anel */
+#ifndef PLC_EVENTS_RING_SIZE
+#define PLC_EVENTS_RING_SIZE    32
+#endif
+/* Maior frame codificado, em bytes */
+#define PLC_EVENTS_FRAME_SIZE   112
+/* Variação de SNR, em dB, em relação ao último valor publicado que gera evento */
+#define PLC_EVENTS_SNR_DELTA    3
+/* Assinantes notificados a cada publicação */
+#define PLC_EVENTS_MAX_LISTENERS 2
+
+/* Tipos de evento */
+typedef enum plcEventType_t
+{
+  PLC_EVENT_NODE_JOIN = 0,
+  PLC_EVENT_NODE_LEAVE,
+  PLC_EVENT_NODE_SNR,
+  PLC_EVENT_IO_ACK,
+  PLC_EVENT_MODULE_RESET,
+} plcEventType_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Notificação de publicação, executada na task do publicador, não deve bloquear */
+typedef void (*plcEventsListener_t)(uint32_t seq);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_events_init(void);
+bool plc_events_add_listener(plcEventsListener_t listener);
+uint32_t plc_events_node(plcEventType_t type, const node_t * nodePtr);
+uint32_t plc_events_io_ack(const char * macPtr, uint32_t value, uint32_t jobId);
+uint32_t plc_events_module_reset(uint32_t port);
+uint32_t plc_events_next_seq(void);
+uint32_t plc_events_oldest_seq(void);
+int32_t plc_events_read(uint32_t seq, char * bufferPtr, size_t bufferSize);
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,373 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_health.h"
+#include <string.h>
+#include "plc_uart.h"
+#include "plc_config.h"
+#include "plc_events.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Bits por porta: módulo pronto (readySignal) e recuperação pedida (recoverySignal) */
+#define PORT_BIT(port)        (1U << (port))
+#define ALL_PORT_BITS         ((1U << PLC_UART_PORT_COUNT) - 1)
+/* Verificação do heartbeat e das tentativas de recuperação */
+#define CHECK_PERIOD_MS       500
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct portHealth_t
+{
+  plcHealthStatus_t status;
+  /* Última resposta recebida do módulo */
+  int64_t lastResponseUs;
+  /* Detecção da falha em andamento */
+  int64_t downSinceUs;
+  /* Próxima tentativa de recuperação e intervalo atual */
+  int64_t nextAttemptUs;
+  uint32_t retryMs;
+} portHealth_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "PLC_HEALTH";
+
+/* Notificações emitidas pelo módulo ao reiniciar, fora do modo AT */
+static const char * const resetNotifications[] = {
+  "+READY",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static portHealth_t ports[PLC_UART_PORT_COUNT];
+static SemaphoreHandle_t healthMutex;
+static EventGroupHandle_t readySignal;
+static EventGroupHandle_t recoverySignal;
+static TaskHandle_t healthTask;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void health_task(void * param);
+static void mark_down(uint32_t port);
+static void heartbeat(uint32_t port);
+static void recover(uint32_t port);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa watchdog, módulos considerados prontos até a primeira falha
+ * 
+ */
+void plc_health_init(void)
+{
+  bzero(ports, sizeof(ports));
+  const int64_t now = esp_timer_get_time();
+  for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+  {
+    ports[port].status.up = true;
+    ports[port].lastResponseUs = now;
+  }
+
+  healthMutex = xSemaphoreCreateMutex();
+  readySignal = xEventGroupCreate();
+  recoverySignal = xEventGroupCreate();
+  xEventGroupSetBits(readySignal, ALL_PORT_BITS);
+
+  xTaskCreate(health_task, "plc_health_task", 3072, NULL, 5, &healthTask);
+}
+
+/**
+ * Aguarda módulo da porta estar pronto antes do envio de um comando.
+ * Comandos da própria recuperação não aguardam
+ * 
+ * @param port        porta do módulo
+ * @param deadlineUs  prazo absoluto do comando, limita a espera, 0 = sem prazo
+ * @return true       módulo pronto
+ * @return false      recuperação não concluída em PLC_HEALTH_HOLD_MS ou no prazo
+ */
+bool plc_health_wait_ready(uint32_t port, int64_t deadlineUs)
+{
+  if ((healthTask == NULL) || (xTaskGetCurrentTaskHandle() == healthTask))
+  {
+    return true;
+  }
+
+  if (xEventGroupGetBits(readySignal) & PORT_BIT(port))
+  {
+    return true;
+  }
+
+  int64_t holdMs = PLC_HEALTH_HOLD_MS;
+  if (deadlineUs != 0)
+  {
+    const int64_t remainingMs = (deadlineUs - esp_timer_get_time()) / 1000;
+    holdMs = (remainingMs < holdMs) ? remainingMs : holdMs;
+  }
+
+  if (holdMs <= 0)
+  {
+    return false;
+  }
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  ports[port].status.held++;
+  xSemaphoreGive(healthMutex);
+
+  const EventBits_t bits = xEventGroupWaitBits(readySignal, PORT_BIT(port), false, true,
+                                               holdMs / portTICK_PERIOD_MS);
+  if (bits & PORT_BIT(port))
+  {
+    return true;
+  }
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  ports[port].status.holdTimeouts++;
+  xSemaphoreGive(healthMutex);
+  return false;
+}
+
+/**
+ * Verifica, sem aguardar, se o módulo da porta está pronto
+ * 
+ * @param port    porta do módulo
+ * @return true   módulo pronto
+ * @return false  módulo em recuperação
+ */
+bool plc_health_is_up(uint32_t port)
+{
+  if ((readySignal == NULL) || (port >= PLC_UART_PORT_COUNT))
+  {
+    return readySignal == NULL;
+  }
+
+  return (xEventGroupGetBits(readySignal) & PORT_BIT(port)) != 0;
+}
+
+/**
+ * Registra resultado de um comando enviado ao módulo
+ * 
+ * @param port        porta do módulo
+ * @param responded   linha de resultado recebida (OK ou ERROR)
+ */
+void plc_health_report(uint32_t port, bool responded)
+{
+  if (port >= PLC_UART_PORT_COUNT)
+  {
+    return;
+  }
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  portHealth_t * healthPtr = &ports[port];
+  if (responded)
+  {
+    healthPtr->lastResponseUs = esp_timer_get_time();
+    healthPtr->status.consecutiveFailures = 0;
+  }
+  else if (healthPtr->status.up)
+  {
+    /* Falhas durante a recuperação não contam para uma nova detecção */
+    healthPtr->status.consecutiveFailures++;
+    if (healthPtr->status.consecutiveFailures >= PLC_HEALTH_FAILURE_THRESHOLD)
+    {
+      mark_down(port);
+    }
+  }
+  xSemaphoreGive(healthMutex);
+}
+
+/**
+ * Verifica notificação recebida do módulo, chamada pela task UART
+ * 
+ * @param port      porta do módulo
+ * @param linePtr   linha de notificação
+ */
+void plc_health_notification(uint32_t port, const char * linePtr)
+{
+  for (uint32_t idx = 0; idx < (sizeof(resetNotifications) / sizeof(resetNotifications[0])); idx++)
+  {
+    if (strncmp(linePtr, resetNotifications[idx], strlen(resetNotifications[idx])) == 0)
+    {
+      xSemaphoreTake(healthMutex, portMAX_DELAY);
+      ports[port].status.resetNotifications++;
+      mark_down(port);
+      xSemaphoreGive(healthMutex);
+
+      plc_events_module_reset(port);
+      return;
+    }
+  }
+}
+
+/**
+ * Solicita recuperação do módulo de uma porta, ex. falha na configuração
+ * inicial
+ * 
+ * @param port    porta do módulo
+ */
+void plc_health_request_recovery(uint32_t port)
+{
+  if (port >= PLC_UART_PORT_COUNT)
+  {
+    return;
+  }
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  mark_down(port);
+  xSemaphoreGive(healthMutex);
+}
+
+/**
+ * Recupera estado do módulo de uma porta
+ * 
+ * @param port        porta do módulo
+ * @param statusPtr   estrutura de escrita
+ */
+void plc_health_get(uint32_t port, plcHealthStatus_t * statusPtr)
+{
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  *statusPtr = ports[port].status;
+  xSemaphoreGive(healthMutex);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task do watchdog: heartbeat das portas ociosas e recuperação das portas
+ * fora do ar
+ * 
+ * @param param 
+ */
+static void health_task(void * param)
+{
+  while (true)
+  {
+    /* Acorda antes do período com pedido de recuperação */
+    const EventBits_t requested = xEventGroupWaitBits(recoverySignal, ALL_PORT_BITS, true, false,
+                                                      CHECK_PERIOD_MS / portTICK_PERIOD_MS);
+
+    for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+    {
+      xSemaphoreTake(healthMutex, portMAX_DELAY);
+      const bool up = ports[port].status.up;
+      const int64_t now = esp_timer_get_time();
+      const bool attemptDue = (requested & PORT_BIT(port)) || (now >= ports[port].nextAttemptUs);
+      const bool idle = (now - ports[port].lastResponseUs) >= ((int64_t)PLC_HEALTH_HEARTBEAT_MS * 1000);
+      xSemaphoreGive(healthMutex);
+
+      if ((up == false) && attemptDue)
+      {
+        recover(port);
+      }
+      else if (up && idle)
+      {
+        heartbeat(port);
+      }
+    }
+  }
+}
+
+/**
+ * Marca módulo fora do ar, retendo novos comandos. Chamada com healthMutex
+ * 
+ * @param port    porta do módulo
+ */
+static void mark_down(uint32_t port)
+{
+  portHealth_t * healthPtr = &ports[port];
+  if (healthPtr->status.up)
+  {
+    healthPtr->status.up = false;
+    healthPtr->downSinceUs = esp_timer_get_time();
+    healthPtr->nextAttemptUs = 0;
+    healthPtr->retryMs = PLC_HEALTH_RETRY_MIN_MS;
+    xEventGroupClearBits(readySignal, PORT_BIT(port));
+    ESP_LOGW(TAG, "Module on port %u down", port);
+  }
+  xEventGroupSetBits(recoverySignal, PORT_BIT(port));
+}
+
+/**
+ * Envia heartbeat ao módulo ocioso, resultado registrado por plc_uart_send
+ * 
+ * @param port    porta do módulo
+ */
+static void heartbeat(uint32_t port)
+{
+  uartPlcResponse_t response;
+  bzero(&response, sizeof(uartPlcResponse_t));
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  ports[port].status.heartbeats++;
+  const uint32_t failuresBefore = ports[port].status.consecutiveFailures;
+  xSemaphoreGive(healthMutex);
+
+  plc_uart_send(port, "AT\r\n", &response);
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  if (ports[port].status.consecutiveFailures > failuresBefore)
+  {
+    ports[port].status.heartbeatFailures++;
+  }
+  xSemaphoreGive(healthMutex);
+}
+
+/**
+ * Executa sequência de entrada em modo AT. Sucesso libera os comandos
+ * retidos, falha agenda nova tentativa com intervalo dobrado
+ * 
+ * @param port    porta do módulo
+ */
+static void recover(uint32_t port)
+{
+  const bool result = plc_configure_port(port);
+  const int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(healthMutex, portMAX_DELAY);
+  portHealth_t * healthPtr = &ports[port];
+  healthPtr->status.recoveryAttempts++;
+  if (result)
+  {
+    const uint64_t durationUs = now - healthPtr->downSinceUs;
+    healthPtr->status.up = true;
+    healthPtr->status.consecutiveFailures = 0;
+    healthPtr->status.recoveries++;
+    healthPtr->status.lastRecoveryUs = durationUs;
+    healthPtr->status.totalRecoveryUs += durationUs;
+    healthPtr->lastResponseUs = now;
+    xEventGroupSetBits(readySignal, PORT_BIT(port));
+    ESP_LOGI(TAG, "Module on port %u recovered in %u ms", port, (uint32_t)(durationUs / 1000));
+  }
+  else
+  {
+    healthPtr->nextAttemptUs = now + ((int64_t)healthPtr->retryMs * 1000);
+    healthPtr->retryMs = (healthPtr->retryMs * 2 < PLC_HEALTH_RETRY_MAX_MS) ? healthPtr->retryMs * 2 :
+                                                                               PLC_HEALTH_RETRY_MAX_MS;
+  }
+  xSemaphoreGive(healthMutex);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,70 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_HEALTH_H
+#define PLC_HEALTH_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Watchdog dos módulos PLC, um por porta UART. Heartbeat ("AT") quando a
+ * porta fica ociosa; falhas consecutivas ou notificação de reinício marcam
+ * o módulo como fora do ar e disparam a sequência "++" / AT+MODE=2.
+ * Durante a recuperação os comandos aguardam, até PLC_HEALTH_HOLD_MS,
+ * em vez de esgotar as tentativas na UART
+ */
+/* Intervalo sem tráfego com sucesso até o heartbeat */
+#define PLC_HEALTH_HEARTBEAT_MS       5000
+/* Comandos consecutivos sem resposta que indicam módulo travado */
+#define PLC_HEALTH_FAILURE_THRESHOLD  2
+/* Espera máxima de um comando pela recuperação do módulo */
+#define PLC_HEALTH_HOLD_MS            10000
+/* Intervalo entre tentativas de recuperação, dobrado a cada falha */
+#define PLC_HEALTH_RETRY_MIN_MS       1000
+#define PLC_HEALTH_RETRY_MAX_MS       30000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Estado do módulo de uma porta */
+typedef struct plcHealthStatus_t
+{
+  bool up;
+  uint32_t consecutiveFailures;
+  uint32_t heartbeats;
+  uint32_t heartbeatFailures;
+  uint32_t resetNotifications;
+  /* Recuperações concluídas e duração, da detecção ao módulo pronto */
+  uint32_t recoveries;
+  uint32_t recoveryAttempts;
+  uint64_t lastRecoveryUs;
+  uint64_t totalRecoveryUs;
+  /* Comandos retidos durante a recuperação e os que esgotaram a espera */
+  uint32_t held;
+  uint32_t holdTimeouts;
+} plcHealthStatus_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_health_init(void);
+bool plc_health_wait_ready(uint32_t port, int64_t deadlineUs);
+bool plc_health_is_up(uint32_t port);
+void plc_health_report(uint32_t port, bool responded);
+void plc_health_notification(uint32_t port, const char * linePtr);
+void plc_health_request_recovery(uint32_t port);
+void plc_health_get(uint32_t port, plcHealthStatus_t * statusPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
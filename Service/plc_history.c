@@ -0,0 +1,328 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_history.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Duração dos intervalos de agregação, em segundos */
+#define MINUTE_PERIOD   60
+#define HOUR_PERIOD     3600
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Agregado em construção do intervalo corrente */
+typedef struct rollupAccumulator_t
+{
+  uint32_t bucket;
+  /* Sem limite de amostras por intervalo, não pode estourar */
+  uint32_t count;
+  uint32_t snrSum;
+  uint32_t atenuationSum;
+  uint8_t snrMin;
+  uint8_t snrMax;
+  uint8_t atenuationMin;
+  uint8_t atenuationMax;
+} rollupAccumulator_t;
+
+/* Controle de um buffer circular: head = próxima escrita */
+typedef struct ringControl_t
+{
+  uint16_t head;
+  uint16_t count;
+} ringControl_t;
+
+/* Histórico completo de um node */
+typedef struct nodeHistory_t
+{
+  plcHistorySample_t raw[PLC_HISTORY_RAW_SIZE];
+  plcHistoryRollup_t minute[PLC_HISTORY_MINUTE_SIZE];
+  plcHistoryRollup_t hour[PLC_HISTORY_HOUR_SIZE];
+  ringControl_t rawRing;
+  ringControl_t minuteRing;
+  ringControl_t hourRing;
+  rollupAccumulator_t minuteAccumulator;
+  rollupAccumulator_t hourAccumulator;
+} nodeHistory_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Histórico indexado pelo slot do node na tabela da topologia */
+static nodeHistory_t history[PLC_TOPOLOGY_MAX_NODES];
+/* Proteção entre atualização da topologia e consultas */
+static SemaphoreHandle_t historyMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static uint16_t ring_push(ringControl_t * ringPtr, uint16_t capacity);
+static uint16_t ring_index(const ringControl_t * ringPtr, uint16_t capacity, uint32_t index);
+static void accumulator_add(rollupAccumulator_t * accumulatorPtr, const node_t * nodePtr, uint32_t bucket);
+static void accumulator_to_rollup(const rollupAccumulator_t * accumulatorPtr, plcHistoryRollup_t * rollupPtr);
+static void rollup_feed(rollupAccumulator_t * accumulatorPtr, plcHistoryRollup_t * ringBufferPtr,
+                        ringControl_t * ringPtr, uint16_t capacity,
+                        const node_t * nodePtr, uint32_t bucket);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa histórico de qualidade do enlace
+ * 
+ */
+void plc_history_init(void)
+{
+  bzero(history, sizeof(history));
+  historyMutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * Limpa histórico de um slot, utilizado quando slot é atribuído a outro node
+ * 
+ * @param slot  slot do node na tabela da topologia
+ */
+void plc_history_reset(uint32_t slot)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+  bzero(&history[slot], sizeof(nodeHistory_t));
+  xSemaphoreGive(historyMutex);
+}
+
+/**
+ * Insere nova amostra e atualiza agregados de forma incremental
+ * 
+ * @param slot      slot do node na tabela da topologia
+ * @param nodePtr   leitura atual do node
+ * @param timestamp segundos desde a inicialização
+ */
+void plc_history_update(uint32_t slot, const node_t * nodePtr, uint32_t timestamp)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+
+  nodeHistory_t * historyPtr = &history[slot];
+
+  /* Amostra bruta */
+  plcHistorySample_t * samplePtr = &historyPtr->raw[ring_push(&historyPtr->rawRing, PLC_HISTORY_RAW_SIZE)];
+  samplePtr->timestamp = timestamp;
+  samplePtr->snr = nodePtr->snr;
+  samplePtr->atenuation = nodePtr->atenuation;
+  samplePtr->phase = nodePtr->phase;
+
+  /* Agregados por minuto e por hora */
+  rollup_feed(&historyPtr->minuteAccumulator, historyPtr->minute, &historyPtr->minuteRing,
+              PLC_HISTORY_MINUTE_SIZE, nodePtr, timestamp - (timestamp % MINUTE_PERIOD));
+  rollup_feed(&historyPtr->hourAccumulator, historyPtr->hour, &historyPtr->hourRing,
+              PLC_HISTORY_HOUR_SIZE, nodePtr, timestamp - (timestamp % HOUR_PERIOD));
+
+  xSemaphoreGive(historyMutex);
+}
+
+/**
+ * Recupera amostra bruta do histórico
+ * 
+ * @param slot      slot do node na tabela da topologia
+ * @param index     posição da amostra, 0 = mais antiga
+ * @param samplePtr amostra a ser escrita
+ * @return true     amostra encontrada
+ * @return false    posição fora do histórico
+ */
+bool plc_history_get_sample(uint32_t slot, uint32_t index, plcHistorySample_t * samplePtr)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return false;
+  }
+
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+
+  const nodeHistory_t * historyPtr = &history[slot];
+  bool result = index < historyPtr->rawRing.count;
+  if (result)
+  {
+    *samplePtr = historyPtr->raw[ring_index(&historyPtr->rawRing, PLC_HISTORY_RAW_SIZE, index)];
+  }
+
+  xSemaphoreGive(historyMutex);
+  return result;
+}
+
+/**
+ * Recupera agregado do histórico. A última posição é o intervalo em andamento
+ * 
+ * @param slot        slot do node na tabela da topologia
+ * @param resolution  resolução do agregado, minuto ou hora
+ * @param index       posição do agregado, 0 = mais antigo
+ * @param rollupPtr   agregado a ser escrito
+ * @return true       agregado encontrado
+ * @return false      posição fora do histórico
+ */
+bool plc_history_get_rollup(uint32_t slot, plcHistoryResolution_t resolution,
+                            uint32_t index, plcHistoryRollup_t * rollupPtr)
+{
+  if ((slot >= PLC_TOPOLOGY_MAX_NODES) || (resolution == PLC_HISTORY_RAW))
+  {
+    return false;
+  }
+
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+
+  const nodeHistory_t * historyPtr = &history[slot];
+  const bool minute = resolution == PLC_HISTORY_MINUTE;
+  const plcHistoryRollup_t * ringBufferPtr = minute ? historyPtr->minute : historyPtr->hour;
+  const ringControl_t * ringPtr = minute ? &historyPtr->minuteRing : &historyPtr->hourRing;
+  const rollupAccumulator_t * accumulatorPtr = minute ? &historyPtr->minuteAccumulator : &historyPtr->hourAccumulator;
+  const uint16_t capacity = minute ? PLC_HISTORY_MINUTE_SIZE : PLC_HISTORY_HOUR_SIZE;
+
+  bool result = true;
+  if (index < ringPtr->count)
+  {
+    /* Intervalo fechado */
+    *rollupPtr = ringBufferPtr[ring_index(ringPtr, capacity, index)];
+  }
+  else if ((index == ringPtr->count) && (accumulatorPtr->count != 0))
+  {
+    /* Intervalo em andamento */
+    accumulator_to_rollup(accumulatorPtr, rollupPtr);
+  }
+  else
+  {
+    result = false;
+  }
+
+  xSemaphoreGive(historyMutex);
+  return result;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+/**
+ * Reserva próxima posição de escrita, sobrescrevendo a mais antiga se cheio
+ * 
+ * @param ringPtr   controle do buffer circular
+ * @param capacity  capacidade do buffer
+ * @return uint16_t posição a ser escrita
+ */
+static uint16_t ring_push(ringControl_t * ringPtr, uint16_t capacity)
+{
+  uint16_t position = ringPtr->head;
+  ringPtr->head = (ringPtr->head + 1) % capacity;
+  if (ringPtr->count < capacity)
+  {
+    ringPtr->count++;
+  }
+  return position;
+}
+
+/**
+ * Converte índice lógico (0 = mais antigo) em posição física do buffer
+ * 
+ * @param ringPtr   controle do buffer circular
+ * @param capacity  capacidade do buffer
+ * @param index     índice lógico
+ * @return uint16_t posição física
+ */
+static uint16_t ring_index(const ringControl_t * ringPtr, uint16_t capacity, uint32_t index)
+{
+  return (ringPtr->head + capacity - ringPtr->count + index) % capacity;
+}
+
+/**
+ * Soma amostra no agregado em construção
+ * 
+ * @param accumulatorPtr  agregado em construção
+ * @param nodePtr         leitura atual do node
+ * @param bucket          início do intervalo da amostra
+ */
+static void accumulator_add(rollupAccumulator_t * accumulatorPtr, const node_t * nodePtr, uint32_t bucket)
+{
+  if (accumulatorPtr->count == 0)
+  {
+    accumulatorPtr->bucket = bucket;
+    accumulatorPtr->snrMin = accumulatorPtr->snrMax = nodePtr->snr;
+    accumulatorPtr->atenuationMin = accumulatorPtr->atenuationMax = nodePtr->atenuation;
+  }
+
+  accumulatorPtr->count++;
+  accumulatorPtr->snrSum += nodePtr->snr;
+  accumulatorPtr->atenuationSum += nodePtr->atenuation;
+  accumulatorPtr->snrMin = nodePtr->snr < accumulatorPtr->snrMin ? nodePtr->snr : accumulatorPtr->snrMin;
+  accumulatorPtr->snrMax = nodePtr->snr > accumulatorPtr->snrMax ? nodePtr->snr : accumulatorPtr->snrMax;
+  accumulatorPtr->atenuationMin = nodePtr->atenuation < accumulatorPtr->atenuationMin ?
+                                  nodePtr->atenuation : accumulatorPtr->atenuationMin;
+  accumulatorPtr->atenuationMax = nodePtr->atenuation > accumulatorPtr->atenuationMax ?
+                                  nodePtr->atenuation : accumulatorPtr->atenuationMax;
+}
+
+/**
+ * Converte agregado em construção para formato exposto
+ * 
+ * @param accumulatorPtr  agregado em construção
+ * @param rollupPtr       agregado a ser escrito
+ */
+static void accumulator_to_rollup(const rollupAccumulator_t * accumulatorPtr, plcHistoryRollup_t * rollupPtr)
+{
+  rollupPtr->timestamp = accumulatorPtr->bucket;
+  rollupPtr->count = accumulatorPtr->count;
+  rollupPtr->snrMin = accumulatorPtr->snrMin;
+  rollupPtr->snrMax = accumulatorPtr->snrMax;
+  rollupPtr->snrMean = accumulatorPtr->snrSum / accumulatorPtr->count;
+  rollupPtr->atenuationMin = accumulatorPtr->atenuationMin;
+  rollupPtr->atenuationMax = accumulatorPtr->atenuationMax;
+  rollupPtr->atenuationMean = accumulatorPtr->atenuationSum / accumulatorPtr->count;
+}
+
+/**
+ * Insere amostra em uma resolução, fechando o intervalo anterior quando mudou
+ * 
+ * @param accumulatorPtr  agregado em construção
+ * @param ringBufferPtr   buffer de agregados fechados
+ * @param ringPtr         controle do buffer circular
+ * @param capacity        capacidade do buffer
+ * @param nodePtr         leitura atual do node
+ * @param bucket          início do intervalo da amostra
+ */
+static void rollup_feed(rollupAccumulator_t * accumulatorPtr, plcHistoryRollup_t * ringBufferPtr,
+                        ringControl_t * ringPtr, uint16_t capacity,
+                        const node_t * nodePtr, uint32_t bucket)
+{
+  if ((accumulatorPtr->count != 0) && (accumulatorPtr->bucket != bucket))
+  {
+    /* Intervalo encerrado, armazena agregado e inicia novo */
+    accumulator_to_rollup(accumulatorPtr, &ringBufferPtr[ring_push(ringPtr, capacity)]);
+    bzero(accumulatorPtr, sizeof(rollupAccumulator_t));
+  }
+
+  accumulator_add(accumulatorPtr, nodePtr, bucket);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,91 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_HISTORY_H
+#define PLC_HISTORY_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "plc_topology.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Memória ocupada é fixa e alocada estaticamente:
+ * PLC_TOPOLOGY_MAX_NODES * (RAW * 8 + (MINUTE + HOUR) * 16 + 56) bytes
+ * Com os valores padrão, aproximadamente 1050 bytes por node e 13,6 KB
+ * para os 13 nodes (MAX_CCO_NUM + MAX_STA_NUM) da topologia
+ */
+
+/*
+ * Amostras brutas mantidas por node, uma por atualização da topologia
+ * (periódica, PLC_TOPOLOGY_REFRESH_MS, ou consulta com o cache vencido)
+ */
+#ifndef PLC_HISTORY_RAW_SIZE
+#define PLC_HISTORY_RAW_SIZE      16
+#endif
+/* Agregados por minuto mantidos por node */
+#ifndef PLC_HISTORY_MINUTE_SIZE
+#define PLC_HISTORY_MINUTE_SIZE   30
+#endif
+/* Agregados por hora mantidos por node */
+#ifndef PLC_HISTORY_HOUR_SIZE
+#define PLC_HISTORY_HOUR_SIZE     24
+#endif
+
+/* Resoluções disponíveis no histórico */
+typedef enum plcHistoryResolution_t
+{
+  PLC_HISTORY_RAW = 0,
+  PLC_HISTORY_MINUTE,
+  PLC_HISTORY_HOUR,
+} plcHistoryResolution_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Amostra bruta da qualidade do enlace de um node */
+typedef struct plcHistorySample_t
+{
+  /* Segundos desde a inicialização */
+  uint32_t timestamp;
+  uint8_t snr;
+  uint8_t atenuation;
+  uint8_t phase;
+} plcHistorySample_t;
+
+/* Agregado de amostras em um intervalo (minuto ou hora) */
+typedef struct plcHistoryRollup_t
+{
+  /* Início do intervalo, segundos desde a inicialização */
+  uint32_t timestamp;
+  /* Quantidade de amostras agregadas */
+  uint32_t count;
+  uint8_t snrMin;
+  uint8_t snrMax;
+  uint8_t snrMean;
+  uint8_t atenuationMin;
+  uint8_t atenuationMax;
+  uint8_t atenuationMean;
+} plcHistoryRollup_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_history_init(void);
+void plc_history_reset(uint32_t slot);
+void plc_history_update(uint32_t slot, const node_t * nodePtr, uint32_t timestamp);
+bool plc_history_get_sample(uint32_t slot, uint32_t index, plcHistorySample_t * samplePtr);
+bool plc_history_get_rollup(uint32_t slot, plcHistoryResolution_t resolution,
+                            uint32_t index, plcHistoryRollup_t * rollupPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,418 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_io_queue.h"
+#include <string.h>
+#include "plc_uart_model.h"
+#include "plc_health.h"
+#include "plc_events.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Verificação de prazos e do estado dos módulos com escritas pendentes */
+#define CHECK_PERIOD_MS     500
+/* Espera após falha antes de tentar novamente a mesma escrita */
+#define RETRY_DELAY_MS      1000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Escrita pendente de uma estação */
+typedef struct queueEntry_t
+{
+  bool used;
+  uint32_t jobId;
+  uint32_t port;
+  char mac[PLC_IO_QUEUE_MAC_SIZE];
+  uint32_t value;
+  uint32_t attempts;
+  int64_t deadlineUs;
+  int64_t nextAttemptUs;
+} queueEntry_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "PLC_IO_QUEUE";
+
+static const char * const stateNames[] = {
+  [PLC_IO_JOB_QUEUED] = "queued",
+  [PLC_IO_JOB_DONE] = "done",
+  [PLC_IO_JOB_FAILED] = "failed",
+  [PLC_IO_JOB_EXPIRED] = "expired",
+  [PLC_IO_JOB_SUPERSEDED] = "superseded",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static queueEntry_t entries[PLC_IO_QUEUE_SIZE];
+/* Histórico circular, job na posição id % PLC_IO_QUEUE_JOB_HISTORY */
+static plcIoJob_t jobs[PLC_IO_QUEUE_JOB_HISTORY];
+static plcIoQueueStats_t stats;
+static uint32_t nextJobId = 1;
+static SemaphoreHandle_t queueMutex;
+static TaskHandle_t drainTask;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void drain_task(void * param);
+static bool drain_select(int64_t now, queueEntry_t * entryOutPtr);
+static void drain_finish(const queueEntry_t * attemptPtr, bool result);
+static void entry_remove(queueEntry_t * entryPtr, plcIoJobState_t state, int64_t now);
+static plcIoJob_t * job_find(uint32_t id);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa fila e task de drenagem
+ * 
+ */
+void plc_io_queue_init(void)
+{
+  bzero(entries, sizeof(entries));
+  bzero(jobs, sizeof(jobs));
+  bzero(&stats, sizeof(stats));
+
+  queueMutex = xSemaphoreCreateMutex();
+  xTaskCreate(drain_task, "plc_io_queue_task", 3072, NULL, 4, &drainTask);
+}
+
+/**
+ * Verifica se existe escrita pendente para a estação. Uma nova escrita
+ * direta não deve passar à frente de uma pendente para o mesmo MAC
+ * 
+ * @param macPtr  MAC somente números
+ * @return true   escrita pendente na fila
+ * @return false  nenhuma escrita pendente
+ */
+bool plc_io_queue_pending(const char * macPtr)
+{
+  bool pending = false;
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  for (uint32_t idx = 0; (idx < PLC_IO_QUEUE_SIZE) && (pending == false); idx++)
+  {
+    pending = entries[idx].used && (strcmp(entries[idx].mac, macPtr) == 0);
+  }
+  xSemaphoreGive(queueMutex);
+  return pending;
+}
+
+/**
+ * Insere escrita na fila, substituindo o valor pendente da mesma estação
+ * 
+ * @param port      porta (rede) da estação
+ * @param macPtr    MAC somente números
+ * @param value     valor a ser definido na saída do módulo PLC
+ * @param ttlMs     prazo da escrita, 0 = PLC_IO_QUEUE_TTL_MS
+ * @return uint32_t id do job, 0 = fila cheia
+ */
+uint32_t plc_io_queue_submit(uint32_t port, const char * macPtr, uint32_t value, uint32_t ttlMs)
+{
+  if (strlen(macPtr) >= PLC_IO_QUEUE_MAC_SIZE)
+  {
+    return 0;
+  }
+
+  const int64_t now = esp_timer_get_time();
+  ttlMs = (ttlMs == 0) ? PLC_IO_QUEUE_TTL_MS : ttlMs;
+
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  queueEntry_t * entryPtr = NULL;
+  queueEntry_t * freePtr = NULL;
+  for (uint32_t idx = 0; (idx < PLC_IO_QUEUE_SIZE) && (entryPtr == NULL); idx++)
+  {
+    if (entries[idx].used == false)
+    {
+      freePtr = (freePtr == NULL) ? &entries[idx] : freePtr;
+    }
+    else if (strcmp(entries[idx].mac, macPtr) == 0)
+    {
+      entryPtr = &entries[idx];
+    }
+  }
+
+  if (entryPtr != NULL)
+  {
+    /* Somente o último valor da estação é escrito */
+    entry_remove(entryPtr, PLC_IO_JOB_SUPERSEDED, now);
+  }
+  else
+  {
+    entryPtr = freePtr;
+  }
+
+  if (entryPtr == NULL)
+  {
+    stats.rejected++;
+    xSemaphoreGive(queueMutex);
+    return 0;
+  }
+
+  const uint32_t id = nextJobId++;
+  nextJobId = (nextJobId == 0) ? 1 : nextJobId;
+
+  bzero(entryPtr, sizeof(queueEntry_t));
+  entryPtr->used = true;
+  entryPtr->jobId = id;
+  entryPtr->port = port;
+  strcpy(entryPtr->mac, macPtr);
+  entryPtr->value = value;
+  entryPtr->deadlineUs = now + ((int64_t)ttlMs * 1000);
+  entryPtr->nextAttemptUs = now;
+
+  plcIoJob_t * jobPtr = &jobs[id % PLC_IO_QUEUE_JOB_HISTORY];
+  bzero(jobPtr, sizeof(plcIoJob_t));
+  jobPtr->id = id;
+  jobPtr->state = PLC_IO_JOB_QUEUED;
+  jobPtr->port = port;
+  strcpy(jobPtr->mac, macPtr);
+  jobPtr->value = value;
+  jobPtr->createdUs = now;
+
+  stats.depth++;
+  stats.enqueued++;
+  xSemaphoreGive(queueMutex);
+
+  xTaskNotifyGive(drainTask);
+  return id;
+}
+
+/**
+ * Recupera estado de um job
+ * 
+ * @param id      id do job
+ * @param jobPtr  cópia do job
+ * @return true   job encontrado
+ * @return false  id desconhecido ou já removido do histórico
+ */
+bool plc_io_queue_get_job(uint32_t id, plcIoJob_t * jobPtr)
+{
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  const plcIoJob_t * foundPtr = job_find(id);
+  if (foundPtr != NULL)
+  {
+    memcpy(jobPtr, foundPtr, sizeof(plcIoJob_t));
+  }
+  xSemaphoreGive(queueMutex);
+  return foundPtr != NULL;
+}
+
+/**
+ * Nome do estado de um job
+ * 
+ * @param state         estado do job
+ * @return const char*  nome do estado
+ */
+const char * plc_io_queue_state_name(plcIoJobState_t state)
+{
+  return (state <= PLC_IO_JOB_SUPERSEDED) ? stateNames[state] : "unknown";
+}
+
+/**
+ * Copia contadores da fila
+ * 
+ * @param statsPtr  contadores da fila
+ */
+void plc_io_queue_get_stats(plcIoQueueStats_t * statsPtr)
+{
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  memcpy(statsPtr, &stats, sizeof(plcIoQueueStats_t));
+  xSemaphoreGive(queueMutex);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task de drenagem, uma escrita por PLC_IO_QUEUE_DRAIN_INTERVAL_MS para
+ * não disputar a UART com as requisições diretas
+ * 
+ * @param param   não utilizado
+ */
+static void drain_task(void * param)
+{
+  for (;;)
+  {
+    queueEntry_t attempt;
+    if (drain_select(esp_timer_get_time(), &attempt) == false)
+    {
+      /* Nada a escrever, aguarda nova escrita ou a próxima verificação */
+      const bool idle = (stats.depth == 0);
+      ulTaskNotifyTake(pdTRUE, idle ? portMAX_DELAY : (CHECK_PERIOD_MS / portTICK_PERIOD_MS));
+      continue;
+    }
+
+    /* Escrita não enviada após o prazo do job */
+    const bool result = plc_uart_model_io(attempt.port, attempt.mac, attempt.value, attempt.deadlineUs, NULL);
+    drain_finish(&attempt, result);
+    if (result)
+    {
+      plc_events_io_ack(attempt.mac, attempt.value, attempt.jobId);
+    }
+
+    vTaskDelay(PLC_IO_QUEUE_DRAIN_INTERVAL_MS / portTICK_PERIOD_MS);
+  }
+}
+
+/**
+ * Remove escritas expiradas e seleciona a mais antiga pronta para envio
+ * 
+ * @param now           tempo atual
+ * @param entryOutPtr   cópia da escrita selecionada
+ * @return true         escrita selecionada
+ * @return false        nenhuma escrita pronta
+ */
+static bool drain_select(int64_t now, queueEntry_t * entryOutPtr)
+{
+  queueEntry_t * selectedPtr = NULL;
+
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  for (uint32_t idx = 0; idx < PLC_IO_QUEUE_SIZE; idx++)
+  {
+    queueEntry_t * entryPtr = &entries[idx];
+    if (entryPtr->used == false)
+    {
+      continue;
+    }
+
+    if (now >= entryPtr->deadlineUs)
+    {
+      entry_remove(entryPtr, PLC_IO_JOB_EXPIRED, now);
+      continue;
+    }
+
+    /* Ids crescentes, menor id = escrita mais antiga */
+    if ((now >= entryPtr->nextAttemptUs) && plc_health_is_up(entryPtr->port) &&
+        ((selectedPtr == NULL) || (entryPtr->jobId < selectedPtr->jobId)))
+    {
+      selectedPtr = entryPtr;
+    }
+  }
+
+  if (selectedPtr != NULL)
+  {
+    memcpy(entryOutPtr, selectedPtr, sizeof(queueEntry_t));
+  }
+  xSemaphoreGive(queueMutex);
+
+  return selectedPtr != NULL;
+}
+
+/**
+ * Registra resultado de uma escrita drenada
+ * 
+ * @param attemptPtr  cópia da escrita enviada
+ * @param result      resultado da escrita
+ */
+static void drain_finish(const queueEntry_t * attemptPtr, bool result)
+{
+  const int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(queueMutex, portMAX_DELAY);
+  queueEntry_t * entryPtr = NULL;
+  for (uint32_t idx = 0; (idx < PLC_IO_QUEUE_SIZE) && (entryPtr == NULL); idx++)
+  {
+    if (entries[idx].used && (entries[idx].jobId == attemptPtr->jobId))
+    {
+      entryPtr = &entries[idx];
+    }
+  }
+
+  /* Substituída durante o envio, o novo valor segue na fila */
+  if (entryPtr != NULL)
+  {
+    entryPtr->attempts++;
+    plcIoJob_t * jobPtr = job_find(entryPtr->jobId);
+    if (jobPtr != NULL)
+    {
+      jobPtr->attempts = entryPtr->attempts;
+    }
+
+    if (result)
+    {
+      entry_remove(entryPtr, PLC_IO_JOB_DONE, now);
+    }
+    else if (entryPtr->attempts >= PLC_IO_QUEUE_MAX_ATTEMPTS)
+    {
+      ESP_LOGW(TAG, "Write to %s failed after %u attempts", entryPtr->mac, entryPtr->attempts);
+      entry_remove(entryPtr, PLC_IO_JOB_FAILED, now);
+    }
+    else
+    {
+      entryPtr->nextAttemptUs = now + ((int64_t)RETRY_DELAY_MS * 1000);
+    }
+  }
+  xSemaphoreGive(queueMutex);
+}
+
+/**
+ * Remove escrita da fila e finaliza seu job, chamada com queueMutex
+ * 
+ * @param entryPtr  escrita a ser removida
+ * @param state     estado final do job
+ * @param now       tempo atual
+ */
+static void entry_remove(queueEntry_t * entryPtr, plcIoJobState_t state, int64_t now)
+{
+  plcIoJob_t * jobPtr = job_find(entryPtr->jobId);
+  if (jobPtr != NULL)
+  {
+    jobPtr->state = state;
+    jobPtr->finishedUs = now;
+  }
+
+  switch (state)
+  {
+    case PLC_IO_JOB_DONE:
+      stats.done++;
+      break;
+    case PLC_IO_JOB_FAILED:
+      stats.failed++;
+      break;
+    case PLC_IO_JOB_EXPIRED:
+      stats.expired++;
+      break;
+    case PLC_IO_JOB_SUPERSEDED:
+      stats.superseded++;
+      break;
+    default:
+      break;
+  }
+
+  entryPtr->used = false;
+  stats.depth--;
+}
+
+/**
+ * Localiza job no histórico, chamada com queueMutex
+ * 
+ * @param id            id do job
+ * @return plcIoJob_t*  job encontrado, NULL = sobrescrito ou inexistente
+ */
+static plcIoJob_t * job_find(uint32_t id)
+{
+  plcIoJob_t * jobPtr = &jobs[id % PLC_IO_QUEUE_JOB_HISTORY];
+  return ((id != 0) && (jobPtr->id == id)) ? jobPtr : NULL;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
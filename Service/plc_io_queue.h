@@ -0,0 +1,90 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_IO_QUEUE_H
+#define PLC_IO_QUEUE_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "plc_topology.h"
+#include "plc_uart.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Fila de escritas IO adiadas, uma posição por estação: uma nova escrita
+ * para o mesmo MAC substitui o valor pendente (somente o último valor
+ * importa). Cada escrita recebe um job, consultado pelo cliente, e expira
+ * no prazo informado. A fila é drenada em ritmo controlado somente com o
+ * módulo da porta pronto (plc_health)
+ */
+#define PLC_IO_QUEUE_SIZE               (MAX_STA_NUM * PLC_UART_PORT_COUNT)
+/* Prazo padrão e máximo de uma escrita na fila */
+#define PLC_IO_QUEUE_TTL_MS             30000
+#define PLC_IO_QUEUE_MAX_TTL_MS         300000
+/* Intervalo mínimo entre escritas drenadas */
+#define PLC_IO_QUEUE_DRAIN_INTERVAL_MS  100
+/* Tentativas com módulo pronto até o job falhar, ex. MAC desconhecido */
+#define PLC_IO_QUEUE_MAX_ATTEMPTS       3
+/* Jobs mantidos para consulta, inclusive os finalizados */
+#define PLC_IO_QUEUE_JOB_HISTORY        32
+/* MAC somente números, 12 caracteres */
+#define PLC_IO_QUEUE_MAC_SIZE           13
+
+typedef enum plcIoJobState_t
+{
+  PLC_IO_JOB_QUEUED = 0,
+  PLC_IO_JOB_DONE,
+  PLC_IO_JOB_FAILED,
+  PLC_IO_JOB_EXPIRED,
+  PLC_IO_JOB_SUPERSEDED,
+} plcIoJobState_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Job de uma escrita IO adiada */
+typedef struct plcIoJob_t
+{
+  uint32_t id;
+  plcIoJobState_t state;
+  uint32_t port;
+  char mac[PLC_IO_QUEUE_MAC_SIZE];
+  uint32_t value;
+  uint32_t attempts;
+  int64_t createdUs;
+  int64_t finishedUs;
+} plcIoJob_t;
+
+/* Contadores da fila */
+typedef struct plcIoQueueStats_t
+{
+  uint32_t depth;
+  uint32_t enqueued;
+  uint32_t rejected;
+  uint32_t done;
+  uint32_t failed;
+  uint32_t expired;
+  uint32_t superseded;
+} plcIoQueueStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_io_queue_init(void);
+bool plc_io_queue_pending(const char * macPtr);
+uint32_t plc_io_queue_submit(uint32_t port, const char * macPtr, uint32_t value, uint32_t ttlMs);
+bool plc_io_queue_get_job(uint32_t id, plcIoJob_t * jobPtr);
+const char * plc_io_queue_state_name(plcIoJobState_t state);
+void plc_io_queue_get_stats(plcIoQueueStats_t * statsPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,397 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_jobs.h"
+#include <string.h>
+#include "plc_uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/message_buffer.h"
+#include "esp_timer.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Entrada reservada ao job em stream, após a tabela */
+#define STREAM_SLOT     PLC_JOBS_TABLE_SIZE
+/* Entradas da tabela e do stream */
+#define SLOT_COUNT      (PLC_JOBS_TABLE_SIZE + 1)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const stateNames[] = {
+  [PLC_JOB_FREE] = "free",
+  [PLC_JOB_QUEUED] = "queued",
+  [PLC_JOB_RUNNING] = "running",
+  [PLC_JOB_DONE] = "done",
+  [PLC_JOB_FAILED] = "failed",
+  [PLC_JOB_EXPIRED] = "expired",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static plcJob_t jobs[SLOT_COUNT];
+static uint32_t nextJobId = 1;
+static SemaphoreHandle_t jobsMutex;
+/* Notificação de conclusão, registrada antes da criação dos jobs */
+static plcJobsListener_t completedListener;
+/* Entradas aguardando execução, em ordem de criação */
+static QueueHandle_t jobQueue;
+/* Linhas do job em stream, escrito pela task UART e lido pelo servidor HTTP */
+static MessageBufferHandle_t lineStream;
+/* Job dono do stream, 0 = nenhum */
+static uint32_t streamJobId;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void jobs_task(void * param);
+static uint32_t job_submit(uint32_t network, const char * commandPtr, int64_t deadlineUs, bool stream);
+static void job_line_sink(const char * linePtr, void * contextPtr);
+static plcJob_t * job_find(uint32_t id);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa tabela e task de execução dos jobs
+ * 
+ */
+void plc_jobs_init(void)
+{
+  bzero(jobs, sizeof(jobs));
+  jobsMutex = xSemaphoreCreateMutex();
+  jobQueue = xQueueCreate(SLOT_COUNT, sizeof(uint32_t));
+  lineStream = xMessageBufferCreate(PLC_JOBS_STREAM_SIZE);
+
+  xTaskCreate(jobs_task, "plc_jobs_task", 4096, NULL, 4, NULL);
+}
+
+/**
+ * Registra notificação de conclusão dos jobs, substitui a anterior
+ * 
+ * @param listener  função de notificação, NULL = nenhuma
+ */
+void plc_jobs_set_listener(plcJobsListener_t listener)
+{
+  completedListener = listener;
+}
+
+/**
+ * Cria job para um comando AT. Entradas concluídas há mais de
+ * PLC_JOBS_TTL_MS são reaproveitadas
+ * 
+ * @param network     rede (porta UART) de destino
+ * @param commandPtr  comando a ser enviado
+ * @return uint32_t   id do job, 0 = tabela cheia ou comando muito longo
+ */
+uint32_t plc_jobs_submit(uint32_t network, const char * commandPtr)
+{
+  return job_submit(network, commandPtr, 0, false);
+}
+
+/**
+ * Cria job com as linhas da resposta entregues pelo stream, lidas com
+ * plc_jobs_stream_read. O leitor deve fechar o stream com
+ * plc_jobs_stream_close
+ * 
+ * @param network     rede (porta UART) de destino
+ * @param commandPtr  comando a ser enviado
+ * @param deadlineUs  prazo absoluto do comando, 0 = PLC_JOBS_DEADLINE_MS
+ * @return uint32_t   id do job, 0 = job em stream anterior ainda em
+ *                    execução ou comando muito longo
+ */
+uint32_t plc_jobs_submit_stream(uint32_t network, const char * commandPtr, int64_t deadlineUs)
+{
+  return job_submit(network, commandPtr, deadlineUs, true);
+}
+
+/**
+ * Lê próxima linha do stream de um job, aguardando até waitMs
+ * 
+ * @param id          id do job dono do stream
+ * @param bufferPtr   buffer da linha, terminada em '\0'
+ * @param bufferSize  tamanho do buffer, mínimo PLC_JOBS_LINE_SIZE
+ * @param waitMs      espera máxima por uma linha
+ * @return int32_t    tamanho da linha, 0 = nenhuma linha no tempo,
+ *                    -1 = job concluído e stream vazio, ou job sem stream
+ */
+int32_t plc_jobs_stream_read(uint32_t id, char * bufferPtr, size_t bufferSize, uint32_t waitMs)
+{
+  if ((id == 0) || (id != streamJobId) || (bufferSize < PLC_JOBS_LINE_SIZE))
+  {
+    return -1;
+  }
+
+  const size_t length = xMessageBufferReceive(lineStream, bufferPtr, bufferSize - 1, waitMs / portTICK_PERIOD_MS);
+  if (length != 0)
+  {
+    bufferPtr[length] = '\0';
+    return length;
+  }
+
+  /* Linhas escritas pela task UART antes da conclusão do job */
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  const plcJob_t * jobPtr = job_find(id);
+  const bool finished = (jobPtr == NULL) || plc_jobs_finished(jobPtr);
+  xSemaphoreGive(jobsMutex);
+
+  return (finished && xMessageBufferIsEmpty(lineStream)) ? -1 : 0;
+}
+
+/**
+ * Desliga o stream do job, linhas seguintes somente na saída do job
+ * 
+ * @param id  id do job dono do stream
+ */
+void plc_jobs_stream_close(uint32_t id)
+{
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  if (streamJobId == id)
+  {
+    streamJobId = 0;
+  }
+  xSemaphoreGive(jobsMutex);
+}
+
+/**
+ * Recupera cópia de um job, sem aguardar sua conclusão
+ * 
+ * @param id      id do job
+ * @param jobPtr  cópia do job
+ * @return true   job encontrado
+ * @return false  id desconhecido ou entrada já reaproveitada
+ */
+bool plc_jobs_get(uint32_t id, plcJob_t * jobPtr)
+{
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  const plcJob_t * foundPtr = job_find(id);
+  if (foundPtr != NULL)
+  {
+    memcpy(jobPtr, foundPtr, sizeof(plcJob_t));
+  }
+  xSemaphoreGive(jobsMutex);
+
+  return foundPtr != NULL;
+}
+
+/**
+ * Verifica se o job foi concluído, com qualquer resultado
+ * 
+ * @param jobPtr  job a ser verificado
+ * @return true   job concluído
+ * @return false  job livre, na fila ou em execução
+ */
+bool plc_jobs_finished(const plcJob_t * jobPtr)
+{
+  return (jobPtr->state == PLC_JOB_DONE) || (jobPtr->state == PLC_JOB_FAILED) ||
+         (jobPtr->state == PLC_JOB_EXPIRED);
+}
+
+/**
+ * Nome do estado de um job
+ * 
+ * @param state         estado do job
+ * @return const char*  nome do estado
+ */
+const char * plc_jobs_state_name(plcJobState_t state)
+{
+  return (state <= PLC_JOB_EXPIRED) ? stateNames[state] : "unknown";
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task de execução, um job por vez na ordem de criação, exceto o job em
+ * stream, à frente dos aguardando
+ * 
+ * @param param   não utilizado
+ */
+static void jobs_task(void * param)
+{
+  for (;;)
+  {
+    uint32_t slot;
+    if (xQueueReceive(jobQueue, &slot, portMAX_DELAY) != pdPASS)
+    {
+      continue;
+    }
+
+    plcJob_t * jobPtr = &jobs[slot];
+    char command[PLC_JOBS_COMMAND_SIZE];
+    uartPlcResponse_t response;
+    bzero(&response, sizeof(uartPlcResponse_t));
+
+    xSemaphoreTake(jobsMutex, portMAX_DELAY);
+    const uint32_t network = jobPtr->network;
+    strcpy(command, jobPtr->command);
+    jobPtr->state = PLC_JOB_RUNNING;
+    jobPtr->startedUs = esp_timer_get_time();
+    response.deadlineUs = jobPtr->deadlineUs;
+    xSemaphoreGive(jobsMutex);
+
+    /* Linhas escritas no job pela task UART durante a resposta */
+    response.lineSink = job_line_sink;
+    response.lineContextPtr = jobPtr;
+    plc_uart_send(network, command, &response);
+
+    xSemaphoreTake(jobsMutex, portMAX_DELAY);
+    jobPtr->finishedUs = esp_timer_get_time();
+    jobPtr->state = response.expired ? PLC_JOB_EXPIRED : (response.result ? PLC_JOB_DONE : PLC_JOB_FAILED);
+    const uint32_t id = jobPtr->id;
+    xSemaphoreGive(jobsMutex);
+
+    if (completedListener != NULL)
+    {
+      completedListener(id);
+    }
+  }
+}
+
+/**
+ * Cria job na primeira entrada livre ou com resultado vencido. Job em
+ * stream usa a entrada reservada, livre assim que o anterior termina
+ * 
+ * @param network     rede (porta UART) de destino
+ * @param commandPtr  comando a ser enviado
+ * @param deadlineUs  prazo absoluto do comando, 0 = PLC_JOBS_DEADLINE_MS
+ * @param stream      entrega as linhas pelo stream
+ * @return uint32_t   id do job, 0 = sem entrada livre ou comando muito longo
+ */
+static uint32_t job_submit(uint32_t network, const char * commandPtr, int64_t deadlineUs, bool stream)
+{
+  if (strlen(commandPtr) >= PLC_JOBS_COMMAND_SIZE)
+  {
+    return 0;
+  }
+
+  const int64_t now = esp_timer_get_time();
+  uint32_t id = 0;
+
+  const uint32_t firstSlot = stream ? STREAM_SLOT : 0;
+  const uint32_t lastSlot = stream ? STREAM_SLOT : (PLC_JOBS_TABLE_SIZE - 1);
+
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  for (uint32_t slot = firstSlot; (slot <= lastSlot) && (id == 0); slot++)
+  {
+    plcJob_t * jobPtr = &jobs[slot];
+    const bool reclaim = plc_jobs_finished(jobPtr) &&
+                         (stream || ((now - jobPtr->finishedUs) >= ((int64_t)PLC_JOBS_TTL_MS * 1000)));
+    if ((jobPtr->state != PLC_JOB_FREE) && (reclaim == false))
+    {
+      continue;
+    }
+
+    id = nextJobId++;
+    nextJobId = (nextJobId == 0) ? 1 : nextJobId;
+
+    bzero(jobPtr, sizeof(plcJob_t));
+    jobPtr->id = id;
+    jobPtr->state = PLC_JOB_QUEUED;
+    jobPtr->network = network;
+    strcpy(jobPtr->command, commandPtr);
+    jobPtr->createdUs = now;
+    jobPtr->deadlineUs = (deadlineUs != 0) ? deadlineUs : (now + ((int64_t)PLC_JOBS_DEADLINE_MS * 1000));
+    if (stream)
+    {
+      /* Linhas de um stream anterior não pertencem ao novo job */
+      xMessageBufferReset(lineStream);
+      streamJobId = id;
+    }
+    /*
+     * Job em stream tem o servidor HTTP aguardando suas linhas, executado
+     * antes dos assíncronos na fila (somente o em execução é aguardado)
+     */
+    if (stream)
+    {
+      xQueueSendToFront(jobQueue, &slot, 0);
+    }
+    else
+    {
+      xQueueSend(jobQueue, &slot, 0);
+    }
+  }
+  xSemaphoreGive(jobsMutex);
+
+  return id;
+}
+
+/**
+ * Acrescenta linha de dados na saída do job, chamada pela task UART
+ * 
+ * @param linePtr     linha recebida, sem terminador
+ * @param contextPtr  job em execução
+ */
+static void job_line_sink(const char * linePtr, void * contextPtr)
+{
+  plcJob_t * jobPtr = contextPtr;
+  const size_t length = strlen(linePtr);
+
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  if (jobPtr->lineCount++ == 0)
+  {
+    jobPtr->firstLineUs = esp_timer_get_time();
+  }
+
+  /* Linha e separador, mantendo terminador */
+  if ((jobPtr->outputLength + length + 1) < PLC_JOBS_OUTPUT_SIZE)
+  {
+    memcpy(&jobPtr->output[jobPtr->outputLength], linePtr, length);
+    jobPtr->outputLength += length;
+    jobPtr->output[jobPtr->outputLength++] = '\n';
+    jobPtr->output[jobPtr->outputLength] = '\0';
+  }
+  else
+  {
+    jobPtr->truncated = true;
+  }
+
+  /* Entrega ao leitor do stream sem bloquear a task UART */
+  const size_t streamLength = (length < PLC_JOBS_LINE_SIZE) ? length : (PLC_JOBS_LINE_SIZE - 1);
+  if ((jobPtr->id == streamJobId) && (xMessageBufferSend(lineStream, linePtr, streamLength, 0) == 0))
+  {
+    jobPtr->streamDropped++;
+  }
+  xSemaphoreGive(jobsMutex);
+}
+
+/**
+ * Localiza job na tabela, chamada com jobsMutex
+ * 
+ * @param id          id do job
+ * @return plcJob_t*  job encontrado, NULL = inexistente ou reaproveitado
+ */
+static plcJob_t * job_find(uint32_t id)
+{
+  for (uint32_t slot = 0; (slot < SLOT_COUNT) && (id != 0); slot++)
+  {
+    if ((jobs[slot].state != PLC_JOB_FREE) && (jobs[slot].id == id))
+    {
+      return &jobs[slot];
+    }
+  }
+
+  return NULL;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,106 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_JOBS_H
+#define PLC_JOBS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Comandos AT assíncronos: o job é criado e executado por uma task, o
+ * resultado (todas as linhas e tempos) fica disponível até PLC_JOBS_TTL_MS
+ * após a conclusão. Tabela de tamanho fixo, sem alocação por job
+ */
+#define PLC_JOBS_TABLE_SIZE     8
+/* Maior comando aceito, com terminador, mesmo limite de POST /plc/command */
+#define PLC_JOBS_COMMAND_SIZE   256
+/* Saída guardada por job, linhas separadas por "\n". Excedente descartado */
+#define PLC_JOBS_OUTPUT_SIZE    1024
+/* Validade do resultado após a conclusão, entrada reaproveitada depois */
+#define PLC_JOBS_TTL_MS         60000
+/* Prazo da fila até o fim da execução */
+#define PLC_JOBS_DEADLINE_MS    30000
+/*
+ * Maior espera de uma consulta pela conclusão (long-poll). A espera não
+ * ocupa a task do servidor HTTP, a resposta é enviada na notificação de
+ * conclusão (plc_jobs_set_listener) ou no fim do prazo
+ */
+#define PLC_JOBS_MAX_WAIT_MS    10000
+/*
+ * Stream de linhas: um job por vez entrega cada linha da resposta ao
+ * leitor assim que recebida, sem limite de tamanho total. Linhas que não
+ * cabem no stream (leitor lento) são descartadas e contadas, a task UART
+ * não aguarda o leitor. O job em stream usa uma entrada reservada, fora da
+ * tabela e de PLC_JOBS_TTL_MS, reaproveitada assim que concluído
+ */
+#define PLC_JOBS_STREAM_SIZE    2048
+/* Maior linha entregue pelo stream, com terminador. Excedente truncado */
+#define PLC_JOBS_LINE_SIZE      256
+
+typedef enum plcJobState_t
+{
+  PLC_JOB_FREE = 0,
+  PLC_JOB_QUEUED,
+  PLC_JOB_RUNNING,
+  /* Resultado OK do módulo */
+  PLC_JOB_DONE,
+  /* Resultado ERROR / FAIL ou módulo sem resposta */
+  PLC_JOB_FAILED,
+  /* Prazo esgotado antes do envio ou dos reenvios */
+  PLC_JOB_EXPIRED,
+} plcJobState_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct plcJob_t
+{
+  uint32_t id;
+  plcJobState_t state;
+  uint32_t network;
+  char command[PLC_JOBS_COMMAND_SIZE];
+  /* Linhas de dados da resposta */
+  uint32_t lineCount;
+  uint32_t outputLength;
+  bool truncated;
+  /* Linhas não entregues ao leitor do stream */
+  uint32_t streamDropped;
+  char output[PLC_JOBS_OUTPUT_SIZE];
+  /* Prazo absoluto do comando (esp_timer_get_time) */
+  int64_t deadlineUs;
+  int64_t createdUs;
+  int64_t startedUs;
+  int64_t firstLineUs;
+  int64_t finishedUs;
+} plcJob_t;
+
+/* Notificação de conclusão de um job, executada na task dos jobs, não deve bloquear */
+typedef void (*plcJobsListener_t)(uint32_t id);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_jobs_init(void);
+void plc_jobs_set_listener(plcJobsListener_t listener);
+uint32_t plc_jobs_submit(uint32_t network, const char * commandPtr);
+uint32_t plc_jobs_submit_stream(uint32_t network, const char * commandPtr, int64_t deadlineUs);
+int32_t plc_jobs_stream_read(uint32_t id, char * bufferPtr, size_t bufferSize, uint32_t waitMs);
+void plc_jobs_stream_close(uint32_t id);
+bool plc_jobs_get(uint32_t id, plcJob_t * jobPtr);
+bool plc_jobs_finished(const plcJob_t * jobPtr);
+const char * plc_jobs_state_name(plcJobState_t state);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
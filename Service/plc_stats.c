@@ -0,0 +1,449 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_stats.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Casas fracionárias da média móvel do SNR */
+#define EWMA_FRACTION_BITS  4
+/* Índice de posição inexistente no heap ou na lista de quedas */
+#define NO_INDEX            -1
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Contribuição de um node nos agregados */
+typedef struct nodeStats_t
+{
+  bool present;
+  uint8_t mac[6];
+  uint8_t snr;
+  uint8_t atenuation;
+  uint8_t phase;
+  /* Média móvel exponencial do SNR, ponto fixo */
+  uint16_t snrAverage;
+  /* Posição no heap de pior atenuação */
+  int16_t heapIndex;
+  /* Posição na lista de quedas de SNR */
+  int16_t dropIndex;
+} nodeStats_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Contribuição indexada pelo slot do node na tabela da topologia */
+static nodeStats_t nodes[PLC_TOPOLOGY_MAX_NODES];
+static uint32_t nodeCount;
+static uint32_t snrHistogram[PLC_STATS_SNR_BUCKETS];
+static uint32_t phaseCount[PLC_STATS_PHASES];
+/* Heap mínimo (por atenuação) dos K nodes de maior atenuação */
+static uint16_t heap[PLC_STATS_TOP_K];
+static uint32_t heapSize;
+/* Nodes sinalizados com queda de SNR */
+static uint16_t drops[PLC_STATS_MAX_DROPS];
+static uint32_t dropCount;
+/* Proteção dos agregados */
+static SemaphoreHandle_t statsMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void contribution_add(const nodeStats_t * nodePtr);
+static void contribution_remove(const nodeStats_t * nodePtr);
+static uint32_t snr_bucket(uint8_t snr);
+static uint32_t phase_index(uint8_t phase);
+static void drop_set(uint32_t slot, bool flagged);
+static void heap_offer(uint32_t slot);
+static void heap_change(uint32_t slot, uint8_t previousAtenuation);
+static void heap_rebuild(void);
+static void heap_swap(uint32_t indexA, uint32_t indexB);
+static void heap_sift_up(uint32_t index);
+static void heap_sift_down(uint32_t index);
+static void stats_node_copy(uint32_t slot, uint8_t value, plcStatsNode_t * nodeOutPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa agregados da rede
+ * 
+ */
+void plc_stats_init(void)
+{
+  bzero(nodes, sizeof(nodes));
+  nodeCount = 0;
+  heapSize = 0;
+  dropCount = 0;
+  bzero(snrHistogram, sizeof(snrHistogram));
+  bzero(phaseCount, sizeof(phaseCount));
+  statsMutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * Atualiza agregados com leitura de um node presente na topologia
+ * 
+ * Somente a contribuição do node é substituída, sem percorrer a tabela,
+ * exceto quando uma estação do top-K melhora e pode ser ultrapassada.
+ * 
+ * @param slot      slot do node na tabela da topologia
+ * @param nodePtr   leitura atual do node
+ */
+void plc_stats_update(uint32_t slot, const node_t * nodePtr)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  xSemaphoreTake(statsMutex, portMAX_DELAY);
+
+  nodeStats_t * statsPtr = &nodes[slot];
+  const bool wasPresent = statsPtr->present;
+  const uint8_t previousAtenuation = statsPtr->atenuation;
+
+  if (wasPresent)
+  {
+    contribution_remove(statsPtr);
+  }
+  else
+  {
+    /* Node novo ou retornando à rede */
+    statsPtr->present = true;
+    statsPtr->heapIndex = NO_INDEX;
+    statsPtr->dropIndex = NO_INDEX;
+    statsPtr->snrAverage = nodePtr->snr << EWMA_FRACTION_BITS;
+    nodeCount++;
+  }
+
+  memcpy(statsPtr->mac, nodePtr->mac, sizeof(statsPtr->mac));
+  statsPtr->snr = nodePtr->snr;
+  statsPtr->atenuation = nodePtr->atenuation;
+  statsPtr->phase = nodePtr->phase;
+  contribution_add(statsPtr);
+
+  /* Queda de SNR em relação à média móvel, avaliada antes de atualizar a média */
+  const int32_t snrFixed = nodePtr->snr << EWMA_FRACTION_BITS;
+  drop_set(slot, (snrFixed + (PLC_STATS_SNR_DROP << EWMA_FRACTION_BITS)) < statsPtr->snrAverage);
+  statsPtr->snrAverage += (snrFixed - (int32_t)statsPtr->snrAverage) >> PLC_STATS_EWMA_SHIFT;
+
+  wasPresent ? heap_change(slot, previousAtenuation) : heap_offer(slot);
+
+  xSemaphoreGive(statsMutex);
+}
+
+/**
+ * Remove contribuição de um node que deixou a topologia
+ * 
+ * @param slot  slot do node na tabela da topologia
+ */
+void plc_stats_remove(uint32_t slot)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  xSemaphoreTake(statsMutex, portMAX_DELAY);
+
+  nodeStats_t * statsPtr = &nodes[slot];
+  if (statsPtr->present)
+  {
+    contribution_remove(statsPtr);
+    drop_set(slot, false);
+    statsPtr->present = false;
+    nodeCount--;
+
+    if (statsPtr->heapIndex != NO_INDEX)
+    {
+      /* Vaga no top-K, próxima estação só é conhecida percorrendo a tabela */
+      heap_rebuild();
+    }
+  }
+
+  xSemaphoreGive(statsMutex);
+}
+
+/**
+ * Copia agregados atuais, custo independente da quantidade de nodes
+ * 
+ * @param statsPtr  estrutura a ser escrita
+ */
+void plc_stats_get(plcStats_t * statsPtr)
+{
+  bzero(statsPtr, sizeof(plcStats_t));
+
+  xSemaphoreTake(statsMutex, portMAX_DELAY);
+
+  statsPtr->nodeCount = nodeCount;
+  memcpy(statsPtr->snrHistogram, snrHistogram, sizeof(snrHistogram));
+  memcpy(statsPtr->phaseCount, phaseCount, sizeof(phaseCount));
+
+  /* Top-K ordenado da maior para a menor atenuação */
+  statsPtr->worstAtenuationCount = heapSize;
+  for (uint32_t idx = 0; idx < heapSize; idx++)
+  {
+    plcStatsNode_t item;
+    stats_node_copy(heap[idx], nodes[heap[idx]].atenuation, &item);
+
+    uint32_t position = idx;
+    for (; (position > 0) && (statsPtr->worstAtenuation[position - 1].value < item.value); position--)
+    {
+      statsPtr->worstAtenuation[position] = statsPtr->worstAtenuation[position - 1];
+    }
+    statsPtr->worstAtenuation[position] = item;
+  }
+
+  statsPtr->snrDropCount = dropCount;
+  for (uint32_t idx = 0; idx < dropCount; idx++)
+  {
+    stats_node_copy(drops[idx], nodes[drops[idx]].snr, &statsPtr->snrDrops[idx]);
+  }
+
+  xSemaphoreGive(statsMutex);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+/**
+ * Soma contribuição do node no histograma e contadores de fase
+ * 
+ * @param nodePtr   contribuição do node
+ */
+static void contribution_add(const nodeStats_t * nodePtr)
+{
+  snrHistogram[snr_bucket(nodePtr->snr)]++;
+  phaseCount[phase_index(nodePtr->phase)]++;
+}
+
+/**
+ * Remove contribuição do node no histograma e contadores de fase
+ * 
+ * @param nodePtr   contribuição do node
+ */
+static void contribution_remove(const nodeStats_t * nodePtr)
+{
+  snrHistogram[snr_bucket(nodePtr->snr)]--;
+  phaseCount[phase_index(nodePtr->phase)]--;
+}
+
+/**
+ * Faixa do histograma de um valor de SNR
+ * 
+ * @param snr       valor de SNR
+ * @return uint32_t faixa do histograma
+ */
+static uint32_t snr_bucket(uint8_t snr)
+{
+  const uint32_t bucket = snr / PLC_STATS_SNR_BUCKET_WIDTH;
+  return bucket < PLC_STATS_SNR_BUCKETS ? bucket : PLC_STATS_SNR_BUCKETS - 1;
+}
+
+/**
+ * Índice do contador de uma fase elétrica
+ * 
+ * @param phase     fase informada pelo módulo
+ * @return uint32_t índice do contador, 0 = fase não identificada
+ */
+static uint32_t phase_index(uint8_t phase)
+{
+  return phase < PLC_STATS_PHASES ? phase : 0;
+}
+
+/**
+ * Insere ou remove node da lista de quedas de SNR
+ * 
+ * @param slot      slot do node
+ * @param flagged   node com queda de SNR
+ */
+static void drop_set(uint32_t slot, bool flagged)
+{
+  nodeStats_t * statsPtr = &nodes[slot];
+
+  if (flagged && (statsPtr->dropIndex == NO_INDEX) && (dropCount < PLC_STATS_MAX_DROPS))
+  {
+    statsPtr->dropIndex = dropCount;
+    drops[dropCount++] = slot;
+  }
+  else if ((flagged == false) && (statsPtr->dropIndex != NO_INDEX))
+  {
+    /* Remove trocando com o último da lista */
+    const uint32_t lastSlot = drops[--dropCount];
+    drops[statsPtr->dropIndex] = lastSlot;
+    nodes[lastSlot].dropIndex = statsPtr->dropIndex;
+    statsPtr->dropIndex = NO_INDEX;
+  }
+}
+
+/**
+ * Oferece node ao top-K, substituindo o de menor atenuação se necessário
+ * 
+ * @param slot  slot do node
+ */
+static void heap_offer(uint32_t slot)
+{
+  if (heapSize < PLC_STATS_TOP_K)
+  {
+    heap[heapSize] = slot;
+    nodes[slot].heapIndex = heapSize;
+    heap_sift_up(heapSize++);
+    return;
+  }
+
+  if (nodes[slot].atenuation > nodes[heap[0]].atenuation)
+  {
+    nodes[heap[0]].heapIndex = NO_INDEX;
+    heap[0] = slot;
+    nodes[slot].heapIndex = 0;
+    heap_sift_down(0);
+  }
+}
+
+/**
+ * Reposiciona node no top-K após alteração da atenuação
+ * 
+ * @param slot                slot do node
+ * @param previousAtenuation  atenuação anterior
+ */
+static void heap_change(uint32_t slot, uint8_t previousAtenuation)
+{
+  const int32_t index = nodes[slot].heapIndex;
+
+  if (index == NO_INDEX)
+  {
+    heap_offer(slot);
+  }
+  else if (nodes[slot].atenuation >= previousAtenuation)
+  {
+    heap_sift_down(index);
+  }
+  else if (nodeCount > heapSize)
+  {
+    /* Atenuação reduzida: estação fora do top-K pode ter passado à frente */
+    heap_rebuild();
+  }
+  else
+  {
+    heap_sift_up(index);
+  }
+}
+
+/**
+ * Reconstrói top-K percorrendo todos os nodes presentes
+ * 
+ */
+static void heap_rebuild(void)
+{
+  heapSize = 0;
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    nodes[slot].heapIndex = NO_INDEX;
+  }
+
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if (nodes[slot].present)
+    {
+      heap_offer(slot);
+    }
+  }
+}
+
+/**
+ * Troca duas posições do heap mantendo índices dos nodes
+ * 
+ * @param indexA  primeira posição
+ * @param indexB  segunda posição
+ */
+static void heap_swap(uint32_t indexA, uint32_t indexB)
+{
+  const uint16_t slot = heap[indexA];
+  heap[indexA] = heap[indexB];
+  heap[indexB] = slot;
+  nodes[heap[indexA]].heapIndex = indexA;
+  nodes[heap[indexB]].heapIndex = indexB;
+}
+
+/**
+ * Sobe posição no heap enquanto menor que o pai
+ * 
+ * @param index   posição inicial
+ */
+static void heap_sift_up(uint32_t index)
+{
+  while (index > 0)
+  {
+    const uint32_t parent = (index - 1) / 2;
+    if (nodes[heap[index]].atenuation >= nodes[heap[parent]].atenuation)
+    {
+      break;
+    }
+    heap_swap(index, parent);
+    index = parent;
+  }
+}
+
+/**
+ * Desce posição no heap enquanto maior que algum filho
+ * 
+ * @param index   posição inicial
+ */
+static void heap_sift_down(uint32_t index)
+{
+  while (true)
+  {
+    uint32_t smallest = index;
+    const uint32_t left = (2 * index) + 1;
+    const uint32_t right = left + 1;
+
+    if ((left < heapSize) && (nodes[heap[left]].atenuation < nodes[heap[smallest]].atenuation))
+    {
+      smallest = left;
+    }
+    if ((right < heapSize) && (nodes[heap[right]].atenuation < nodes[heap[smallest]].atenuation))
+    {
+      smallest = right;
+    }
+    if (smallest == index)
+    {
+      break;
+    }
+    heap_swap(index, smallest);
+    index = smallest;
+  }
+}
+
+/**
+ * Copia dados de um node para lista de destaque
+ * 
+ * @param slot        slot do node
+ * @param value       valor que classificou o node na lista
+ * @param nodeOutPtr  item a ser escrito
+ */
+static void stats_node_copy(uint32_t slot, uint8_t value, plcStatsNode_t * nodeOutPtr)
+{
+  const nodeStats_t * statsPtr = &nodes[slot];
+  memcpy(nodeOutPtr->mac, statsPtr->mac, sizeof(nodeOutPtr->mac));
+  nodeOutPtr->value = value;
+  nodeOutPtr->average = statsPtr->snrAverage >> EWMA_FRACTION_BITS;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
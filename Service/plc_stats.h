@@ -0,0 +1,70 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_STATS_H
+#define PLC_STATS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "plc_topology.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Faixas do histograma de SNR, a última acumula valores acima */
+#define PLC_STATS_SNR_BUCKETS       8
+#define PLC_STATS_SNR_BUCKET_WIDTH  8
+/* Fases elétricas contabilizadas, 0 = fase não identificada */
+#define PLC_STATS_PHASES            4
+/* Quantidade de estações com pior atenuação expostas */
+#define PLC_STATS_TOP_K             5
+/* Quantidade máxima de estações sinalizadas com queda de SNR */
+#define PLC_STATS_MAX_DROPS         8
+/* Peso da média móvel exponencial do SNR: alfa = 1 / 2^SHIFT */
+#define PLC_STATS_EWMA_SHIFT        3
+/* Queda em relação à média, em dB, para sinalizar estação */
+#define PLC_STATS_SNR_DROP          6
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Estação em uma lista de destaque */
+typedef struct plcStatsNode_t
+{
+  uint8_t mac[6];
+  /* Valor que classificou a estação: atenuação ou SNR atual */
+  uint8_t value;
+  /* SNR médio (EWMA), somente para queda de SNR */
+  uint8_t average;
+} plcStatsNode_t;
+
+/* Agregados da rede, tamanho fixo e independente da quantidade de nodes */
+typedef struct plcStats_t
+{
+  uint32_t nodeCount;
+  uint32_t snrHistogram[PLC_STATS_SNR_BUCKETS];
+  uint32_t phaseCount[PLC_STATS_PHASES];
+  /* Ordenado da maior para a menor atenuação */
+  plcStatsNode_t worstAtenuation[PLC_STATS_TOP_K];
+  uint32_t worstAtenuationCount;
+  plcStatsNode_t snrDrops[PLC_STATS_MAX_DROPS];
+  uint32_t snrDropCount;
+} plcStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_stats_init(void);
+void plc_stats_update(uint32_t slot, const node_t * nodePtr);
+void plc_stats_remove(uint32_t slot);
+void plc_stats_get(plcStats_t * statsPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
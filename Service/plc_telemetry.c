@@ -0,0 +1,660 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_telemetry.h"
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_bit_defs.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Unidade de gravação do log */
+#define PAGE_SIZE           256
+/* Unidade de apagamento da flash */
+#define SECTOR_SIZE         4096
+#define PAGE_MAGIC          0x544C
+#define PAGE_HEADER_SIZE    8
+#define BLOCK_HEADER_SIZE   15
+/* Pior caso de uma amostra codificada: delta-of-delta (5) + controle (1) + 3 deltas (2) */
+#define MAX_SAMPLE_SIZE     12
+/* Bits do byte de controle de uma amostra */
+#define SAMPLE_SNR_BIT        BIT0
+#define SAMPLE_ATENUATION_BIT BIT1
+#define SAMPLE_PHASE_BIT      BIT2
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Bloco comprimido em construção para um node */
+typedef struct blockEncoder_t
+{
+  uint8_t mac[6];
+  uint8_t count;
+  uint8_t length;
+  uint32_t baseTimestamp;
+  uint8_t baseSnr;
+  uint8_t baseAtenuation;
+  uint8_t basePhase;
+  uint8_t payload[PLC_TELEMETRY_BLOCK_SIZE];
+  /* Estado para codificação da próxima amostra */
+  uint32_t lastTimestamp;
+  int32_t lastDelta;
+  uint8_t lastSnr;
+  uint8_t lastAtenuation;
+  uint8_t lastPhase;
+} blockEncoder_t;
+
+/* Parâmetros de uma consulta em andamento */
+typedef struct telemetryQuery_t
+{
+  const uint8_t * macPtr;
+  uint32_t from;
+  uint32_t to;
+  plcTelemetryCallback_t callback;
+  void * contextPtr;
+} telemetryQuery_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+/* Identificador LOG */
+static const char *TAG = "PLC_TELEMETRY";
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Partição do log, NULL = log desabilitado */
+static const esp_partition_t * partitionPtr;
+/* Área útil da partição, múltipla do setor */
+static uint32_t partitionSize;
+/* Próxima página a ser gravada */
+static uint32_t writeOffset;
+/* Sequência da próxima página */
+static uint32_t nextSequence;
+/* Página em montagem na RAM */
+static uint8_t pageBuffer[PAGE_SIZE];
+static uint32_t pageUsed;
+/* Blocos em construção, indexados pelo slot do node */
+static blockEncoder_t encoders[PLC_TOPOLOGY_MAX_NODES];
+/* Proteção do estado do log */
+static SemaphoreHandle_t telemetryMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void recover_write_position(void);
+static void page_reset(void);
+static void page_write(void);
+static void block_start(blockEncoder_t * encoderPtr, const node_t * nodePtr, uint32_t timestamp);
+static void block_seal(blockEncoder_t * encoderPtr);
+static size_t sample_encode(const blockEncoder_t * encoderPtr, const node_t * nodePtr,
+                            uint32_t timestamp, uint8_t * bufferOutPtr);
+static void sample_commit(blockEncoder_t * encoderPtr, const node_t * nodePtr, uint32_t timestamp);
+static bool page_decode(const uint8_t * pagePtr, const telemetryQuery_t * queryPtr);
+static bool block_decode(const uint8_t * blockPtr, const telemetryQuery_t * queryPtr);
+static size_t varint_put(uint32_t value, uint8_t * bufferOutPtr);
+static size_t varint_get(const uint8_t * bufferInPtr, size_t available, uint32_t * valuePtr);
+static uint32_t zigzag_encode(int32_t value);
+static int32_t zigzag_decode(uint32_t value);
+static void put_u32(uint8_t * bufferOutPtr, uint32_t value);
+static uint32_t get_u32(const uint8_t * bufferInPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa log de telemetria, recuperando posição de escrita da flash
+ * 
+ */
+void plc_telemetry_init(void)
+{
+  telemetryMutex = xSemaphoreCreateMutex();
+  bzero(encoders, sizeof(encoders));
+  page_reset();
+
+  partitionPtr = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                          PLC_TELEMETRY_PARTITION_LABEL);
+  if (partitionPtr == NULL)
+  {
+    ESP_LOGI(TAG, "Partition '%s' not found, telemetry log disabled", PLC_TELEMETRY_PARTITION_LABEL);
+    return;
+  }
+
+  partitionSize = partitionPtr->size - (partitionPtr->size % SECTOR_SIZE);
+  recover_write_position();
+  ESP_LOGI(TAG, "Telemetry log: %u bytes, write offset %u, sequence %u",
+           partitionSize, writeOffset, nextSequence);
+}
+
+/**
+ * Insere leitura de um node no log, gravando a flash por página completa
+ * 
+ * O timestamp é o relógio do sistema (time), somente após o acerto por
+ * SNTP (PLC_TELEMETRY_MIN_VALID_TIME), antes disso a amostra é descartada.
+ * Blocos ainda na RAM são perdidos em caso de reinicialização.
+ * 
+ * @param slot      slot do node na tabela da topologia
+ * @param nodePtr   leitura atual do node
+ */
+void plc_telemetry_append(uint32_t slot, const node_t * nodePtr)
+{
+  if (slot >= PLC_TOPOLOGY_MAX_NODES)
+  {
+    return;
+  }
+
+  const time_t now = time(NULL);
+  if (now < PLC_TELEMETRY_MIN_VALID_TIME)
+  {
+    /* Relógio ainda não sincronizado, timestamp não sobrevive ao reboot */
+    return;
+  }
+  const uint32_t timestamp = now;
+
+  xSemaphoreTake(telemetryMutex, portMAX_DELAY);
+
+  blockEncoder_t * encoderPtr = &encoders[slot];
+  if ((encoderPtr->count != 0) && (memcmp(encoderPtr->mac, nodePtr->mac, sizeof(encoderPtr->mac)) != 0))
+  {
+    /* Slot atribuído a outro node, fecha bloco do node anterior */
+    block_seal(encoderPtr);
+  }
+
+  if (encoderPtr->count == 0)
+  {
+    block_start(encoderPtr, nodePtr, timestamp);
+  }
+  else
+  {
+    uint8_t sample[MAX_SAMPLE_SIZE];
+    size_t sampleSize = sample_encode(encoderPtr, nodePtr, timestamp, sample);
+    if ((encoderPtr->length + sampleSize > PLC_TELEMETRY_BLOCK_SIZE) || (encoderPtr->count == UINT8_MAX))
+    {
+      /* Bloco cheio, fecha e inicia novo a partir desta amostra */
+      block_seal(encoderPtr);
+      block_start(encoderPtr, nodePtr, timestamp);
+    }
+    else
+    {
+      memcpy(&encoderPtr->payload[encoderPtr->length], sample, sampleSize);
+      encoderPtr->length += sampleSize;
+      encoderPtr->count++;
+      sample_commit(encoderPtr, nodePtr, timestamp);
+    }
+  }
+
+  xSemaphoreGive(telemetryMutex);
+}
+
+/**
+ * Consulta amostras de um node em um intervalo de tempo, em ordem cronológica
+ * 
+ * Percorre as páginas da flash, a página em montagem e o bloco em construção.
+ * O callback é executado fora da região protegida.
+ * 
+ * @param macPtr      MAC do node, 6 bytes
+ * @param from        início do intervalo (inclusivo)
+ * @param to          fim do intervalo (inclusivo)
+ * @param callback    tratamento de cada amostra encontrada
+ * @param contextPtr  contexto repassado ao callback
+ * @return true       consulta concluída
+ * @return false      consulta interrompida pelo callback
+ */
+bool plc_telemetry_query(const uint8_t * macPtr, uint32_t from, uint32_t to,
+                         plcTelemetryCallback_t callback, void * contextPtr)
+{
+  const telemetryQuery_t query = {
+    .macPtr = macPtr,
+    .from = from,
+    .to = to,
+    .callback = callback,
+    .contextPtr = contextPtr,
+  };
+  uint8_t page[PAGE_SIZE];
+
+  /* Páginas gravadas, da mais antiga (posição de escrita) para a mais recente */
+  for (uint32_t offset = 0; (partitionPtr != NULL) && (offset < partitionSize); offset += PAGE_SIZE)
+  {
+    xSemaphoreTake(telemetryMutex, portMAX_DELAY);
+    const uint32_t address = (writeOffset + offset) % partitionSize;
+    esp_err_t result = esp_partition_read(partitionPtr, address, page, sizeof(page));
+    xSemaphoreGive(telemetryMutex);
+
+    if ((result != ESP_OK) || ((page[0] | (page[1] << 8)) != PAGE_MAGIC))
+    {
+      /* Página apagada ou inválida */
+      continue;
+    }
+
+    if (page_decode(page, &query) == false)
+    {
+      return false;
+    }
+  }
+
+  /* Dados ainda na RAM: página em montagem e bloco em construção do node */
+  blockEncoder_t encoder;
+  bzero(&encoder, sizeof(encoder));
+  xSemaphoreTake(telemetryMutex, portMAX_DELAY);
+  memcpy(page, pageBuffer, sizeof(page));
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if ((encoders[slot].count != 0) && (memcmp(encoders[slot].mac, macPtr, sizeof(encoders[slot].mac)) == 0))
+    {
+      encoder = encoders[slot];
+      break;
+    }
+  }
+  xSemaphoreGive(telemetryMutex);
+
+  if (page_decode(page, &query) == false)
+  {
+    return false;
+  }
+
+  if (encoder.count == 0)
+  {
+    return true;
+  }
+
+  /* Serializa bloco em construção no mesmo formato da flash */
+  memcpy(&page[0], encoder.mac, sizeof(encoder.mac));
+  page[6] = encoder.count;
+  page[7] = encoder.length;
+  put_u32(&page[8], encoder.baseTimestamp);
+  page[12] = encoder.baseSnr;
+  page[13] = encoder.baseAtenuation;
+  page[14] = encoder.basePhase;
+  memcpy(&page[BLOCK_HEADER_SIZE], encoder.payload, encoder.length);
+
+  return block_decode(page, &query);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+/**
+ * Busca página de maior sequência para continuar o log após reinicialização
+ * 
+ */
+static void recover_write_position(void)
+{
+  uint8_t header[PAGE_HEADER_SIZE];
+  bool found = false;
+  uint32_t lastSequence = 0;
+  uint32_t lastOffset = 0;
+
+  for (uint32_t offset = 0; offset < partitionSize; offset += PAGE_SIZE)
+  {
+    if ((esp_partition_read(partitionPtr, offset, header, sizeof(header)) != ESP_OK) ||
+        ((header[0] | (header[1] << 8)) != PAGE_MAGIC))
+    {
+      continue;
+    }
+
+    uint32_t sequence = get_u32(&header[4]);
+    if ((found == false) || (sequence > lastSequence))
+    {
+      found = true;
+      lastSequence = sequence;
+      lastOffset = offset;
+    }
+  }
+
+  writeOffset = found ? (lastOffset + PAGE_SIZE) % partitionSize : 0;
+  nextSequence = found ? lastSequence + 1 : 0;
+}
+
+/**
+ * Limpa página em montagem
+ * 
+ */
+static void page_reset(void)
+{
+  memset(pageBuffer, 0xFF, sizeof(pageBuffer));
+  pageUsed = PAGE_HEADER_SIZE;
+}
+
+/**
+ * Grava página em montagem na próxima posição do log
+ * 
+ */
+static void page_write(void)
+{
+  if (partitionPtr != NULL)
+  {
+    pageBuffer[0] = PAGE_MAGIC & 0xFF;
+    pageBuffer[1] = PAGE_MAGIC >> 8;
+    put_u32(&pageBuffer[4], nextSequence++);
+
+    if ((writeOffset % SECTOR_SIZE) == 0)
+    {
+      /* Primeira página do setor, apaga dados da volta anterior */
+      esp_partition_erase_range(partitionPtr, writeOffset, SECTOR_SIZE);
+    }
+
+    if (esp_partition_write(partitionPtr, writeOffset, pageBuffer, PAGE_SIZE) != ESP_OK)
+    {
+      ESP_LOGI(TAG, "Write fail at offset %u", writeOffset);
+    }
+
+    writeOffset = (writeOffset + PAGE_SIZE) % partitionSize;
+  }
+
+  page_reset();
+}
+
+/**
+ * Inicia bloco com a amostra base
+ * 
+ * @param encoderPtr  bloco a ser iniciado
+ * @param nodePtr     leitura atual do node
+ * @param timestamp   timestamp da amostra
+ */
+static void block_start(blockEncoder_t * encoderPtr, const node_t * nodePtr, uint32_t timestamp)
+{
+  memcpy(encoderPtr->mac, nodePtr->mac, sizeof(encoderPtr->mac));
+  encoderPtr->count = 1;
+  encoderPtr->length = 0;
+  encoderPtr->baseTimestamp = timestamp;
+  encoderPtr->baseSnr = nodePtr->snr;
+  encoderPtr->baseAtenuation = nodePtr->atenuation;
+  encoderPtr->basePhase = nodePtr->phase;
+  encoderPtr->lastDelta = 0;
+  sample_commit(encoderPtr, nodePtr, timestamp);
+}
+
+/**
+ * Fecha bloco e copia para a página em montagem, gravando a página se cheia
+ * 
+ * @param encoderPtr  bloco a ser fechado
+ */
+static void block_seal(blockEncoder_t * encoderPtr)
+{
+  if (encoderPtr->count == 0)
+  {
+    return;
+  }
+
+  const size_t blockSize = BLOCK_HEADER_SIZE + encoderPtr->length;
+  if (pageUsed + blockSize > PAGE_SIZE)
+  {
+    page_write();
+  }
+
+  uint8_t * blockPtr = &pageBuffer[pageUsed];
+  memcpy(&blockPtr[0], encoderPtr->mac, sizeof(encoderPtr->mac));
+  blockPtr[6] = encoderPtr->count;
+  blockPtr[7] = encoderPtr->length;
+  put_u32(&blockPtr[8], encoderPtr->baseTimestamp);
+  blockPtr[12] = encoderPtr->baseSnr;
+  blockPtr[13] = encoderPtr->baseAtenuation;
+  blockPtr[14] = encoderPtr->basePhase;
+  memcpy(&blockPtr[BLOCK_HEADER_SIZE], encoderPtr->payload, encoderPtr->length);
+  pageUsed += blockSize;
+
+  encoderPtr->count = 0;
+}
+
+/**
+ * Codifica amostra em relação à anterior do bloco
+ * 
+ * @param encoderPtr    bloco em construção
+ * @param nodePtr       leitura atual do node
+ * @param timestamp     timestamp da amostra
+ * @param bufferOutPtr  buffer de escrita, mínimo MAX_SAMPLE_SIZE
+ * @return size_t       tamanho codificado
+ */
+static size_t sample_encode(const blockEncoder_t * encoderPtr, const node_t * nodePtr,
+                            uint32_t timestamp, uint8_t * bufferOutPtr)
+{
+  const int32_t delta = timestamp - encoderPtr->lastTimestamp;
+  size_t length = varint_put(zigzag_encode(delta - encoderPtr->lastDelta), bufferOutPtr);
+
+  uint8_t * controlPtr = &bufferOutPtr[length++];
+  *controlPtr = 0;
+
+  if (nodePtr->snr != encoderPtr->lastSnr)
+  {
+    *controlPtr |= SAMPLE_SNR_BIT;
+    length += varint_put(zigzag_encode(nodePtr->snr - encoderPtr->lastSnr), &bufferOutPtr[length]);
+  }
+  if (nodePtr->atenuation != encoderPtr->lastAtenuation)
+  {
+    *controlPtr |= SAMPLE_ATENUATION_BIT;
+    length += varint_put(zigzag_encode(nodePtr->atenuation - encoderPtr->lastAtenuation), &bufferOutPtr[length]);
+  }
+  if (nodePtr->phase != encoderPtr->lastPhase)
+  {
+    *controlPtr |= SAMPLE_PHASE_BIT;
+    length += varint_put(zigzag_encode(nodePtr->phase - encoderPtr->lastPhase), &bufferOutPtr[length]);
+  }
+
+  return length;
+}
+
+/**
+ * Atualiza referência para codificação da próxima amostra
+ * 
+ * @param encoderPtr  bloco em construção
+ * @param nodePtr     leitura inserida
+ * @param timestamp   timestamp da amostra inserida
+ */
+static void sample_commit(blockEncoder_t * encoderPtr, const node_t * nodePtr, uint32_t timestamp)
+{
+  if (encoderPtr->count > 1)
+  {
+    encoderPtr->lastDelta = timestamp - encoderPtr->lastTimestamp;
+  }
+  encoderPtr->lastTimestamp = timestamp;
+  encoderPtr->lastSnr = nodePtr->snr;
+  encoderPtr->lastAtenuation = nodePtr->atenuation;
+  encoderPtr->lastPhase = nodePtr->phase;
+}
+
+/**
+ * Decodifica blocos de uma página
+ * 
+ * @param pagePtr   página completa
+ * @param queryPtr  consulta em andamento
+ * @return true     página tratada
+ * @return false    consulta interrompida pelo callback
+ */
+static bool page_decode(const uint8_t * pagePtr, const telemetryQuery_t * queryPtr)
+{
+  for (uint32_t offset = PAGE_HEADER_SIZE; offset + BLOCK_HEADER_SIZE <= PAGE_SIZE;)
+  {
+    const uint8_t * blockPtr = &pagePtr[offset];
+    const uint32_t blockSize = BLOCK_HEADER_SIZE + blockPtr[7];
+    if ((blockPtr[6] == 0xFF) || (blockPtr[6] == 0) || (offset + blockSize > PAGE_SIZE))
+    {
+      /* Fim dos blocos gravados */
+      break;
+    }
+
+    if ((memcmp(blockPtr, queryPtr->macPtr, 6) == 0) && (block_decode(blockPtr, queryPtr) == false))
+    {
+      return false;
+    }
+
+    offset += blockSize;
+  }
+
+  return true;
+}
+
+/**
+ * Decodifica amostras de um bloco, repassando as que estão no intervalo
+ * 
+ * @param blockPtr  bloco serializado
+ * @param queryPtr  consulta em andamento
+ * @return true     bloco tratado
+ * @return false    consulta interrompida pelo callback
+ */
+static bool block_decode(const uint8_t * blockPtr, const telemetryQuery_t * queryPtr)
+{
+  const uint8_t count = blockPtr[6];
+  const uint8_t length = blockPtr[7];
+  const uint8_t * payloadPtr = &blockPtr[BLOCK_HEADER_SIZE];
+
+  plcHistorySample_t sample = {
+    .timestamp = get_u32(&blockPtr[8]),
+    .snr = blockPtr[12],
+    .atenuation = blockPtr[13],
+    .phase = blockPtr[14],
+  };
+
+  if (sample.timestamp > queryPtr->to)
+  {
+    /* Bloco inteiro após o intervalo */
+    return true;
+  }
+
+  int32_t delta = 0;
+  size_t position = 0;
+  for (uint32_t idx = 0; idx < count; idx++)
+  {
+    if (idx != 0)
+    {
+      uint32_t value;
+      size_t used = varint_get(&payloadPtr[position], length - position, &value);
+      if ((used == 0) || (position + used >= length))
+      {
+        /* Bloco corrompido */
+        return true;
+      }
+      position += used;
+      delta += zigzag_decode(value);
+      sample.timestamp += delta;
+
+      const uint8_t control = payloadPtr[position++];
+      uint8_t * fieldPtr[] = { &sample.snr, &sample.atenuation, &sample.phase };
+      for (uint32_t field = 0; field < 3; field++)
+      {
+        if ((control & (1 << field)) == 0)
+        {
+          continue;
+        }
+        used = varint_get(&payloadPtr[position], length - position, &value);
+        if (used == 0)
+        {
+          return true;
+        }
+        position += used;
+        *fieldPtr[field] += zigzag_decode(value);
+      }
+    }
+
+    if ((sample.timestamp >= queryPtr->from) && (sample.timestamp <= queryPtr->to) &&
+        (queryPtr->callback(&sample, queryPtr->contextPtr) == false))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Escreve inteiro sem sinal em formato varint (7 bits por byte)
+ * 
+ * @param value         valor a ser escrito
+ * @param bufferOutPtr  buffer de escrita, mínimo 5 bytes
+ * @return size_t       bytes escritos
+ */
+static size_t varint_put(uint32_t value, uint8_t * bufferOutPtr)
+{
+  size_t length = 0;
+  while (value >= 0x80)
+  {
+    bufferOutPtr[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  bufferOutPtr[length++] = value;
+  return length;
+}
+
+/**
+ * Lê inteiro sem sinal em formato varint
+ * 
+ * @param bufferInPtr   buffer de leitura
+ * @param available     bytes disponíveis para leitura
+ * @param valuePtr      valor lido
+ * @return size_t       bytes lidos, 0 = varint inválido
+ */
+static size_t varint_get(const uint8_t * bufferInPtr, size_t available, uint32_t * valuePtr)
+{
+  *valuePtr = 0;
+  for (size_t idx = 0; (idx < available) && (idx < 5); idx++)
+  {
+    *valuePtr |= (uint32_t)(bufferInPtr[idx] & 0x7F) << (7 * idx);
+    if ((bufferInPtr[idx] & 0x80) == 0)
+    {
+      return idx + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Mapeia inteiro com sinal para sem sinal, valores pequenos em poucos bytes
+ * 
+ * @param value     valor com sinal
+ * @return uint32_t valor mapeado
+ */
+static uint32_t zigzag_encode(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * Inverso de zigzag_encode
+ * 
+ * @param value     valor mapeado
+ * @return int32_t  valor com sinal
+ */
+static int32_t zigzag_decode(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**
+ * Escreve u32 little-endian
+ * 
+ * @param bufferOutPtr  buffer de escrita
+ * @param value         valor a ser escrito
+ */
+static void put_u32(uint8_t * bufferOutPtr, uint32_t value)
+{
+  bufferOutPtr[0] = value;
+  bufferOutPtr[1] = value >> 8;
+  bufferOutPtr[2] = value >> 16;
+  bufferOutPtr[3] = value >> 24;
+}
+
+/**
+ * Lê u32 little-endian
+ * 
+ * @param bufferInPtr   buffer de leitura
+ * @return uint32_t     valor lido
+ */
+static uint32_t get_u32(const uint8_t * bufferInPtr)
+{
+  return bufferInPtr[0] | (bufferInPtr[1] << 8) | (bufferInPtr[2] << 16) | ((uint32_t)bufferInPtr[3] << 24);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,67 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_TELEMETRY_H
+#define PLC_TELEMETRY_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "plc_topology.h"
+#include "plc_history.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Log append-only da qualidade do enlace em partição dedicada da flash.
+ * Requer entrada na tabela de partições, ex:
+ *   telemetry, data, 0x40, , 512K
+ * Sem a partição o log fica desabilitado e as consultas retornam vazio.
+ * 
+ * Formato na flash, páginas de 256 bytes gravadas uma única vez por volta:
+ *   página: magic (u16 = 0x544C) | reservado (u16) | sequência (u32) | blocos
+ *   bloco:  mac[6] | amostras (u8) | tamanho payload (u8) |
+ *           timestamp base (u32) | snr (u8) | atenuação (u8) | fase (u8) | payload
+ *   amostra no payload (a partir da segunda):
+ *           varint zigzag do delta-of-delta do timestamp |
+ *           controle (bit0 = snr, bit1 = atenuação, bit2 = fase alterados) |
+ *           varint zigzag do delta de cada campo alterado
+ * Campos multibyte em little-endian. Bytes 0xFF após o último bloco.
+ */
+#define PLC_TELEMETRY_PARTITION_LABEL "telemetry"
+
+/*
+ * Timestamps em segundos do relógio do sistema (Unix), acertado por SNTP
+ * após a conexão Wi-Fi (wifi_app). Até o primeiro acerto o relógio conta
+ * a partir de 1970 e reinicia a cada boot, amostras descartadas
+ */
+#define PLC_TELEMETRY_MIN_VALID_TIME  1577836800
+
+/* Payload máximo de um bloco em construção por node, em bytes */
+#ifndef PLC_TELEMETRY_BLOCK_SIZE
+#define PLC_TELEMETRY_BLOCK_SIZE  48
+#endif
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Callback de consulta, retorno false interrompe a leitura */
+typedef bool (*plcTelemetryCallback_t)(const plcHistorySample_t * samplePtr, void * contextPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_telemetry_init(void);
+void plc_telemetry_append(uint32_t slot, const node_t * nodePtr);
+bool plc_telemetry_query(const uint8_t * macPtr, uint32_t from, uint32_t to,
+                         plcTelemetryCallback_t callback, void * contextPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
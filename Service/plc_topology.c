@@ -11,7 +11,15 @@
 *******************************************************************************/
 #include "plc_topology.h"
 #include "plc_uart_model.h"
+#include "plc_history.h"
+#include "plc_telemetry.h"
+#include "plc_stats.h"
+#include "plc_events.h"
+#include "plc_uart.h"
 #include "string.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
@@ -19,6 +27,20 @@
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
+/* Posição da tabela de nodes acompanhados entre atualizações */
+typedef struct nodeSlot_t
+{
+  /* Última leitura do node */
+  node_t node;
+  /* Slot atribuído a um node */
+  bool used;
+  /* Node presente na última atualização */
+  bool present;
+  /* Última atualização em que o node foi visto, segundos desde a inicialização */
+  uint32_t lastSeen;
+  /* SNR do último evento publicado do node */
+  uint8_t eventSnr;
+} nodeSlot_t;
 
 /*******************************************************************************
 * CONSTANTES
@@ -27,59 +49,419 @@
 /*******************************************************************************
 * VARIÁVEIS
 *******************************************************************************/
+/* Tabela de nodes, o índice (slot) é estável enquanto o node for acompanhado */
+static nodeSlot_t nodeTable[PLC_TOPOLOGY_MAX_NODES];
+/* Proteção da tabela de nodes e da topologia em cache */
+static SemaphoreHandle_t nodeTableMutex;
+/* Uma leitura do módulo por vez, consultas simultâneas reaproveitam o resultado */
+static SemaphoreHandle_t refreshMutex;
+/* Resultado da última leitura e seu instante (esp_timer_get_time), 0 = nenhuma */
+static topology_t cachedTopology;
+static int64_t cachedUs;
+/* Notificação de node lido, registrada antes da primeira atualização */
+static plcTopologyListener_t updatedListener;
 
 /*******************************************************************************
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
-static void copy_node(const node_t nodeCopynode, node_t * nodePtr, uint32_t * nodeCounterPtr);
+static void copy_node(const node_t nodeCopynode, node_t * nodePtr, uint32_t * nodeCounterPtr, uint32_t nodeMax);
+static void update_node_table(const node_t * nodeBufferPtr, uint32_t nodeCount, const bool * networkReadPtr);
+static bool topology_read(void);
+static bool cache_copy(topology_t * topologyPtr, uint32_t maxAgeMs);
+static bool cache_valid(uint32_t maxAgeMs);
+static int32_t find_slot(const uint8_t * macPtr);
+static int32_t allocate_slot(void);
 
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 
 /**
- * Montar objeto topologia dos concentradores (CCO) e estações (STA)
+ * Inicializa tabela de nodes e histórico
+ * 
+ */
+void plc_topology_init(void)
+{
+  bzero(nodeTable, sizeof(nodeTable));
+  bzero(&cachedTopology, sizeof(cachedTopology));
+  cachedUs = 0;
+  nodeTableMutex = xSemaphoreCreateMutex();
+  refreshMutex = xSemaphoreCreateMutex();
+  plc_history_init();
+  plc_telemetry_init();
+  plc_stats_init();
+}
+
+/**
+ * Registra notificação de cada node lido nas atualizações, substitui a anterior
+ * 
+ * @param listener  função de notificação, NULL = nenhuma
+ */
+void plc_topology_set_listener(plcTopologyListener_t listener)
+{
+  updatedListener = listener;
+}
+
+/**
+ * Lê a topologia de todas as redes no módulo, atualizando a tabela de nodes
+ * (eventos, histórico, telemetria e estatísticas) e o cache
+ * 
+ * @return true   encontrou módulos disponíveis
+ * @return false  não foram encontrados módulos pela rede elétrica
+ */
+bool plc_topology_refresh(void)
+{
+  xSemaphoreTake(refreshMutex, portMAX_DELAY);
+  const bool found = topology_read();
+  xSemaphoreGive(refreshMutex);
+
+  return found;
+}
+
+/**
+ * Montar objeto topologia dos concentradores (CCO) e estações (STA) de
+ * todas as redes, a partir do cache quando não mais antigo que maxAgeMs
  * 
  * @param topologyPtr ponteiro a ser escrita estrutura
+ * @param maxAgeMs    idade máxima aceita do cache, acima dela lê o módulo
  * @return true       encontrou módulos disponíveis
  * @return false      não foram encontrados módulos pela rede elétrica
  */
-bool plc_topology_get(topology_t * topologyPtr)
+bool plc_topology_get(topology_t * topologyPtr, uint32_t maxAgeMs)
 {
-  node_t nodes[MAX_CCO_NUM + MAX_STA_NUM];
+  if (cache_copy(topologyPtr, maxAgeMs) == false)
+  {
+    xSemaphoreTake(refreshMutex, portMAX_DELAY);
+    /* Atualizado por outra task durante a espera */
+    if (cache_copy(topologyPtr, maxAgeMs) == false)
+    {
+      topology_read();
+      cache_copy(topologyPtr, UINT32_MAX);
+    }
+    xSemaphoreGive(refreshMutex);
+  }
 
-  bzero(topologyPtr, sizeof(topology_t));
+  return (topologyPtr->ccoCount + topologyPtr->staCount) != 0;
+}
 
-  uint32_t nodeCount = plc_uart_model_get_topology(nodes, sizeof(nodes));
+/**
+ * Verifica se a topologia em cache pode ser entregue sem ler o módulo
+ * 
+ * @param maxAgeMs  idade máxima aceita do cache
+ * @return true     cache não mais antigo que maxAgeMs
+ * @return false    consulta com a mesma idade máxima lê o módulo
+ */
+bool plc_topology_is_fresh(uint32_t maxAgeMs)
+{
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+  const bool fresh = cache_valid(maxAgeMs);
+  xSemaphoreGive(nodeTableMutex);
 
-  for (uint32_t idx = 0; idx < nodeCount; idx++)
-  {
-    nodes[idx].role == NODE_ROLE_CCO ? copy_node(nodes[idx], 
-                                                      &topologyPtr->cco[0], 
-                                                      &topologyPtr->ccoCount) :
-                                       copy_node(nodes[idx], 
-                                                      &topologyPtr->sta[0], 
-                                                      &topologyPtr->staCount);
-  }
+  return fresh;
+}
 
-  return nodeCount != 0;
+/**
+ * Recupera slot de um node na tabela da topologia
+ * 
+ * @param macPtr    MAC do node, 6 bytes
+ * @return int32_t  slot do node, -1 = node não acompanhado
+ */
+int32_t plc_topology_find_slot(const uint8_t * macPtr)
+{
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+  int32_t slot = find_slot(macPtr);
+  xSemaphoreGive(nodeTableMutex);
+
+  return slot;
+}
+
+/**
+ * Recupera rede em que um node foi visto pela última vez
+ * 
+ * @param macPtr    MAC do node, 6 bytes
+ * @return int32_t  rede (porta UART) do node, -1 = node não acompanhado
+ */
+int32_t plc_topology_find_network(const uint8_t * macPtr)
+{
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+  const int32_t slot = find_slot(macPtr);
+  const int32_t network = (slot >= 0) ? nodeTable[slot].node.network : -1;
+  xSemaphoreGive(nodeTableMutex);
+
+  return network;
 }
 
 /*******************************************************************************
 * FUNÇÕES LOCAIS
 *******************************************************************************/
 /**
- * Copia estrutura de um node
+ * Copia estrutura de um node, descartado com o vetor do tipo cheio
  * 
  * @param nodeCopynode    node a ser copiado
  * @param nodePtr         node a ser escrito
  * @param nodeCounterPtr  quantidade do tipo de node copiado, incremento +1
+ * @param nodeMax         capacidade do vetor do tipo de node
  */
-static void copy_node(const node_t nodeCopynode, node_t * nodePtr, uint32_t * nodeCounterPtr)
+static void copy_node(const node_t nodeCopynode, node_t * nodePtr, uint32_t * nodeCounterPtr, uint32_t nodeMax)
 {
+  if (*nodeCounterPtr >= nodeMax)
+  {
+    return;
+  }
+
   nodePtr[*nodeCounterPtr] = nodeCopynode;
   *nodeCounterPtr += 1;
 }
+
+/**
+ * Lê nodes de todas as redes, atualiza tabela de nodes e cache. Chamada
+ * com refreshMutex
+ * 
+ * @return true   encontrou módulos disponíveis
+ * @return false  não foram encontrados módulos pela rede elétrica
+ */
+static bool topology_read(void)
+{
+  node_t nodes[MAX_CCO_NUM + MAX_STA_NUM];
+  topology_t topology;
+
+  bzero(&topology, sizeof(topology_t));
+
+  uint32_t nodeCount = 0;
+  /* Redes lidas com sucesso, somente nelas a ausência de um node é saída da rede */
+  bool networkRead[PLC_UART_PORT_COUNT];
+  for (uint32_t network = 0; network < PLC_UART_PORT_COUNT; network++)
+  {
+    if (nodeCount >= (sizeof(nodes) / sizeof(node_t)))
+    {
+      /* Limite de nodes atingido pelas redes anteriores, rede não lida */
+      networkRead[network] = false;
+      continue;
+    }
+
+    const int32_t count = plc_uart_model_get_topology(network, &nodes[nodeCount],
+                                                      sizeof(nodes) - (nodeCount * sizeof(node_t)));
+    networkRead[network] = count >= 0;
+    nodeCount += (count > 0) ? (uint32_t)count : 0;
+  }
+
+  /* Atualiza estruturas mantidas por node */
+  update_node_table(nodes, nodeCount, networkRead);
+
+  for (uint32_t idx = 0; idx < nodeCount; idx++)
+  {
+    nodes[idx].role == NODE_ROLE_CCO ? copy_node(nodes[idx], 
+                                                      &topology.cco[0], 
+                                                      &topology.ccoCount, MAX_CCO_NUM) :
+                                       copy_node(nodes[idx], 
+                                                      &topology.sta[0], 
+                                                      &topology.staCount, MAX_STA_NUM);
+  }
+
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+  cachedTopology = topology;
+  cachedUs = esp_timer_get_time();
+  xSemaphoreGive(nodeTableMutex);
+
+  return nodeCount != 0;
+}
+
+/**
+ * Copia topologia em cache quando não mais antiga que maxAgeMs
+ * 
+ * @param topologyPtr ponteiro a ser escrita estrutura
+ * @param maxAgeMs    idade máxima aceita
+ * @return true       cache copiado
+ * @return false      cache vencido ou inexistente, estrutura não alterada
+ */
+static bool cache_copy(topology_t * topologyPtr, uint32_t maxAgeMs)
+{
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+  const bool fresh = cache_valid(maxAgeMs);
+  if (fresh)
+  {
+    *topologyPtr = cachedTopology;
+  }
+  xSemaphoreGive(nodeTableMutex);
+
+  return fresh;
+}
+
+/**
+ * Verifica idade da topologia em cache, chamada com nodeTableMutex
+ * 
+ * @param maxAgeMs  idade máxima aceita
+ * @return true     cache não mais antigo que maxAgeMs
+ * @return false    cache vencido ou nenhuma leitura realizada
+ */
+static bool cache_valid(uint32_t maxAgeMs)
+{
+  return (cachedUs != 0) && ((esp_timer_get_time() - cachedUs) <= ((int64_t)maxAgeMs * 1000));
+}
+
+/**
+ * Atualiza tabela de nodes com a leitura recebida, alimentando histórico,
+ * telemetria, agregados da rede e a notificação de node lido
+ * 
+ * A tabela é atualizada com nodeTableMutex, tomado também a cada comando IO
+ * (plc_topology_find_network), histórico, telemetria (escrita na flash) e
+ * agregados são alimentados após liberá-lo. Chamada com refreshMutex, que
+ * mantém a ordem entre atualizações
+ * 
+ * @param nodeBufferPtr   nodes recebidos na atualização
+ * @param nodeCount       quantidade de nodes recebidos
+ * @param networkReadPtr  leitura com sucesso por rede, nodes de rede não lida
+ *                        mantêm a presença anterior
+ */
+static void update_node_table(const node_t * nodeBufferPtr, uint32_t nodeCount, const bool * networkReadPtr)
+{
+  const uint32_t now = esp_timer_get_time() / 1000000;
+
+  bool wasPresent[PLC_TOPOLOGY_MAX_NODES];
+  /* Node deixou a rede, agregados removidos após liberar a tabela */
+  bool hasLeft[PLC_TOPOLOGY_MAX_NODES];
+  /* Slot de cada node recebido, -1 = não acompanhado, e slot reaproveitado */
+  int32_t nodeSlot[MAX_CCO_NUM + MAX_STA_NUM];
+  bool slotReused[MAX_CCO_NUM + MAX_STA_NUM];
+
+  bzero(hasLeft, sizeof(hasLeft));
+  bzero(slotReused, sizeof(slotReused));
+
+  xSemaphoreTake(nodeTableMutex, portMAX_DELAY);
+
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    wasPresent[slot] = nodeTable[slot].present;
+    nodeTable[slot].present = false;
+  }
+
+  for (uint32_t idx = 0; idx < nodeCount; idx++)
+  {
+    int32_t slot = find_slot(nodeBufferPtr[idx].mac);
+    if (slot < 0)
+    {
+      slot = allocate_slot();
+      if (slot < 0)
+      {
+        /* Tabela cheia com nodes presentes, node não é acompanhado */
+        nodeSlot[idx] = -1;
+        continue;
+      }
+
+      /* Slot reaproveitado, descarta histórico anterior */
+      slotReused[idx] = true;
+      nodeTable[slot].used = true;
+    }
+    nodeSlot[idx] = slot;
+
+    nodeTable[slot].node = nodeBufferPtr[idx];
+    nodeTable[slot].present = true;
+    nodeTable[slot].lastSeen = now;
+
+    const uint8_t snr = nodeBufferPtr[idx].snr;
+    const uint8_t snrDelta = (snr > nodeTable[slot].eventSnr) ? (snr - nodeTable[slot].eventSnr) :
+                                                                 (nodeTable[slot].eventSnr - snr);
+    if ((wasPresent[slot] == false) || (snrDelta >= PLC_EVENTS_SNR_DELTA))
+    {
+      plc_events_node(wasPresent[slot] ? PLC_EVENT_NODE_SNR : PLC_EVENT_NODE_JOIN, &nodeBufferPtr[idx]);
+      nodeTable[slot].eventSnr = snr;
+    }
+  }
+
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if (wasPresent[slot] && (nodeTable[slot].present == false))
+    {
+      if (networkReadPtr[nodeTable[slot].node.network] == false)
+      {
+        /* Falha na leitura da rede, node não é dado como ausente e agregados são mantidos */
+        nodeTable[slot].present = true;
+        continue;
+      }
+
+      /* Node deixou a rede */
+      hasLeft[slot] = true;
+      plc_events_node(PLC_EVENT_NODE_LEAVE, &nodeTable[slot].node);
+    }
+  }
+
+  xSemaphoreGive(nodeTableMutex);
+
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if (hasLeft[slot])
+    {
+      plc_stats_remove(slot);
+    }
+  }
+
+  for (uint32_t idx = 0; idx < nodeCount; idx++)
+  {
+    const int32_t slot = nodeSlot[idx];
+    if (slot < 0)
+    {
+      continue;
+    }
+
+    if (slotReused[idx])
+    {
+      plc_history_reset(slot);
+    }
+    plc_history_update(slot, &nodeBufferPtr[idx], now);
+    plc_telemetry_append(slot, &nodeBufferPtr[idx]);
+    plc_stats_update(slot, &nodeBufferPtr[idx]);
+
+    if (updatedListener != NULL)
+    {
+      updatedListener(slot, &nodeBufferPtr[idx]);
+    }
+  }
+}
+
+/**
+ * Busca slot ocupado por um MAC
+ * 
+ * @param macPtr    MAC do node, 6 bytes
+ * @return int32_t  slot do node, -1 = não encontrado
+ */
+static int32_t find_slot(const uint8_t * macPtr)
+{
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if (nodeTable[slot].used && 
+        (memcmp(nodeTable[slot].node.mac, macPtr, sizeof(nodeTable[slot].node.mac)) == 0))
+    {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Reserva slot livre ou, na falta, o node ausente há mais tempo
+ * 
+ * @return int32_t  slot reservado, -1 = todos os nodes presentes
+ */
+static int32_t allocate_slot(void)
+{
+  int32_t oldestSlot = -1;
+  for (uint32_t slot = 0; slot < PLC_TOPOLOGY_MAX_NODES; slot++)
+  {
+    if (nodeTable[slot].used == false)
+    {
+      return slot;
+    }
+
+    if ((nodeTable[slot].present == false) &&
+        ((oldestSlot < 0) || (nodeTable[slot].lastSeen < nodeTable[oldestSlot].lastSeen)))
+    {
+      oldestSlot = slot;
+    }
+  }
+
+  return oldestSlot;
+}
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -18,13 +18,41 @@
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
-/* Maximo de módulos no retorno que a topologia exibe */
+/*
+ * Maximo de módulos no retorno que a topologia exibe, somando todas as
+ * redes: limite real da leitura, da tabela de nodes e das estruturas por
+ * node (histórico, telemetria e estatísticas), 13 nodes com os valores padrão
+ */
 
 /* Concentradores */
 #define MAX_CCO_NUM   3
 /* Estações */
 #define MAX_STA_NUM   10
 
+/*
+ * Atualização periódica da topologia (plc_app), alimenta eventos, histórico,
+ * telemetria e estatísticas por node independente das consultas dos clientes
+ */
+#ifndef PLC_TOPOLOGY_REFRESH_MS
+#define PLC_TOPOLOGY_REFRESH_MS   10000
+#endif
+/*
+ * Idade máxima da topologia em cache entregue aos clientes, acima dela a
+ * consulta lê o módulo (atualização periódica atrasada ou antes da primeira)
+ */
+#ifndef PLC_TOPOLOGY_MAX_AGE_MS
+#define PLC_TOPOLOGY_MAX_AGE_MS   (PLC_TOPOLOGY_REFRESH_MS + 5000)
+#endif
+
+/*
+ * Nodes acompanhados entre atualizações (histórico e estatísticas por node).
+ * A leitura entrega no máximo MAX_CCO_NUM + MAX_STA_NUM nodes, valores
+ * maiores somente mantêm por mais tempo o histórico de nodes ausentes
+ */
+#ifndef PLC_TOPOLOGY_MAX_NODES
+#define PLC_TOPOLOGY_MAX_NODES  (MAX_CCO_NUM + MAX_STA_NUM)
+#endif
+
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
@@ -44,6 +72,8 @@ typedef struct node_t
   uint8_t atenuation;
   /* Fase elétrica módulo */
   uint8_t phase;
+  /* Rede do módulo, porta UART do concentrador que o reportou */
+  uint8_t network;
 } node_t;
 
 /* Estrutura da topologia vista pelo CCO sob controle do ESP */
@@ -59,10 +89,19 @@ typedef struct topology_t
   uint32_t staCount;
 } topology_t;
 
+/* Notificação de node lido na atualização, executada na task da leitura, não deve bloquear */
+typedef void (*plcTopologyListener_t)(uint32_t slot, const node_t * nodePtr);
+
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
-bool plc_topology_get(topology_t * topologyPtr);
+void plc_topology_init(void);
+void plc_topology_set_listener(plcTopologyListener_t listener);
+bool plc_topology_refresh(void);
+bool plc_topology_get(topology_t * topologyPtr, uint32_t maxAgeMs);
+bool plc_topology_is_fresh(uint32_t maxAgeMs);
+int32_t plc_topology_find_slot(const uint8_t * macPtr);
+int32_t plc_topology_find_network(const uint8_t * macPtr);
 
 /*******************************************************************************
 * END OF FILE
@@ -0,0 +1,235 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const stageNames[PLC_TRACE_STAGE_COUNT] = {
+  [PLC_TRACE_STAGE_READ] = "read",
+  [PLC_TRACE_STAGE_DECODE] = "decode",
+  [PLC_TRACE_STAGE_QUEUE] = "queue",
+  [PLC_TRACE_STAGE_TX] = "tx",
+  [PLC_TRACE_STAGE_MODULE] = "module",
+  [PLC_TRACE_STAGE_RETRY] = "retry",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Traces finalizados, head = próxima escrita */
+static plcTrace_t traceRing[PLC_TRACE_RING_SIZE];
+static uint32_t traceHead;
+static uint32_t traceCount;
+/* Identificador do próximo trace */
+static uint32_t nextTraceId = 1;
+/* Proteção do buffer circular entre handlers HTTP */
+static SemaphoreHandle_t traceMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa buffer de traces
+ * 
+ */
+void plc_trace_init(void)
+{
+  traceMutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * Inicia trace de uma requisição. Funções aceitam trace NULL, sem efeito
+ * 
+ * @param tracePtr  trace a ser iniciado
+ * @param uriPtr    URI da requisição
+ */
+void plc_trace_begin(plcTrace_t * tracePtr, const char * uriPtr)
+{
+  if (tracePtr == NULL)
+  {
+    return;
+  }
+
+  bzero(tracePtr, sizeof(plcTrace_t));
+  tracePtr->id = __atomic_fetch_add(&nextTraceId, 1, __ATOMIC_RELAXED);
+  strncpy(tracePtr->uri, uriPtr, sizeof(tracePtr->uri) - 1);
+  tracePtr->startUs = esp_timer_get_time();
+  tracePtr->lastMarkUs = tracePtr->startUs;
+}
+
+/**
+ * Encerra etapa iniciada na última marcação
+ * 
+ * @param tracePtr  trace da requisição
+ * @param stage     etapa encerrada
+ */
+void plc_trace_mark(plcTrace_t * tracePtr, plcTraceStage_t stage)
+{
+  if (tracePtr == NULL)
+  {
+    return;
+  }
+
+  const int64_t nowUs = esp_timer_get_time();
+  tracePtr->stageUs[stage] += (uint32_t)(nowUs - tracePtr->lastMarkUs);
+  tracePtr->lastMarkUs = nowUs;
+}
+
+/**
+ * Soma duração medida externamente a uma etapa, sem alterar a última marcação
+ * 
+ * @param tracePtr  trace da requisição
+ * @param stage     etapa medida
+ * @param elapsedUs duração em microssegundos
+ */
+void plc_trace_add(plcTrace_t * tracePtr, plcTraceStage_t stage, int64_t elapsedUs)
+{
+  if ((tracePtr == NULL) || (elapsedUs < 0))
+  {
+    return;
+  }
+
+  tracePtr->stageUs[stage] += (uint32_t)elapsedUs;
+}
+
+/**
+ * Contabiliza nova tentativa de envio
+ * 
+ * @param tracePtr  trace da requisição
+ */
+void plc_trace_retry(plcTrace_t * tracePtr)
+{
+  if (tracePtr == NULL)
+  {
+    return;
+  }
+
+  tracePtr->retries++;
+}
+
+/**
+ * Finaliza trace e armazena cópia no buffer circular
+ * 
+ * @param tracePtr  trace da requisição
+ * @param result    resultado da requisição
+ */
+void plc_trace_end(plcTrace_t * tracePtr, bool result)
+{
+  if (tracePtr == NULL)
+  {
+    return;
+  }
+
+  tracePtr->totalUs = (uint32_t)(esp_timer_get_time() - tracePtr->startUs);
+  tracePtr->result = result;
+
+  xSemaphoreTake(traceMutex, portMAX_DELAY);
+  traceRing[traceHead] = *tracePtr;
+  traceHead = (traceHead + 1) % PLC_TRACE_RING_SIZE;
+  if (traceCount < PLC_TRACE_RING_SIZE)
+  {
+    traceCount++;
+  }
+  xSemaphoreGive(traceMutex);
+}
+
+/**
+ * Formata valor do header Server-Timing, durações em milissegundos.
+ * Etapas sem duração são omitidas
+ * 
+ * @param tracePtr    trace finalizado
+ * @param bufferPtr   buffer de escrita
+ * @param bufferSize  tamanho do buffer
+ * @return size_t     tamanho escrito
+ */
+size_t plc_trace_server_timing(const plcTrace_t * tracePtr, char * bufferPtr, size_t bufferSize)
+{
+  size_t used = 0;
+  for (uint32_t stage = 0; stage < PLC_TRACE_STAGE_COUNT; stage++)
+  {
+    if ((tracePtr->stageUs[stage] == 0) || (used >= bufferSize))
+    {
+      continue;
+    }
+
+    used += snprintf(&bufferPtr[used], bufferSize - used, "%s;dur=%u.%03u, ", stageNames[stage],
+                     tracePtr->stageUs[stage] / 1000, tracePtr->stageUs[stage] % 1000);
+  }
+
+  if (used < bufferSize)
+  {
+    used += snprintf(&bufferPtr[used], bufferSize - used, "total;dur=%u.%03u",
+                     tracePtr->totalUs / 1000, tracePtr->totalUs % 1000);
+  }
+
+  return used < bufferSize ? used : bufferSize - 1;
+}
+
+/**
+ * Recupera cópia de um trace finalizado
+ * 
+ * @param index     posição a partir do mais recente, 0 = mais recente
+ * @param tracePtr  estrutura de escrita
+ * @return true     trace copiado
+ * @return false    posição sem trace
+ */
+bool plc_trace_get(uint32_t index, plcTrace_t * tracePtr)
+{
+  bool result = false;
+
+  xSemaphoreTake(traceMutex, portMAX_DELAY);
+  if (index < traceCount)
+  {
+    *tracePtr = traceRing[(traceHead + PLC_TRACE_RING_SIZE - 1 - index) % PLC_TRACE_RING_SIZE];
+    result = true;
+  }
+  xSemaphoreGive(traceMutex);
+
+  return result;
+}
+
+/**
+ * Nome de exibição de uma etapa
+ * 
+ * @param stage         etapa
+ * @return const char*  nome
+ */
+const char * plc_trace_stage_name(plcTraceStage_t stage)
+{
+  return stageNames[stage];
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,79 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_TRACE_H
+#define PLC_TRACE_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Quantidade de traces finalizados mantidos para consulta */
+#ifndef PLC_TRACE_RING_SIZE
+#define PLC_TRACE_RING_SIZE         16
+#endif
+/* Tamanho da URI armazenada no trace */
+#define PLC_TRACE_URI_SIZE          32
+/* Tamanho suficiente para o header Server-Timing de todas as etapas */
+#define PLC_TRACE_SERVER_TIMING_SIZE 160
+
+/* Etapas de uma requisição, na ordem em que ocorrem */
+typedef enum plcTraceStage_t
+{
+  /* Leitura do body HTTP */
+  PLC_TRACE_STAGE_READ = 0,
+  /* Decodificação do JSON */
+  PLC_TRACE_STAGE_DECODE,
+  /* Espera pela liberação da UART */
+  PLC_TRACE_STAGE_QUEUE,
+  /* Escrita do comando no driver, todas as tentativas */
+  PLC_TRACE_STAGE_TX,
+  /* Resposta do módulo na tentativa bem sucedida */
+  PLC_TRACE_STAGE_MODULE,
+  /* Tempo perdido em tentativas sem resposta */
+  PLC_TRACE_STAGE_RETRY,
+  PLC_TRACE_STAGE_COUNT,
+} plcTraceStage_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Contexto de uma requisição, alocado na pilha do handler */
+typedef struct plcTrace_t
+{
+  uint32_t id;
+  char uri[PLC_TRACE_URI_SIZE];
+  int64_t startUs;
+  int64_t lastMarkUs;
+  /* Duração de cada etapa em microssegundos */
+  uint32_t stageUs[PLC_TRACE_STAGE_COUNT];
+  uint32_t totalUs;
+  uint32_t retries;
+  bool result;
+} plcTrace_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_trace_init(void);
+void plc_trace_begin(plcTrace_t * tracePtr, const char * uriPtr);
+void plc_trace_mark(plcTrace_t * tracePtr, plcTraceStage_t stage);
+void plc_trace_add(plcTrace_t * tracePtr, plcTraceStage_t stage, int64_t elapsedUs);
+void plc_trace_retry(plcTrace_t * tracePtr);
+void plc_trace_end(plcTrace_t * tracePtr, bool result);
+size_t plc_trace_server_timing(const plcTrace_t * tracePtr, char * bufferPtr, size_t bufferSize);
+bool plc_trace_get(uint32_t index, plcTrace_t * tracePtr);
+const char * plc_trace_stage_name(plcTraceStage_t stage);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
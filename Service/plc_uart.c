@@ -16,22 +16,60 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-#include "esp_log.h"
+#include "deferred_log.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
+#include "plc_uart_stats.h"
+#include "plc_uart_capture.h"
+#include "plc_uart_parser.h"
+#include "plc_health.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
-#define UART_PLC_NUM            UART_NUM_1
 #define UART_PLC_BUFFER_SIZE    1024
 #define MAX_UART_SEND_RETRY     5
 #define MAX_UART_RESPONSE_RETRY 10
 #define WAIT_RESPONSE_TIME      (100 / portTICK_PERIOD_MS)
 #define UART_EVENT_QUEUE_SIZE   20
-#define UART_PLC_TX_PIN         GPIO_NUM_22
-#define UART_PLC_RX_PIN         GPIO_NUM_23
+/* Maior linha recebida do módulo, com terminador. Excedente descartado */
+#define UART_LINE_SIZE          256
+#if (PLC_UART_PORT_COUNT < 1) || (PLC_UART_PORT_COUNT > PLC_UART_PORT_MAX)
+#error "PLC_UART_PORT_COUNT deve estar entre 1 e PLC_UART_PORT_MAX"
+#endif
+/* Log adiado, formatação fora da task UART */
+#define UART_LOGI(format, text, ...) DEFERRED_LOGI(DEFERRED_LOG_MODULE_PLC_UART, format, text, ##__VA_ARGS__)
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
+/* Interface e pinos de uma porta */
+typedef struct plcUartPortConfig_t
+{
+    uart_port_t uartNum;
+    gpio_num_t txPin;
+    gpio_num_t rxPin;
+    const char * taskNamePtr;
+} plcUartPortConfig_t;
+
+/* Contexto de uma porta: um módulo PLC, uma task de recepção e um comando em andamento */
+typedef struct plcUartPort_t
+{
+    uint32_t index;
+    const plcUartPortConfig_t * configPtr;
+    QueueHandle_t eventQueue;
+    uint8_t buffer[UART_PLC_BUFFER_SIZE];
+    /* Linha em montagem, pode chegar dividida entre eventos UART */
+    char line[UART_LINE_SIZE];
+    size_t lineLength;
+    /* Fila de comandos: tomado pelo remetente, liberado pela task ao receber o resultado */
+    SemaphoreHandle_t responseSemaphore;
+    uartPlcResponse_t * responsePtr;
+    /* Marcas de tempo da resposta em andamento, escritas pela task UART */
+    volatile int64_t firstByteUs;
+    volatile int64_t resultUs;
+    /* Última linha de dados recebida, resposta ainda em andamento */
+    volatile int64_t lastLineUs;
+} plcUartPort_t;
+
 typedef struct queueCommandResponse_t
 {
     char * namePtr;
@@ -43,88 +81,116 @@ typedef struct queueCommandResponse_t
 /*******************************************************************************
 * CONSTANTES
 *******************************************************************************/
-/* Identificador LOG */
-static const char *TAG = "PLC_CONFIG_SERVICE";
+/* Portas disponíveis, UART0 reservada ao console */
+static const plcUartPortConfig_t portConfigs[PLC_UART_PORT_MAX] = {
+    { .uartNum = UART_NUM_1, .txPin = GPIO_NUM_22, .rxPin = GPIO_NUM_23, .taskNamePtr = "plc_uart_task" },
+    { .uartNum = UART_NUM_2, .txPin = GPIO_NUM_17, .rxPin = GPIO_NUM_16, .taskNamePtr = "plc_uart_task_1" },
+};
 
 /*******************************************************************************
 * VARIÁVEIS
 *******************************************************************************/
-static QueueHandle_t uartPlcHandler;
-static uint8_t uartPlcBuffer[UART_PLC_BUFFER_SIZE];
-static SemaphoreHandle_t uartResponseSemaphore;
-static uartPlcResponse_t * uartResponsePtr;
+static plcUartPort_t ports[PLC_UART_PORT_COUNT];
 /*******************************************************************************
 * PROTÓTIPOS DE FUNÇÕES
 *******************************************************************************/
 static void plc_uart_task(void *pvParameters);
-static bool uart_send(const char *sendBufferPtr, size_t size);
-static void parse_uart_data(uint8_t * bufferOutPtr, size_t bytesReceived);
-static bool wait_for_response(void);
-static bool parse_result(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr);
-static bool parse_notification(const char * bufferRxPtr);
-static void parse_response(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr);
-static void config_plc_uart(void);
+static bool uart_send(plcUartPort_t * portPtr, const char *sendBufferPtr, size_t size);
+static void parse_uart_data(plcUartPort_t * portPtr, size_t bytesReceived);
+static void parse_uart_line(plcUartPort_t * portPtr);
+static bool wait_for_response(plcUartPort_t * portPtr);
+static void config_plc_uart(plcUartPort_t * portPtr);
+static bool send_command(plcUartPort_t * portPtr, const char * sendBufferPtr, uartPlcResponse_t * responsePtr);
+static bool take_port(plcUartPort_t * portPtr, int64_t deadlineUs);
+static bool deadline_passed(int64_t deadlineUs);
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 
 /**
- * Inicializa UART e configura sistemas de controle
+ * Inicializa UARTs e configura sistemas de controle de cada porta
  * 
  */
 void plc_uart_init(void)
 {
-    /* Inicializa interface ESP */
-    config_plc_uart();
+    /* Captura de tráfego, desabilitada até POST /debug/uart/capture */
+    plc_uart_capture_init();
+
+    for (uint32_t port = 0; port < PLC_UART_PORT_COUNT; port++)
+    {
+        plcUartPort_t * portPtr = &ports[port];
+        portPtr->index = port;
+        portPtr->configPtr = &portConfigs[port];
 
-    /* Cria semáforo de envio */
-    uartResponseSemaphore = xSemaphoreCreateBinary();
-    xSemaphoreGive(uartResponseSemaphore);
+        /* Inicializa interface ESP */
+        config_plc_uart(portPtr);
 
-    /* Cria task de controle da interface UART */
-    xTaskCreate(plc_uart_task, "plc_uart_task", 4096, NULL, 12, NULL);
+        /* Cria semáforo de envio */
+        portPtr->responseSemaphore = xSemaphoreCreateBinary();
+        xSemaphoreGive(portPtr->responseSemaphore);
+
+        /* Task de controle da interface UART, portas distribuídas entre os núcleos */
+        xTaskCreatePinnedToCore(plc_uart_task, portPtr->configPtr->taskNamePtr, 4096, portPtr, 12, NULL,
+                                port % portNUM_PROCESSORS);
+    }
 }
 
 /**
- * Envia comando buffer para a UART PLC
+ * Envia comando buffer para o módulo PLC de uma porta. Comandos em portas
+ * diferentes são executados em paralelo. Com o módulo em recuperação o
+ * comando aguarda o watchdog (plc_health.h)
  * 
+ * Com responsePtr->deadlineUs definido, o comando é descartado se o prazo
+ * esgotar antes do envio e não é reenviado após o prazo, responsePtr->expired
+ * indica o cancelamento. Um comando já enviado aguarda sua resposta
+ * 
+ * @param port              porta do módulo, 0 .. PLC_UART_PORT_COUNT - 1
  * @param sendBufferPtr     buffer a ser enviado
  * @param responsePtr       estrutura de preenchimento da resposta
  */
-void plc_uart_send(const void *sendBufferPtr, uartPlcResponse_t * responsePtr)
+void plc_uart_send(uint32_t port, const void *sendBufferPtr, uartPlcResponse_t * responsePtr)
 {
-    /* Aguarda não ter um tratamento de comando em andamento */
-    xSemaphoreTake(uartResponseSemaphore, portMAX_DELAY);
-
-    /* Copia estrutura de resposta para variável local, a ser escrita de maneira assíncrona */
-    uartResponsePtr = responsePtr;
-
-    /* Envia comando */
-    bool result = uart_send(sendBufferPtr, strlen(sendBufferPtr));
-
-    if (result == false)
+    if (port >= PLC_UART_PORT_COUNT)
     {
-        /* Falha interface UART, finaliza execução */
-        uartResponsePtr->result = false;
-        xSemaphoreGive(uartResponseSemaphore);
+        /* Porta inexistente */
+        responsePtr->result = false;
         return;
     }
 
-    /* Comando colocado na fila, aguarda e valida resposta */
-    static uint32_t attemptsResponse;
-    attemptsResponse = attemptsResponse == 0 ? MAX_UART_SEND_RETRY : attemptsResponse;
-    if (wait_for_response() == false)
-    {
-        /* Tempo para aguarde da resposta esgotado, realiza retry */
-        ESP_LOGI(TAG, "Retry TX UART[%d]", UART_PLC_NUM);
-        xSemaphoreGive(uartResponseSemaphore);
+    plc_uart_stats_pending_enter();
 
-        if (--attemptsResponse != 0)
+    if (plc_health_wait_ready(port, responsePtr->deadlineUs) == false)
+    {
+        /* Módulo não recuperado no tempo de espera, não ocupa a UART */
+        responsePtr->result = false;
+        responsePtr->expired = deadline_passed(responsePtr->deadlineUs);
+        if (responsePtr->expired)
         {
-            /* Utiliza função de maneira recursiva */
-            plc_uart_send(sendBufferPtr, responsePtr);
+            plc_uart_stats_count_cancel(plc_uart_stats_classify(sendBufferPtr), false);
         }
+        plc_uart_stats_pending_leave();
+        return;
     }
+
+    const bool responded = send_command(&ports[port], sendBufferPtr, responsePtr);
+    plc_uart_stats_pending_leave();
+
+    /* Cancelamento pelo prazo não indica falha do módulo */
+    if (responsePtr->expired == false)
+    {
+        plc_health_report(port, responded);
+    }
+}
+
+/**
+ * Recupera quantidade de eventos do driver UART aguardando tratamento
+ * 
+ * @param port      porta do módulo
+ * @return uint32_t quantidade de eventos
+ */
+uint32_t plc_uart_get_event_queue_depth(uint32_t port)
+{
+    return (port < PLC_UART_PORT_COUNT) ? uxQueueMessagesWaiting(ports[port].eventQueue) : 0;
 }
 
 /*******************************************************************************
@@ -132,10 +198,163 @@ void plc_uart_send(const void *sendBufferPtr, uartPlcResponse_t * responsePtr)
 *******************************************************************************/
 
 /**
- * Configura interface baixo nível UART ESP 
+ * Envia comando e aguarda resultado, com retry e medição de cada etapa
+ * 
+ * @param portPtr           porta do módulo
+ * @param sendBufferPtr     buffer a ser enviado
+ * @param responsePtr       estrutura de preenchimento da resposta
+ * @return true             linha de resultado recebida do módulo
+ * @return false            falha de escrita ou tentativas esgotadas
+ */
+static bool send_command(plcUartPort_t * portPtr, const char * sendBufferPtr, uartPlcResponse_t * responsePtr)
+{
+    const int64_t requestUs = esp_timer_get_time();
+    /* Início do primeiro envio, base do tempo de UART ocupado pelo comando */
+    int64_t firstTxUs = 0;
+    const plcUartCommandClass_t commandClass = plc_uart_stats_classify(sendBufferPtr);
+    plc_uart_stats_count_sent(commandClass);
+
+    for (uint32_t attempt = 0; attempt < MAX_UART_SEND_RETRY; attempt++)
+    {
+        /* Aguarda não ter um tratamento de comando em andamento, até o prazo */
+        if (take_port(portPtr, responsePtr->deadlineUs) == false)
+        {
+            /* Prazo esgotado na fila ou antes do reenvio, não ocupa a UART */
+            responsePtr->result = false;
+            responsePtr->expired = true;
+            plc_uart_stats_count_cancel(commandClass, attempt != 0);
+            if (attempt != 0)
+            {
+                plc_uart_stats_count_result(commandClass, false, false);
+                plc_uart_stats_record_service(esp_timer_get_time() - firstTxUs);
+            }
+            return false;
+        }
+
+        const int64_t txStartUs = esp_timer_get_time();
+        if (attempt == 0)
+        {
+            firstTxUs = txStartUs;
+            plc_uart_stats_record(commandClass, PLC_UART_STAGE_QUEUE, txStartUs - requestUs);
+            plc_trace_add(responsePtr->tracePtr, PLC_TRACE_STAGE_QUEUE, txStartUs - requestUs);
+        }
+
+        /* Copia estrutura de resposta para variável local, a ser escrita de maneira assíncrona */
+        portPtr->responsePtr = responsePtr;
+        portPtr->firstByteUs = 0;
+        portPtr->resultUs = 0;
+        portPtr->lastLineUs = 0;
+
+        /* Envia comando */
+        bool result = uart_send(portPtr, sendBufferPtr, strlen(sendBufferPtr));
+        const int64_t txEndUs = esp_timer_get_time();
+        plc_uart_stats_record(commandClass, PLC_UART_STAGE_TX, txEndUs - txStartUs);
+        plc_trace_add(responsePtr->tracePtr, PLC_TRACE_STAGE_TX, txEndUs - txStartUs);
+
+        if (result == false)
+        {
+            /* Falha interface UART, finaliza execução */
+            responsePtr->result = false;
+            xSemaphoreGive(portPtr->responseSemaphore);
+            plc_uart_stats_count_result(commandClass, true, false);
+            return false;
+        }
+
+        /* Comando colocado na fila, aguarda e valida resposta */
+        if (wait_for_response(portPtr) == true)
+        {
+            /* Marcas de tempo escritas pela task UART antes de liberar o semáforo */
+            if (portPtr->firstByteUs != 0)
+            {
+                plc_uart_stats_record(commandClass, PLC_UART_STAGE_FIRST_BYTE, portPtr->firstByteUs - txStartUs);
+            }
+            plc_uart_stats_record(commandClass, PLC_UART_STAGE_RESULT, portPtr->resultUs - txStartUs);
+            plc_trace_add(responsePtr->tracePtr, PLC_TRACE_STAGE_MODULE, esp_timer_get_time() - txEndUs);
+            plc_uart_stats_count_result(commandClass, true, responsePtr->result);
+            plc_uart_stats_record_service(esp_timer_get_time() - firstTxUs);
+            return true;
+        }
+
+        /* Tempo para aguarde da resposta esgotado, realiza retry. Linhas
+           atrasadas não são mais escritas na resposta do remetente */
+        UART_LOGI("Retry TX UART[%u]", NULL, portPtr->configPtr->uartNum);
+        portPtr->responsePtr = NULL;
+        xSemaphoreGive(portPtr->responseSemaphore);
+        plc_trace_add(responsePtr->tracePtr, PLC_TRACE_STAGE_RETRY, esp_timer_get_time() - txEndUs);
+
+        if ((responsePtr->lineSink != NULL) && (portPtr->lastLineUs != 0))
+        {
+            /* Linhas já entregues ao destino, reenvio duplicaria a resposta */
+            break;
+        }
+
+        if (((attempt + 1) < MAX_UART_SEND_RETRY) && (deadline_passed(responsePtr->deadlineUs) == false))
+        {
+            plc_uart_stats_count_retry(commandClass);
+            plc_trace_retry(responsePtr->tracePtr);
+        }
+    }
+
+    /* Tentativas esgotadas sem resultado */
+    plc_uart_stats_count_result(commandClass, false, false);
+    plc_uart_stats_record_service(esp_timer_get_time() - firstTxUs);
+    return false;
+}
+
+/**
+ * Toma a porta para envio de um comando, esperando no máximo até o prazo
  * 
+ * @param portPtr     porta do módulo
+ * @param deadlineUs  prazo absoluto, 0 = sem prazo
+ * @return true       porta tomada dentro do prazo
+ * @return false      prazo esgotado, porta não tomada
  */
-static void config_plc_uart(void)
+static bool take_port(plcUartPort_t * portPtr, int64_t deadlineUs)
+{
+    if (deadlineUs == 0)
+    {
+        return xSemaphoreTake(portPtr->responseSemaphore, portMAX_DELAY) == pdPASS;
+    }
+
+    const int64_t remainingUs = deadlineUs - esp_timer_get_time();
+    if (remainingUs <= 0)
+    {
+        return false;
+    }
+
+    if (xSemaphoreTake(portPtr->responseSemaphore, (remainingUs / 1000) / portTICK_PERIOD_MS) != pdPASS)
+    {
+        return false;
+    }
+
+    /* Arredondamento em ticks, revalida prazo antes de ocupar a UART */
+    if (deadline_passed(deadlineUs))
+    {
+        xSemaphoreGive(portPtr->responseSemaphore);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Verifica se o prazo de um comando esgotou
+ * 
+ * @param deadlineUs  prazo absoluto, 0 = sem prazo
+ * @return true       prazo esgotado
+ * @return false      dentro do prazo ou sem prazo
+ */
+static bool deadline_passed(int64_t deadlineUs)
+{
+    return (deadlineUs != 0) && (esp_timer_get_time() >= deadlineUs);
+}
+
+/**
+ * Configura interface baixo nível UART ESP de uma porta
+ * 
+ * @param portPtr   porta a ser configurada
+ */
+static void config_plc_uart(plcUartPort_t * portPtr)
 {
     /* Template de configuração da UART */
     uart_config_t config = {
@@ -147,22 +366,23 @@ static void config_plc_uart(void)
         .source_clk = UART_SCLK_REF_TICK,
     };
 
-    ESP_ERROR_CHECK(uart_param_config(UART_PLC_NUM, &config));
+    const uart_port_t uartNum = portPtr->configPtr->uartNum;
+    ESP_ERROR_CHECK(uart_param_config(uartNum, &config));
 
     /* Instala tratamento */
     ESP_ERROR_CHECK(uart_driver_install(
-        UART_PLC_NUM,
+        uartNum,
         UART_PLC_BUFFER_SIZE,
         UART_PLC_BUFFER_SIZE,
         UART_EVENT_QUEUE_SIZE,
-        &uartPlcHandler,
+        &portPtr->eventQueue,
         0)
     );
 
     /* Define pinos para TX e RX */
     ESP_ERROR_CHECK(uart_set_pin(
-        UART_PLC_NUM,
-        UART_PLC_TX_PIN, UART_PLC_RX_PIN,
+        uartNum,
+        portPtr->configPtr->txPin, portPtr->configPtr->rxPin,
         UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE)
     );
 }
@@ -170,18 +390,19 @@ static void config_plc_uart(void)
 /**
  * Envia buffer para UART baixo nível ESP 
  * 
+ * @param portPtr           Porta de envio
  * @param sendBufferPtr     Buffer a ser enviado
  * @param size              Tamanho do buffer para enviar
  * @return true             Bytes colocados na fila para escrita
  * @return false            Falha interface ESP
  */
-static bool uart_send(const char *sendBufferPtr, size_t size)
+static bool uart_send(plcUartPort_t * portPtr, const char *sendBufferPtr, size_t size)
 {
-    static uint32_t attemptsTx;
-    attemptsTx = MAX_UART_SEND_RETRY;
+    const uart_port_t uartNum = portPtr->configPtr->uartNum;
+    uint32_t attemptsTx = MAX_UART_SEND_RETRY;
     for (;attemptsTx != 0;)
     {
-        int32_t bytesSent = uart_write_bytes(UART_PLC_NUM, sendBufferPtr, strlen(sendBufferPtr));
+        int32_t bytesSent = uart_write_bytes(uartNum, sendBufferPtr, strlen(sendBufferPtr));
         if (bytesSent < 0)
         {
             /* Falha colocar na fila, executa loop novamente */
@@ -190,27 +411,37 @@ static bool uart_send(const char *sendBufferPtr, size_t size)
         }
 
         /* Bytes colocados na fila, retorna sucesso */
-        ESP_LOGI(TAG, "TX UART[%d] SENT: %s", UART_PLC_NUM, sendBufferPtr);
+        plc_uart_capture_record(portPtr->index, PLC_UART_CAPTURE_TX, (const uint8_t *)sendBufferPtr, bytesSent);
+        UART_LOGI("TX UART[%u] SENT: %s", sendBufferPtr, uartNum);
         return true;
     }
 
-    ESP_LOGI(TAG, "TX UART[%d] FAIL: %s", UART_PLC_NUM, sendBufferPtr);
+    UART_LOGI("TX UART[%u] FAIL: %s", sendBufferPtr, uartNum);
     return false;
 }
 
 /**
  * Aguarda semaforo de envio e tratamento UART ser liberado 
  * 
+ * @param portPtr   porta do comando em andamento
  * @return true     Processamento concluído 
  * @return false    Falha no processamento
  */
-static bool wait_for_response(void)
+static bool wait_for_response(plcUartPort_t * portPtr)
 {
-    static uint32_t attemptsRx;
-    attemptsRx = MAX_UART_SEND_RETRY * 2;
+    uint32_t attemptsRx = MAX_UART_SEND_RETRY * 2;
+    int64_t lastLineUs = 0;
 
-    while(xSemaphoreTake(uartResponseSemaphore, WAIT_RESPONSE_TIME) != pdPASS)
+    while(xSemaphoreTake(portPtr->responseSemaphore, WAIT_RESPONSE_TIME) != pdPASS)
     {
+        if (portPtr->lastLineUs != lastLineUs)
+        {
+            /* Resposta longa ainda chegando, espera contada a partir da última linha */
+            lastLineUs = portPtr->lastLineUs;
+            attemptsRx = MAX_UART_SEND_RETRY * 2;
+            continue;
+        }
+
         if (--attemptsRx == 0)
         {
             /* Wait loop esgotado */
@@ -218,44 +449,55 @@ static bool wait_for_response(void)
         }
     }
 
+    /* Resposta concluída, dados após o resultado não pertencem ao remetente */
+    portPtr->responsePtr = NULL;
+
     /* Libera semaforo */
-    return (xSemaphoreGive(uartResponseSemaphore) == pdPASS);
+    return (xSemaphoreGive(portPtr->responseSemaphore) == pdPASS);
 }
 
 /**
- * Task de controle eventos UART
+ * Task de controle eventos UART, uma por porta
  * 
- * @param pvParameters  
+ * @param pvParameters  contexto da porta
  */
 static void plc_uart_task(void *pvParameters)
 {
+    plcUartPort_t * portPtr = pvParameters;
+    const uart_port_t uartNum = portPtr->configPtr->uartNum;
     uart_event_t event;
     while (true)
     {
         //Waiting for UART event.
-        if (xQueueReceive(uartPlcHandler, (void *)&event, (portTickType)portMAX_DELAY))
+        if (xQueueReceive(portPtr->eventQueue, (void *)&event, (portTickType)portMAX_DELAY))
         {
-            bzero(uartPlcBuffer, UART_PLC_BUFFER_SIZE);
-            ESP_LOGI(TAG, "UART[%d] event, size: %u", UART_PLC_NUM, event.size);
+            bzero(portPtr->buffer, UART_PLC_BUFFER_SIZE);
+            UART_LOGI("UART[%u] event, size: %u", NULL, uartNum, event.size);
             switch (event.type)
             {
                 case UART_DATA:
-                    parse_uart_data(uartPlcBuffer, event.size);
+                    if (portPtr->firstByteUs == 0)
+                    {
+                        portPtr->firstByteUs = esp_timer_get_time();
+                    }
+                    parse_uart_data(portPtr, event.size);
                     break;
                 case UART_FIFO_OVF:
-                    ESP_LOGI(TAG, "HW FIFO overflow");
-                    /* Buffer recepção estourado */
-                    uart_flush_input(UART_PLC_NUM);
-                    xQueueReset(uartPlcHandler);
+                    UART_LOGI("HW FIFO overflow", NULL);
+                    /* Buffer recepção estourado, linha em montagem incompleta */
+                    uart_flush_input(uartNum);
+                    portPtr->lineLength = 0;
+                    xQueueReset(portPtr->eventQueue);
                     break;
                 case UART_BUFFER_FULL:
                     /* Buffer aplicação estourado */
-                    ESP_LOGI(TAG, "ring buffer full");
-                    uart_flush_input(UART_PLC_NUM);
-                    xQueueReset(uartPlcHandler);
+                    UART_LOGI("ring buffer full", NULL);
+                    uart_flush_input(uartNum);
+                    portPtr->lineLength = 0;
+                    xQueueReset(portPtr->eventQueue);
                     break;
                 default:
-                    ESP_LOGI(TAG, "uart event type: %d", event.type);
+                    UART_LOGI("uart event type: %d", NULL, event.type);
                     break;
                 }
         }
@@ -263,130 +505,83 @@ static void plc_uart_task(void *pvParameters)
 }
 
 /**
- * Realiza leitura do buffer de recepção e trata dados
+ * Realiza leitura do buffer de recepção da porta e trata cada linha
+ * completa. Linha sem terminador aguarda o próximo evento
  * 
- * @param bufferOutPtr  Buffer para tratar
+ * @param portPtr       Porta com dados recebidos
  * @param bytesReceived Tamanho do tratamento
  */
-static void parse_uart_data(uint8_t * bufferOutPtr, size_t bytesReceived)
+static void parse_uart_data(plcUartPort_t * portPtr, size_t bytesReceived)
 {
-    uart_read_bytes(UART_PLC_NUM, bufferOutPtr, bytesReceived, portMAX_DELAY);
-    char * data = strtok((char *)bufferOutPtr, "\r\n");
-    char cmdData[128];
-    for (;data != NULL && data[0] != '\0';)
+    uint8_t * bufferOutPtr = portPtr->buffer;
+    int32_t bytesRead = uart_read_bytes(portPtr->configPtr->uartNum, bufferOutPtr, bytesReceived, portMAX_DELAY);
+    if (bytesRead > 0)
     {
-        bzero(cmdData, sizeof(cmdData));
-        strcpy(cmdData, data);
-
-        ESP_LOGI(TAG, "TX UART[%u] DATA TO PARSE: %s", UART_PLC_NUM, data);
+        plc_uart_capture_record(portPtr->index, PLC_UART_CAPTURE_RX, bufferOutPtr, bytesRead);
+    }
 
-        if (parse_result(&cmdData[0], uartResponsePtr) == true)
+    for (int32_t index = 0; index < bytesRead; index++)
+    {
+        const char data = bufferOutPtr[index];
+        if ((data != '\r') && (data != '\n'))
         {
-            /* Processou resultado, finaliza tratamento */
-            xSemaphoreGive(uartResponseSemaphore);
-            break;
+            /* Linha maior que o buffer é truncada */
+            if (portPtr->lineLength < (UART_LINE_SIZE - 1))
+            {
+                portPtr->line[portPtr->lineLength++] = data;
+            }
+            continue;
         }
 
-        if (parse_notification(&cmdData[0]) == true)
+        if (portPtr->lineLength != 0)
         {
-            /* Processou notificação, finaliza tratamento */
-            break;
+            portPtr->line[portPtr->lineLength] = '\0';
+            parse_uart_line(portPtr);
+            portPtr->lineLength = 0;
         }
-
-        /* Procesa linha como dado de resposta para um comando */
-        parse_response(&cmdData[0], uartResponsePtr);
-
-        /* Processa proxima linha da resposta */
-        data = strtok(NULL, "\r\n");
     }
 }
 
 /**
- * Realiza tratamento mensagem de resultado
+ * Trata linha completa recebida do módulo
  * 
- * @param bufferRxPtr       Buffer a ser tratado
- * @param uartResponsePtr   Estrutura de resultado
- * @return true             Buffer tratado
- * @return false            Dados não são de resultados. Não tratado
+ * @param portPtr       Porta com a linha montada
  */
-static bool parse_result(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr)
-{    
-    if (strstr(bufferRxPtr, "ERROR") != NULL || strstr(bufferRxPtr, "FAIL") != NULL)
+static void parse_uart_line(plcUartPort_t * portPtr)
+{
+    const char * linePtr = portPtr->line;
+    UART_LOGI("TX UART[%u] DATA TO PARSE: %s", linePtr, portPtr->configPtr->uartNum);
+
+    const plcUartLine_t line = plc_uart_parser_line(linePtr, portPtr->responsePtr);
+
+    if (line == PLC_UART_LINE_RESULT)
     {
-        if (uartResponsePtr != NULL)
+        /* Processou resultado, linhas seguintes não pertencem ao remetente */
+        UART_LOGI("Result: %s", linePtr);
+        portPtr->resultUs = esp_timer_get_time();
+        if (portPtr->responsePtr != NULL)
         {
-            uartResponsePtr->result = false;
+            portPtr->responsePtr = NULL;
+            xSemaphoreGive(portPtr->responseSemaphore);
         }
-        ESP_LOGI(TAG, "Falha notificada pelo módulo");
-        /* Processamento com sucesso */
-        return true;
+        return;
     }
 
-    char * resultOk = strstr(bufferRxPtr, "OK");
-    if (resultOk != NULL)
+    if (line == PLC_UART_LINE_NOTIFICATION)
     {
-        
-        if (uartResponsePtr != NULL)
-        {
-            uartResponsePtr->result = true;
-        }
-        
-        ESP_LOGI(TAG, "Sucesso comando, %s", resultOk);
-        /* Processamento com sucesso */
-        return true;
+        /* Processou notificação */
+        UART_LOGI("Notification: %s", linePtr);
+        plc_health_notification(portPtr->index, linePtr);
+        return;
     }
 
-    return false;
-}
-
-/**
- * Realiza tratamento mensagem de notificação
- * 
- * @param bufferRxPtr       Buffer a ser tratado
- * @return true             Buffer tratado
- * @return false            Dados não são de resultados. Não tratado
- */
-static bool parse_notification(const char * bufferRxPtr)
-{
-    if (strchr(bufferRxPtr, ':') == NULL)
+    if (portPtr->responsePtr != NULL)
     {
-        /* Como não tem dados no tratamento, ":", comando é de notificação */
-        ESP_LOGI(TAG, "Notification: %s", bufferRxPtr);
-        return true;
+        /* Linha de dados de resposta em andamento */
+        portPtr->lastLineUs = esp_timer_get_time();
     }
-
-    return false;
 }
 
-/**
- * Realiza tratamento mensagem de resposta de comando
- * 
- * @param bufferRxPtr       Buffer a ser tratado
- * @param uartResponsePtr   Estrutura de resultado
- */
-static void parse_response(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr)
-{
-    /* Recupera posição do separador entre <COMANDO>:<DATA> */
-    char * atCmdDividerPtr = strchr(bufferRxPtr, ':');
-
-    ESP_LOGI(TAG, "TX UART[%u] response foo: %s", UART_PLC_NUM, bufferRxPtr);
-
-    if ((uartResponsePtr != NULL) && (atCmdDividerPtr != NULL))
-    {
-        /* Copia dados de comando, formato -> "XX:yy". Sendo XX = comando respondido */
-        strncpy(&uartResponsePtr->command[0], &bufferRxPtr[1], strlen(&bufferRxPtr[1]) - strlen(atCmdDividerPtr));
-
-        ESP_LOGI(TAG, "AT Command: %s", uartResponsePtr->command);
-
-        /* Copia dados de respondidos, formato -> "XX:yy". Sendo yy = dados respondido */
-        strcpy(&uartResponsePtr->data[uartResponsePtr->lineCounter][0], &atCmdDividerPtr[1]);
-
-        ESP_LOGI(TAG, "AT Data: %s", uartResponsePtr->data[uartResponsePtr->lineCounter]); 
-
-        /* Linha de resposta tratada */
-        uartResponsePtr->lineCounter++;
-    }        
-}
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
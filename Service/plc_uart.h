@@ -13,27 +13,49 @@
 *******************************************************************************/
 #include <stdbool.h>
 #include <stdint.h>
+#include "plc_trace.h"
 
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Portas UART em uso, cada uma com um módulo PLC (uma rede elétrica) */
+#ifndef PLC_UART_PORT_COUNT
+#define PLC_UART_PORT_COUNT     1
+#endif
+/* Portas com pinos definidos em plc_uart.c */
+#define PLC_UART_PORT_MAX       2
+/* Porta de comandos sem rede definida e de MACs fora da topologia */
+#define PLC_UART_PORT_DEFAULT   0
 
 /*******************************************************************************
 * TYPEDEFS
 *******************************************************************************/
+/* Recebe cada linha da resposta exceto a de resultado, inclusive sem ":" e além de data[], na task UART */
+typedef void (*plcUartLineSink_t)(const char * linePtr, void * contextPtr);
+
 typedef struct uartPlcResponse_t
 {
   char command [50];
   char data [5][128];
   uint32_t lineCounter;
   bool result;
+  /* Trace da requisição de origem, NULL = sem trace */
+  plcTrace_t * tracePtr;
+  /* Prazo absoluto (esp_timer_get_time) do comando, 0 = sem prazo */
+  int64_t deadlineUs;
+  /* Comando cancelado pelo prazo, antes do envio ou sem os reenvios */
+  bool expired;
+  /* Destino opcional das linhas de dados, NULL = somente data[] */
+  plcUartLineSink_t lineSink;
+  void * lineContextPtr;
 } uartPlcResponse_t;
 
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
 void plc_uart_init(void);
-void plc_uart_send(const void *sendBufferPtr, uartPlcResponse_t * responsePtr);
+void plc_uart_send(uint32_t port, const void *sendBufferPtr, uartPlcResponse_t * responsePtr);
+uint32_t plc_uart_get_event_queue_depth(uint32_t port);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
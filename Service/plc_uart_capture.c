@@ -0,0 +1,459 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_uart_capture.h"
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Versão do formato do arquivo */
+#define FILE_VERSION        1
+/* Flag do cabeçalho: registros iniciais lidos da flash */
+#define FILE_FLAG_SPILL     0x01
+/* Setor de apagamento da flash */
+#define SECTOR_SIZE         4096
+/* Intervalo entre transferências da RAM para a flash */
+#define SPILL_PERIOD_MS     50
+/* Maior registro, incluindo cabeçalho */
+#define MAX_RECORD_SIZE     (PLC_UART_CAPTURE_RECORD_HEADER_SIZE + PLC_UART_CAPTURE_MAX_DATA)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+/* Identificador LOG */
+static const char *TAG = "PLC_UART_CAPTURE";
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Registros em RAM, posições lógicas crescentes: tail = registro mais antigo */
+static uint8_t ramRing[PLC_UART_CAPTURE_RAM_SIZE];
+static uint32_t ringHead;
+static uint32_t ringTail;
+/* Estado da captura */
+static bool captureEnabled;
+static bool spillEnabled;
+static int64_t captureStartUs;
+static uint32_t captureStartTime;
+static uint32_t recordCount;
+static uint32_t droppedCount;
+/* Partição de spill, NULL = spill indisponível */
+static const esp_partition_t * partitionPtr;
+static uint32_t partitionSize;
+static uint32_t flashUsed;
+/* Buffer da task de spill */
+static uint8_t spillBuffer[MAX_RECORD_SIZE];
+/* Proteção do buffer circular, a task UART não aguarda */
+static SemaphoreHandle_t captureMutex;
+/* Exclusão entre transferência para flash e leitura do arquivo */
+static SemaphoreHandle_t spillMutex;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void spill_task(void *pvParameters);
+static bool spill_step(void);
+static void ring_copy_in(uint32_t position, const uint8_t * dataPtr, size_t length);
+static void ring_copy_out(uint32_t position, uint8_t * dataPtr, size_t length);
+static uint32_t ring_record_size(uint32_t position);
+static size_t ring_read_records(uint32_t * cursorPtr, uint8_t * bufferPtr, size_t bufferSize, uint32_t limit);
+static void put_u32(uint8_t * bufferOutPtr, uint32_t value);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa captura, desabilitada até ser iniciada
+ * 
+ */
+void plc_uart_capture_init(void)
+{
+  captureMutex = xSemaphoreCreateMutex();
+  spillMutex = xSemaphoreCreateMutex();
+
+  partitionPtr = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                          PLC_UART_CAPTURE_PARTITION_LABEL);
+  if (partitionPtr == NULL)
+  {
+    ESP_LOGI(TAG, "Partition '%s' not found, capture limited to RAM", PLC_UART_CAPTURE_PARTITION_LABEL);
+    return;
+  }
+
+  partitionSize = partitionPtr->size - (partitionPtr->size % SECTOR_SIZE);
+  xTaskCreate(spill_task, "uart_capture_task", 2048, NULL, 2, NULL);
+}
+
+/**
+ * Inicia nova captura, descartando a anterior
+ * 
+ * @param spill     transfere registros para a flash
+ * @return true     captura iniciada
+ * @return false    spill solicitado sem partição disponível
+ */
+bool plc_uart_capture_start(bool spill)
+{
+  if (spill && (partitionPtr == NULL))
+  {
+    return false;
+  }
+
+  /* Aguarda transferência ou leitura em andamento */
+  xSemaphoreTake(spillMutex, portMAX_DELAY);
+  xSemaphoreTake(captureMutex, portMAX_DELAY);
+
+  ringHead = 0;
+  ringTail = 0;
+  recordCount = 0;
+  droppedCount = 0;
+  flashUsed = 0;
+  captureStartUs = esp_timer_get_time();
+  captureStartTime = (uint32_t)time(NULL);
+  spillEnabled = spill;
+  __atomic_store_n(&captureEnabled, true, __ATOMIC_RELEASE);
+
+  xSemaphoreGive(captureMutex);
+  xSemaphoreGive(spillMutex);
+
+  ESP_LOGI(TAG, "Capture started, spill %s", spill ? "on" : "off");
+  return true;
+}
+
+/**
+ * Encerra captura, registros permanecem disponíveis para leitura
+ * 
+ */
+void plc_uart_capture_stop(void)
+{
+  __atomic_store_n(&captureEnabled, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * Registra bloco de bytes trafegado. Sem espera: com o buffer em leitura
+ * o bloco é descartado e contabilizado
+ * 
+ * @param port        porta UART PLC do tráfego
+ * @param direction   direção do tráfego
+ * @param dataPtr     bytes trafegados
+ * @param length      quantidade de bytes
+ */
+void plc_uart_capture_record(uint32_t port, plcUartCaptureDirection_t direction, const uint8_t * dataPtr,
+                             size_t length)
+{
+  if (__atomic_load_n(&captureEnabled, __ATOMIC_ACQUIRE) == false)
+  {
+    return;
+  }
+
+  if (xSemaphoreTake(captureMutex, 0) != pdTRUE)
+  {
+    __atomic_fetch_add(&droppedCount, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  if (length > PLC_UART_CAPTURE_MAX_DATA)
+  {
+    length = PLC_UART_CAPTURE_MAX_DATA;
+  }
+
+  /* Libera espaço sobrescrevendo registros mais antigos */
+  const uint32_t recordSize = PLC_UART_CAPTURE_RECORD_HEADER_SIZE + length;
+  while ((PLC_UART_CAPTURE_RAM_SIZE - (ringHead - ringTail)) < recordSize)
+  {
+    ringTail += ring_record_size(ringTail);
+    __atomic_fetch_add(&droppedCount, 1, __ATOMIC_RELAXED);
+  }
+
+  uint8_t header[PLC_UART_CAPTURE_RECORD_HEADER_SIZE];
+  put_u32(header, (uint32_t)(esp_timer_get_time() - captureStartUs));
+  header[4] = direction;
+  header[5] = port;
+  header[6] = length & 0xFF;
+  header[7] = length >> 8;
+
+  ring_copy_in(ringHead, header, sizeof(header));
+  ring_copy_in(ringHead + sizeof(header), dataPtr, length);
+  ringHead += recordSize;
+  recordCount++;
+
+  xSemaphoreGive(captureMutex);
+}
+
+/**
+ * Recupera estado da captura
+ * 
+ * @param statusPtr   estrutura de escrita
+ */
+void plc_uart_capture_get_status(plcUartCaptureStatus_t * statusPtr)
+{
+  xSemaphoreTake(captureMutex, portMAX_DELAY);
+  statusPtr->enabled = captureEnabled;
+  statusPtr->spill = spillEnabled;
+  statusPtr->startTime = captureStartTime;
+  statusPtr->records = recordCount;
+  statusPtr->dropped = __atomic_load_n(&droppedCount, __ATOMIC_RELAXED);
+  statusPtr->ramBytes = ringHead - ringTail;
+  statusPtr->flashBytes = flashUsed;
+  xSemaphoreGive(captureMutex);
+}
+
+/**
+ * Inicia leitura do arquivo de captura. Transferência para a flash fica
+ * suspensa até plc_uart_capture_read_end
+ * 
+ * @param readerPtr   cursor de leitura
+ */
+void plc_uart_capture_read_begin(plcUartCaptureReader_t * readerPtr)
+{
+  xSemaphoreTake(spillMutex, portMAX_DELAY);
+  xSemaphoreTake(captureMutex, portMAX_DELAY);
+
+  readerPtr->headerSent = false;
+  readerPtr->flashOffset = 0;
+  readerPtr->flashEnd = flashUsed;
+  readerPtr->ramCursor = ringTail;
+
+  xSemaphoreGive(captureMutex);
+}
+
+/**
+ * Lê próximo trecho do arquivo: cabeçalho, registros da flash e registros da RAM.
+ * Registros da RAM sobrescritos durante a leitura são pulados
+ * 
+ * @param readerPtr   cursor de leitura
+ * @param bufferPtr   buffer de escrita
+ * @param bufferSize  tamanho do buffer, mínimo de um registro completo
+ * @return size_t     bytes escritos, 0 = fim do arquivo
+ */
+size_t plc_uart_capture_read(plcUartCaptureReader_t * readerPtr, uint8_t * bufferPtr, size_t bufferSize)
+{
+  if (readerPtr->headerSent == false)
+  {
+    memcpy(bufferPtr, "PLCU", 4);
+    bufferPtr[4] = FILE_VERSION;
+    bufferPtr[5] = readerPtr->flashEnd != 0 ? FILE_FLAG_SPILL : 0;
+    bufferPtr[6] = 0;
+    bufferPtr[7] = 0;
+    put_u32(&bufferPtr[8], captureStartTime);
+    put_u32(&bufferPtr[12], __atomic_load_n(&droppedCount, __ATOMIC_RELAXED));
+    readerPtr->headerSent = true;
+    return PLC_UART_CAPTURE_FILE_HEADER_SIZE;
+  }
+
+  if (readerPtr->flashOffset < readerPtr->flashEnd)
+  {
+    /* Flash contém somente registros completos, leitura em trechos livres */
+    size_t length = readerPtr->flashEnd - readerPtr->flashOffset;
+    length = length < bufferSize ? length : bufferSize;
+    if (esp_partition_read(partitionPtr, readerPtr->flashOffset, bufferPtr, length) != ESP_OK)
+    {
+      return 0;
+    }
+    readerPtr->flashOffset += length;
+    return length;
+  }
+
+  xSemaphoreTake(captureMutex, portMAX_DELAY);
+  if ((int32_t)(readerPtr->ramCursor - ringTail) < 0)
+  {
+    /* Registros sobrescritos desde a última leitura */
+    readerPtr->ramCursor = ringTail;
+  }
+  size_t length = ring_read_records(&readerPtr->ramCursor, bufferPtr, bufferSize, bufferSize);
+  xSemaphoreGive(captureMutex);
+
+  return length;
+}
+
+/**
+ * Finaliza leitura, liberando transferência para a flash
+ * 
+ * @param readerPtr   cursor de leitura
+ */
+void plc_uart_capture_read_end(plcUartCaptureReader_t * readerPtr)
+{
+  xSemaphoreGive(spillMutex);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task de transferência dos registros da RAM para a flash
+ * 
+ * @param pvParameters
+ */
+static void spill_task(void *pvParameters)
+{
+  while (true)
+  {
+    vTaskDelay(pdMS_TO_TICKS(SPILL_PERIOD_MS));
+
+    if ((spillEnabled == false) || (xSemaphoreTake(spillMutex, 0) != pdTRUE))
+    {
+      /* Spill desabilitado ou leitura em andamento */
+      continue;
+    }
+
+    while (spill_step())
+    {
+      /* Esvazia RAM até o limite da partição */
+    }
+
+    xSemaphoreGive(spillMutex);
+  }
+}
+
+/**
+ * Transfere um lote de registros completos para a flash
+ * 
+ * @return true     lote transferido
+ * @return false    RAM vazia ou partição cheia
+ */
+static bool spill_step(void)
+{
+  xSemaphoreTake(captureMutex, portMAX_DELAY);
+  uint32_t cursor = ringTail;
+  const size_t length = ring_read_records(&cursor, spillBuffer, sizeof(spillBuffer),
+                                          partitionSize - flashUsed);
+  ringTail = cursor;
+  if ((length == 0) && (ringHead != ringTail))
+  {
+    /* Partição cheia, registros seguintes permanecem somente na RAM */
+    spillEnabled = false;
+    ESP_LOGI(TAG, "Partition full, spill stopped at %u bytes", flashUsed);
+  }
+  xSemaphoreGive(captureMutex);
+
+  if (length == 0)
+  {
+    return false;
+  }
+
+  /* Apaga setores alcançados pela primeira vez */
+  const uint32_t end = flashUsed + length;
+  for (uint32_t sector = (flashUsed + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1); sector < end; sector += SECTOR_SIZE)
+  {
+    esp_partition_erase_range(partitionPtr, sector, SECTOR_SIZE);
+  }
+
+  if (esp_partition_write(partitionPtr, flashUsed, spillBuffer, length) != ESP_OK)
+  {
+    ESP_LOGI(TAG, "Write fail at offset %u", flashUsed);
+    spillEnabled = false;
+    return false;
+  }
+
+  flashUsed = end;
+  return true;
+}
+
+/**
+ * Copia bytes para o buffer circular
+ * 
+ * @param position  posição lógica de escrita
+ * @param dataPtr   bytes a serem copiados
+ * @param length    quantidade de bytes
+ */
+static void ring_copy_in(uint32_t position, const uint8_t * dataPtr, size_t length)
+{
+  const uint32_t index = position % PLC_UART_CAPTURE_RAM_SIZE;
+  const size_t first = (PLC_UART_CAPTURE_RAM_SIZE - index) < length ? (PLC_UART_CAPTURE_RAM_SIZE - index) : length;
+  memcpy(&ramRing[index], dataPtr, first);
+  memcpy(ramRing, &dataPtr[first], length - first);
+}
+
+/**
+ * Copia bytes do buffer circular
+ * 
+ * @param position  posição lógica de leitura
+ * @param dataPtr   buffer de escrita
+ * @param length    quantidade de bytes
+ */
+static void ring_copy_out(uint32_t position, uint8_t * dataPtr, size_t length)
+{
+  const uint32_t index = position % PLC_UART_CAPTURE_RAM_SIZE;
+  const size_t first = (PLC_UART_CAPTURE_RAM_SIZE - index) < length ? (PLC_UART_CAPTURE_RAM_SIZE - index) : length;
+  memcpy(dataPtr, &ramRing[index], first);
+  memcpy(&dataPtr[first], ramRing, length - first);
+}
+
+/**
+ * Tamanho total do registro iniciado em uma posição
+ * 
+ * @param position  posição lógica do cabeçalho
+ * @return uint32_t tamanho com cabeçalho
+ */
+static uint32_t ring_record_size(uint32_t position)
+{
+  uint8_t header[PLC_UART_CAPTURE_RECORD_HEADER_SIZE];
+  ring_copy_out(position, header, sizeof(header));
+  return PLC_UART_CAPTURE_RECORD_HEADER_SIZE + (header[6] | (header[7] << 8));
+}
+
+/**
+ * Copia registros completos a partir de um cursor. Chamar com captureMutex
+ * 
+ * @param cursorPtr   posição lógica, avançada ao fim dos registros copiados
+ * @param bufferPtr   buffer de escrita
+ * @param bufferSize  tamanho do buffer
+ * @param limit       limite adicional de bytes copiados
+ * @return size_t     bytes copiados
+ */
+static size_t ring_read_records(uint32_t * cursorPtr, uint8_t * bufferPtr, size_t bufferSize, uint32_t limit)
+{
+  const size_t maxLength = bufferSize < limit ? bufferSize : limit;
+  size_t length = 0;
+
+  while (*cursorPtr != ringHead)
+  {
+    const uint32_t recordSize = ring_record_size(*cursorPtr);
+    if ((length + recordSize) > maxLength)
+    {
+      break;
+    }
+
+    ring_copy_out(*cursorPtr, &bufferPtr[length], recordSize);
+    *cursorPtr += recordSize;
+    length += recordSize;
+  }
+
+  return length;
+}
+
+/**
+ * Escreve u32 little-endian
+ * 
+ * @param bufferOutPtr  buffer de escrita
+ * @param value         valor
+ */
+static void put_u32(uint8_t * bufferOutPtr, uint32_t value)
+{
+  bufferOutPtr[0] = value & 0xFF;
+  bufferOutPtr[1] = (value >> 8) & 0xFF;
+  bufferOutPtr[2] = (value >> 16) & 0xFF;
+  bufferOutPtr[3] = value >> 24;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,93 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_UART_CAPTURE_H
+#define PLC_UART_CAPTURE_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Captura do tráfego da UART PLC, formato do arquivo (little-endian):
+ *   cabeçalho, 16 bytes:
+ *     magic "PLCU" | versão (u8 = 1) | flags (u8, bit0 = spill flash) |
+ *     reservado (u16) | início da captura, relógio do sistema (u32, s) |
+ *     registros descartados (u32)
+ *   registro, repetido até o fim do arquivo:
+ *     timestamp desde o início (u32, us) | direção (u8, 0 = TX, 1 = RX) |
+ *     porta UART PLC (u8) | tamanho (u16) | bytes
+ * 
+ * Registros mais antigos da RAM são sobrescritos quando o buffer enche.
+ * Com spill, uma task de baixa prioridade move os registros para a
+ * partição abaixo até enchê-la, ex. na tabela de partições:
+ *   uartcap, data, 0x41, , 256K
+ */
+#define PLC_UART_CAPTURE_PARTITION_LABEL "uartcap"
+
+/* Buffer circular de registros em RAM, em bytes */
+#ifndef PLC_UART_CAPTURE_RAM_SIZE
+#define PLC_UART_CAPTURE_RAM_SIZE   8192
+#endif
+/* Maior quantidade de bytes por registro, blocos maiores são truncados */
+#define PLC_UART_CAPTURE_MAX_DATA   1024
+/* Tamanho do cabeçalho de um registro */
+#define PLC_UART_CAPTURE_RECORD_HEADER_SIZE 8
+/* Tamanho do cabeçalho do arquivo */
+#define PLC_UART_CAPTURE_FILE_HEADER_SIZE   16
+
+typedef enum plcUartCaptureDirection_t
+{
+  PLC_UART_CAPTURE_TX = 0,
+  PLC_UART_CAPTURE_RX = 1,
+} plcUartCaptureDirection_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Estado da captura */
+typedef struct plcUartCaptureStatus_t
+{
+  bool enabled;
+  bool spill;
+  uint32_t startTime;
+  uint32_t records;
+  uint32_t dropped;
+  uint32_t ramBytes;
+  uint32_t flashBytes;
+} plcUartCaptureStatus_t;
+
+/* Cursor de leitura do arquivo de captura */
+typedef struct plcUartCaptureReader_t
+{
+  bool headerSent;
+  uint32_t flashOffset;
+  uint32_t flashEnd;
+  uint32_t ramCursor;
+} plcUartCaptureReader_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void plc_uart_capture_init(void);
+bool plc_uart_capture_start(bool spill);
+void plc_uart_capture_stop(void);
+void plc_uart_capture_record(uint32_t port, plcUartCaptureDirection_t direction, const uint8_t * dataPtr,
+                             size_t length);
+void plc_uart_capture_get_status(plcUartCaptureStatus_t * statusPtr);
+void plc_uart_capture_read_begin(plcUartCaptureReader_t * readerPtr);
+size_t plc_uart_capture_read(plcUartCaptureReader_t * readerPtr, uint8_t * bufferPtr, size_t bufferSize);
+void plc_uart_capture_read_end(plcUartCaptureReader_t * readerPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
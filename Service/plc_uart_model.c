@@ -12,12 +12,15 @@
 #include "plc_uart_model.h"
 #include "plc_uart.h"
 #include <string.h>
+#include <stdlib.h>
 #include "esp_log.h"
 #include <stdio.h>
 #include "plc_module_types.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Nodes por página do AT+TOPOINFO, comportados por data[] de uartPlcResponse_t */
+#define TOPOINFO_PAGE_NODES   4
 
 /*******************************************************************************
 * TYPEDEFS
@@ -43,54 +46,112 @@ static void format_mac_only_numbers(char * macPtr);
 *******************************************************************************/
 
 /**
- * Transforma layout recebido pela UART em array nodes 
+ * Transforma layout recebido pela UART em array nodes. A topologia é lida
+ * em páginas de TOPOINFO_PAGE_NODES até uma página incompleta ou o buffer
+ * cheio, nodes além do buffer não são lidos
  * 
+ * @param network         rede (porta UART) consultada
  * @param nodeBufferPtr   buffer de nodes a ser escrito
  * @param nodeBufferSize  tamanho disponivel para escrita
- * @return uint32_t       número de módulos recebidos
+ * @return int32_t        número de módulos recebidos, -1 = falha na leitura
  */
-uint32_t plc_uart_model_get_topology(node_t * nodeBufferPtr, 
-                                     size_t nodeBufferSize)
+int32_t plc_uart_model_get_topology(uint32_t network, node_t * nodeBufferPtr, 
+                                    size_t nodeBufferSize)
 {
   /* Limpa e inicializa estruturas */
   bzero(nodeBufferPtr, nodeBufferSize);
-  uartPlcResponse_t response;
-  bzero(&response, sizeof(uartPlcResponse_t));
-
-  /* Envia comando ao módulo para captar topologia */
-  plc_uart_send("AT+TOPOINFO=1,4\r\n\0", &response);
+  const uint32_t nodeMax = nodeBufferSize / sizeof(node_t);
+  uint32_t nodeCount = 0;
 
-  for(uint32_t idx = 0; idx < response.lineCounter; idx++)
+  for (uint32_t first = 1; nodeCount < nodeMax; first += TOPOINFO_PAGE_NODES)
   {
-    char * data = strtok(&response.data[idx][0], ",");
-    mac_string_hex_to_bytes(data, nodeBufferPtr[idx].mac);
-
-    nodeBufferPtr[idx].id = split_convert_to_number(NULL, ",", 10);
-    split_convert_to_number(NULL, ",", 10);
-    split_convert_to_number(NULL, ",", 10);
-    nodeBufferPtr[idx].role = split_convert_to_number(NULL, ",", 10) == NODE_ROLE_CCO ? NODE_ROLE_CCO : NODE_ROLE_STA;
-    nodeBufferPtr[idx].snr = split_convert_to_number(NULL, ",", 10);
-    nodeBufferPtr[idx].atenuation = split_convert_to_number(NULL, ",", 10);
-    nodeBufferPtr[idx].phase = split_convert_to_number(NULL, ",", 10);
+    uartPlcResponse_t response;
+    bzero(&response, sizeof(uartPlcResponse_t));
+
+    /* Envia comando ao módulo para captar página da topologia, primeiro node = 1 */
+    char command[32];
+    snprintf(command, sizeof(command), "AT+TOPOINFO=%u,%u\r\n", first, TOPOINFO_PAGE_NODES);
+    plc_uart_send(network, command, &response);
+
+    if (response.result == false)
+    {
+      /* Sem resposta ou erro do módulo, rede não lida (diferente de rede vazia) */
+      return -1;
+    }
+
+    const uint32_t pageCount = (response.lineCounter < (nodeMax - nodeCount)) ?
+                               response.lineCounter : (nodeMax - nodeCount);
+    for(uint32_t idx = 0; idx < pageCount; idx++)
+    {
+      node_t * nodePtr = &nodeBufferPtr[nodeCount + idx];
+      char * data = strtok(&response.data[idx][0], ",");
+      mac_string_hex_to_bytes(data, nodePtr->mac);
+
+      nodePtr->id = split_convert_to_number(NULL, ",", 10);
+      split_convert_to_number(NULL, ",", 10);
+      split_convert_to_number(NULL, ",", 10);
+      nodePtr->role = split_convert_to_number(NULL, ",", 10) == NODE_ROLE_CCO ? NODE_ROLE_CCO : NODE_ROLE_STA;
+      nodePtr->snr = split_convert_to_number(NULL, ",", 10);
+      nodePtr->atenuation = split_convert_to_number(NULL, ",", 10);
+      nodePtr->phase = split_convert_to_number(NULL, ",", 10);
+      nodePtr->network = network;
+    }
+    nodeCount += pageCount;
+
+    if (response.lineCounter < TOPOINFO_PAGE_NODES)
+    {
+      /* Página incompleta, últimos nodes da rede */
+      break;
+    }
   }
 
-  return response.lineCounter;
+  return (int32_t)nodeCount;
 }
 
 /**
- * Manipula carga estação (STA) PLC
+ * Remove ":" do MAC e resolve a rede (porta UART) da estação
  * 
- * @param macPtr  MAC da estação a ser controlada
- * @param value   valor a ser definido na saída do módulo PLC
- * @return true   manipulação com sucesso
- * @return false  falha na operação
+ * @param network   rede informada, PLC_UART_MODEL_NETWORK_AUTO = rede onde
+ *                  o MAC foi visto, ou a padrão se desconhecido
+ * @param macPtr    MAC da estação, formatado somente com números
+ * @return uint32_t porta UART da estação
  */
-bool plc_uart_model_io(const char * macPtr, const uint32_t value)
+uint32_t plc_uart_model_resolve_network(int32_t network, char * macPtr)
 {
   format_mac_only_numbers(macPtr);
 
+  uint32_t port = (network >= 0) ? (uint32_t)network : PLC_UART_PORT_DEFAULT;
+  if ((network == PLC_UART_MODEL_NETWORK_AUTO) && (strlen(macPtr) == 12))
+  {
+    uint8_t mac[6];
+    mac_string_hex_to_bytes(macPtr, mac);
+    const int32_t found = plc_topology_find_network(mac);
+    port = (found >= 0) ? (uint32_t)found : PLC_UART_PORT_DEFAULT;
+  }
+
+  return port;
+}
+
+/**
+ * Manipula carga estação (STA) PLC
+ * 
+ * @param port        porta UART da estação, resolvida com
+ *                    plc_uart_model_resolve_network
+ * @param macPtr      MAC da estação a ser controlada, formatado somente com
+ *                    números (plc_uart_model_resolve_network)
+ * @param value       valor a ser definido na saída do módulo PLC
+ * @param deadlineUs  prazo absoluto do comando, 0 = sem prazo
+ * @param tracePtr    trace da requisição de origem, NULL = sem trace
+ * @return true       manipulação com sucesso
+ * @return false      falha na operação ou prazo esgotado
+ */
+bool plc_uart_model_io(uint32_t port, const char * macPtr, const uint32_t value, int64_t deadlineUs,
+                       plcTrace_t * tracePtr)
+{
   uartPlcResponse_t response;
   bzero(&response, sizeof(uartPlcResponse_t));
+  response.tracePtr = tracePtr;
+  response.deadlineUs = deadlineUs;
   
   bool result = sprintf(response.command, "AT+IOCTRL=%s,%u,%u\r\n", macPtr, PLC_MODEL_GPIO_LOAD, value) > 0;
 
@@ -99,7 +160,7 @@ bool plc_uart_model_io(const char * macPtr, const uint32_t value)
     return false;
   }
 
-  plc_uart_send(response.command, &response);
+  plc_uart_send(port, response.command, &response);
 
   return response.result;
 }
@@ -116,10 +177,11 @@ static void mac_string_hex_to_bytes (const char * bufferInPtr, uint8_t * bufferO
 {
   size_t macLength = strlen(bufferInPtr);
   uint32_t counter = 0;
-  for (uint32_t stringIdx = 0; stringIdx < macLength; stringIdx += 2)
+  /* MAC de 6 bytes, caracteres excedentes ignorados */
+  for (uint32_t stringIdx = 0; (stringIdx < macLength) && (counter < 6); stringIdx += 2)
   {
     /* Realiza leitura dois caracteres string para ter os dados do byte em hex */
-    const char macByte[2] = {bufferInPtr[stringIdx], bufferInPtr[stringIdx + 1]};
+    const char macByte[3] = {bufferInPtr[stringIdx], bufferInPtr[stringIdx + 1], '\0'};
     /* Transforma valor do texto em byte */
     bufferOutPtr[counter++] = strtol(macByte, NULL, 16);
   }
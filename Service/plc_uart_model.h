@@ -13,9 +13,12 @@
 *******************************************************************************/
 #include <stddef.h>
 #include "plc_topology.h"
+#include "plc_trace.h"
 /*******************************************************************************
 * DEFINES E ENUMS
 *******************************************************************************/
+/* Rede resolvida pelo MAC na tabela da topologia */
+#define PLC_UART_MODEL_NETWORK_AUTO   -1
 
 /*******************************************************************************
 * TYPEDEFS
@@ -24,9 +27,11 @@
 /*******************************************************************************
 * FUNÇÕES EXPORTADAS
 *******************************************************************************/
-uint32_t plc_uart_model_get_topology(node_t * nodeBufferPtr, 
-                                     size_t nodeBufferSize);
-bool plc_uart_model_io(const char * macPtr, const uint32_t value);
+int32_t plc_uart_model_get_topology(uint32_t network, node_t * nodeBufferPtr, 
+                                    size_t nodeBufferSize);
+uint32_t plc_uart_model_resolve_network(int32_t network, char * macPtr);
+bool plc_uart_model_io(uint32_t port, const char * macPtr, const uint32_t value, int64_t deadlineUs,
+                       plcTrace_t * tracePtr);
 /*******************************************************************************
 * END OF FILE
 *******************************************************************************/
@@ -0,0 +1,177 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_uart_parser.h"
+#include <string.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Linhas e tamanho de cada linha comportados por uartPlcResponse_t.data */
+#define RESPONSE_LINES      (sizeof(((uartPlcResponse_t *)0)->data) / sizeof(((uartPlcResponse_t *)0)->data[0]))
+#define RESPONSE_LINE_SIZE  sizeof(((uartPlcResponse_t *)0)->data[0])
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static bool parse_result(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr);
+static bool parse_notification(const char * bufferRxPtr);
+static void parse_response(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr);
+static void line_sink(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Trata uma linha recebida do módulo, sem terminador "\r\n"
+ * 
+ * @param linePtr         linha a ser tratada
+ * @param responsePtr     resposta em andamento, NULL = nenhum comando aguardando
+ * @return plcUartLine_t  classificação da linha
+ */
+plcUartLine_t plc_uart_parser_line(const char * linePtr, uartPlcResponse_t * responsePtr)
+{
+  if (parse_result(linePtr, responsePtr) == true)
+  {
+    return PLC_UART_LINE_RESULT;
+  }
+
+  if (parse_notification(linePtr) == true)
+  {
+    /* Com comando em andamento, a linha também pertence à saída do comando */
+    line_sink(linePtr, responsePtr);
+    return PLC_UART_LINE_NOTIFICATION;
+  }
+
+  /* Procesa linha como dado de resposta para um comando */
+  parse_response(linePtr, responsePtr);
+  return PLC_UART_LINE_RESPONSE;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Realiza tratamento mensagem de resultado
+ * 
+ * @param bufferRxPtr       Buffer a ser tratado
+ * @param uartResponsePtr   Estrutura de resultado
+ * @return true             Buffer tratado
+ * @return false            Dados não são de resultados. Não tratado
+ */
+static bool parse_result(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr)
+{    
+  if (strstr(bufferRxPtr, "ERROR") != NULL || strstr(bufferRxPtr, "FAIL") != NULL)
+  {
+    if (uartResponsePtr != NULL)
+    {
+      uartResponsePtr->result = false;
+    }
+    /* Processamento com sucesso */
+    return true;
+  }
+
+  if (strstr(bufferRxPtr, "OK") != NULL)
+  {
+    if (uartResponsePtr != NULL)
+    {
+      uartResponsePtr->result = true;
+    }
+    /* Processamento com sucesso */
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Realiza tratamento mensagem de notificação
+ * 
+ * @param bufferRxPtr       Buffer a ser tratado
+ * @return true             Buffer tratado
+ * @return false            Dados não são de resultados. Não tratado
+ */
+static bool parse_notification(const char * bufferRxPtr)
+{
+  /* Como não tem dados no tratamento, ":", comando é de notificação */
+  return strchr(bufferRxPtr, ':') == NULL;
+}
+
+/**
+ * Realiza tratamento mensagem de resposta de comando
+ * 
+ * @param bufferRxPtr       Buffer a ser tratado
+ * @param uartResponsePtr   Estrutura de resultado
+ */
+static void parse_response(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr)
+{
+  /* Recupera posição do separador entre <COMANDO>:<DATA> */
+  char * atCmdDividerPtr = strchr(bufferRxPtr, ':');
+
+  if ((uartResponsePtr != NULL) && (atCmdDividerPtr != NULL))
+  {
+    line_sink(bufferRxPtr, uartResponsePtr);
+
+    /* Linhas além de data[] somente no destino */
+    if (uartResponsePtr->lineCounter >= RESPONSE_LINES)
+    {
+      return;
+    }
+
+    /* Copia dados de comando, formato -> "XX:yy". Sendo XX = comando respondido */
+    size_t commandLength = (atCmdDividerPtr > bufferRxPtr) ? (size_t)(atCmdDividerPtr - bufferRxPtr - 1) : 0;
+    if (commandLength > (sizeof(uartResponsePtr->command) - 1))
+    {
+      /* Limitado ao buffer do comando, mantendo terminador */
+      commandLength = sizeof(uartResponsePtr->command) - 1;
+    }
+    memcpy(uartResponsePtr->command, &bufferRxPtr[1], commandLength);
+    uartResponsePtr->command[commandLength] = '\0';
+
+    /* Copia dados de respondidos, formato -> "XX:yy". Sendo yy = dados respondido */
+    char * dataPtr = &uartResponsePtr->data[uartResponsePtr->lineCounter][0];
+    strncpy(dataPtr, &atCmdDividerPtr[1], RESPONSE_LINE_SIZE - 1);
+    dataPtr[RESPONSE_LINE_SIZE - 1] = '\0';
+
+    /* Linha de resposta tratada */
+    uartResponsePtr->lineCounter++;
+  }        
+}
+
+/**
+ * Entrega linha completa ao destino da resposta, sem limite de linhas
+ * 
+ * @param bufferRxPtr       linha recebida
+ * @param uartResponsePtr   resposta em andamento, NULL = nenhum comando aguardando
+ */
+static void line_sink(const char * bufferRxPtr, uartPlcResponse_t * uartResponsePtr)
+{
+  if ((uartResponsePtr != NULL) && (uartResponsePtr->lineSink != NULL))
+  {
+    uartResponsePtr->lineSink(bufferRxPtr, uartResponsePtr->lineContextPtr);
+  }
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
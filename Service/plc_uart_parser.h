@@ -0,0 +1,47 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_UART_PARSER_H
+#define PLC_UART_PARSER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "plc_uart.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/*
+ * Tratamento das linhas recebidas do módulo PLC. Sem dependência de
+ * FreeRTOS ou do driver UART, compilável fora do ESP32 (Tools/plc_replay)
+ */
+
+/* Classificação de uma linha recebida */
+typedef enum plcUartLine_t
+{
+  /* Resultado do comando, "OK" / "ERROR" / "FAIL", encerra a resposta */
+  PLC_UART_LINE_RESULT = 0,
+  /* Notificação espontânea do módulo, sem separador ":" */
+  PLC_UART_LINE_NOTIFICATION,
+  /* Linha de dados da resposta, formato "+COMANDO:dados" */
+  PLC_UART_LINE_RESPONSE,
+} plcUartLine_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+plcUartLine_t plc_uart_parser_line(const char * linePtr, uartPlcResponse_t * responsePtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
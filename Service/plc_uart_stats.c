@@ -0,0 +1,281 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_uart_stats.h"
+#include "plc_uart.h"
+#include <string.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const classNames[PLC_UART_CLASS_COUNT] = {
+  [PLC_UART_CLASS_TOPOINFO] = "TOPOINFO",
+  [PLC_UART_CLASS_IOCTRL] = "IOCTRL",
+  [PLC_UART_CLASS_MODE] = "MODE",
+  [PLC_UART_CLASS_RAW] = "RAW",
+};
+
+static const char * const stageNames[PLC_UART_STAGE_COUNT] = {
+  [PLC_UART_STAGE_QUEUE] = "queue",
+  [PLC_UART_STAGE_TX] = "tx",
+  [PLC_UART_STAGE_FIRST_BYTE] = "firstByte",
+  [PLC_UART_STAGE_RESULT] = "result",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Escritas somente com operações atômicas, leitura sem bloqueio */
+static plcUartCommandStats_t commandStats[PLC_UART_CLASS_COUNT];
+/* Chamadas de envio aguardando a UART ou em andamento */
+static uint32_t pendingCommands;
+/* Média móvel do tempo de UART ocupado por comando, incluindo reenvios */
+static uint32_t serviceUs = PLC_UART_STATS_SERVICE_SEED_US;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Identifica classe de um comando AT pelo prefixo
+ * 
+ * @param commandPtr              comando a ser enviado
+ * @return plcUartCommandClass_t  classe do comando
+ */
+plcUartCommandClass_t plc_uart_stats_classify(const char * commandPtr)
+{
+  if (strncmp(commandPtr, "AT+TOPOINFO", 11) == 0)
+  {
+    return PLC_UART_CLASS_TOPOINFO;
+  }
+
+  if (strncmp(commandPtr, "AT+IOCTRL", 9) == 0)
+  {
+    return PLC_UART_CLASS_IOCTRL;
+  }
+
+  if ((strncmp(commandPtr, "AT+MODE", 7) == 0) || (strncmp(commandPtr, "++", 2) == 0))
+  {
+    return PLC_UART_CLASS_MODE;
+  }
+
+  return PLC_UART_CLASS_RAW;
+}
+
+/**
+ * Nome de exibição de uma classe de comando
+ * 
+ * @param commandClass  classe do comando
+ * @return const char*  nome
+ */
+const char * plc_uart_stats_class_name(plcUartCommandClass_t commandClass)
+{
+  return classNames[commandClass];
+}
+
+/**
+ * Nome de exibição de uma etapa
+ * 
+ * @param stage         etapa
+ * @return const char*  nome
+ */
+const char * plc_uart_stats_stage_name(plcUartStage_t stage)
+{
+  return stageNames[stage];
+}
+
+/**
+ * Registra duração de uma etapa
+ * 
+ * @param commandClass  classe do comando
+ * @param stage         etapa medida
+ * @param elapsedUs     duração em microssegundos
+ */
+void plc_uart_stats_record(plcUartCommandClass_t commandClass, plcUartStage_t stage, int64_t elapsedUs)
+{
+  if (elapsedUs < 0)
+  {
+    /* Marca de tempo de outra tentativa, descarta */
+    return;
+  }
+
+  latency_histogram_record(&commandStats[commandClass].stages[stage],
+                           elapsedUs > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsedUs);
+}
+
+/**
+ * Contabiliza comando enviado
+ * 
+ * @param commandClass  classe do comando
+ */
+void plc_uart_stats_count_sent(plcUartCommandClass_t commandClass)
+{
+  __atomic_fetch_add(&commandStats[commandClass].sent, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Contabiliza nova tentativa após tempo de resposta esgotado
+ * 
+ * @param commandClass  classe do comando
+ */
+void plc_uart_stats_count_retry(plcUartCommandClass_t commandClass)
+{
+  __atomic_fetch_add(&commandStats[commandClass].retries, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Contabiliza comando cancelado pelo prazo da requisição
+ * 
+ * @param commandClass  classe do comando
+ * @param transmitted   false = descartado antes do envio, true = reenvio não realizado
+ */
+void plc_uart_stats_count_cancel(plcUartCommandClass_t commandClass, bool transmitted)
+{
+  uint32_t * counterPtr = transmitted ? &commandStats[commandClass].retriesSkipped :
+                                        &commandStats[commandClass].expired;
+  __atomic_fetch_add(counterPtr, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Contabiliza desfecho de um comando
+ * 
+ * @param commandClass  classe do comando
+ * @param completed     linha de resultado recebida
+ * @param result        resultado informado pelo módulo
+ */
+void plc_uart_stats_count_result(plcUartCommandClass_t commandClass, bool completed, bool result)
+{
+  uint32_t * counterPtr = &commandStats[commandClass].timeout;
+  if (completed)
+  {
+    counterPtr = result ? &commandStats[commandClass].success : &commandStats[commandClass].fail;
+  }
+
+  __atomic_fetch_add(counterPtr, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Contabiliza chamada de envio aguardando a UART
+ * 
+ */
+void plc_uart_stats_pending_enter(void)
+{
+  __atomic_fetch_add(&pendingCommands, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Contabiliza chamada de envio finalizada
+ * 
+ */
+void plc_uart_stats_pending_leave(void)
+{
+  __atomic_fetch_sub(&pendingCommands, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Recupera quantidade de chamadas de envio aguardando a UART ou em andamento.
+ * Não é zerado junto das métricas
+ * 
+ * @return uint32_t quantidade de chamadas
+ */
+uint32_t plc_uart_stats_get_pending(void)
+{
+  return __atomic_load_n(&pendingCommands, __ATOMIC_RELAXED);
+}
+
+/**
+ * Atualiza média móvel do tempo de UART por comando, do primeiro envio ao
+ * resultado ou à última tentativa. Atualizações concorrentes podem perder
+ * uma medida, sem impacto na estimativa
+ * 
+ * @param elapsedUs   tempo ocupado pelo comando
+ */
+void plc_uart_stats_record_service(int64_t elapsedUs)
+{
+  const int64_t average = __atomic_load_n(&serviceUs, __ATOMIC_RELAXED);
+  const int64_t updated = average + ((elapsedUs - average) >> PLC_UART_STATS_SERVICE_SHIFT);
+  __atomic_store_n(&serviceUs, (uint32_t)updated, __ATOMIC_RELAXED);
+}
+
+/**
+ * Recupera média móvel do tempo de UART por comando
+ * 
+ * @return uint32_t tempo por comando em us
+ */
+uint32_t plc_uart_stats_get_service_us(void)
+{
+  return __atomic_load_n(&serviceUs, __ATOMIC_RELAXED);
+}
+
+/**
+ * Estima tempo até a UART atender um novo comando: chamadas pendentes,
+ * distribuídas entre as portas, vezes o tempo médio por comando
+ * 
+ * @return uint32_t backlog estimado em ms
+ */
+uint32_t plc_uart_stats_get_backlog_ms(void)
+{
+  const uint64_t pending = plc_uart_stats_get_pending();
+  return (uint32_t)((pending * plc_uart_stats_get_service_us()) / (1000 * PLC_UART_PORT_COUNT));
+}
+
+/**
+ * Recupera métricas de uma classe de comando. Valores podem avançar durante a leitura
+ * 
+ * @param commandClass                  classe do comando
+ * @return const plcUartCommandStats_t* métricas
+ */
+const plcUartCommandStats_t * plc_uart_stats_get(plcUartCommandClass_t commandClass)
+{
+  return &commandStats[commandClass];
+}
+
+/**
+ * Zera todas as métricas
+ * 
+ */
+void plc_uart_stats_reset(void)
+{
+  for (uint32_t cls = 0; cls < PLC_UART_CLASS_COUNT; cls++)
+  {
+    plcUartCommandStats_t * statsPtr = &commandStats[cls];
+    for (uint32_t stage = 0; stage < PLC_UART_STAGE_COUNT; stage++)
+    {
+      latency_histogram_reset(&statsPtr->stages[stage]);
+    }
+    __atomic_store_n(&statsPtr->sent, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->success, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->fail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->timeout, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->retries, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->expired, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&statsPtr->retriesSkipped, 0, __ATOMIC_RELAXED);
+  }
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
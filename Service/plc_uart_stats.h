@@ -0,0 +1,93 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_UART_STATS_H
+#define PLC_UART_STATS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "latency_histogram.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Classe do comando enviado ao módulo PLC */
+typedef enum plcUartCommandClass_t
+{
+  PLC_UART_CLASS_TOPOINFO = 0,
+  PLC_UART_CLASS_IOCTRL,
+  /* AT+MODE e sequência de entrada em modo AT "++" */
+  PLC_UART_CLASS_MODE,
+  /* Demais comandos, repassados por /plc/command */
+  PLC_UART_CLASS_RAW,
+  PLC_UART_CLASS_COUNT,
+} plcUartCommandClass_t;
+
+/* Etapa medida de um comando, relativa ao início da tentativa bem sucedida */
+typedef enum plcUartStage_t
+{
+  /* Espera pela liberação da UART, relativa à chamada de envio */
+  PLC_UART_STAGE_QUEUE = 0,
+  /* Escrita do comando no driver */
+  PLC_UART_STAGE_TX,
+  /* Primeiro byte recebido */
+  PLC_UART_STAGE_FIRST_BYTE,
+  /* Linha de resultado (OK / ERROR) recebida */
+  PLC_UART_STAGE_RESULT,
+  PLC_UART_STAGE_COUNT,
+} plcUartStage_t;
+
+/* Tempo de UART por comando antes da primeira medida, em us */
+#define PLC_UART_STATS_SERVICE_SEED_US  50000
+/* Peso da nova medida na média móvel do tempo por comando, 1 / 2^N */
+#define PLC_UART_STATS_SERVICE_SHIFT    3
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Métricas de uma classe de comando */
+typedef struct plcUartCommandStats_t
+{
+  latencyHistogram_t stages[PLC_UART_STAGE_COUNT];
+  uint32_t sent;
+  /* Resultado OK */
+  uint32_t success;
+  /* Resultado ERROR / FAIL ou falha de escrita no driver */
+  uint32_t fail;
+  /* Tentativas esgotadas sem linha de resultado */
+  uint32_t timeout;
+  uint32_t retries;
+  /* Cancelados pelo prazo: descartados antes do envio e reenvios não realizados */
+  uint32_t expired;
+  uint32_t retriesSkipped;
+} plcUartCommandStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+plcUartCommandClass_t plc_uart_stats_classify(const char * commandPtr);
+const char * plc_uart_stats_class_name(plcUartCommandClass_t commandClass);
+const char * plc_uart_stats_stage_name(plcUartStage_t stage);
+void plc_uart_stats_record(plcUartCommandClass_t commandClass, plcUartStage_t stage, int64_t elapsedUs);
+void plc_uart_stats_count_sent(plcUartCommandClass_t commandClass);
+void plc_uart_stats_count_retry(plcUartCommandClass_t commandClass);
+void plc_uart_stats_count_cancel(plcUartCommandClass_t commandClass, bool transmitted);
+void plc_uart_stats_count_result(plcUartCommandClass_t commandClass, bool completed, bool result);
+void plc_uart_stats_pending_enter(void);
+void plc_uart_stats_pending_leave(void);
+uint32_t plc_uart_stats_get_pending(void);
+void plc_uart_stats_record_service(int64_t elapsedUs);
+uint32_t plc_uart_stats_get_service_us(void);
+uint32_t plc_uart_stats_get_backlog_ms(void);
+const plcUartCommandStats_t * plc_uart_stats_get(plcUartCommandClass_t commandClass);
+void plc_uart_stats_reset(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,397 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <sys/random.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Partições conhecidas pelo Service */
+#define PARTITION_COUNT     2
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+struct hostTimer_t
+{
+  esp_timer_cb_t callback;
+  void * arg;
+  bool armed;
+  int64_t expiryUs;
+  struct hostTimer_t * nextPtr;
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Início do processo, base de esp_timer_get_time */
+static struct timespec startTime;
+static esp_log_level_t logLevel = ESP_LOG_INFO;
+static pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t timerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timerCond;
+static struct hostTimer_t * timerListPtr;
+static bool timerTaskStarted;
+
+/* Heap virtual, bytes entregues pelo malloc às alocações do firmware */
+static size_t heapSize = HOST_HEAP_DEFAULT_SIZE;
+static size_t heapUsed;
+static size_t heapPeak;
+
+static esp_partition_t partitions[PARTITION_COUNT] = {
+  { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .size = HOST_PARTITION_SIZE, .label = "telemetry" },
+  { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x41, .size = HOST_PARTITION_SIZE, .label = "uartcap" },
+};
+static uint8_t partitionData[PARTITION_COUNT][HOST_PARTITION_SIZE];
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+void __real_free(void * ptr);
+static void start_time_init(void) __attribute__((constructor));
+static void timer_task(void * pvParameters);
+static void heap_account(size_t allocated, size_t released);
+static uint8_t * partition_data(const esp_partition_t * partition, size_t offset, size_t size);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Define tamanho do heap virtual reportado por heap_caps
+ * 
+ * @param size  tamanho em bytes
+ */
+void host_heap_set_size(size_t size)
+{
+  heapSize = size;
+}
+
+void esp_log_level_set(const char * tag, esp_log_level_t level)
+{
+  /* Somente nível global, como esp_log_level_set("*", nível) */
+  if (strcmp(tag, "*") == 0)
+  {
+    logLevel = level;
+  }
+}
+
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...)
+{
+  if (level > logLevel)
+  {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  pthread_mutex_lock(&logMutex);
+  vfprintf(stderr, format, args);
+  pthread_mutex_unlock(&logMutex);
+  va_end(args);
+}
+
+uint32_t esp_log_timestamp(void)
+{
+  return esp_timer_get_time() / 1000;
+}
+
+int64_t esp_timer_get_time(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)(now.tv_sec - startTime.tv_sec) * 1000000) + ((now.tv_nsec - startTime.tv_nsec) / 1000);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t * argsPtr, esp_timer_handle_t * handlePtr)
+{
+  struct hostTimer_t * timerPtr = calloc(1, sizeof(struct hostTimer_t));
+  if (timerPtr == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  timerPtr->callback = argsPtr->callback;
+  timerPtr->arg = argsPtr->arg;
+
+  pthread_mutex_lock(&timerMutex);
+  if (timerTaskStarted == false)
+  {
+    /* Callbacks executados pela task "esp_timer", como no ESP-IDF */
+    host_cond_init(&timerCond);
+    xTaskCreate(timer_task, "esp_timer", 4096, NULL, 22, NULL);
+    timerTaskStarted = true;
+  }
+  timerPtr->nextPtr = timerListPtr;
+  timerListPtr = timerPtr;
+  pthread_mutex_unlock(&timerMutex);
+
+  *handlePtr = timerPtr;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+  esp_err_t result = ESP_ERR_INVALID_STATE;
+  pthread_mutex_lock(&timerMutex);
+  if (timer->armed == false)
+  {
+    timer->armed = true;
+    timer->expiryUs = esp_timer_get_time() + timeoutUs;
+    pthread_cond_signal(&timerCond);
+    result = ESP_OK;
+  }
+  pthread_mutex_unlock(&timerMutex);
+  return result;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  esp_err_t result = ESP_ERR_INVALID_STATE;
+  pthread_mutex_lock(&timerMutex);
+  if (timer->armed)
+  {
+    timer->armed = false;
+    result = ESP_OK;
+  }
+  pthread_mutex_unlock(&timerMutex);
+  return result;
+}
+
+uint32_t esp_random(void)
+{
+  uint32_t value = 0;
+  while (getrandom(&value, sizeof(value), 0) != sizeof(value))
+  {
+  }
+  return value;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+  const size_t used = __atomic_load_n(&heapUsed, __ATOMIC_RELAXED);
+  return (used < heapSize) ? (heapSize - used) : 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+  const size_t peak = __atomic_load_n(&heapPeak, __ATOMIC_RELAXED);
+  return (peak < heapSize) ? (heapSize - peak) : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+  /* Sem modelo de fragmentação, todo o livre é contíguo */
+  return heap_caps_get_free_size(caps);
+}
+
+/* Alocações contabilizadas via -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free */
+void * __wrap_malloc(size_t size)
+{
+  void * ptr = __real_malloc(size);
+  heap_account(malloc_usable_size(ptr), 0);
+  return ptr;
+}
+
+void * __wrap_calloc(size_t count, size_t size)
+{
+  void * ptr = __real_calloc(count, size);
+  heap_account(malloc_usable_size(ptr), 0);
+  return ptr;
+}
+
+void * __wrap_realloc(void * ptr, size_t size)
+{
+  const size_t released = malloc_usable_size(ptr);
+  void * newPtr = __real_realloc(ptr, size);
+  if ((newPtr != NULL) || (size == 0))
+  {
+    heap_account(malloc_usable_size(newPtr), released);
+  }
+  return newPtr;
+}
+
+void __wrap_free(void * ptr)
+{
+  heap_account(0, malloc_usable_size(ptr));
+  __real_free(ptr);
+}
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                 const char * label)
+{
+  for (uint32_t idx = 0; idx < PARTITION_COUNT; idx++)
+  {
+    if ((partitions[idx].type == type) && (strcmp(partitions[idx].label, label) == 0))
+    {
+      return &partitions[idx];
+    }
+  }
+
+  return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t * partition, size_t offset, void * dst, size_t size)
+{
+  const uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  memcpy(dst, dataPtr, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t * partition, size_t offset, const void * src, size_t size)
+{
+  uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  /* Escrita em flash somente limpa bits */
+  for (size_t idx = 0; idx < size; idx++)
+  {
+    dataPtr[idx] &= ((const uint8_t *)src)[idx];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t * partition, size_t offset, size_t size)
+{
+  uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  memset(dataPtr, 0xFF, size);
+  return ESP_OK;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Registra início do processo e apaga partições simuladas, antes do main
+ * 
+ */
+static void start_time_init(void)
+{
+  clock_gettime(CLOCK_MONOTONIC, &startTime);
+  memset(partitionData, 0xFF, sizeof(partitionData));
+}
+
+/**
+ * Task de disparo dos timers, um callback por vez
+ * 
+ * @param pvParameters  não utilizado
+ */
+static void timer_task(void * pvParameters)
+{
+  pthread_mutex_lock(&timerMutex);
+  for (;;)
+  {
+    struct hostTimer_t * nextTimerPtr = NULL;
+    for (struct hostTimer_t * timerPtr = timerListPtr; timerPtr != NULL; timerPtr = timerPtr->nextPtr)
+    {
+      if (timerPtr->armed && ((nextTimerPtr == NULL) || (timerPtr->expiryUs < nextTimerPtr->expiryUs)))
+      {
+        nextTimerPtr = timerPtr;
+      }
+    }
+
+    if (nextTimerPtr == NULL)
+    {
+      host_cond_wait(&timerCond, &timerMutex, NULL);
+      continue;
+    }
+
+    const int64_t remainingUs = nextTimerPtr->expiryUs - esp_timer_get_time();
+    if (remainingUs > 0)
+    {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += remainingUs / 1000000;
+      deadline.tv_nsec += (remainingUs % 1000000) * 1000;
+      if (deadline.tv_nsec >= 1000000000L)
+      {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      host_cond_wait(&timerCond, &timerMutex, &deadline);
+      continue;
+    }
+
+    /* Callback fora do mutex, pode rearmar ou parar timers */
+    nextTimerPtr->armed = false;
+    pthread_mutex_unlock(&timerMutex);
+    nextTimerPtr->callback(nextTimerPtr->arg);
+    pthread_mutex_lock(&timerMutex);
+  }
+}
+
+/**
+ * Atualiza uso e pico do heap virtual
+ * 
+ * @param allocated   bytes alocados
+ * @param released    bytes liberados
+ */
+static void heap_account(size_t allocated, size_t released)
+{
+  const size_t used = __atomic_add_fetch(&heapUsed, allocated - released, __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n(&heapPeak, __ATOMIC_RELAXED);
+  while ((used > peak) &&
+         (__atomic_compare_exchange_n(&heapPeak, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false))
+  {
+  }
+}
+
+/**
+ * Valida intervalo e recupera memória de uma partição simulada
+ * 
+ * @param partition   partição retornada por esp_partition_find_first
+ * @param offset      início do intervalo
+ * @param size        tamanho do intervalo
+ * @return uint8_t*   memória do intervalo, NULL = fora da partição
+ */
+static uint8_t * partition_data(const esp_partition_t * partition, size_t offset, size_t size)
+{
+  const uint32_t idx = partition - partitions;
+  if ((idx >= PARTITION_COUNT) || (offset + size > partition->size))
+  {
+    return NULL;
+  }
+
+  return &partitionData[idx][offset];
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,686 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/message_buffer.h"
+#include "esp_timer.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define MAX_TASKS               32
+/* configMAX_TASK_NAME_LEN do ESP-IDF */
+#define TASK_NAME_SIZE          16
+/* Preenchimento da pilha para a marca d'água, como tskSTACK_FILL_BYTE */
+#define STACK_FILL_BYTE         0xA5
+/* Cabeçalho de tamanho de cada mensagem, size_t de 32 bits do ESP32 */
+#define MESSAGE_HEADER_SIZE     sizeof(uint32_t)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+struct hostTask_t
+{
+  pthread_t thread;
+  char name[TASK_NAME_SIZE];
+  TaskFunction_t taskCode;
+  void * pvParameters;
+  BaseType_t coreId;
+  uint8_t * stackPtr;
+  pthread_mutex_t notifyMutex;
+  pthread_cond_t notifyCond;
+  uint32_t notifyValue;
+};
+
+struct hostQueue_t
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+  uint8_t * itemsPtr;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t count;
+  UBaseType_t head;
+};
+
+struct hostEventGroup_t
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  EventBits_t bits;
+};
+
+struct hostMessageBuffer_t
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  uint8_t * dataPtr;
+  size_t size;
+  size_t head;
+  size_t used;
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct hostTask_t tasks[MAX_TASKS];
+static uint32_t taskCount;
+static __thread struct hostTask_t * currentTask;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void * task_entry(void * arg);
+static BaseType_t queue_send(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait, bool front);
+static const struct timespec * deadline_get(TickType_t ticksToWait, struct timespec * deadlinePtr);
+static void ring_copy_in(struct hostMessageBuffer_t * bufferPtr, size_t offset, const void * srcPtr, size_t size);
+static void ring_copy_out(const struct hostMessageBuffer_t * bufferPtr, size_t offset, void * dstPtr, size_t size);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Calcula instante absoluto (CLOCK_MONOTONIC) de expiração de uma espera
+ * 
+ * @param ticksToWait   espera em ticks
+ * @param deadlinePtr   instante de expiração
+ */
+void host_deadline(TickType_t ticksToWait, struct timespec * deadlinePtr)
+{
+  clock_gettime(CLOCK_MONOTONIC, deadlinePtr);
+  const uint64_t waitNs = (uint64_t)ticksToWait * portTICK_PERIOD_MS * 1000000ULL;
+  deadlinePtr->tv_sec += waitNs / 1000000000ULL;
+  deadlinePtr->tv_nsec += waitNs % 1000000000ULL;
+  if (deadlinePtr->tv_nsec >= 1000000000L)
+  {
+    deadlinePtr->tv_sec++;
+    deadlinePtr->tv_nsec -= 1000000000L;
+  }
+}
+
+/**
+ * Inicializa condição temporizada pelo relógio monotônico
+ * 
+ * @param condPtr   condição
+ */
+void host_cond_init(pthread_cond_t * condPtr)
+{
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(condPtr, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+/**
+ * Aguarda condição com o mutex tomado
+ * 
+ * @param condPtr       condição
+ * @param mutexPtr      mutex tomado pela thread
+ * @param deadlinePtr   expiração da espera, NULL = sem limite
+ * @return true         condição sinalizada
+ * @return false        espera expirada
+ */
+bool host_cond_wait(pthread_cond_t * condPtr, pthread_mutex_t * mutexPtr, const struct timespec * deadlinePtr)
+{
+  if (deadlinePtr == NULL)
+  {
+    pthread_cond_wait(condPtr, mutexPtr);
+    return true;
+  }
+
+  return pthread_cond_timedwait(condPtr, mutexPtr, deadlinePtr) != ETIMEDOUT;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char * namePtr, uint32_t stackDepth, void * pvParameters,
+                       UBaseType_t priority, TaskHandle_t * createdTaskPtr)
+{
+  /* Sem afinidade, tasks distribuídas entre os núcleos virtuais */
+  return xTaskCreatePinnedToCore(taskCode, namePtr, stackDepth, pvParameters, priority, createdTaskPtr,
+                                 taskCount % portNUM_PROCESSORS);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char * namePtr, uint32_t stackDepth,
+                                   void * pvParameters, UBaseType_t priority, TaskHandle_t * createdTaskPtr,
+                                   BaseType_t coreId)
+{
+  pthread_mutex_lock(&registryMutex);
+  if (taskCount >= MAX_TASKS)
+  {
+    pthread_mutex_unlock(&registryMutex);
+    return pdFAIL;
+  }
+  struct hostTask_t * taskPtr = &tasks[taskCount++];
+  snprintf(taskPtr->name, sizeof(taskPtr->name), "%s", namePtr);
+  taskPtr->taskCode = taskCode;
+  taskPtr->pvParameters = pvParameters;
+  taskPtr->coreId = coreId;
+  pthread_mutex_init(&taskPtr->notifyMutex, NULL);
+  host_cond_init(&taskPtr->notifyCond);
+  pthread_mutex_unlock(&registryMutex);
+
+  /* Pilha fora do heap contabilizado, preenchida para a marca d'água */
+  taskPtr->stackPtr = mmap(NULL, HOST_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (taskPtr->stackPtr == MAP_FAILED)
+  {
+    return pdFAIL;
+  }
+  memset(taskPtr->stackPtr, STACK_FILL_BYTE, HOST_STACK_SIZE);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, taskPtr->stackPtr, HOST_STACK_SIZE);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  const bool created = pthread_create(&taskPtr->thread, &attr, task_entry, taskPtr) == 0;
+  pthread_attr_destroy(&attr);
+  if (created == false)
+  {
+    return pdFAIL;
+  }
+
+  pthread_setname_np(taskPtr->thread, taskPtr->name);
+  if (createdTaskPtr != NULL)
+  {
+    *createdTaskPtr = taskPtr;
+  }
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticksToDelay)
+{
+  if (ticksToDelay == 0)
+  {
+    sched_yield();
+    return;
+  }
+
+  struct timespec deadline;
+  host_deadline(ticksToDelay, &deadline);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+  {
+  }
+}
+
+void vTaskDelayUntil(TickType_t * previousWakeTimePtr, TickType_t timeIncrement)
+{
+  *previousWakeTimePtr += timeIncrement;
+  const TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(*previousWakeTimePtr - now) > 0)
+  {
+    vTaskDelay(*previousWakeTimePtr - now);
+  }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(esp_timer_get_time() / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetHandle(const char * namePtr)
+{
+  TaskHandle_t task = NULL;
+  pthread_mutex_lock(&registryMutex);
+  for (uint32_t idx = 0; (idx < taskCount) && (task == NULL); idx++)
+  {
+    if (strncmp(tasks[idx].name, namePtr, TASK_NAME_SIZE - 1) == 0)
+    {
+      task = &tasks[idx];
+    }
+  }
+  pthread_mutex_unlock(&registryMutex);
+  return task;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  const struct hostTask_t * taskPtr = (task != NULL) ? task : currentTask;
+  if (taskPtr == NULL)
+  {
+    return 0;
+  }
+
+  /* Pilha cresce para baixo, bytes nunca escritos a partir da base */
+  UBaseType_t untouched = 0;
+  while ((untouched < HOST_STACK_SIZE) && (taskPtr->stackPtr[untouched] == STACK_FILL_BYTE))
+  {
+    untouched++;
+  }
+  return untouched;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  pthread_mutex_lock(&task->notifyMutex);
+  task->notifyValue++;
+  pthread_cond_signal(&task->notifyCond);
+  pthread_mutex_unlock(&task->notifyMutex);
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+  struct hostTask_t * taskPtr = currentTask;
+  if (taskPtr == NULL)
+  {
+    return 0;
+  }
+
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&taskPtr->notifyMutex);
+  while ((taskPtr->notifyValue == 0) && (ticksToWait != 0) &&
+         host_cond_wait(&taskPtr->notifyCond, &taskPtr->notifyMutex, deadlinePtr))
+  {
+  }
+  const uint32_t value = taskPtr->notifyValue;
+  if (value != 0)
+  {
+    taskPtr->notifyValue = clearCountOnExit ? 0 : (value - 1);
+  }
+  pthread_mutex_unlock(&taskPtr->notifyMutex);
+  return value;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+  return (currentTask != NULL) ? currentTask->coreId : 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  struct hostQueue_t * queuePtr = calloc(1, sizeof(struct hostQueue_t));
+  if (queuePtr == NULL)
+  {
+    return NULL;
+  }
+
+  queuePtr->itemsPtr = (itemSize != 0) ? calloc(length, itemSize) : NULL;
+  if ((itemSize != 0) && (queuePtr->itemsPtr == NULL))
+  {
+    free(queuePtr);
+    return NULL;
+  }
+
+  queuePtr->length = length;
+  queuePtr->itemSize = itemSize;
+  pthread_mutex_init(&queuePtr->mutex, NULL);
+  host_cond_init(&queuePtr->notEmpty);
+  host_cond_init(&queuePtr->notFull);
+  return queuePtr;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait)
+{
+  return queue_send(queue, itemPtr, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait)
+{
+  return queue_send(queue, itemPtr, ticksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * bufferPtr, TickType_t ticksToWait)
+{
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&queue->mutex);
+  while ((queue->count == 0) && (ticksToWait != 0) &&
+         host_cond_wait(&queue->notEmpty, &queue->mutex, deadlinePtr))
+  {
+  }
+
+  const bool received = queue->count != 0;
+  if (received)
+  {
+    if (queue->itemSize != 0)
+    {
+      memcpy(bufferPtr, &queue->itemsPtr[queue->head * queue->itemSize], queue->itemSize);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->notFull);
+  }
+  pthread_mutex_unlock(&queue->mutex);
+  return received ? pdPASS : pdFAIL;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  pthread_mutex_lock(&queue->mutex);
+  queue->count = 0;
+  queue->head = 0;
+  pthread_cond_broadcast(&queue->notFull);
+  pthread_mutex_unlock(&queue->mutex);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  pthread_mutex_lock(&queue->mutex);
+  const UBaseType_t count = queue->count;
+  pthread_mutex_unlock(&queue->mutex);
+  return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+  if (semaphore != NULL)
+  {
+    xSemaphoreGive(semaphore);
+  }
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+  return xQueueCreate(1, 0);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+  struct hostEventGroup_t * groupPtr = calloc(1, sizeof(struct hostEventGroup_t));
+  if (groupPtr != NULL)
+  {
+    pthread_mutex_init(&groupPtr->mutex, NULL);
+    host_cond_init(&groupPtr->changed);
+  }
+  return groupPtr;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bitsToSet)
+{
+  pthread_mutex_lock(&group->mutex);
+  group->bits |= bitsToSet;
+  const EventBits_t bits = group->bits;
+  pthread_cond_broadcast(&group->changed);
+  pthread_mutex_unlock(&group->mutex);
+  return bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bitsToClear)
+{
+  pthread_mutex_lock(&group->mutex);
+  const EventBits_t bits = group->bits;
+  group->bits &= ~bitsToClear;
+  pthread_mutex_unlock(&group->mutex);
+  return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+  pthread_mutex_lock(&group->mutex);
+  const EventBits_t bits = group->bits;
+  pthread_mutex_unlock(&group->mutex);
+  return bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bitsToWait, BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticksToWait)
+{
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&group->mutex);
+  bool satisfied;
+  for (;;)
+  {
+    const EventBits_t matched = group->bits & bitsToWait;
+    satisfied = waitForAllBits ? (matched == bitsToWait) : (matched != 0);
+    if (satisfied || (ticksToWait == 0) || (host_cond_wait(&group->changed, &group->mutex, deadlinePtr) == false))
+    {
+      break;
+    }
+  }
+
+  /* Valor antes da limpeza, como no FreeRTOS */
+  const EventBits_t bits = group->bits;
+  if (satisfied && clearOnExit)
+  {
+    group->bits &= ~bitsToWait;
+  }
+  pthread_mutex_unlock(&group->mutex);
+  return bits;
+}
+
+MessageBufferHandle_t xMessageBufferCreate(size_t bufferSize)
+{
+  struct hostMessageBuffer_t * bufferPtr = calloc(1, sizeof(struct hostMessageBuffer_t));
+  if (bufferPtr == NULL)
+  {
+    return NULL;
+  }
+
+  bufferPtr->dataPtr = malloc(bufferSize);
+  if (bufferPtr->dataPtr == NULL)
+  {
+    free(bufferPtr);
+    return NULL;
+  }
+
+  bufferPtr->size = bufferSize;
+  pthread_mutex_init(&bufferPtr->mutex, NULL);
+  host_cond_init(&bufferPtr->changed);
+  return bufferPtr;
+}
+
+size_t xMessageBufferSend(MessageBufferHandle_t buffer, const void * dataPtr, size_t dataLength,
+                          TickType_t ticksToWait)
+{
+  const size_t needed = MESSAGE_HEADER_SIZE + dataLength;
+  if (needed > buffer->size)
+  {
+    return 0;
+  }
+
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&buffer->mutex);
+  while (((buffer->size - buffer->used) < needed) && (ticksToWait != 0) &&
+         host_cond_wait(&buffer->changed, &buffer->mutex, deadlinePtr))
+  {
+  }
+
+  const bool sent = (buffer->size - buffer->used) >= needed;
+  if (sent)
+  {
+    const uint32_t header = dataLength;
+    ring_copy_in(buffer, buffer->used, &header, MESSAGE_HEADER_SIZE);
+    ring_copy_in(buffer, buffer->used + MESSAGE_HEADER_SIZE, dataPtr, dataLength);
+    buffer->used += needed;
+    pthread_cond_broadcast(&buffer->changed);
+  }
+  pthread_mutex_unlock(&buffer->mutex);
+  return sent ? dataLength : 0;
+}
+
+size_t xMessageBufferReceive(MessageBufferHandle_t buffer, void * rxDataPtr, size_t bufferLength,
+                             TickType_t ticksToWait)
+{
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&buffer->mutex);
+  while ((buffer->used == 0) && (ticksToWait != 0) &&
+         host_cond_wait(&buffer->changed, &buffer->mutex, deadlinePtr))
+  {
+  }
+
+  size_t length = 0;
+  if (buffer->used != 0)
+  {
+    uint32_t header;
+    ring_copy_out(buffer, 0, &header, MESSAGE_HEADER_SIZE);
+    /* Mensagem maior que o buffer de leitura fica na fila, como no FreeRTOS */
+    if (header <= bufferLength)
+    {
+      ring_copy_out(buffer, MESSAGE_HEADER_SIZE, rxDataPtr, header);
+      buffer->head = (buffer->head + MESSAGE_HEADER_SIZE + header) % buffer->size;
+      buffer->used -= MESSAGE_HEADER_SIZE + header;
+      length = header;
+      pthread_cond_broadcast(&buffer->changed);
+    }
+  }
+  pthread_mutex_unlock(&buffer->mutex);
+  return length;
+}
+
+BaseType_t xMessageBufferReset(MessageBufferHandle_t buffer)
+{
+  pthread_mutex_lock(&buffer->mutex);
+  buffer->head = 0;
+  buffer->used = 0;
+  pthread_cond_broadcast(&buffer->changed);
+  pthread_mutex_unlock(&buffer->mutex);
+  return pdPASS;
+}
+
+BaseType_t xMessageBufferIsEmpty(MessageBufferHandle_t buffer)
+{
+  pthread_mutex_lock(&buffer->mutex);
+  const bool empty = buffer->used == 0;
+  pthread_mutex_unlock(&buffer->mutex);
+  return empty ? pdTRUE : pdFALSE;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Ponto de entrada da thread de uma task
+ * 
+ * @param arg     task criada
+ * @return void*  sem retorno
+ */
+static void * task_entry(void * arg)
+{
+  currentTask = arg;
+  currentTask->taskCode(currentTask->pvParameters);
+
+  /* Task do FreeRTOS não retorna, encerramento sem vTaskDelete */
+  fprintf(stderr, "Task '%s' returned\n", currentTask->name);
+  return NULL;
+}
+
+/**
+ * Insere item no fim ou, como xQueueSendToFront, no início da fila
+ * 
+ * @param queue         fila
+ * @param itemPtr       item
+ * @param ticksToWait   espera por posição livre
+ * @param front         item recebido antes dos já enfileirados
+ * @return BaseType_t   pdPASS = item inserido
+ */
+static BaseType_t queue_send(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait, bool front)
+{
+  struct timespec deadline;
+  const struct timespec * deadlinePtr = deadline_get(ticksToWait, &deadline);
+
+  pthread_mutex_lock(&queue->mutex);
+  while ((queue->count == queue->length) && (ticksToWait != 0) &&
+         host_cond_wait(&queue->notFull, &queue->mutex, deadlinePtr))
+  {
+  }
+
+  const bool sent = queue->count < queue->length;
+  if (sent)
+  {
+    if (front)
+    {
+      queue->head = (queue->head + queue->length - 1) % queue->length;
+    }
+    const UBaseType_t position = front ? queue->head : ((queue->head + queue->count) % queue->length);
+    if (queue->itemSize != 0)
+    {
+      memcpy(&queue->itemsPtr[position * queue->itemSize], itemPtr, queue->itemSize);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+  }
+  pthread_mutex_unlock(&queue->mutex);
+  return sent ? pdPASS : pdFAIL;
+}
+
+/**
+ * Converte espera em ticks para instante de expiração
+ * 
+ * @param ticksToWait             espera em ticks
+ * @param deadlinePtr             memória do instante
+ * @return const struct timespec* instante, NULL = portMAX_DELAY
+ */
+static const struct timespec * deadline_get(TickType_t ticksToWait, struct timespec * deadlinePtr)
+{
+  if (ticksToWait == portMAX_DELAY)
+  {
+    return NULL;
+  }
+
+  host_deadline(ticksToWait, deadlinePtr);
+  return deadlinePtr;
+}
+
+/**
+ * Escreve no buffer circular a partir de uma posição relativa ao início dos dados
+ * 
+ * @param bufferPtr   message buffer
+ * @param offset      posição relativa
+ * @param srcPtr      dados
+ * @param size        tamanho dos dados
+ */
+static void ring_copy_in(struct hostMessageBuffer_t * bufferPtr, size_t offset, const void * srcPtr, size_t size)
+{
+  for (size_t idx = 0; idx < size; idx++)
+  {
+    bufferPtr->dataPtr[(bufferPtr->head + offset + idx) % bufferPtr->size] = ((const uint8_t *)srcPtr)[idx];
+  }
+}
+
+/**
+ * Lê do buffer circular a partir de uma posição relativa ao início dos dados
+ * 
+ * @param bufferPtr   message buffer
+ * @param offset      posição relativa
+ * @param dstPtr      destino
+ * @param size        tamanho a ler
+ */
+static void ring_copy_out(const struct hostMessageBuffer_t * bufferPtr, size_t offset, void * dstPtr, size_t size)
+{
+  for (size_t idx = 0; idx < size; idx++)
+  {
+    ((uint8_t *)dstPtr)[idx] = bufferPtr->dataPtr[(bufferPtr->head + offset + idx) % bufferPtr->size];
+  }
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,1546 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Servidor HTTP do host com a API e o modelo de execução do esp_http_server:
+ * uma única task atende todas as sessões por select(), handlers executam na
+ * task do servidor, httpd_queue_work entrega trabalho pelo socket de controle
+ * e o contexto de sessão (sess_ctx / free_ctx) segue as regras do ESP-IDF.
+ * Suporta keep-alive, respostas chunked e WebSocket, o necessário para os
+ * endpoints do firmware.
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Cabeçalho da requisição, CONFIG_HTTPD_MAX_REQ_HDR_LEN */
+#define SESSION_BUFFER_SIZE   1024
+/* Cabeçalho da resposta montado antes do envio */
+#define RESP_HEAD_SIZE        1024
+/* Payload máximo de frames de controle WebSocket (RFC 6455) */
+#define WS_CONTROL_MAX        125
+#define WS_GUID               "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_SIZE           32
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct httpdWsState_t
+{
+  httpd_ws_type_t type;
+  bool final;
+  bool headerRead;
+  size_t length;
+  size_t offset;
+  uint8_t mask[4];
+} httpdWsState_t;
+
+typedef struct httpdSession_t
+{
+  int fd;
+  void * ctx;
+  httpd_free_ctx_fn_t freeFn;
+  bool ignoreCtxChanges;
+  uint64_t lruCounter;
+  /* Handler WebSocket após o handshake, -1 = sessão HTTP */
+  int32_t wsHandler;
+  httpdWsState_t ws;
+  uint8_t buffer[SESSION_BUFFER_SIZE];
+  size_t start;
+  size_t end;
+} httpdSession_t;
+
+typedef struct httpdRespHeader_t
+{
+  const char * fieldPtr;
+  const char * valuePtr;
+} httpdRespHeader_t;
+
+typedef struct httpdRequest_t
+{
+  httpdSession_t * sessPtr;
+  /* Linhas de cabeçalho após a linha da requisição */
+  const char * headerPtr;
+  size_t headerLength;
+  size_t remaining;
+  const char * statusPtr;
+  const char * typePtr;
+  uint32_t respHeaderCount;
+  bool chunkStarted;
+} httpdRequest_t;
+
+typedef struct httpdServer_t
+{
+  httpd_config_t config;
+  httpd_uri_t * handlersPtr;
+  uint32_t handlerCount;
+  httpdSession_t * sessionsPtr;
+  httpdRespHeader_t * respHeadersPtr;
+  int listenFd;
+  int ctrlFd[2];
+  uint64_t lruCounter;
+  /* Requisição em execução, contexto de sessão fica no req até o fim */
+  httpd_req_t * currentReqPtr;
+} httpdServer_t;
+
+typedef struct httpdWork_t
+{
+  httpd_work_fn_t fn;
+  void * arg;
+} httpdWork_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "HOST_HTTPD";
+
+static const char * const methodNames[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static httpdServer_t * serverPtr;
+static uint16_t hostPort;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void server_task(void * arg);
+static void session_accept(httpdServer_t * srvPtr);
+static httpdSession_t * session_get(httpdServer_t * srvPtr, int fd);
+static void session_delete(httpdServer_t * srvPtr, httpdSession_t * sessPtr);
+static void session_close_work(void * arg);
+static void ctx_free(void * ctx, httpd_free_ctx_fn_t freeFn);
+static bool request_process(httpdServer_t * srvPtr, httpdSession_t * sessPtr);
+static bool ws_process(httpdServer_t * srvPtr, httpdSession_t * sessPtr);
+static bool handler_call(httpdServer_t * srvPtr, httpdSession_t * sessPtr, httpd_req_t * req, int32_t handlerIdx);
+static bool ws_handshake(httpd_req_t * req);
+static bool ws_header_read(httpdSession_t * sessPtr);
+static bool ws_payload_read(httpdSession_t * sessPtr, uint8_t * payloadPtr, size_t length);
+static int ws_frame_send(int fd, httpd_ws_type_t type, bool final, const uint8_t * payloadPtr, size_t length);
+static bool header_receive(httpdSession_t * sessPtr, size_t * headEndPtr);
+static const char * header_find(httpd_req_t * req, const char * fieldPtr, size_t * lengthPtr);
+static int32_t handler_find(httpdServer_t * srvPtr, const char * uriPtr, int method, bool * uriFoundPtr);
+static esp_err_t error_send(httpd_req_t * req, const char * statusPtr, const char * messagePtr);
+static esp_err_t resp_head_send(httpd_req_t * req, const char * framingPtr);
+static int sess_read(httpdSession_t * sessPtr, void * bufPtr, size_t length);
+static bool sess_read_all(httpdSession_t * sessPtr, void * bufPtr, size_t length);
+static int sock_send(int fd, const void * bufPtr, size_t length);
+static void sha1(const uint8_t * dataPtr, size_t length, uint8_t digest[20]);
+static void base64_encode(const uint8_t * dataPtr, size_t length, char * outPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Define porta TCP do servidor, substitui server_port da configuração
+ * 
+ * @param port  porta, 0 = mantém a configuração
+ */
+void host_httpd_set_port(uint16_t port)
+{
+  hostPort = port;
+}
+
+esp_err_t httpd_start(httpd_handle_t * handlePtr, const httpd_config_t * configPtr)
+{
+  if ((handlePtr == NULL) || (configPtr == NULL) || (configPtr->max_open_sockets == 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (serverPtr != NULL)
+  {
+    return ESP_ERR_HTTPD_TASK;
+  }
+
+  httpdServer_t * srvPtr = calloc(1, sizeof(httpdServer_t));
+  if (srvPtr == NULL)
+  {
+    return ESP_ERR_HTTPD_ALLOC_MEM;
+  }
+  srvPtr->config = *configPtr;
+  if (hostPort != 0)
+  {
+    srvPtr->config.server_port = hostPort;
+  }
+  srvPtr->handlersPtr = calloc(configPtr->max_uri_handlers, sizeof(httpd_uri_t));
+  srvPtr->sessionsPtr = calloc(configPtr->max_open_sockets, sizeof(httpdSession_t));
+  srvPtr->respHeadersPtr = calloc(configPtr->max_resp_headers + 1, sizeof(httpdRespHeader_t));
+  if ((srvPtr->handlersPtr == NULL) || (srvPtr->sessionsPtr == NULL) || (srvPtr->respHeadersPtr == NULL))
+  {
+    free(srvPtr->handlersPtr);
+    free(srvPtr->sessionsPtr);
+    free(srvPtr->respHeadersPtr);
+    free(srvPtr);
+    return ESP_ERR_HTTPD_ALLOC_MEM;
+  }
+  for (uint32_t idx = 0; idx < configPtr->max_open_sockets; idx++)
+  {
+    srvPtr->sessionsPtr[idx].fd = -1;
+  }
+
+  srvPtr->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  const int enable = 1;
+  setsockopt(srvPtr->listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY),
+                                 .sin_port = htons(srvPtr->config.server_port) };
+  if ((srvPtr->listenFd < 0) ||
+      (bind(srvPtr->listenFd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+      (listen(srvPtr->listenFd, srvPtr->config.backlog_conn) != 0) ||
+      (socketpair(AF_UNIX, SOCK_DGRAM, 0, srvPtr->ctrlFd) != 0))
+  {
+    ESP_LOGE(TAG, "Port %u unavailable: %s", srvPtr->config.server_port, strerror(errno));
+    if (srvPtr->listenFd >= 0)
+    {
+      close(srvPtr->listenFd);
+    }
+    free(srvPtr->handlersPtr);
+    free(srvPtr->sessionsPtr);
+    free(srvPtr->respHeadersPtr);
+    free(srvPtr);
+    return ESP_FAIL;
+  }
+
+  serverPtr = srvPtr;
+  if (xTaskCreate(server_task, "httpd", srvPtr->config.stack_size, srvPtr, srvPtr->config.task_priority,
+                  NULL) != pdPASS)
+  {
+    return ESP_ERR_HTTPD_TASK;
+  }
+
+  ESP_LOGI(TAG, "Listening on port %u", srvPtr->config.server_port);
+  *handlePtr = srvPtr;
+  return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t * uriHandlerPtr)
+{
+  httpdServer_t * srvPtr = handle;
+  if ((srvPtr == NULL) || (uriHandlerPtr == NULL) || (uriHandlerPtr->uri == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (uint32_t idx = 0; idx < srvPtr->handlerCount; idx++)
+  {
+    if ((srvPtr->handlersPtr[idx].method == uriHandlerPtr->method) &&
+        (strcmp(srvPtr->handlersPtr[idx].uri, uriHandlerPtr->uri) == 0))
+    {
+      return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+  }
+  if (srvPtr->handlerCount >= srvPtr->config.max_uri_handlers)
+  {
+    return ESP_ERR_HTTPD_HANDLERS_FULL;
+  }
+
+  srvPtr->handlersPtr[srvPtr->handlerCount++] = *uriHandlerPtr;
+  return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char * referenceUri, const char * uriToMatch, size_t matchUpto)
+{
+  const size_t templateLength = strlen(referenceUri);
+  const char last = (templateLength > 0) ? referenceUri[templateLength - 1] : 0;
+  const char prevLast = (templateLength > 1) ? referenceUri[templateLength - 2] : 0;
+  const bool asterisk = (last == '*') || ((prevLast == '*') && (last == '?'));
+  const bool quest = (last == '?') || ((prevLast == '?') && (last == '*'));
+  size_t exactChars = templateLength - asterisk - quest;
+
+  if (asterisk)
+  {
+    /* Prefixo, com '?' o último caractere do prefixo é opcional */
+    if (matchUpto < exactChars)
+    {
+      if ((quest == false) || (matchUpto + 1 != exactChars))
+      {
+        return false;
+      }
+      exactChars--;
+    }
+    return strncmp(referenceUri, uriToMatch, exactChars) == 0;
+  }
+
+  if (quest && (exactChars > 0) && (matchUpto + 1 == exactChars))
+  {
+    exactChars--;
+  }
+  return (matchUpto == exactChars) && (strncmp(referenceUri, uriToMatch, exactChars) == 0);
+}
+
+const char * http_method_str(int method)
+{
+  return ((method >= 0) && (method < (int)(sizeof(methodNames) / sizeof(methodNames[0])))) ?
+         methodNames[method] : "<unknown>";
+}
+
+esp_err_t httpd_resp_send(httpd_req_t * req, const char * buf, ssize_t bufLen)
+{
+  if ((req == NULL) || (req->aux == NULL))
+  {
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+
+  const size_t length = (bufLen == HTTPD_RESP_USE_STRLEN) ? ((buf != NULL) ? strlen(buf) : 0) : (size_t)bufLen;
+  char framing[40];
+  snprintf(framing, sizeof(framing), "Content-Length: %zu", length);
+  const esp_err_t result = resp_head_send(req, framing);
+  if (result != ESP_OK)
+  {
+    return result;
+  }
+
+  const httpdRequest_t * auxPtr = req->aux;
+  if ((length > 0) && (sock_send(auxPtr->sessPtr->fd, buf, length) != (int)length))
+  {
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t * req, const char * buf, ssize_t bufLen)
+{
+  if ((req == NULL) || (req->aux == NULL))
+  {
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+
+  httpdRequest_t * auxPtr = req->aux;
+  const size_t length = (bufLen == HTTPD_RESP_USE_STRLEN) ? ((buf != NULL) ? strlen(buf) : 0) : (size_t)bufLen;
+  if (auxPtr->chunkStarted == false)
+  {
+    const esp_err_t result = resp_head_send(req, "Transfer-Encoding: chunked");
+    if (result != ESP_OK)
+    {
+      return result;
+    }
+    auxPtr->chunkStarted = true;
+  }
+
+  char sizeLine[20];
+  const int sizeLength = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", length);
+  const int fd = auxPtr->sessPtr->fd;
+  if ((sock_send(fd, sizeLine, sizeLength) != sizeLength) ||
+      ((length > 0) && (sock_send(fd, buf, length) != (int)length)) ||
+      (sock_send(fd, "\r\n", 2) != 2))
+  {
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t * req, const char * str)
+{
+  return httpd_resp_send(req, str, (str != NULL) ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t * req, const char * status)
+{
+  if ((req == NULL) || (req->aux == NULL) || (status == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  ((httpdRequest_t *)req->aux)->statusPtr = status;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t * req, const char * type)
+{
+  if ((req == NULL) || (req->aux == NULL) || (type == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  ((httpdRequest_t *)req->aux)->typePtr = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t * req, const char * field, const char * value)
+{
+  if ((req == NULL) || (req->aux == NULL) || (field == NULL) || (value == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  httpdRequest_t * auxPtr = req->aux;
+  const httpdServer_t * srvPtr = req->handle;
+  if (auxPtr->respHeaderCount >= srvPtr->config.max_resp_headers)
+  {
+    return ESP_ERR_HTTPD_RESP_HDR;
+  }
+  srvPtr->respHeadersPtr[auxPtr->respHeaderCount].fieldPtr = field;
+  srvPtr->respHeadersPtr[auxPtr->respHeaderCount].valuePtr = value;
+  auxPtr->respHeaderCount++;
+  return ESP_OK;
+}
+
+int httpd_send(httpd_req_t * req, const char * buf, size_t bufLen)
+{
+  if ((req == NULL) || (req->aux == NULL) || ((buf == NULL) && (bufLen > 0)))
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  return sock_send(((httpdRequest_t *)req->aux)->sessPtr->fd, buf, bufLen);
+}
+
+int httpd_req_recv(httpd_req_t * req, char * buf, size_t bufLen)
+{
+  if ((req == NULL) || (req->aux == NULL) || (buf == NULL))
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+
+  httpdRequest_t * auxPtr = req->aux;
+  if (auxPtr->remaining == 0)
+  {
+    return 0;
+  }
+
+  const int result = sess_read(auxPtr->sessPtr, buf, (bufLen < auxPtr->remaining) ? bufLen : auxPtr->remaining);
+  if (result > 0)
+  {
+    auxPtr->remaining -= result;
+  }
+  return result;
+}
+
+int httpd_req_to_sockfd(httpd_req_t * req)
+{
+  return ((req != NULL) && (req->aux != NULL)) ? ((httpdRequest_t *)req->aux)->sessPtr->fd : -1;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t * req, const char * field)
+{
+  size_t length = 0;
+  return (header_find(req, field, &length) != NULL) ? length : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t * req, const char * field, char * val, size_t valSize)
+{
+  size_t length = 0;
+  const char * valuePtr = header_find(req, field, &length);
+  if (valuePtr == NULL)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if ((val == NULL) || (valSize == 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const size_t copyLength = (length < valSize) ? length : (valSize - 1);
+  memcpy(val, valuePtr, copyLength);
+  val[copyLength] = '\0';
+  return (copyLength < length) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t * req)
+{
+  const char * queryPtr = (req != NULL) ? strchr(req->uri, '?') : NULL;
+  return (queryPtr != NULL) ? strlen(queryPtr + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t * req, char * buf, size_t bufLen)
+{
+  const char * queryPtr = (req != NULL) ? strchr(req->uri, '?') : NULL;
+  if (queryPtr == NULL)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if ((buf == NULL) || (bufLen == 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const size_t length = strlen(++queryPtr);
+  const size_t copyLength = (length < bufLen) ? length : (bufLen - 1);
+  memcpy(buf, queryPtr, copyLength);
+  buf[copyLength] = '\0';
+  return (copyLength < length) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char * queryPtr, const char * key, char * val, size_t valSize)
+{
+  if ((queryPtr == NULL) || (key == NULL) || (val == NULL) || (valSize == 0))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const size_t keyLength = strlen(key);
+  for (const char * pairPtr = queryPtr; *pairPtr != '\0';)
+  {
+    const size_t pairLength = strcspn(pairPtr, "&");
+    const char * equalPtr = memchr(pairPtr, '=', pairLength);
+    const size_t nameLength = (equalPtr != NULL) ? (size_t)(equalPtr - pairPtr) : pairLength;
+    if ((nameLength == keyLength) && (strncmp(pairPtr, key, keyLength) == 0))
+    {
+      const size_t length = (equalPtr != NULL) ? (pairLength - nameLength - 1) : 0;
+      const size_t copyLength = (length < valSize) ? length : (valSize - 1);
+      memcpy(val, pairPtr + nameLength + 1, copyLength);
+      val[copyLength] = '\0';
+      return (copyLength < length) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+    }
+
+    pairPtr += pairLength;
+    pairPtr += (*pairPtr == '&') ? 1 : 0;
+  }
+
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void * arg)
+{
+  const httpdServer_t * srvPtr = handle;
+  if ((srvPtr == NULL) || (work == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const httpdWork_t message = { .fn = work, .arg = arg };
+  return (send(srvPtr->ctrlFd[1], &message, sizeof(message), 0) == sizeof(message)) ? ESP_OK : ESP_FAIL;
+}
+
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char * buf, size_t bufLen, int flags)
+{
+  if ((handle == NULL) || ((buf == NULL) && (bufLen > 0)))
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  return (session_get(handle, sockfd) != NULL) ? sock_send(sockfd, buf, bufLen) : HTTPD_SOCK_ERR_INVALID;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+  if ((handle == NULL) || (session_get(handle, sockfd) == NULL))
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return httpd_queue_work(handle, session_close_work, (void *)(intptr_t)sockfd);
+}
+
+void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void * ctx, httpd_free_ctx_fn_t freeFn)
+{
+  httpdServer_t * srvPtr = handle;
+  httpdSession_t * sessPtr = (srvPtr != NULL) ? session_get(srvPtr, sockfd) : NULL;
+  if (sessPtr == NULL)
+  {
+    return;
+  }
+
+  /* Dentro de um handler da sessão o contexto vigente está no req */
+  void ** ctxPtr = &sessPtr->ctx;
+  httpd_free_ctx_fn_t * freeFnPtr = &sessPtr->freeFn;
+  httpd_req_t * req = srvPtr->currentReqPtr;
+  if ((req != NULL) && (((httpdRequest_t *)req->aux)->sessPtr == sessPtr))
+  {
+    ctxPtr = &req->sess_ctx;
+    freeFnPtr = &req->free_ctx;
+  }
+
+  /* Como no ESP-IDF, contexto substituído é liberado */
+  if (*ctxPtr != ctx)
+  {
+    ctx_free(*ctxPtr, *freeFnPtr);
+  }
+  *ctxPtr = ctx;
+  *freeFnPtr = freeFn;
+}
+
+void * httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
+{
+  httpdServer_t * srvPtr = handle;
+  httpdSession_t * sessPtr = (srvPtr != NULL) ? session_get(srvPtr, sockfd) : NULL;
+  if (sessPtr == NULL)
+  {
+    return NULL;
+  }
+
+  httpd_req_t * req = srvPtr->currentReqPtr;
+  if ((req != NULL) && (((httpdRequest_t *)req->aux)->sessPtr == sessPtr))
+  {
+    return req->sess_ctx;
+  }
+  return sessPtr->ctx;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t * req, httpd_ws_frame_t * framePtr, size_t maxLen)
+{
+  if ((req == NULL) || (req->aux == NULL) || (framePtr == NULL))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  httpdSession_t * sessPtr = ((httpdRequest_t *)req->aux)->sessPtr;
+  if ((sessPtr->wsHandler < 0) || (sessPtr->ws.headerRead == false))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  /* len = 0 obtém tipo e tamanho do frame, payload em nova chamada */
+  if (framePtr->len == 0)
+  {
+    framePtr->type = sessPtr->ws.type;
+    framePtr->final = sessPtr->ws.final;
+    framePtr->fragmented = false;
+    framePtr->len = sessPtr->ws.length;
+    if (maxLen == 0)
+    {
+      return ESP_OK;
+    }
+  }
+
+  const size_t length = sessPtr->ws.length - sessPtr->ws.offset;
+  if (length == 0)
+  {
+    return ESP_OK;
+  }
+  if ((framePtr->payload == NULL) || (length > maxLen))
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  return ws_payload_read(sessPtr, framePtr->payload, length) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t handle, int fd, httpd_ws_frame_t * framePtr)
+{
+  if ((handle == NULL) || (framePtr == NULL) || ((framePtr->payload == NULL) && (framePtr->len > 0)))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const bool final = framePtr->fragmented ? framePtr->final : true;
+  return (ws_frame_send(fd, framePtr->type, final, framePtr->payload, framePtr->len) == (int)framePtr->len) ?
+         ESP_OK : ESP_FAIL;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task do servidor, atende controle, sessões e novas conexões
+ * 
+ * @param arg   servidor
+ */
+static void server_task(void * arg)
+{
+  httpdServer_t * srvPtr = arg;
+
+  for (;;)
+  {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(srvPtr->ctrlFd[0], &readSet);
+    int maxFd = srvPtr->ctrlFd[0];
+
+    bool sessionFree = false;
+    bool buffered = false;
+    for (uint32_t idx = 0; idx < srvPtr->config.max_open_sockets; idx++)
+    {
+      const int fd = srvPtr->sessionsPtr[idx].fd;
+      sessionFree |= (fd < 0);
+      buffered |= (fd >= 0) && (srvPtr->sessionsPtr[idx].end > srvPtr->sessionsPtr[idx].start);
+      if (fd >= 0)
+      {
+        FD_SET(fd, &readSet);
+        maxFd = (fd > maxFd) ? fd : maxFd;
+      }
+    }
+
+    /* Sem sessão livre e sem LRU, conexões aguardam no backlog */
+    if (sessionFree || srvPtr->config.lru_purge_enable)
+    {
+      FD_SET(srvPtr->listenFd, &readSet);
+      maxFd = (srvPtr->listenFd > maxFd) ? srvPtr->listenFd : maxFd;
+    }
+
+    /* Dados já no buffer de uma sessão (pipelining, frame após o handshake) não acordam o select */
+    struct timeval noWait = { 0 };
+    if (select(maxFd + 1, &readSet, NULL, NULL, buffered ? &noWait : NULL) < 0)
+    {
+      continue;
+    }
+
+    if (FD_ISSET(srvPtr->ctrlFd[0], &readSet))
+    {
+      httpdWork_t message;
+      while (recv(srvPtr->ctrlFd[0], &message, sizeof(message), MSG_DONTWAIT) == sizeof(message))
+      {
+        message.fn(message.arg);
+      }
+    }
+
+    for (uint32_t idx = 0; idx < srvPtr->config.max_open_sockets; idx++)
+    {
+      httpdSession_t * sessPtr = &srvPtr->sessionsPtr[idx];
+      if ((sessPtr->fd < 0) || ((FD_ISSET(sessPtr->fd, &readSet) == 0) && (sessPtr->end == sessPtr->start)))
+      {
+        continue;
+      }
+
+      sessPtr->lruCounter = ++srvPtr->lruCounter;
+      const bool keep = (sessPtr->wsHandler >= 0) ? ws_process(srvPtr, sessPtr) : request_process(srvPtr, sessPtr);
+      if (keep == false)
+      {
+        session_delete(srvPtr, sessPtr);
+      }
+    }
+
+    if (FD_ISSET(srvPtr->listenFd, &readSet))
+    {
+      session_accept(srvPtr);
+    }
+  }
+}
+
+/**
+ * Aceita conexão, encerra a sessão menos recente com todas ocupadas
+ * 
+ * @param srvPtr  servidor
+ */
+static void session_accept(httpdServer_t * srvPtr)
+{
+  const int fd = accept(srvPtr->listenFd, NULL, NULL);
+  if (fd < 0)
+  {
+    return;
+  }
+
+  httpdSession_t * sessPtr = NULL;
+  httpdSession_t * oldestPtr = NULL;
+  for (uint32_t idx = 0; (idx < srvPtr->config.max_open_sockets) && (sessPtr == NULL); idx++)
+  {
+    httpdSession_t * candidatePtr = &srvPtr->sessionsPtr[idx];
+    if (candidatePtr->fd < 0)
+    {
+      sessPtr = candidatePtr;
+    }
+    else if ((oldestPtr == NULL) || (candidatePtr->lruCounter < oldestPtr->lruCounter))
+    {
+      oldestPtr = candidatePtr;
+    }
+  }
+
+  if ((sessPtr == NULL) && srvPtr->config.lru_purge_enable && (oldestPtr != NULL))
+  {
+    ESP_LOGD(TAG, "LRU purge of session %d", oldestPtr->fd);
+    session_delete(srvPtr, oldestPtr);
+    sessPtr = oldestPtr;
+  }
+  if (sessPtr == NULL)
+  {
+    close(fd);
+    return;
+  }
+
+  /* Timeouts da configuração; sem Nagle, respostas em várias escritas não
+     esperam o ACK atrasado do cliente no loopback */
+  const struct timeval recvTimeout = { .tv_sec = srvPtr->config.recv_wait_timeout };
+  const struct timeval sendTimeout = { .tv_sec = srvPtr->config.send_wait_timeout };
+  const int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+  memset(sessPtr, 0, offsetof(httpdSession_t, buffer));
+  sessPtr->fd = fd;
+  sessPtr->wsHandler = -1;
+  sessPtr->start = 0;
+  sessPtr->end = 0;
+  sessPtr->lruCounter = ++srvPtr->lruCounter;
+}
+
+/**
+ * Busca sessão pelo socket
+ * 
+ * @param srvPtr            servidor
+ * @param fd                socket
+ * @return httpdSession_t*  sessão, NULL = não encontrada
+ */
+static httpdSession_t * session_get(httpdServer_t * srvPtr, int fd)
+{
+  for (uint32_t idx = 0; (fd >= 0) && (idx < srvPtr->config.max_open_sockets); idx++)
+  {
+    if (srvPtr->sessionsPtr[idx].fd == fd)
+    {
+      return &srvPtr->sessionsPtr[idx];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Encerra sessão e libera o contexto
+ * 
+ * @param srvPtr    servidor
+ * @param sessPtr   sessão
+ */
+static void session_delete(httpdServer_t * srvPtr, httpdSession_t * sessPtr)
+{
+  const int fd = sessPtr->fd;
+  void * ctx = sessPtr->ctx;
+  const httpd_free_ctx_fn_t freeFn = sessPtr->freeFn;
+
+  sessPtr->ctx = NULL;
+  sessPtr->freeFn = NULL;
+  ctx_free(ctx, freeFn);
+  close(fd);
+  sessPtr->fd = -1;
+}
+
+/**
+ * Encerramento pedido por httpd_sess_trigger_close, na task do servidor
+ * 
+ * @param arg   socket da sessão
+ */
+static void session_close_work(void * arg)
+{
+  httpdSession_t * sessPtr = (serverPtr != NULL) ? session_get(serverPtr, (int)(intptr_t)arg) : NULL;
+  if (sessPtr != NULL)
+  {
+    session_delete(serverPtr, sessPtr);
+  }
+}
+
+/**
+ * Libera contexto de sessão, free() sem função de liberação
+ * 
+ * @param ctx       contexto
+ * @param freeFn    função de liberação
+ */
+static void ctx_free(void * ctx, httpd_free_ctx_fn_t freeFn)
+{
+  if (ctx != NULL)
+  {
+    if (freeFn != NULL)
+    {
+      freeFn(ctx);
+    }
+    else
+    {
+      free(ctx);
+    }
+  }
+}
+
+/**
+ * Recebe e atende uma requisição HTTP da sessão
+ * 
+ * @param srvPtr    servidor
+ * @param sessPtr   sessão com dados
+ * @return true     sessão segue aberta
+ * @return false    sessão deve ser encerrada
+ */
+static bool request_process(httpdServer_t * srvPtr, httpdSession_t * sessPtr)
+{
+  httpdRequest_t aux = { .sessPtr = sessPtr };
+  httpd_req_t request = { .handle = srvPtr, .aux = &aux };
+  httpd_req_t * req = &request;
+
+  size_t headEnd = 0;
+  if (header_receive(sessPtr, &headEnd) == false)
+  {
+    if (sessPtr->end - sessPtr->start >= SESSION_BUFFER_SIZE)
+    {
+      error_send(req, "431 Request Header Fields Too Large", "Header fields are too long");
+    }
+    return false;
+  }
+
+  /* Linha da requisição: método, URI e versão */
+  char * linePtr = (char *)&sessPtr->buffer[sessPtr->start];
+  char * lineEndPtr = strstr(linePtr, "\r\n");
+  char * uriPtr = memchr(linePtr, ' ', lineEndPtr - linePtr);
+  char * versionPtr = (uriPtr != NULL) ? memchr(uriPtr + 1, ' ', lineEndPtr - uriPtr - 1) : NULL;
+  request.method = -1;
+  for (int idx = 0; (uriPtr != NULL) && (idx < (int)(sizeof(methodNames) / sizeof(methodNames[0]))); idx++)
+  {
+    if ((strlen(methodNames[idx]) == (size_t)(uriPtr - linePtr)) &&
+        (strncmp(linePtr, methodNames[idx], uriPtr - linePtr) == 0))
+    {
+      request.method = idx;
+    }
+  }
+
+  aux.headerPtr = lineEndPtr + 2;
+  aux.headerLength = &sessPtr->buffer[headEnd] - (uint8_t *)aux.headerPtr;
+  sessPtr->start = headEnd;
+
+  if ((versionPtr == NULL) || (request.method < 0))
+  {
+    error_send(req, HTTPD_400, "Server unable to understand request due to invalid syntax");
+    return false;
+  }
+
+  const size_t uriLength = versionPtr - uriPtr - 1;
+  if (uriLength > HTTPD_MAX_URI_LEN)
+  {
+    error_send(req, "414 URI Too Long", "URI is too long");
+    return false;
+  }
+  memcpy((char *)request.uri, uriPtr + 1, uriLength);
+
+  char lengthValue[16];
+  if (httpd_req_get_hdr_value_str(req, "Content-Length", lengthValue, sizeof(lengthValue)) == ESP_OK)
+  {
+    request.content_len = strtoul(lengthValue, NULL, 10);
+  }
+  aux.remaining = request.content_len;
+
+  bool uriFound = false;
+  const int32_t handlerIdx = handler_find(srvPtr, request.uri, request.method, &uriFound);
+  if (handlerIdx < 0)
+  {
+    if (uriFound)
+    {
+      error_send(req, "405 Method Not Allowed", "Request method for this URI is not handled by server");
+    }
+    else
+    {
+      error_send(req, HTTPD_404, "Nothing matches the given URI");
+    }
+    return false;
+  }
+
+  if (srvPtr->handlersPtr[handlerIdx].is_websocket)
+  {
+    if (ws_handshake(req) == false)
+    {
+      return false;
+    }
+    sessPtr->wsHandler = handlerIdx;
+    sessPtr->ws.headerRead = false;
+  }
+
+  const bool keep = handler_call(srvPtr, sessPtr, req, handlerIdx);
+
+  /* Corpo não lido pelo handler é descartado, próxima requisição alinhada */
+  char discard[128];
+  while (keep && (aux.remaining > 0))
+  {
+    if (httpd_req_recv(req, discard, sizeof(discard)) <= 0)
+    {
+      return false;
+    }
+  }
+  return keep;
+}
+
+/**
+ * Recebe um frame WebSocket, frames de controle atendidos pelo servidor
+ * 
+ * @param srvPtr    servidor
+ * @param sessPtr   sessão WebSocket com dados
+ * @return true     sessão segue aberta
+ * @return false    sessão deve ser encerrada
+ */
+static bool ws_process(httpdServer_t * srvPtr, httpdSession_t * sessPtr)
+{
+  if (ws_header_read(sessPtr) == false)
+  {
+    return false;
+  }
+
+  const httpd_uri_t * handlerPtr = &srvPtr->handlersPtr[sessPtr->wsHandler];
+  const httpd_ws_type_t type = sessPtr->ws.type;
+  if ((type & 0x8) && (handlerPtr->handle_ws_control_frames == false))
+  {
+    uint8_t payload[WS_CONTROL_MAX];
+    if ((sessPtr->ws.length > sizeof(payload)) || (ws_payload_read(sessPtr, payload, sessPtr->ws.length) == false))
+    {
+      return false;
+    }
+
+    if (type == HTTPD_WS_TYPE_PING)
+    {
+      return ws_frame_send(sessPtr->fd, HTTPD_WS_TYPE_PONG, true, payload, sessPtr->ws.length) >= 0;
+    }
+    if (type == HTTPD_WS_TYPE_CLOSE)
+    {
+      /* Responde com o mesmo código de encerramento */
+      ws_frame_send(sessPtr->fd, HTTPD_WS_TYPE_CLOSE, true, payload, (sessPtr->ws.length >= 2) ? 2 : 0);
+      return false;
+    }
+    return true;
+  }
+
+  httpdRequest_t aux = { .sessPtr = sessPtr };
+  httpd_req_t request = { .handle = srvPtr, .aux = &aux };
+  strncpy((char *)request.uri, handlerPtr->uri, HTTPD_MAX_URI_LEN);
+  bool keep = handler_call(srvPtr, sessPtr, &request, sessPtr->wsHandler);
+
+  /* Payload não lido pelo handler é descartado */
+  uint8_t discard[128];
+  while (keep && (sessPtr->ws.offset < sessPtr->ws.length))
+  {
+    const size_t remaining = sessPtr->ws.length - sessPtr->ws.offset;
+    keep = ws_payload_read(sessPtr, discard, (remaining < sizeof(discard)) ? remaining : sizeof(discard));
+  }
+  sessPtr->ws.headerRead = false;
+  return keep;
+}
+
+/**
+ * Executa handler com o contexto de sessão, regras do ESP-IDF: contexto
+ * alterado pelo handler substitui e libera o anterior, exceto com
+ * ignore_sess_ctx_changes
+ * 
+ * @param srvPtr      servidor
+ * @param sessPtr     sessão
+ * @param req         requisição preenchida
+ * @param handlerIdx  handler
+ * @return true       handler retornou ESP_OK
+ * @return false      sessão deve ser encerrada
+ */
+static bool handler_call(httpdServer_t * srvPtr, httpdSession_t * sessPtr, httpd_req_t * req, int32_t handlerIdx)
+{
+  const httpd_uri_t * handlerPtr = &srvPtr->handlersPtr[handlerIdx];
+  req->user_ctx = handlerPtr->user_ctx;
+  req->sess_ctx = sessPtr->ctx;
+  req->free_ctx = sessPtr->freeFn;
+  req->ignore_sess_ctx_changes = sessPtr->ignoreCtxChanges;
+
+  srvPtr->currentReqPtr = req;
+  const esp_err_t result = handlerPtr->handler(req);
+  srvPtr->currentReqPtr = NULL;
+
+  if ((req->ignore_sess_ctx_changes == false) && (sessPtr->ctx != req->sess_ctx))
+  {
+    ctx_free(sessPtr->ctx, sessPtr->freeFn);
+  }
+  sessPtr->ctx = req->sess_ctx;
+  sessPtr->freeFn = req->free_ctx;
+  sessPtr->ignoreCtxChanges = req->ignore_sess_ctx_changes;
+
+  return result == ESP_OK;
+}
+
+/**
+ * Responde handshake WebSocket da requisição
+ * 
+ * @param req     requisição GET com Upgrade: websocket
+ * @return true   sessão convertida em WebSocket
+ * @return false  requisição inválida, erro enviado
+ */
+static bool ws_handshake(httpd_req_t * req)
+{
+  char upgrade[16];
+  char key[WS_KEY_SIZE];
+  if ((req->method != HTTP_GET) ||
+      (httpd_req_get_hdr_value_str(req, "Upgrade", upgrade, sizeof(upgrade)) != ESP_OK) ||
+      (strcasecmp(upgrade, "websocket") != 0) ||
+      (httpd_req_get_hdr_value_str(req, "Sec-WebSocket-Key", key, sizeof(key)) != ESP_OK))
+  {
+    error_send(req, HTTPD_400, "WebSocket upgrade required");
+    return false;
+  }
+
+  char keyGuid[WS_KEY_SIZE + sizeof(WS_GUID)];
+  uint8_t digest[20];
+  char accept[32];
+  const int keyGuidLength = snprintf(keyGuid, sizeof(keyGuid), "%s%s", key, WS_GUID);
+  sha1((const uint8_t *)keyGuid, keyGuidLength, digest);
+  base64_encode(digest, sizeof(digest), accept);
+
+  char response[160];
+  const int length = snprintf(response, sizeof(response),
+                              "HTTP/1.1 101 Switching Protocols\r\n"
+                              "Upgrade: websocket\r\n"
+                              "Connection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+  return httpd_send(req, response, length) == length;
+}
+
+/**
+ * Recebe cabeçalho de frame WebSocket do cliente
+ * 
+ * @param sessPtr   sessão WebSocket
+ * @return true     cabeçalho em sessPtr->ws
+ * @return false    falha ou frame inválido
+ */
+static bool ws_header_read(httpdSession_t * sessPtr)
+{
+  uint8_t header[2];
+  if (sess_read_all(sessPtr, header, sizeof(header)) == false)
+  {
+    return false;
+  }
+
+  httpdWsState_t * wsPtr = &sessPtr->ws;
+  wsPtr->final = (header[0] & 0x80) != 0;
+  wsPtr->type = header[0] & 0x0F;
+  wsPtr->length = header[1] & 0x7F;
+  wsPtr->offset = 0;
+
+  uint8_t extended[8];
+  const size_t extendedLength = (wsPtr->length == 126) ? 2 : ((wsPtr->length == 127) ? 8 : 0);
+  if ((extendedLength > 0) && (sess_read_all(sessPtr, extended, extendedLength) == false))
+  {
+    return false;
+  }
+  if (extendedLength > 0)
+  {
+    wsPtr->length = 0;
+    for (size_t idx = 0; idx < extendedLength; idx++)
+    {
+      wsPtr->length = (wsPtr->length << 8) | extended[idx];
+    }
+  }
+
+  /* Frames do cliente sempre mascarados (RFC 6455) */
+  if (((header[1] & 0x80) == 0) || (sess_read_all(sessPtr, wsPtr->mask, sizeof(wsPtr->mask)) == false))
+  {
+    return false;
+  }
+
+  wsPtr->headerRead = true;
+  return true;
+}
+
+/**
+ * Recebe parte do payload do frame atual e remove a máscara
+ * 
+ * @param sessPtr     sessão WebSocket
+ * @param payloadPtr  destino
+ * @param length      bytes, até o fim do frame
+ * @return true       bytes recebidos
+ * @return false      falha na recepção
+ */
+static bool ws_payload_read(httpdSession_t * sessPtr, uint8_t * payloadPtr, size_t length)
+{
+  if (sess_read_all(sessPtr, payloadPtr, length) == false)
+  {
+    return false;
+  }
+
+  for (size_t idx = 0; idx < length; idx++)
+  {
+    payloadPtr[idx] ^= sessPtr->ws.mask[(sessPtr->ws.offset + idx) % 4];
+  }
+  sessPtr->ws.offset += length;
+  return true;
+}
+
+/**
+ * Envia frame WebSocket do servidor, sem máscara
+ * 
+ * @param fd          socket
+ * @param type        tipo do frame
+ * @param final       último fragmento
+ * @param payloadPtr  payload
+ * @param length      tamanho do payload
+ * @return int        bytes de payload enviados, < 0 = falha
+ */
+static int ws_frame_send(int fd, httpd_ws_type_t type, bool final, const uint8_t * payloadPtr, size_t length)
+{
+  uint8_t header[10];
+  size_t headerLength = 2;
+  header[0] = (final ? 0x80 : 0) | (type & 0x0F);
+  if (length < 126)
+  {
+    header[1] = length;
+  }
+  else if (length <= 0xFFFF)
+  {
+    header[1] = 126;
+    header[2] = length >> 8;
+    header[3] = length;
+    headerLength = 4;
+  }
+  else
+  {
+    header[1] = 127;
+    for (size_t idx = 0; idx < 8; idx++)
+    {
+      header[2 + idx] = (uint64_t)length >> (8 * (7 - idx));
+    }
+    headerLength = 10;
+  }
+
+  if (sock_send(fd, header, headerLength) != (int)headerLength)
+  {
+    return HTTPD_SOCK_ERR_FAIL;
+  }
+  return (length > 0) ? sock_send(fd, payloadPtr, length) : 0;
+}
+
+/**
+ * Recebe cabeçalho da requisição até a linha em branco
+ * 
+ * @param sessPtr     sessão
+ * @param headEndPtr  índice no buffer após a linha em branco
+ * @return true       cabeçalho completo, terminado em '\0'
+ * @return false      conexão encerrada, timeout ou cabeçalho longo demais
+ */
+static bool header_receive(httpdSession_t * sessPtr, size_t * headEndPtr)
+{
+  /* Requisição anterior consumida, restante (pipelining) no início do buffer */
+  if (sessPtr->start > 0)
+  {
+    memmove(sessPtr->buffer, &sessPtr->buffer[sessPtr->start], sessPtr->end - sessPtr->start);
+    sessPtr->end -= sessPtr->start;
+    sessPtr->start = 0;
+  }
+
+  for (;;)
+  {
+    const uint8_t * endPtr = memmem(sessPtr->buffer, sessPtr->end, "\r\n\r\n", 4);
+    if (endPtr != NULL)
+    {
+      *headEndPtr = endPtr - sessPtr->buffer + 4;
+      /* Termina a última linha de cabeçalho, "\r\n" final fica fora das buscas */
+      sessPtr->buffer[*headEndPtr - 2] = '\0';
+      return true;
+    }
+
+    if (sessPtr->end >= SESSION_BUFFER_SIZE)
+    {
+      return false;
+    }
+
+    const ssize_t length = recv(sessPtr->fd, &sessPtr->buffer[sessPtr->end], SESSION_BUFFER_SIZE - sessPtr->end, 0);
+    if ((length < 0) && (errno == EINTR))
+    {
+      continue;
+    }
+    if (length <= 0)
+    {
+      return false;
+    }
+    sessPtr->end += length;
+  }
+}
+
+/**
+ * Busca campo do cabeçalho da requisição, nome sem diferenciar maiúsculas
+ * 
+ * @param req           requisição
+ * @param fieldPtr      nome do campo
+ * @param lengthPtr     tamanho do valor
+ * @return const char*  início do valor, NULL = campo ausente
+ */
+static const char * header_find(httpd_req_t * req, const char * fieldPtr, size_t * lengthPtr)
+{
+  if ((req == NULL) || (req->aux == NULL) || (fieldPtr == NULL))
+  {
+    return NULL;
+  }
+
+  const httpdRequest_t * auxPtr = req->aux;
+  const size_t fieldLength = strlen(fieldPtr);
+  const char * endPtr = auxPtr->headerPtr + auxPtr->headerLength;
+  for (const char * linePtr = auxPtr->headerPtr; linePtr < endPtr;)
+  {
+    const char * lineEndPtr = strstr(linePtr, "\r\n");
+    lineEndPtr = (lineEndPtr != NULL) ? lineEndPtr : (linePtr + strlen(linePtr));
+
+    if (((size_t)(lineEndPtr - linePtr) > fieldLength) && (linePtr[fieldLength] == ':') &&
+        (strncasecmp(linePtr, fieldPtr, fieldLength) == 0))
+    {
+      const char * valuePtr = linePtr + fieldLength + 1;
+      while ((valuePtr < lineEndPtr) && (*valuePtr == ' '))
+      {
+        valuePtr++;
+      }
+      const char * valueEndPtr = lineEndPtr;
+      while ((valueEndPtr > valuePtr) && (valueEndPtr[-1] == ' '))
+      {
+        valueEndPtr--;
+      }
+      *lengthPtr = valueEndPtr - valuePtr;
+      return valuePtr;
+    }
+
+    linePtr = lineEndPtr + 2;
+  }
+
+  return NULL;
+}
+
+/**
+ * Busca handler da URI e método, comparação até o início da query
+ * 
+ * @param srvPtr        servidor
+ * @param uriPtr        URI da requisição
+ * @param method        método
+ * @param uriFoundPtr   URI atendida por outro método
+ * @return int32_t      índice do handler, -1 = não encontrado
+ */
+static int32_t handler_find(httpdServer_t * srvPtr, const char * uriPtr, int method, bool * uriFoundPtr)
+{
+  const size_t matchUpto = strcspn(uriPtr, "?");
+  for (uint32_t idx = 0; idx < srvPtr->handlerCount; idx++)
+  {
+    const httpd_uri_t * handlerPtr = &srvPtr->handlersPtr[idx];
+    const bool match = (srvPtr->config.uri_match_fn != NULL) ?
+                       srvPtr->config.uri_match_fn(handlerPtr->uri, uriPtr, matchUpto) :
+                       ((strlen(handlerPtr->uri) == matchUpto) && (strncmp(handlerPtr->uri, uriPtr, matchUpto) == 0));
+    if (match && ((int)handlerPtr->method == method))
+    {
+      return idx;
+    }
+    *uriFoundPtr |= match;
+  }
+  return -1;
+}
+
+/**
+ * Envia resposta de erro do servidor
+ * 
+ * @param req         requisição
+ * @param statusPtr   código HTTP
+ * @param messagePtr  corpo da resposta
+ * @return esp_err_t  resultado do envio
+ */
+static esp_err_t error_send(httpd_req_t * req, const char * statusPtr, const char * messagePtr)
+{
+  httpd_resp_set_status(req, statusPtr);
+  httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+  return httpd_resp_sendstr(req, messagePtr);
+}
+
+/**
+ * Envia linha de status e cabeçalhos da resposta
+ * 
+ * @param req         requisição
+ * @param framingPtr  Content-Length ou Transfer-Encoding
+ * @return esp_err_t  ESP_OK ou falha no envio
+ */
+static esp_err_t resp_head_send(httpd_req_t * req, const char * framingPtr)
+{
+  const httpdRequest_t * auxPtr = req->aux;
+  const httpdServer_t * srvPtr = req->handle;
+  char head[RESP_HEAD_SIZE];
+  size_t length = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s\r\n",
+                           (auxPtr->statusPtr != NULL) ? auxPtr->statusPtr : HTTPD_200,
+                           (auxPtr->typePtr != NULL) ? auxPtr->typePtr : HTTPD_TYPE_TEXT, framingPtr);
+
+  for (uint32_t idx = 0; (idx < auxPtr->respHeaderCount) && (length < sizeof(head)); idx++)
+  {
+    length += snprintf(&head[length], sizeof(head) - length, "%s: %s\r\n",
+                       srvPtr->respHeadersPtr[idx].fieldPtr, srvPtr->respHeadersPtr[idx].valuePtr);
+  }
+  if (length < sizeof(head))
+  {
+    length += snprintf(&head[length], sizeof(head) - length, "\r\n");
+  }
+  if (length >= sizeof(head))
+  {
+    return ESP_ERR_HTTPD_RESP_HDR;
+  }
+
+  return (sock_send(auxPtr->sessPtr->fd, head, length) == (int)length) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+/**
+ * Lê da sessão, primeiro os bytes já no buffer
+ * 
+ * @param sessPtr   sessão
+ * @param bufPtr    destino
+ * @param length    bytes máximos
+ * @return int      bytes lidos, 0 = conexão encerrada, < 0 = HTTPD_SOCK_ERR_*
+ */
+static int sess_read(httpdSession_t * sessPtr, void * bufPtr, size_t length)
+{
+  const size_t buffered = sessPtr->end - sessPtr->start;
+  if (buffered > 0)
+  {
+    const size_t count = (buffered < length) ? buffered : length;
+    memcpy(bufPtr, &sessPtr->buffer[sessPtr->start], count);
+    sessPtr->start += count;
+    return count;
+  }
+
+  for (;;)
+  {
+    const ssize_t result = recv(sessPtr->fd, bufPtr, length, 0);
+    if (result >= 0)
+    {
+      return result;
+    }
+    if (errno != EINTR)
+    {
+      return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+  }
+}
+
+/**
+ * Lê exatamente length bytes da sessão
+ * 
+ * @param sessPtr   sessão
+ * @param bufPtr    destino
+ * @param length    bytes
+ * @return true     bytes recebidos
+ * @return false    conexão encerrada ou timeout
+ */
+static bool sess_read_all(httpdSession_t * sessPtr, void * bufPtr, size_t length)
+{
+  for (size_t received = 0; received < length;)
+  {
+    const int result = sess_read(sessPtr, (uint8_t *)bufPtr + received, length - received);
+    if (result <= 0)
+    {
+      return false;
+    }
+    received += result;
+  }
+  return true;
+}
+
+/**
+ * Envia todos os bytes, timeout do socket limita a espera
+ * 
+ * @param fd        socket
+ * @param bufPtr    dados
+ * @param length    bytes
+ * @return int      bytes enviados ou HTTPD_SOCK_ERR_*
+ */
+static int sock_send(int fd, const void * bufPtr, size_t length)
+{
+  for (size_t sent = 0; sent < length;)
+  {
+    const ssize_t result = send(fd, (const uint8_t *)bufPtr + sent, length - sent, MSG_NOSIGNAL);
+    if ((result < 0) && (errno != EINTR))
+    {
+      return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    sent += (result > 0) ? result : 0;
+  }
+  return length;
+}
+
+/**
+ * SHA-1 (RFC 3174), usado somente no handshake WebSocket
+ * 
+ * @param dataPtr   mensagem
+ * @param length    tamanho da mensagem
+ * @param digest    resumo de 20 bytes
+ */
+static void sha1(const uint8_t * dataPtr, size_t length, uint8_t digest[20])
+{
+  uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  const uint64_t bitLength = (uint64_t)length * 8;
+  const size_t paddedLength = ((length + 8) / 64 + 1) * 64;
+
+  for (size_t blockStart = 0; blockStart < paddedLength; blockStart += 64)
+  {
+    uint32_t words[80];
+    for (size_t idx = 0; idx < 64; idx++)
+    {
+      const size_t pos = blockStart + idx;
+      uint8_t byte = 0;
+      if (pos < length)
+      {
+        byte = dataPtr[pos];
+      }
+      else if (pos == length)
+      {
+        byte = 0x80;
+      }
+      else if (pos >= paddedLength - 8)
+      {
+        byte = bitLength >> (8 * (paddedLength - 1 - pos));
+      }
+      words[idx / 4] = ((idx % 4 == 0) ? 0 : (words[idx / 4] << 8)) | byte;
+    }
+    for (size_t idx = 16; idx < 80; idx++)
+    {
+      const uint32_t value = words[idx - 3] ^ words[idx - 8] ^ words[idx - 14] ^ words[idx - 16];
+      words[idx] = (value << 1) | (value >> 31);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (size_t idx = 0; idx < 80; idx++)
+    {
+      uint32_t f, k;
+      if (idx < 20)
+      {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      }
+      else if (idx < 40)
+      {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      }
+      else if (idx < 60)
+      {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      }
+      else
+      {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      const uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + words[idx];
+      e = d;
+      d = c;
+      c = (b << 30) | (b >> 2);
+      b = a;
+      a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+
+  for (size_t idx = 0; idx < 20; idx++)
+  {
+    digest[idx] = state[idx / 4] >> (8 * (3 - idx % 4));
+  }
+}
+
+/**
+ * Codifica em base64 com padding
+ * 
+ * @param dataPtr   dados
+ * @param length    tamanho dos dados
+ * @param outPtr    destino, 4 * ceil(length / 3) + 1 bytes
+ */
+static void base64_encode(const uint8_t * dataPtr, size_t length, char * outPtr)
+{
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  for (size_t idx = 0; idx < length; idx += 3)
+  {
+    const uint32_t group = ((uint32_t)dataPtr[idx] << 16) |
+                           ((idx + 1 < length) ? ((uint32_t)dataPtr[idx + 1] << 8) : 0) |
+                           ((idx + 2 < length) ? dataPtr[idx + 2] : 0);
+    *outPtr++ = alphabet[(group >> 18) & 0x3F];
+    *outPtr++ = alphabet[(group >> 12) & 0x3F];
+    *outPtr++ = (idx + 1 < length) ? alphabet[(group >> 6) & 0x3F] : '=';
+    *outPtr++ = (idx + 2 < length) ? alphabet[group & 0x3F] : '=';
+  }
+  *outPtr = '\0';
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,127 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Build do firmware para Linux, usado nos testes de carga. Application e
+ * Service compilam sem alteração sobre os shims de Tools/host/shim:
+ * FreeRTOS sobre pthreads, esp_http_server sobre sockets (uma task, como
+ * no ESP-IDF), NVS e Wi-Fi em memória com redes simuladas, e as UARTs dos
+ * módulos PLC sobre o pty do plc_sim. malloc/calloc/realloc/free são
+ * interceptados pelo linker e contabilizados num heap virtual do tamanho
+ * da DRAM livre do ESP32, lido por /metrics como no dispositivo.
+ * 
+ * Build (cJSON compilado do fonte para que suas alocações sejam contadas):
+ *   gcc -O2 -pthread -ITools/host -ITools/host/shim -IService -IApplication \
+ *       -IApplication/endpoints -I<cjson> Tools/host/[a-z]*.c Application/[a-z]*.c \
+ *       Application/endpoints/[a-z]*.c Service/[a-z]*.c <cjson>/cJSON.c \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free -o powerline_host
+ * 
+ * Uso:
+ *   powerline_host [-p porta_http] [-u pty[,pty]] [-m heap_kb] [-v]
+ * 
+ *   -u: escravos do pty das UARTs 1 e 2, sem -u módulos PLC ausentes e, como
+ *       no dispositivo, servidores iniciam durante as tentativas de configuração
+ *   -v: log em nível debug
+ * 
+ * Exemplo com o simulador do módulo e o gerador de carga:
+ *   plc_sim -n 8 -l /tmp/plc0 &
+ *   powerline_host -p 8080 -u /tmp/plc0 &
+ *   http_load -H 127.0.0.1 -P 8080 -c 4 -d 30
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "driver/uart.h"
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+void app_main(void);
+static void usage(const char * programPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Configura o host a partir da linha de comando e executa app_main
+ * 
+ * @param argc    quantidade de argumentos
+ * @param argv    argumentos
+ * @return int    código de saída, somente em erro de argumentos
+ */
+int main(int argc, char * argv[])
+{
+  int option;
+  while ((option = getopt(argc, argv, "p:u:m:v")) != -1)
+  {
+    switch (option)
+    {
+      case 'p':
+        host_httpd_set_port(atoi(optarg));
+        break;
+
+      case 'u':
+      {
+        /* Primeira porta PLC na UART_NUM_1, segunda na UART_NUM_2 */
+        char * separatorPtr = strchr(optarg, ',');
+        if (separatorPtr != NULL)
+        {
+          *separatorPtr = '\0';
+          host_uart_set_device(UART_NUM_2, separatorPtr + 1);
+        }
+        host_uart_set_device(UART_NUM_1, optarg);
+        break;
+      }
+
+      case 'm':
+        host_heap_set_size((size_t)atoi(optarg) * 1024);
+        break;
+
+      case 'v':
+        esp_log_level_set("*", ESP_LOG_DEBUG);
+        break;
+
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  app_main();
+
+  /* Como no ESP-IDF, a execução segue nas tasks criadas por app_main */
+  for (;;)
+  {
+    pause();
+  }
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Escreve forma de uso
+ * 
+ * @param programPtr  nome do executável
+ */
+static void usage(const char * programPtr)
+{
+  fprintf(stderr, "usage: %s [-p http_port] [-u pty[,pty]] [-m heap_kb] [-v]\n", programPtr);
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
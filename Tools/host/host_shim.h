@@ -0,0 +1,42 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Heap virtual padrão, DRAM livre típica do ESP32 após o boot */
+#define HOST_HEAP_DEFAULT_SIZE  (160 * 1024)
+/* Pilha real das threads, o tamanho pedido pela task é de 32 bits */
+#define HOST_STACK_SIZE         (256 * 1024)
+/* Tamanho das partições simuladas em RAM */
+#define HOST_PARTITION_SIZE     (256 * 1024)
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void host_heap_set_size(size_t size);
+void host_httpd_set_port(uint16_t port);
+void host_uart_set_device(uint32_t uartNum, const char * pathPtr);
+void host_deadline(TickType_t ticksToWait, struct timespec * deadlinePtr);
+void host_cond_init(pthread_cond_t * condPtr);
+bool host_cond_wait(pthread_cond_t * condPtr, pthread_mutex_t * mutexPtr, const struct timespec * deadlinePtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
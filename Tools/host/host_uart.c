@@ -0,0 +1,288 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Driver UART do host sobre um dispositivo de caracteres, normalmente o
+ * escravo do pty aberto pelo plc_sim. Uma thread por porta faz o papel da
+ * interrupção: lê o dispositivo em blocos do tamanho da FIFO, guarda no
+ * buffer circular de recepção e publica UART_DATA / UART_BUFFER_FULL na
+ * fila de eventos, como o driver do ESP-IDF.
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "driver/uart.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* FIFO de recepção do ESP32 */
+#define UART_FIFO_SIZE      128
+/* Espera antes de nova leitura com o simulador encerrado */
+#define REOPEN_DELAY_US     100000
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct uartPort_t
+{
+  const char * pathPtr;
+  int fd;
+  bool installed;
+  QueueHandle_t eventQueue;
+  pthread_t reader;
+  pthread_mutex_t mutex;
+  pthread_cond_t dataCond;
+  uint8_t * rxPtr;
+  size_t rxSize;
+  size_t rxHead;
+  size_t rxUsed;
+} uartPort_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char *TAG = "HOST_UART";
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static uartPort_t ports[UART_NUM_MAX];
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void * reader_thread(void * arg);
+static void event_post(uartPort_t * portPtr, uart_event_type_t type, size_t size);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Define dispositivo de uma porta, antes de uart_driver_install
+ * 
+ * @param uartNum   porta, UART_NUM_1 = primeira porta PLC
+ * @param pathPtr   caminho do dispositivo, ex. /dev/pts/3
+ */
+void host_uart_set_device(uint32_t uartNum, const char * pathPtr)
+{
+  if (uartNum < UART_NUM_MAX)
+  {
+    ports[uartNum].pathPtr = pathPtr;
+  }
+}
+
+esp_err_t uart_param_config(uart_port_t uartNum, const uart_config_t * configPtr)
+{
+  return (uartNum < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t uartNum, int rxBufferSize, int txBufferSize, int queueSize,
+                              QueueHandle_t * queuePtr, int intrAllocFlags)
+{
+  if ((uartNum >= UART_NUM_MAX) || ports[uartNum].installed || (rxBufferSize <= UART_FIFO_SIZE))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uartPort_t * portPtr = &ports[uartNum];
+  portPtr->rxPtr = malloc(rxBufferSize);
+  if (portPtr->rxPtr == NULL)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  portPtr->rxSize = rxBufferSize;
+  pthread_mutex_init(&portPtr->mutex, NULL);
+  host_cond_init(&portPtr->dataCond);
+
+  if (queuePtr != NULL)
+  {
+    portPtr->eventQueue = xQueueCreate(queueSize, sizeof(uart_event_t));
+    *queuePtr = portPtr->eventQueue;
+  }
+
+  portPtr->fd = -1;
+  portPtr->installed = true;
+  if (portPtr->pathPtr == NULL)
+  {
+    /* Sem dispositivo, linha sem módulo conectado */
+    ESP_LOGW(TAG, "UART[%d] without device, PLC module absent", uartNum);
+    return ESP_OK;
+  }
+
+  portPtr->fd = open(portPtr->pathPtr, O_RDWR | O_NOCTTY);
+  if (portPtr->fd < 0)
+  {
+    ESP_LOGE(TAG, "UART[%d] open '%s' failed: %s", uartNum, portPtr->pathPtr, strerror(errno));
+    return ESP_FAIL;
+  }
+
+  struct termios tty;
+  if (tcgetattr(portPtr->fd, &tty) == 0)
+  {
+    cfmakeraw(&tty);
+    tcsetattr(portPtr->fd, TCSANOW, &tty);
+  }
+
+  pthread_create(&portPtr->reader, NULL, reader_thread, portPtr);
+  ESP_LOGI(TAG, "UART[%d] on '%s'", uartNum, portPtr->pathPtr);
+  return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uartNum, int txPin, int rxPin, int rtsPin, int ctsPin)
+{
+  return (uartNum < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+int uart_write_bytes(uart_port_t uartNum, const void * srcPtr, size_t size)
+{
+  if ((uartNum >= UART_NUM_MAX) || (ports[uartNum].installed == false))
+  {
+    return -1;
+  }
+
+  const int fd = ports[uartNum].fd;
+  for (size_t written = 0; (fd >= 0) && (written < size);)
+  {
+    const ssize_t result = write(fd, (const uint8_t *)srcPtr + written, size - written);
+    if ((result < 0) && (errno != EINTR))
+    {
+      return -1;
+    }
+    written += (result > 0) ? result : 0;
+  }
+
+  return size;
+}
+
+int uart_read_bytes(uart_port_t uartNum, void * bufferPtr, uint32_t length, TickType_t ticksToWait)
+{
+  if ((uartNum >= UART_NUM_MAX) || (ports[uartNum].installed == false))
+  {
+    return -1;
+  }
+
+  uartPort_t * portPtr = &ports[uartNum];
+  struct timespec deadline;
+  host_deadline(ticksToWait, &deadline);
+
+  /* Como no ESP-IDF, aguarda o tamanho pedido ou o fim da espera */
+  pthread_mutex_lock(&portPtr->mutex);
+  while ((portPtr->rxUsed < length) && (ticksToWait != 0) &&
+         host_cond_wait(&portPtr->dataCond, &portPtr->mutex, (ticksToWait == portMAX_DELAY) ? NULL : &deadline))
+  {
+  }
+
+  const size_t count = (portPtr->rxUsed < length) ? portPtr->rxUsed : length;
+  for (size_t idx = 0; idx < count; idx++)
+  {
+    ((uint8_t *)bufferPtr)[idx] = portPtr->rxPtr[(portPtr->rxHead + idx) % portPtr->rxSize];
+  }
+  portPtr->rxHead = (portPtr->rxHead + count) % portPtr->rxSize;
+  portPtr->rxUsed -= count;
+  pthread_mutex_unlock(&portPtr->mutex);
+
+  return count;
+}
+
+esp_err_t uart_flush_input(uart_port_t uartNum)
+{
+  if ((uartNum >= UART_NUM_MAX) || (ports[uartNum].installed == false))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uartPort_t * portPtr = &ports[uartNum];
+  pthread_mutex_lock(&portPtr->mutex);
+  portPtr->rxHead = 0;
+  portPtr->rxUsed = 0;
+  pthread_mutex_unlock(&portPtr->mutex);
+  return ESP_OK;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Recepção de uma porta, papel da interrupção do driver
+ * 
+ * @param arg     porta
+ * @return void*  sem retorno
+ */
+static void * reader_thread(void * arg)
+{
+  uartPort_t * portPtr = arg;
+  uint8_t fifo[UART_FIFO_SIZE];
+  bool lost = false;
+
+  for (;;)
+  {
+    const ssize_t length = read(portPtr->fd, fifo, sizeof(fifo));
+    if (length <= 0)
+    {
+      /* Simulador encerrado (EIO no pty), aguarda nova conexão no mesmo caminho */
+      if ((lost == false) && (errno != EINTR))
+      {
+        ESP_LOGW(TAG, "UART device '%s' lost", portPtr->pathPtr);
+        lost = true;
+      }
+      usleep(REOPEN_DELAY_US);
+      continue;
+    }
+    lost = false;
+
+    pthread_mutex_lock(&portPtr->mutex);
+    const bool fits = (portPtr->rxSize - portPtr->rxUsed) >= (size_t)length;
+    if (fits)
+    {
+      for (ssize_t idx = 0; idx < length; idx++)
+      {
+        portPtr->rxPtr[(portPtr->rxHead + portPtr->rxUsed + idx) % portPtr->rxSize] = fifo[idx];
+      }
+      portPtr->rxUsed += length;
+      pthread_cond_broadcast(&portPtr->dataCond);
+    }
+    pthread_mutex_unlock(&portPtr->mutex);
+
+    /* Buffer cheio, bytes da FIFO descartados */
+    event_post(portPtr, fits ? UART_DATA : UART_BUFFER_FULL, fits ? length : 0);
+  }
+
+  return NULL;
+}
+
+/**
+ * Publica evento na fila da porta sem bloquear, evento perdido com a fila cheia
+ * 
+ * @param portPtr   porta
+ * @param type      tipo do evento
+ * @param size      bytes recebidos
+ */
+static void event_post(uartPort_t * portPtr, uart_event_type_t type, size_t size)
+{
+  if (portPtr->eventQueue != NULL)
+  {
+    const uart_event_t event = { .type = type, .size = size };
+    xQueueSend(portPtr->eventQueue, &event, 0);
+  }
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
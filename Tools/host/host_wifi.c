@@ -0,0 +1,525 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Rede do host: loop de eventos, Wi-Fi simulado, NVS em RAM, SNTP e mDNS.
+ * A estação conecta quando o SSID configurado está na varredura simulada
+ * (PowerLine-Host ou Visitantes), entregando IP_EVENT_STA_GOT_IP como o
+ * driver do ESP32.
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include "host_shim.h"
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_sntp.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "mdns.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define MAX_EVENT_HANDLERS      8
+#define EVENT_QUEUE_SIZE        16
+#define EVENT_DATA_SIZE         64
+/* Tempo de associação e DHCP da estação simulada */
+#define WIFI_CONNECT_MS         500
+#define NVS_MAX_ENTRIES         16
+/* Chave de até 15 caracteres, como no NVS */
+#define NVS_KEY_SIZE            16
+#define NVS_VALUE_SIZE          128
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+struct hostNetif_t
+{
+  wifi_interface_t interface;
+};
+
+typedef struct eventHandler_t
+{
+  esp_event_base_t eventBase;
+  int32_t eventId;
+  esp_event_handler_t handler;
+  void * handlerArg;
+} eventHandler_t;
+
+typedef struct eventMessage_t
+{
+  esp_event_base_t eventBase;
+  int32_t eventId;
+  uint8_t data[EVENT_DATA_SIZE];
+} eventMessage_t;
+
+typedef struct nvsEntry_t
+{
+  char key[NVS_KEY_SIZE];
+  char value[NVS_VALUE_SIZE];
+} nvsEntry_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+static const char *TAG = "HOST_WIFI";
+
+/* Redes retornadas pela varredura simulada */
+static const wifi_ap_record_t networks[] = {
+  {
+    .bssid = { 0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56 },
+    .ssid = "PowerLine-Host",
+    .primary = 6,
+    .rssi = -52,
+    .authmode = WIFI_AUTH_WPA2_PSK,
+  },
+  {
+    .bssid = { 0x24, 0x0A, 0xC4, 0x65, 0x43, 0x21 },
+    .ssid = "Visitantes",
+    .primary = 11,
+    .rssi = -78,
+    .authmode = WIFI_AUTH_OPEN,
+  },
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static pthread_mutex_t stateMutex = PTHREAD_MUTEX_INITIALIZER;
+static QueueHandle_t eventQueue;
+static eventHandler_t handlers[MAX_EVENT_HANDLERS];
+static uint32_t handlerCount;
+
+static struct hostNetif_t staNetif = { .interface = WIFI_IF_STA };
+static struct hostNetif_t apNetif = { .interface = WIFI_IF_AP };
+static wifi_config_t staConfig;
+static wifi_config_t apConfig;
+static bool wifiStarted;
+static bool staConnected;
+static esp_timer_handle_t connectTimer;
+
+static bool sntpEnabled;
+
+static bool nvsInitialized;
+static nvsEntry_t nvsEntries[NVS_MAX_ENTRIES];
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static void event_task(void * pvParameters);
+static void connect_timer_callback(void * arg);
+static nvsEntry_t * nvs_find(const char * keyPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t esp_event_loop_create_default(void)
+{
+  if (eventQueue != NULL)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  eventQueue = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(eventMessage_t));
+  xTaskCreate(event_task, "sys_evt", 2304, NULL, 20, NULL);
+  return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t eventBase, int32_t eventId, esp_event_handler_t handler,
+                                     void * handlerArg)
+{
+  esp_err_t result = ESP_ERR_NO_MEM;
+  pthread_mutex_lock(&stateMutex);
+  if (handlerCount < MAX_EVENT_HANDLERS)
+  {
+    handlers[handlerCount++] = (eventHandler_t) {
+      .eventBase = eventBase,
+      .eventId = eventId,
+      .handler = handler,
+      .handlerArg = handlerArg,
+    };
+    result = ESP_OK;
+  }
+  pthread_mutex_unlock(&stateMutex);
+  return result;
+}
+
+esp_err_t esp_event_post(esp_event_base_t eventBase, int32_t eventId, const void * eventDataPtr,
+                         size_t eventDataSize, TickType_t ticksToWait)
+{
+  if ((eventQueue == NULL) || (eventDataSize > EVENT_DATA_SIZE))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  eventMessage_t message = { .eventBase = eventBase, .eventId = eventId };
+  if (eventDataPtr != NULL)
+  {
+    memcpy(message.data, eventDataPtr, eventDataSize);
+  }
+  return (xQueueSend(eventQueue, &message, ticksToWait) == pdPASS) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t esp_netif_init(void)
+{
+  return ESP_OK;
+}
+
+esp_netif_t * esp_netif_create_default_wifi_sta(void)
+{
+  return &staNetif;
+}
+
+esp_netif_t * esp_netif_create_default_wifi_ap(void)
+{
+  return &apNetif;
+}
+
+esp_err_t tcpip_adapter_get_ip_info(tcpip_adapter_if_t interface, tcpip_adapter_ip_info_t * ipInfoPtr)
+{
+  memset(ipInfoPtr, 0, sizeof(tcpip_adapter_ip_info_t));
+  pthread_mutex_lock(&stateMutex);
+  if ((interface == TCPIP_ADAPTER_IF_STA) && staConnected)
+  {
+    ipInfoPtr->ip.addr = htonl(INADDR_LOOPBACK);
+    ipInfoPtr->netmask.addr = htonl(IN_CLASSA_NET);
+    ipInfoPtr->gw.addr = htonl(INADDR_LOOPBACK);
+  }
+  pthread_mutex_unlock(&stateMutex);
+  return ESP_OK;
+}
+
+char * ip4addr_ntoa(const ip4_addr_t * addrPtr)
+{
+  static char text[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addrPtr->addr, text, sizeof(text));
+  return text;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t * configPtr)
+{
+  const esp_timer_create_args_t timerArgs = {
+    .callback = connect_timer_callback,
+    .name = "wifi_connect",
+  };
+  return esp_timer_create(&timerArgs, &connectTimer);
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+  ESP_LOGI(TAG, "Mode %d", mode);
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+  pthread_mutex_lock(&stateMutex);
+  wifiStarted = true;
+  pthread_mutex_unlock(&stateMutex);
+  return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, portMAX_DELAY);
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+  pthread_mutex_lock(&stateMutex);
+  const bool started = wifiStarted;
+  pthread_mutex_unlock(&stateMutex);
+  if (started == false)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  /* Conexão em andamento mantida */
+  esp_timer_start_once(connectTimer, WIFI_CONNECT_MS * 1000);
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+  pthread_mutex_lock(&stateMutex);
+  const bool wasConnected = staConnected;
+  staConnected = false;
+  pthread_mutex_unlock(&stateMutex);
+
+  esp_timer_stop(connectTimer);
+  if (wasConnected)
+  {
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL, 0, portMAX_DELAY);
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t * configPtr)
+{
+  pthread_mutex_lock(&stateMutex);
+  memcpy((interface == WIFI_IF_STA) ? &staConfig : &apConfig, configPtr, sizeof(wifi_config_t));
+  pthread_mutex_unlock(&stateMutex);
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t * configPtr)
+{
+  pthread_mutex_lock(&stateMutex);
+  memcpy(configPtr, (interface == WIFI_IF_STA) ? &staConfig : &apConfig, sizeof(wifi_config_t));
+  pthread_mutex_unlock(&stateMutex);
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t * configPtr, bool block)
+{
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t * numberPtr, wifi_ap_record_t * apRecordsPtr)
+{
+  const uint16_t count = sizeof(networks) / sizeof(networks[0]);
+  *numberPtr = (*numberPtr < count) ? *numberPtr : count;
+  memcpy(apRecordsPtr, networks, *numberPtr * sizeof(wifi_ap_record_t));
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t * numberPtr)
+{
+  *numberPtr = sizeof(networks) / sizeof(networks[0]);
+  return ESP_OK;
+}
+
+void sntp_setoperatingmode(uint8_t operatingMode)
+{
+}
+
+void sntp_setservername(uint8_t idx, const char * serverPtr)
+{
+}
+
+void sntp_init(void)
+{
+  sntpEnabled = true;
+}
+
+bool sntp_enabled(void)
+{
+  return sntpEnabled;
+}
+
+esp_err_t mdns_init(void)
+{
+  return ESP_OK;
+}
+
+esp_err_t mdns_hostname_set(const char * hostnamePtr)
+{
+  return ESP_OK;
+}
+
+esp_err_t mdns_instance_name_set(const char * instanceNamePtr)
+{
+  return ESP_OK;
+}
+
+esp_err_t mdns_service_add(const char * instanceNamePtr, const char * serviceTypePtr, const char * protoPtr,
+                           uint16_t port, mdns_txt_item_t txtItems[], size_t numItems)
+{
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+  nvsInitialized = true;
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+  pthread_mutex_lock(&stateMutex);
+  memset(nvsEntries, 0, sizeof(nvsEntries));
+  pthread_mutex_unlock(&stateMutex);
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char * namespacePtr, nvs_open_mode_t openMode, nvs_handle_t * handlePtr)
+{
+  /* Namespace único, somente "storage" é usado */
+  *handlePtr = 1;
+  return nvsInitialized ? ESP_OK : ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char * keyPtr, char * outValuePtr, size_t * lengthPtr)
+{
+  esp_err_t result = ESP_ERR_NVS_NOT_FOUND;
+  pthread_mutex_lock(&stateMutex);
+  const nvsEntry_t * entryPtr = nvs_find(keyPtr);
+  if (entryPtr != NULL)
+  {
+    const size_t needed = strlen(entryPtr->value) + 1;
+    if (outValuePtr == NULL)
+    {
+      result = ESP_OK;
+    }
+    else if (*lengthPtr < needed)
+    {
+      result = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    else
+    {
+      memcpy(outValuePtr, entryPtr->value, needed);
+      result = ESP_OK;
+    }
+    *lengthPtr = needed;
+  }
+  pthread_mutex_unlock(&stateMutex);
+  return result;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char * keyPtr, const char * valuePtr)
+{
+  if ((strlen(keyPtr) >= NVS_KEY_SIZE) || (strlen(valuePtr) >= NVS_VALUE_SIZE))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t result = ESP_ERR_NVS_NO_FREE_PAGES;
+  pthread_mutex_lock(&stateMutex);
+  nvsEntry_t * entryPtr = nvs_find(keyPtr);
+  if (entryPtr == NULL)
+  {
+    /* Posição livre */
+    entryPtr = nvs_find("");
+  }
+  if (entryPtr != NULL)
+  {
+    strcpy(entryPtr->key, keyPtr);
+    strcpy(entryPtr->value, valuePtr);
+    result = ESP_OK;
+  }
+  pthread_mutex_unlock(&stateMutex);
+  return result;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char * keyPtr)
+{
+  esp_err_t result = ESP_ERR_NVS_NOT_FOUND;
+  pthread_mutex_lock(&stateMutex);
+  nvsEntry_t * entryPtr = nvs_find(keyPtr);
+  if (entryPtr != NULL)
+  {
+    memset(entryPtr, 0, sizeof(nvsEntry_t));
+    result = ESP_OK;
+  }
+  pthread_mutex_unlock(&stateMutex);
+  return result;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Task do loop de eventos padrão, handlers executados em ordem de registro
+ * 
+ * @param pvParameters  não utilizado
+ */
+static void event_task(void * pvParameters)
+{
+  eventMessage_t message;
+  for (;;)
+  {
+    if (xQueueReceive(eventQueue, &message, portMAX_DELAY) != pdPASS)
+    {
+      continue;
+    }
+
+    pthread_mutex_lock(&stateMutex);
+    const uint32_t count = handlerCount;
+    pthread_mutex_unlock(&stateMutex);
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+      const eventHandler_t * handlerPtr = &handlers[idx];
+      if ((handlerPtr->eventBase == message.eventBase) &&
+          ((handlerPtr->eventId == ESP_EVENT_ANY_ID) || (handlerPtr->eventId == message.eventId)))
+      {
+        handlerPtr->handler(handlerPtr->handlerArg, message.eventBase, message.eventId, message.data);
+      }
+    }
+  }
+}
+
+/**
+ * Conclui tentativa de conexão da estação simulada
+ * 
+ * @param arg   não utilizado
+ */
+static void connect_timer_callback(void * arg)
+{
+  bool found = false;
+  pthread_mutex_lock(&stateMutex);
+  for (uint32_t idx = 0; idx < (sizeof(networks) / sizeof(networks[0])); idx++)
+  {
+    found |= strncmp((const char *)networks[idx].ssid, (const char *)staConfig.sta.ssid,
+                     sizeof(staConfig.sta.ssid)) == 0;
+  }
+  staConnected = found;
+  pthread_mutex_unlock(&stateMutex);
+
+  ESP_LOGI(TAG, "Station '%.32s' %s", staConfig.sta.ssid, found ? "connected" : "not found");
+  if (found)
+  {
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, NULL, 0, portMAX_DELAY);
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, portMAX_DELAY);
+  }
+  else
+  {
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL, 0, portMAX_DELAY);
+  }
+}
+
+/**
+ * Localiza entrada do NVS pela chave, mutex tomado
+ * 
+ * @param keyPtr        chave, "" = posição livre
+ * @return nvsEntry_t*  entrada, NULL = inexistente
+ */
+static nvsEntry_t * nvs_find(const char * keyPtr)
+{
+  for (uint32_t idx = 0; idx < NVS_MAX_ENTRIES; idx++)
+  {
+    if (strcmp(nvsEntries[idx].key, keyPtr) == 0)
+    {
+      return &nvsEntries[idx];
+    }
+  }
+
+  return NULL;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,25 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_GPIO_H
+#define SHIM_GPIO_H
+
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Pinos somente repassados a uart_set_pin */
+typedef enum
+{
+  GPIO_NUM_16 = 16,
+  GPIO_NUM_17 = 17,
+  GPIO_NUM_22 = 22,
+  GPIO_NUM_23 = 23,
+} gpio_num_t;
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,114 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_UART_H
+#define SHIM_UART_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define UART_PIN_NO_CHANGE  -1
+
+typedef enum
+{
+  UART_NUM_0,
+  UART_NUM_1,
+  UART_NUM_2,
+  UART_NUM_MAX,
+} uart_port_t;
+
+typedef enum
+{
+  UART_DATA,
+  UART_BREAK,
+  UART_BUFFER_FULL,
+  UART_FIFO_OVF,
+  UART_FRAME_ERR,
+  UART_PARITY_ERR,
+} uart_event_type_t;
+
+typedef enum
+{
+  UART_DATA_5_BITS,
+  UART_DATA_6_BITS,
+  UART_DATA_7_BITS,
+  UART_DATA_8_BITS,
+} uart_word_length_t;
+
+typedef enum
+{
+  UART_PARITY_DISABLE = 0,
+  UART_PARITY_EVEN = 2,
+  UART_PARITY_ODD = 3,
+} uart_parity_t;
+
+typedef enum
+{
+  UART_STOP_BITS_1 = 1,
+  UART_STOP_BITS_2 = 3,
+} uart_stop_bits_t;
+
+typedef enum
+{
+  UART_HW_FLOWCTRL_DISABLE,
+  UART_HW_FLOWCTRL_RTS,
+  UART_HW_FLOWCTRL_CTS,
+  UART_HW_FLOWCTRL_CTS_RTS,
+} uart_hw_flowcontrol_t;
+
+typedef enum
+{
+  UART_SCLK_APB,
+  UART_SCLK_REF_TICK,
+} uart_sclk_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct
+{
+  int baud_rate;
+  uart_word_length_t data_bits;
+  uart_parity_t parity;
+  uart_stop_bits_t stop_bits;
+  uart_hw_flowcontrol_t flow_ctrl;
+  uint8_t rx_flow_ctrl_thresh;
+  uart_sclk_t source_clk;
+} uart_config_t;
+
+typedef struct
+{
+  uart_event_type_t type;
+  size_t size;
+  bool timeout_flag;
+} uart_event_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Porta ligada ao dispositivo definido por host_uart_set_device (pty do plc_sim),
+   sem dispositivo se comporta como módulo ausente */
+esp_err_t uart_param_config(uart_port_t uartNum, const uart_config_t * configPtr);
+esp_err_t uart_driver_install(uart_port_t uartNum, int rxBufferSize, int txBufferSize, int queueSize,
+                              QueueHandle_t * queuePtr, int intrAllocFlags);
+esp_err_t uart_set_pin(uart_port_t uartNum, int txPin, int rxPin, int rtsPin, int ctsPin);
+int uart_write_bytes(uart_port_t uartNum, const void * srcPtr, size_t size);
+int uart_read_bytes(uart_port_t uartNum, void * bufferPtr, uint32_t length, TickType_t ticksToWait);
+esp_err_t uart_flush_input(uart_port_t uartNum);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
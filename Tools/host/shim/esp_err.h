@@ -0,0 +1,50 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_ERR_H
+#define SHIM_ESP_ERR_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_TIMEOUT         0x107
+
+/* Como no ESP-IDF, erro encerra o processo */
+#define ESP_ERROR_CHECK(x)                                                          \
+  do                                                                                \
+  {                                                                                 \
+    const esp_err_t checkResult = (x);                                              \
+    if (checkResult != ESP_OK)                                                      \
+    {                                                                               \
+      fprintf(stderr, "ESP_ERROR_CHECK failed: 0x%x at %s:%d\n", checkResult,      \
+              __FILE__, __LINE__);                                                  \
+      abort();                                                                      \
+    }                                                                               \
+  } while (0)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef int esp_err_t;
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,43 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_EVENT_H
+#define SHIM_ESP_EVENT_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define ESP_EVENT_ANY_ID                -1
+#define ESP_EVENT_DECLARE_BASE(id)      extern esp_event_base_t const id
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef const char * esp_event_base_t;
+typedef void (*esp_event_handler_t)(void * handlerArg, esp_event_base_t eventBase, int32_t eventId,
+                                    void * eventDataPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Loop padrão executado pela task "sys_evt" */
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_register(esp_event_base_t eventBase, int32_t eventId, esp_event_handler_t handler,
+                                     void * handlerArg);
+esp_err_t esp_event_post(esp_event_base_t eventBase, int32_t eventId, const void * eventDataPtr,
+                         size_t eventDataSize, TickType_t ticksToWait);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,182 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_HTTP_SERVER_H
+#define SHIM_ESP_HTTP_SERVER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+#include "esp_err.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define HTTPD_MAX_URI_LEN       512
+#define HTTPD_RESP_USE_STRLEN   -1
+
+#define HTTPD_200               "200 OK"
+#define HTTPD_204               "204 No Content"
+#define HTTPD_207               "207 Multi-Status"
+#define HTTPD_400               "400 Bad Request"
+#define HTTPD_404               "404 Not Found"
+#define HTTPD_408               "408 Request Timeout"
+#define HTTPD_500               "500 Internal Server Error"
+
+#define HTTPD_TYPE_JSON         "application/json"
+#define HTTPD_TYPE_TEXT         "text/html"
+#define HTTPD_TYPE_OCTET        "application/octet-stream"
+
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_INVALID  -2
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+#define ESP_ERR_HTTPD_BASE              0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ       (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC      (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR          (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND         (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_ALLOC_MEM         (ESP_ERR_HTTPD_BASE + 7)
+#define ESP_ERR_HTTPD_TASK              (ESP_ERR_HTTPD_BASE + 8)
+
+/* Servidor do host com os limites do ESP-IDF, porta definida por host_httpd_set_port */
+#define HTTPD_DEFAULT_CONFIG() {          \
+  .task_priority = 5,                     \
+  .stack_size = 4096,                     \
+  .core_id = 0x7FFFFFFF,                  \
+  .server_port = 80,                      \
+  .ctrl_port = 32768,                     \
+  .max_open_sockets = 7,                  \
+  .max_uri_handlers = 8,                  \
+  .max_resp_headers = 8,                  \
+  .backlog_conn = 5,                      \
+  .lru_purge_enable = false,              \
+  .recv_wait_timeout = 5,                 \
+  .send_wait_timeout = 5,                 \
+  .uri_match_fn = NULL,                   \
+}
+
+/* Numeração do http_parser */
+typedef enum
+{
+  HTTP_DELETE = 0,
+  HTTP_GET = 1,
+  HTTP_HEAD = 2,
+  HTTP_POST = 3,
+  HTTP_PUT = 4,
+} httpd_method_t;
+
+typedef enum
+{
+  HTTPD_WS_TYPE_CONTINUE = 0x0,
+  HTTPD_WS_TYPE_TEXT = 0x1,
+  HTTPD_WS_TYPE_BINARY = 0x2,
+  HTTPD_WS_TYPE_CLOSE = 0x8,
+  HTTPD_WS_TYPE_PING = 0x9,
+  HTTPD_WS_TYPE_PONG = 0xA,
+} httpd_ws_type_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef void * httpd_handle_t;
+typedef void (*httpd_free_ctx_fn_t)(void * ctx);
+typedef void (*httpd_work_fn_t)(void * arg);
+typedef bool (*httpd_uri_match_func_t)(const char * referenceUri, const char * uriToMatch, size_t matchUpto);
+
+typedef struct httpd_config
+{
+  unsigned task_priority;
+  size_t stack_size;
+  int core_id;
+  uint16_t server_port;
+  uint16_t ctrl_port;
+  uint16_t max_open_sockets;
+  uint16_t max_uri_handlers;
+  uint16_t max_resp_headers;
+  uint16_t backlog_conn;
+  bool lru_purge_enable;
+  uint16_t recv_wait_timeout;
+  uint16_t send_wait_timeout;
+  httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+typedef struct httpd_req
+{
+  httpd_handle_t handle;
+  int method;
+  const char uri[HTTPD_MAX_URI_LEN + 1];
+  size_t content_len;
+  void * aux;
+  void * user_ctx;
+  void * sess_ctx;
+  httpd_free_ctx_fn_t free_ctx;
+  bool ignore_sess_ctx_changes;
+} httpd_req_t;
+
+typedef struct httpd_uri
+{
+  const char * uri;
+  httpd_method_t method;
+  esp_err_t (*handler)(httpd_req_t * req);
+  void * user_ctx;
+  bool is_websocket;
+  bool handle_ws_control_frames;
+  const char * supported_subprotocol;
+} httpd_uri_t;
+
+typedef struct httpd_ws_frame
+{
+  bool final;
+  bool fragmented;
+  httpd_ws_type_t type;
+  uint8_t * payload;
+  size_t len;
+} httpd_ws_frame_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t httpd_start(httpd_handle_t * handlePtr, const httpd_config_t * configPtr);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t * uriHandlerPtr);
+bool httpd_uri_match_wildcard(const char * referenceUri, const char * uriToMatch, size_t matchUpto);
+const char * http_method_str(int method);
+
+esp_err_t httpd_resp_send(httpd_req_t * req, const char * buf, ssize_t bufLen);
+esp_err_t httpd_resp_send_chunk(httpd_req_t * req, const char * buf, ssize_t bufLen);
+esp_err_t httpd_resp_sendstr(httpd_req_t * req, const char * str);
+esp_err_t httpd_resp_set_status(httpd_req_t * req, const char * status);
+esp_err_t httpd_resp_set_type(httpd_req_t * req, const char * type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t * req, const char * field, const char * value);
+int httpd_send(httpd_req_t * req, const char * buf, size_t bufLen);
+int httpd_req_recv(httpd_req_t * req, char * buf, size_t bufLen);
+int httpd_req_to_sockfd(httpd_req_t * req);
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t * req, const char * field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t * req, const char * field, char * val, size_t valSize);
+size_t httpd_req_get_url_query_len(httpd_req_t * req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t * req, char * buf, size_t bufLen);
+esp_err_t httpd_query_key_value(const char * queryPtr, const char * key, char * val, size_t valSize);
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void * arg);
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char * buf, size_t bufLen, int flags);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void * ctx, httpd_free_ctx_fn_t freeFn);
+void * httpd_sess_get_ctx(httpd_handle_t handle, int sockfd);
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t * req, httpd_ws_frame_t * framePtr, size_t maxLen);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t handle, int fd, httpd_ws_frame_t * framePtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,67 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_NETIF_H
+#define SHIM_ESP_NETIF_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+typedef enum
+{
+  IP_EVENT_STA_GOT_IP,
+  IP_EVENT_STA_LOST_IP,
+} ip_event_t;
+
+typedef enum
+{
+  TCPIP_ADAPTER_IF_STA = 0,
+  TCPIP_ADAPTER_IF_AP,
+} tcpip_adapter_if_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct hostNetif_t esp_netif_t;
+
+/* Endereço em ordem de rede, como no lwIP */
+typedef struct
+{
+  uint32_t addr;
+} ip4_addr_t;
+
+typedef struct
+{
+  ip4_addr_t ip;
+  ip4_addr_t netmask;
+  ip4_addr_t gw;
+} tcpip_adapter_ip_info_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t esp_netif_init(void);
+esp_netif_t * esp_netif_create_default_wifi_sta(void);
+esp_netif_t * esp_netif_create_default_wifi_ap(void);
+/* Endereço da estação após IP_EVENT_STA_GOT_IP, loopback no host */
+esp_err_t tcpip_adapter_get_ip_info(tcpip_adapter_if_t interface, tcpip_adapter_ip_info_t * ipInfoPtr);
+char * ip4addr_ntoa(const ip4_addr_t * addrPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
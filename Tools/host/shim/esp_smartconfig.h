@@ -0,0 +1,19 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_SMARTCONFIG_H
+#define SHIM_ESP_SMARTCONFIG_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+/* SmartConfig não usado pelo firmware, incluído somente por wifi_config.c */
+#include "esp_err.h"
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
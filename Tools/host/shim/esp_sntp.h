@@ -0,0 +1,32 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_SNTP_H
+#define SHIM_ESP_SNTP_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define SNTP_OPMODE_POLL    0
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Relógio do host já sincronizado, somente registra o início */
+void sntp_setoperatingmode(uint8_t operatingMode);
+void sntp_setservername(uint8_t idx, const char * serverPtr);
+void sntp_init(void);
+bool sntp_enabled(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
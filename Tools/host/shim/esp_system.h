@@ -0,0 +1,24 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_SYSTEM_H
+#define SHIM_ESP_SYSTEM_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+uint32_t esp_random(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,52 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_TIMER_H
+#define SHIM_ESP_TIMER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+typedef enum
+{
+  ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Callbacks executados em sequência pela thread "esp_timer" */
+typedef struct hostTimer_t * esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void * arg);
+
+typedef struct
+{
+  esp_timer_cb_t callback;
+  void * arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char * name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Microssegundos desde o início do processo, monotônico */
+int64_t esp_timer_get_time(void);
+esp_err_t esp_timer_create(const esp_timer_create_args_t * argsPtr, esp_timer_handle_t * handlePtr);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
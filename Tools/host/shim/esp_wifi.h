@@ -0,0 +1,120 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_WIFI_H
+#define SHIM_ESP_WIFI_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define WIFI_INIT_CONFIG_DEFAULT()  { .magic = 0x1F2F3F4F }
+
+typedef enum
+{
+  WIFI_IF_STA = 0,
+  WIFI_IF_AP,
+} wifi_interface_t;
+
+typedef enum
+{
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+typedef enum
+{
+  WIFI_AUTH_OPEN = 0,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+} wifi_auth_mode_t;
+
+typedef enum
+{
+  WIFI_EVENT_STA_START = 2,
+  WIFI_EVENT_STA_STOP,
+  WIFI_EVENT_STA_CONNECTED,
+  WIFI_EVENT_STA_DISCONNECTED,
+} wifi_event_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct
+{
+  int magic;
+} wifi_init_config_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t password[64];
+} wifi_sta_config_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t password[64];
+  uint8_t ssid_len;
+  uint8_t channel;
+  wifi_auth_mode_t authmode;
+  uint8_t ssid_hidden;
+  uint8_t max_connection;
+  uint16_t beacon_interval;
+} wifi_ap_config_t;
+
+typedef union
+{
+  wifi_ap_config_t ap;
+  wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct
+{
+  uint8_t bssid[6];
+  uint8_t ssid[33];
+  uint8_t primary;
+  int8_t rssi;
+  wifi_auth_mode_t authmode;
+} wifi_ap_record_t;
+
+typedef struct wifi_scan_config_t wifi_scan_config_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Rádio simulado: redes fixas na varredura, conexão aceita para SSID presente nela */
+esp_err_t esp_wifi_init(const wifi_init_config_t * configPtr);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_connect(void);
+esp_err_t esp_wifi_disconnect(void);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t * configPtr);
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t * configPtr);
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t * configPtr, bool block);
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t * numberPtr, wifi_ap_record_t * apRecordsPtr);
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t * numberPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
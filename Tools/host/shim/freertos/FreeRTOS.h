@@ -0,0 +1,50 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_FREERTOS_H
+#define SHIM_FREERTOS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_bit_defs.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Shim FreeRTOS sobre pthreads, tick e núcleos iguais aos do ESP32 */
+#define configTICK_RATE_HZ  100
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define portNUM_PROCESSORS  2
+#define portMAX_DELAY       0xFFFFFFFFU
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+
+#define portTickType        TickType_t
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Núcleo virtual da task em execução, fixado na criação */
+BaseType_t xPortGetCoreID(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,33 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_EVENT_GROUPS_H
+#define SHIM_EVENT_GROUPS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct hostEventGroup_t * EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bitsToSet);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bitsToClear);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bitsToWait, BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticksToWait);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
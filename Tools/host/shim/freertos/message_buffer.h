@@ -0,0 +1,34 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_MESSAGE_BUFFER_H
+#define SHIM_MESSAGE_BUFFER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Cada mensagem ocupa seu tamanho mais 4 bytes de cabeçalho, como no ESP32 */
+typedef struct hostMessageBuffer_t * MessageBufferHandle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+MessageBufferHandle_t xMessageBufferCreate(size_t bufferSize);
+size_t xMessageBufferSend(MessageBufferHandle_t buffer, const void * dataPtr, size_t dataLength,
+                          TickType_t ticksToWait);
+size_t xMessageBufferReceive(MessageBufferHandle_t buffer, void * rxDataPtr, size_t bufferLength,
+                             TickType_t ticksToWait);
+BaseType_t xMessageBufferReset(MessageBufferHandle_t buffer);
+BaseType_t xMessageBufferIsEmpty(MessageBufferHandle_t buffer);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
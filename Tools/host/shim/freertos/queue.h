@@ -0,0 +1,33 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_QUEUE_H
+#define SHIM_QUEUE_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Fila de itens de tamanho fixo, semáforos são filas de itens vazios */
+typedef struct hostQueue_t * QueueHandle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * itemPtr, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void * bufferPtr, TickType_t ticksToWait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,36 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_SEMPHR_H
+#define SHIM_SEMPHR_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/queue.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Como no FreeRTOS, semáforo é uma fila de um item sem dados */
+#define xSemaphoreTake(semaphore, ticksToWait)  xQueueReceive((semaphore), NULL, (ticksToWait))
+#define xSemaphoreGive(semaphore)               xQueueSend((semaphore), NULL, 0)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef QueueHandle_t SemaphoreHandle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Mutex criado disponível, binário criado vazio */
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
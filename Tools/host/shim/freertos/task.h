@@ -0,0 +1,41 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_TASK_H
+#define SHIM_TASK_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Task executada em uma thread, prioridade ignorada pelo escalonador do host */
+typedef struct hostTask_t * TaskHandle_t;
+typedef void (*TaskFunction_t)(void * pvParameters);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char * namePtr, uint32_t stackDepth, void * pvParameters,
+                       UBaseType_t priority, TaskHandle_t * createdTaskPtr);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char * namePtr, uint32_t stackDepth,
+                                   void * pvParameters, UBaseType_t priority, TaskHandle_t * createdTaskPtr,
+                                   BaseType_t coreId);
+void vTaskDelay(TickType_t ticksToDelay);
+void vTaskDelayUntil(TickType_t * previousWakeTimePtr, TickType_t timeIncrement);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetHandle(const char * namePtr);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,25 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_SOCKETS_H
+#define SHIM_SOCKETS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+/* API BSD do lwIP equivalente à do host */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
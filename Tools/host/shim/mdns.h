@@ -0,0 +1,38 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_MDNS_H
+#define SHIM_MDNS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct
+{
+  const char * key;
+  const char * value;
+} mdns_txt_item_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Anúncio mDNS não publicado no host */
+esp_err_t mdns_init(void);
+esp_err_t mdns_hostname_set(const char * hostnamePtr);
+esp_err_t mdns_instance_name_set(const char * instanceNamePtr);
+esp_err_t mdns_service_add(const char * instanceNamePtr, const char * serviceTypePtr, const char * protoPtr,
+                           uint16_t port, mdns_txt_item_t txtItems[], size_t numItems);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,51 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_NVS_H
+#define SHIM_NVS_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define ESP_ERR_NVS_BASE                0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED     (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND           (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_LENGTH      (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (ESP_ERR_NVS_BASE + 0x10)
+
+typedef enum
+{
+  NVS_READONLY,
+  NVS_READWRITE,
+} nvs_open_mode_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef uint32_t nvs_handle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Chaves mantidas em RAM, apagadas a cada execução */
+esp_err_t nvs_open(const char * namespacePtr, nvs_open_mode_t openMode, nvs_handle_t * handlePtr);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char * keyPtr, char * outValuePtr, size_t * lengthPtr);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char * keyPtr, const char * valuePtr);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char * keyPtr);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
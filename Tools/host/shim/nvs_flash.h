@@ -0,0 +1,23 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_NVS_FLASH_H
+#define SHIM_NVS_FLASH_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "esp_err.h"
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
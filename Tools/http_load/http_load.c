@@ -0,0 +1,874 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Gerador de carga HTTP para a API do gateway. Mistura configurável de
+ * GET /plc/topology, POST /plc/io e GET /wifi/info sobre conexões
+ * keep-alive, em malha fechada ou com taxa fixa (-R, latência medida a
+ * partir do instante planejado, sem omissão coordenada).
+ * 
+ * Heap do dispositivo é amostrado em /metrics durante a execução.
+ * 
+ * Build:
+ *   gcc -O2 -pthread Tools/http_load/http_load.c -o http_load
+ * 
+ * Uso:
+ *   http_load -H host [-P porta] [-c conexões] [-d segundos] [-R req/s]
+ *             [-m topology=60,io=30,wifi=10] [-M mac[,mac...]]
+ *             [-o resultado.csv] [-B baseline.csv]
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define MAX_CONNECTIONS     64
+#define MAX_MACS            32
+#define RESPONSE_SIZE       8192
+#define REQUEST_SIZE        512
+#define SOCKET_TIMEOUT_S    10
+#define METRICS_PERIOD_US   500000
+
+typedef enum endpoint_t
+{
+  ENDPOINT_TOPOLOGY = 0,
+  ENDPOINT_IO,
+  ENDPOINT_WIFI,
+  ENDPOINT_COUNT,
+} endpoint_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Latências registradas por um worker, em us */
+typedef struct samples_t
+{
+  uint32_t * valuesPtr;
+  uint32_t count;
+  uint32_t capacity;
+  uint64_t errors;
+} samples_t;
+
+typedef struct worker_t
+{
+  pthread_t thread;
+  uint32_t id;
+  int fd;
+  uint64_t randomState;
+  samples_t samples[ENDPOINT_COUNT];
+} worker_t;
+
+/* Resultado de um endpoint, também formato do CSV */
+typedef struct result_t
+{
+  uint64_t requests;
+  uint64_t errors;
+  double rps;
+  double p50Ms;
+  double p99Ms;
+  double p999Ms;
+  double maxMs;
+} result_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const endpointNames[ENDPOINT_COUNT] = {
+  [ENDPOINT_TOPOLOGY] = "topology",
+  [ENDPOINT_IO] = "io",
+  [ENDPOINT_WIFI] = "wifi",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static struct addrinfo * serverAddress;
+static const char * hostPtr;
+static uint32_t connections = 4;
+static double durationSeconds = 10;
+static double targetRate;
+static uint32_t mixWeights[ENDPOINT_COUNT] = { 60, 30, 10 };
+static uint32_t mixTotal = 100;
+static char macs[MAX_MACS][18];
+static uint32_t macCount;
+static int64_t startUs;
+static int64_t endUs;
+static volatile bool running = true;
+/* Amostras de /metrics */
+static uint64_t heapFreeMin = UINT64_MAX;
+static uint64_t heapFreeStart;
+static uint64_t heapMinFreeStart;
+static uint64_t heapMinFreeEnd;
+static uint32_t metricsSamples;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static int64_t now_us(void);
+static uint32_t random_next(uint64_t * statePtr);
+static bool parse_mix(const char * mixPtr);
+static void parse_macs(const char * listPtr);
+static int connect_server(void);
+static int http_request(int * fdPtr, const char * requestPtr, size_t requestLength, char * bodyPtr, size_t bodySize);
+static size_t build_request(endpoint_t endpoint, worker_t * workerPtr, char * requestPtr, size_t requestSize);
+static void * worker_run(void * argumentPtr);
+static void * metrics_run(void * argumentPtr);
+static bool metrics_sample(int * fdPtr, uint64_t * heapFreePtr, uint64_t * heapMinFreePtr);
+static void samples_add(samples_t * samplesPtr, uint32_t valueUs);
+static int compare_u32(const void * aPtr, const void * bPtr);
+static void result_compute(endpoint_t endpoint, worker_t * workers, result_t * resultPtr);
+static void result_print(const char * namePtr, const result_t * resultPtr, const result_t * baselinePtr);
+static bool baseline_load(const char * pathPtr, result_t * baselinePtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+int main(int argc, char * argv[])
+{
+  const char * portPtr = "80";
+  const char * outputPathPtr = NULL;
+  const char * baselinePathPtr = NULL;
+  int option;
+
+  while ((option = getopt(argc, argv, "H:P:c:d:R:m:M:o:B:")) != -1)
+  {
+    switch (option)
+    {
+      case 'H': hostPtr = optarg; break;
+      case 'P': portPtr = optarg; break;
+      case 'c': connections = strtoul(optarg, NULL, 10); break;
+      case 'd': durationSeconds = atof(optarg); break;
+      case 'R': targetRate = atof(optarg); break;
+      case 'M': parse_macs(optarg); break;
+      case 'o': outputPathPtr = optarg; break;
+      case 'B': baselinePathPtr = optarg; break;
+      case 'm':
+        if (parse_mix(optarg) == false)
+        {
+          fprintf(stderr, "invalid mix '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      default:
+        hostPtr = NULL;
+        break;
+    }
+  }
+
+  if ((hostPtr == NULL) || (connections == 0) || (connections > MAX_CONNECTIONS) || (durationSeconds <= 0))
+  {
+    fprintf(stderr, "usage: %s -H host [-P port] [-c connections 1..%u] [-d seconds] [-R req/s] "
+                    "[-m topology=60,io=30,wifi=10] [-M mac,...] [-o out.csv] [-B baseline.csv]\n",
+            argv[0], MAX_CONNECTIONS);
+    return 1;
+  }
+
+  if ((mixWeights[ENDPOINT_IO] != 0) && (macCount == 0))
+  {
+    /* Sem MACs informados, IO para uma estação inexistente (resposta de erro do módulo) */
+    parse_macs("00:11:22:33:00:01");
+  }
+
+  struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+  int error = getaddrinfo(hostPtr, portPtr, &hints, &serverAddress);
+  if (error != 0)
+  {
+    fprintf(stderr, "%s: %s\n", hostPtr, gai_strerror(error));
+    return 1;
+  }
+
+  /* Heap inicial, ignora resultado quando /metrics não está disponível */
+  int metricsFd = -1;
+  metrics_sample(&metricsFd, &heapFreeStart, &heapMinFreeStart);
+
+  static worker_t workers[MAX_CONNECTIONS];
+  pthread_t metricsThread;
+  startUs = now_us();
+  endUs = startUs + (int64_t)(durationSeconds * 1e6);
+
+  for (uint32_t idx = 0; idx < connections; idx++)
+  {
+    workers[idx].id = idx;
+    workers[idx].fd = -1;
+    workers[idx].randomState = 0x9E3779B97F4A7C15ULL * (idx + 1);
+    pthread_create(&workers[idx].thread, NULL, worker_run, &workers[idx]);
+  }
+  pthread_create(&metricsThread, NULL, metrics_run, &metricsFd);
+
+  for (uint32_t idx = 0; idx < connections; idx++)
+  {
+    pthread_join(workers[idx].thread, NULL);
+  }
+  running = false;
+  pthread_join(metricsThread, NULL);
+  const double elapsedSeconds = (now_us() - startUs) / 1e6;
+
+  result_t results[ENDPOINT_COUNT + 1];
+  result_t baselines[ENDPOINT_COUNT + 1];
+  const bool hasBaseline = (baselinePathPtr != NULL) && baseline_load(baselinePathPtr, baselines);
+
+  printf("%s:%s, %u connections, %.1f s, %s\n", hostPtr, portPtr, connections, elapsedSeconds,
+         targetRate > 0 ? "open loop" : "closed loop");
+  printf("%-10s %9s %7s %9s %9s %9s %9s %9s\n", "endpoint", "requests", "errors", "req/s", "p50 ms",
+         "p99 ms", "p999 ms", "max ms");
+
+  for (uint32_t endpoint = 0; endpoint <= ENDPOINT_COUNT; endpoint++)
+  {
+    /* ENDPOINT_COUNT = todos os endpoints */
+    result_compute(endpoint, workers, &results[endpoint]);
+    results[endpoint].rps = results[endpoint].requests / elapsedSeconds;
+    if (results[endpoint].requests != 0)
+    {
+      result_print(endpoint < ENDPOINT_COUNT ? endpointNames[endpoint] : "all", &results[endpoint],
+                   hasBaseline ? &baselines[endpoint] : NULL);
+    }
+  }
+
+  if ((targetRate > 0) && (results[ENDPOINT_COUNT].rps < targetRate * 0.95))
+  {
+    printf("target rate %.1f req/s not sustained, latencies include queueing behind schedule\n", targetRate);
+  }
+
+  if (metricsSamples != 0)
+  {
+    printf("heap: free at start %llu, lowest free %llu (peak use +%lld), min free %llu -> %llu\n",
+           (unsigned long long)heapFreeStart, (unsigned long long)heapFreeMin,
+           (long long)heapFreeStart - (long long)heapFreeMin, (unsigned long long)heapMinFreeStart,
+           (unsigned long long)heapMinFreeEnd);
+  }
+
+  if (outputPathPtr != NULL)
+  {
+    FILE * file = fopen(outputPathPtr, "w");
+    if (file == NULL)
+    {
+      perror(outputPathPtr);
+      return 1;
+    }
+    fprintf(file, "endpoint,requests,errors,rps,p50_ms,p99_ms,p999_ms,max_ms\n");
+    for (uint32_t endpoint = 0; endpoint <= ENDPOINT_COUNT; endpoint++)
+    {
+      const result_t * resultPtr = &results[endpoint];
+      fprintf(file, "%s,%llu,%llu,%.2f,%.3f,%.3f,%.3f,%.3f\n",
+              endpoint < ENDPOINT_COUNT ? endpointNames[endpoint] : "all",
+              (unsigned long long)resultPtr->requests, (unsigned long long)resultPtr->errors,
+              resultPtr->rps, resultPtr->p50Ms, resultPtr->p99Ms, resultPtr->p999Ms, resultPtr->maxMs);
+    }
+    fclose(file);
+  }
+
+  freeaddrinfo(serverAddress);
+  return results[ENDPOINT_COUNT].errors != 0 ? 2 : 0;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Relógio monotônico
+ * 
+ * @return int64_t  microssegundos
+ */
+static int64_t now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Gerador xorshift64* por worker
+ * 
+ * @param statePtr    estado do gerador
+ * @return uint32_t   próximo valor
+ */
+static uint32_t random_next(uint64_t * statePtr)
+{
+  *statePtr ^= *statePtr >> 12;
+  *statePtr ^= *statePtr << 25;
+  *statePtr ^= *statePtr >> 27;
+  return (*statePtr * 2685821657736338717ULL) >> 32;
+}
+
+/**
+ * Interpreta mistura "topology=60,io=30,wifi=10", endpoints omitidos = 0
+ * 
+ * @param mixPtr  especificação
+ * @return true   mistura aplicada
+ * @return false  especificação inválida
+ */
+static bool parse_mix(const char * mixPtr)
+{
+  char copy[128];
+  snprintf(copy, sizeof(copy), "%s", mixPtr);
+  memset(mixWeights, 0, sizeof(mixWeights));
+  mixTotal = 0;
+
+  for (char * itemPtr = strtok(copy, ","); itemPtr != NULL; itemPtr = strtok(NULL, ","))
+  {
+    char * separatorPtr = strchr(itemPtr, '=');
+    if (separatorPtr == NULL)
+    {
+      return false;
+    }
+    *separatorPtr = '\0';
+
+    uint32_t endpoint = 0;
+    while ((endpoint < ENDPOINT_COUNT) && (strcmp(itemPtr, endpointNames[endpoint]) != 0))
+    {
+      endpoint++;
+    }
+    if (endpoint == ENDPOINT_COUNT)
+    {
+      return false;
+    }
+
+    mixWeights[endpoint] = strtoul(&separatorPtr[1], NULL, 10);
+    mixTotal += mixWeights[endpoint];
+  }
+
+  return mixTotal != 0;
+}
+
+/**
+ * Lista de MACs das estações usadas no POST /plc/io
+ * 
+ * @param listPtr   MACs separados por vírgula
+ */
+static void parse_macs(const char * listPtr)
+{
+  char copy[MAX_MACS * 18];
+  snprintf(copy, sizeof(copy), "%s", listPtr);
+
+  for (char * macPtr = strtok(copy, ","); (macPtr != NULL) && (macCount < MAX_MACS); macPtr = strtok(NULL, ","))
+  {
+    snprintf(macs[macCount++], sizeof(macs[0]), "%s", macPtr);
+  }
+}
+
+/**
+ * Abre conexão TCP com o gateway
+ * 
+ * @return int  socket, -1 = falha
+ */
+static int connect_server(void)
+{
+  int fd = socket(serverAddress->ai_family, serverAddress->ai_socktype, serverAddress->ai_protocol);
+  if (fd < 0)
+  {
+    return -1;
+  }
+
+  struct timeval timeout = { .tv_sec = SOCKET_TIMEOUT_S };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  const int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+  if (connect(fd, serverAddress->ai_addr, serverAddress->ai_addrlen) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/**
+ * Envia requisição e lê resposta completa (Content-Length ou chunked).
+ * Reabre a conexão quando o servidor a encerrou
+ * 
+ * @param fdPtr           socket keep-alive, -1 = abrir
+ * @param requestPtr      requisição completa
+ * @param requestLength   tamanho da requisição
+ * @param bodyPtr         buffer do corpo, pode ser NULL
+ * @param bodySize        tamanho do buffer do corpo
+ * @return int            status HTTP, -1 = falha de conexão
+ */
+static int http_request(int * fdPtr, const char * requestPtr, size_t requestLength, char * bodyPtr, size_t bodySize)
+{
+  char buffer[RESPONSE_SIZE];
+
+  for (uint32_t attempt = 0; attempt < 2; attempt++)
+  {
+    if (*fdPtr < 0)
+    {
+      *fdPtr = connect_server();
+      if (*fdPtr < 0)
+      {
+        return -1;
+      }
+    }
+
+    if (send(*fdPtr, requestPtr, requestLength, MSG_NOSIGNAL) != (ssize_t)requestLength)
+    {
+      close(*fdPtr);
+      *fdPtr = -1;
+      continue;
+    }
+
+    /* Cabeçalho */
+    size_t used = 0;
+    char * headerEndPtr = NULL;
+    while (headerEndPtr == NULL)
+    {
+      ssize_t received = recv(*fdPtr, &buffer[used], sizeof(buffer) - 1 - used, 0);
+      if (received <= 0)
+      {
+        break;
+      }
+      used += received;
+      buffer[used] = '\0';
+      headerEndPtr = strstr(buffer, "\r\n\r\n");
+    }
+
+    if (headerEndPtr == NULL)
+    {
+      /* Conexão keep-alive encerrada pelo servidor, tenta novamente em uma nova */
+      close(*fdPtr);
+      *fdPtr = -1;
+      if (used == 0)
+      {
+        continue;
+      }
+      return -1;
+    }
+
+    *headerEndPtr = '\0';
+    int status = 0;
+    sscanf(buffer, "HTTP/1.%*d %d", &status);
+    const bool chunked = strcasestr(buffer, "transfer-encoding: chunked") != NULL;
+    const bool closeConnection = strcasestr(buffer, "connection: close") != NULL;
+    const char * lengthPtr = strcasestr(buffer, "content-length:");
+    long contentLength = lengthPtr != NULL ? strtol(&lengthPtr[15], NULL, 10) : -1;
+
+    /* Corpo: bytes já recebidos após o cabeçalho seguidos do restante */
+    char * dataPtr = headerEndPtr + 4;
+    size_t available = used - (dataPtr - buffer);
+    size_t bodyUsed = 0;
+    bool complete = false;
+
+    while (complete == false)
+    {
+      if (chunked)
+      {
+        /* Consome chunks completos presentes no buffer */
+        char * lineEndPtr;
+        while ((lineEndPtr = memmem(dataPtr, available, "\r\n", 2)) != NULL)
+        {
+          const size_t chunkSize = strtoul(dataPtr, NULL, 16);
+          const size_t needed = (lineEndPtr + 2 - dataPtr) + chunkSize + 2;
+          if (available < needed)
+          {
+            break;
+          }
+          if ((bodyPtr != NULL) && (bodyUsed + chunkSize < bodySize))
+          {
+            memcpy(&bodyPtr[bodyUsed], lineEndPtr + 2, chunkSize);
+            bodyUsed += chunkSize;
+          }
+          dataPtr += needed;
+          available -= needed;
+          if (chunkSize == 0)
+          {
+            complete = true;
+            break;
+          }
+        }
+      }
+      else
+      {
+        const size_t take = ((contentLength >= 0) && ((long)available > contentLength)) ?
+                            (size_t)contentLength : available;
+        if ((bodyPtr != NULL) && (bodyUsed + take < bodySize))
+        {
+          memcpy(&bodyPtr[bodyUsed], dataPtr, take);
+          bodyUsed += take;
+        }
+        if (contentLength >= 0)
+        {
+          contentLength -= take;
+          complete = contentLength == 0;
+        }
+        available = 0;
+      }
+
+      if (complete)
+      {
+        break;
+      }
+
+      /* Preserva bytes parciais no início do buffer e lê mais */
+      memmove(buffer, dataPtr, available);
+      dataPtr = buffer;
+      ssize_t received = recv(*fdPtr, &buffer[available], sizeof(buffer) - 1 - available, 0);
+      if (received <= 0)
+      {
+        /* Sem Content-Length o corpo termina no fechamento */
+        complete = (chunked == false) && (contentLength < 0) && (received == 0);
+        close(*fdPtr);
+        *fdPtr = -1;
+        if (complete == false)
+        {
+          return -1;
+        }
+        break;
+      }
+      available += received;
+    }
+
+    if (bodyPtr != NULL)
+    {
+      bodyPtr[bodyUsed < bodySize ? bodyUsed : bodySize - 1] = '\0';
+    }
+
+    if (closeConnection && (*fdPtr >= 0))
+    {
+      close(*fdPtr);
+      *fdPtr = -1;
+    }
+
+    return status;
+  }
+
+  return -1;
+}
+
+/**
+ * Monta requisição de um endpoint
+ * 
+ * @param endpoint        endpoint sorteado
+ * @param workerPtr       worker, fornece o gerador
+ * @param requestPtr      buffer de escrita
+ * @param requestSize     tamanho do buffer
+ * @return size_t         tamanho da requisição
+ */
+static size_t build_request(endpoint_t endpoint, worker_t * workerPtr, char * requestPtr, size_t requestSize)
+{
+  switch (endpoint)
+  {
+    case ENDPOINT_IO:
+    {
+      char body[64];
+      const int bodyLength = snprintf(body, sizeof(body), "{\"mac\":\"%s\",\"value\":%u}",
+                                      macs[random_next(&workerPtr->randomState) % macCount],
+                                      random_next(&workerPtr->randomState) & 1);
+      return snprintf(requestPtr, requestSize,
+                      "POST /plc/io HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                      "Content-Length: %d\r\n\r\n%s", hostPtr, bodyLength, body);
+    }
+    case ENDPOINT_WIFI:
+      return snprintf(requestPtr, requestSize, "GET /wifi/info HTTP/1.1\r\nHost: %s\r\n\r\n", hostPtr);
+    default:
+      return snprintf(requestPtr, requestSize, "GET /plc/topology HTTP/1.1\r\nHost: %s\r\n\r\n", hostPtr);
+  }
+}
+
+/**
+ * Worker: uma conexão keep-alive, requisições em sequência
+ * 
+ * @param argumentPtr   worker_t
+ * @return void*        NULL
+ */
+static void * worker_run(void * argumentPtr)
+{
+  worker_t * workerPtr = argumentPtr;
+  char request[REQUEST_SIZE];
+  /* Taxa aberta: cada worker envia a sua fração em intervalos fixos, defasados */
+  const int64_t intervalUs = targetRate > 0 ? (int64_t)(connections * 1e6 / targetRate) : 0;
+  int64_t plannedUs = startUs + (intervalUs * workerPtr->id) / connections;
+
+  while (true)
+  {
+    int64_t nowUs = now_us();
+    if (intervalUs != 0)
+    {
+      if (plannedUs > nowUs)
+      {
+        usleep(plannedUs - nowUs);
+      }
+      nowUs = now_us();
+    }
+    else
+    {
+      plannedUs = nowUs;
+    }
+
+    if ((plannedUs >= endUs) || (nowUs >= endUs))
+    {
+      /* Com taxa aberta acima da capacidade, atraso restante não é enviado */
+      break;
+    }
+
+    uint32_t pick = random_next(&workerPtr->randomState) % mixTotal;
+    endpoint_t endpoint = 0;
+    while (pick >= mixWeights[endpoint])
+    {
+      pick -= mixWeights[endpoint++];
+    }
+
+    const size_t length = build_request(endpoint, workerPtr, request, sizeof(request));
+    const int status = http_request(&workerPtr->fd, request, length, NULL, 0);
+    const int64_t latencyUs = now_us() - plannedUs;
+
+    samples_t * samplesPtr = &workerPtr->samples[endpoint];
+    samples_add(samplesPtr, latencyUs > UINT32_MAX ? UINT32_MAX : (uint32_t)latencyUs);
+    if ((status < 200) || (status >= 300))
+    {
+      samplesPtr->errors++;
+      if (status < 0)
+      {
+        /* Falha de conexão, evita laço sem espera */
+        usleep(10000);
+      }
+    }
+
+    plannedUs += intervalUs;
+  }
+
+  if (workerPtr->fd >= 0)
+  {
+    close(workerPtr->fd);
+  }
+  return NULL;
+}
+
+/**
+ * Amostra heap do dispositivo durante a carga
+ * 
+ * @param argumentPtr   socket de /metrics
+ * @return void*        NULL
+ */
+static void * metrics_run(void * argumentPtr)
+{
+  int * fdPtr = argumentPtr;
+  uint64_t heapFree;
+  uint64_t heapMinFree;
+
+  while (running)
+  {
+    if (metrics_sample(fdPtr, &heapFree, &heapMinFree) == false)
+    {
+      /* Sem /metrics, encerra amostragem */
+      break;
+    }
+    usleep(METRICS_PERIOD_US);
+  }
+
+  /* Leitura final com a carga encerrada */
+  while (running)
+  {
+    usleep(METRICS_PERIOD_US);
+  }
+  metrics_sample(fdPtr, &heapFree, &heapMinFree);
+
+  if (*fdPtr >= 0)
+  {
+    close(*fdPtr);
+  }
+  return NULL;
+}
+
+/**
+ * Lê heap livre e menor heap livre de /metrics
+ * 
+ * @param fdPtr           socket keep-alive de /metrics
+ * @param heapFreePtr     heap livre
+ * @param heapMinFreePtr  menor heap livre desde a inicialização
+ * @return true           valores lidos
+ * @return false          /metrics indisponível
+ */
+static bool metrics_sample(int * fdPtr, uint64_t * heapFreePtr, uint64_t * heapMinFreePtr)
+{
+  char request[128];
+  static char body[16 * 1024];
+  const int length = snprintf(request, sizeof(request), "GET /metrics HTTP/1.1\r\nHost: %s\r\n\r\n", hostPtr);
+
+  if (http_request(fdPtr, request, length, body, sizeof(body)) != 200)
+  {
+    return false;
+  }
+
+  const char * freePtr = strstr(body, "\npowerline_heap_free_bytes ");
+  const char * minFreePtr = strstr(body, "\npowerline_heap_min_free_bytes ");
+  if ((freePtr == NULL) || (minFreePtr == NULL))
+  {
+    return false;
+  }
+
+  *heapFreePtr = strtoull(strchr(freePtr + 1, ' ') + 1, NULL, 10);
+  *heapMinFreePtr = strtoull(strchr(minFreePtr + 1, ' ') + 1, NULL, 10);
+  heapFreeMin = *heapFreePtr < heapFreeMin ? *heapFreePtr : heapFreeMin;
+  heapMinFreeEnd = *heapMinFreePtr;
+  metricsSamples++;
+  return true;
+}
+
+/**
+ * Registra latência
+ * 
+ * @param samplesPtr  amostras do endpoint
+ * @param valueUs     latência em us
+ */
+static void samples_add(samples_t * samplesPtr, uint32_t valueUs)
+{
+  if (samplesPtr->count == samplesPtr->capacity)
+  {
+    samplesPtr->capacity = samplesPtr->capacity != 0 ? samplesPtr->capacity * 2 : 1024;
+    samplesPtr->valuesPtr = realloc(samplesPtr->valuesPtr, samplesPtr->capacity * sizeof(uint32_t));
+  }
+  samplesPtr->valuesPtr[samplesPtr->count++] = valueUs;
+}
+
+static int compare_u32(const void * aPtr, const void * bPtr)
+{
+  const uint32_t a = *(const uint32_t *)aPtr;
+  const uint32_t b = *(const uint32_t *)bPtr;
+  return (a > b) - (a < b);
+}
+
+/**
+ * Junta amostras dos workers e calcula percentis exatos
+ * 
+ * @param endpoint    endpoint, ENDPOINT_COUNT = todos
+ * @param workers     workers executados
+ * @param resultPtr   estrutura de escrita
+ */
+static void result_compute(endpoint_t endpoint, worker_t * workers, result_t * resultPtr)
+{
+  memset(resultPtr, 0, sizeof(result_t));
+  const uint32_t first = endpoint < ENDPOINT_COUNT ? endpoint : 0;
+  const uint32_t last = endpoint < ENDPOINT_COUNT ? endpoint : ENDPOINT_COUNT - 1;
+
+  uint64_t total = 0;
+  for (uint32_t idx = 0; idx < connections; idx++)
+  {
+    for (uint32_t current = first; current <= last; current++)
+    {
+      total += workers[idx].samples[current].count;
+      resultPtr->errors += workers[idx].samples[current].errors;
+    }
+  }
+
+  resultPtr->requests = total;
+  if (total == 0)
+  {
+    return;
+  }
+
+  uint32_t * valuesPtr = malloc(total * sizeof(uint32_t));
+  uint64_t used = 0;
+  for (uint32_t idx = 0; idx < connections; idx++)
+  {
+    for (uint32_t current = first; current <= last; current++)
+    {
+      const samples_t * samplesPtr = &workers[idx].samples[current];
+      memcpy(&valuesPtr[used], samplesPtr->valuesPtr, samplesPtr->count * sizeof(uint32_t));
+      used += samplesPtr->count;
+    }
+  }
+
+  qsort(valuesPtr, total, sizeof(uint32_t), compare_u32);
+  resultPtr->p50Ms = valuesPtr[(total - 1) * 500 / 1000] / 1000.0;
+  resultPtr->p99Ms = valuesPtr[(total - 1) * 990 / 1000] / 1000.0;
+  resultPtr->p999Ms = valuesPtr[(total - 1) * 999 / 1000] / 1000.0;
+  resultPtr->maxMs = valuesPtr[total - 1] / 1000.0;
+  free(valuesPtr);
+}
+
+/**
+ * Escreve linha de resultado, com variação percentual sobre o baseline
+ * 
+ * @param namePtr       endpoint
+ * @param resultPtr     resultado
+ * @param baselinePtr   baseline, NULL = sem comparação
+ */
+static void result_print(const char * namePtr, const result_t * resultPtr, const result_t * baselinePtr)
+{
+  printf("%-10s %9llu %7llu %9.1f %9.2f %9.2f %9.2f %9.2f\n", namePtr,
+         (unsigned long long)resultPtr->requests, (unsigned long long)resultPtr->errors, resultPtr->rps,
+         resultPtr->p50Ms, resultPtr->p99Ms, resultPtr->p999Ms, resultPtr->maxMs);
+
+  if ((baselinePtr == NULL) || (baselinePtr->requests == 0))
+  {
+    return;
+  }
+
+#define DELTA(field) (baselinePtr->field != 0 ? 100.0 * (resultPtr->field - baselinePtr->field) / baselinePtr->field : 0.0)
+  printf("%-10s %9s %7s %+8.1f%% %+8.1f%% %+8.1f%% %+8.1f%% %+8.1f%%\n", "  vs base", "", "",
+         DELTA(rps), DELTA(p50Ms), DELTA(p99Ms), DELTA(p999Ms), DELTA(maxMs));
+#undef DELTA
+}
+
+/**
+ * Carrega CSV gerado por uma execução anterior (-o)
+ * 
+ * @param pathPtr       caminho do CSV
+ * @param baselinePtr   resultados por endpoint, último = todos
+ * @return true         baseline carregado
+ * @return false        arquivo indisponível
+ */
+static bool baseline_load(const char * pathPtr, result_t * baselinePtr)
+{
+  FILE * file = fopen(pathPtr, "r");
+  if (file == NULL)
+  {
+    perror(pathPtr);
+    return false;
+  }
+
+  memset(baselinePtr, 0, sizeof(result_t) * (ENDPOINT_COUNT + 1));
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    char name[16];
+    result_t result;
+    unsigned long long requests;
+    unsigned long long errors;
+    if (sscanf(line, "%15[^,],%llu,%llu,%lf,%lf,%lf,%lf,%lf", name, &requests, &errors, &result.rps,
+               &result.p50Ms, &result.p99Ms, &result.p999Ms, &result.maxMs) != 8)
+    {
+      continue;
+    }
+    result.requests = requests;
+    result.errors = errors;
+
+    for (uint32_t endpoint = 0; endpoint <= ENDPOINT_COUNT; endpoint++)
+    {
+      if (strcmp(name, endpoint < ENDPOINT_COUNT ? endpointNames[endpoint] : "all") == 0)
+      {
+        baselinePtr[endpoint] = result;
+      }
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
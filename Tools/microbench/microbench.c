@@ -0,0 +1,407 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Microbenchmarks das funções auxiliares no host (Linux). Executa os casos
+ * de Application/microbench.c (também expostos em GET /debug/bench no
+ * ESP32, em ciclos) e os auxiliares estáticos de plc_uart_model.c,
+ * reportando ns por operação e alocações do cJSON por operação.
+ * 
+ * Build, a partir da raiz do repositório (cJSON do sistema, libcjson-dev):
+ *   gcc -O2 -DPOWERLINE_MICROBENCH -IService -IApplication \
+ *       -IApplication/endpoints -ITools/microbench/shim \
+ *       -ITools/plc_replay/shim -I/usr/include/cjson \
+ *       Tools/microbench/microbench.c Application/microbench.c \
+ *       Application/endpoints/http_util.c Application/endpoints/json_buffer.c \
+ *       Application/endpoints/udp_protocol.c Service/plc_uart_parser.c \
+ *       -lcjson -o microbench
+ * 
+ * Uso:
+ *   microbench [-t ms por medida] [-r repetições] [-o baseline] [-B baseline]
+ *              [-x limite %]
+ * 
+ * -o grava o resultado como baseline, com CPU, compilador e versão do
+ * cJSON em linhas de comentário ('#'). -B compara com uma baseline gravada
+ * na mesma máquina e retorna 1 quando algum caso fica mais lento que o
+ * limite (padrão 10 %) ou passa a alocar mais. Baseline de referência em
+ * Tools/microbench/baseline.txt
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "microbench.h"
+#include "esp_http_server.h"
+#include "cJSON.h"
+/* Acesso aos auxiliares estáticos do modelo */
+#include "plc_uart_model.c"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define DEFAULT_MIN_MS          200
+/* Repetições por caso, vale a menor medida (menos interferência do sistema) */
+#define DEFAULT_REPEATS         5
+#define DEFAULT_THRESHOLD       10.0
+#define MAX_CASES               32
+#define ALLOC_RESOLUTION        0.005
+#define NAME_SIZE               48
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Linha da baseline: nome, ns por operação, alocações por operação */
+typedef struct baselineEntry_t
+{
+  char name[NAME_SIZE];
+  double perOp;
+  double allocsPerOp;
+} baselineEntry_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char macCompact[] = "0012A3B4C5D6";
+static const char macColon[] = "00:12:A3:B4:C5:D6";
+static const char topoinfoData[] = "0012A3B4C5D6,2,0,0,1,31,41,2";
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static volatile uint32_t hostSink;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static uint64_t clock_ns(void);
+static void bench_mac_string_hex_to_bytes(uint32_t iterations);
+static void bench_split_convert_to_number(uint32_t iterations);
+static void bench_format_mac_only_numbers(uint32_t iterations);
+static void baseline_header_write(FILE * file);
+static uint32_t baseline_load(const char * pathPtr, baselineEntry_t * entriesPtr, uint32_t maxEntries);
+static const baselineEntry_t * baseline_find(const baselineEntry_t * entriesPtr, uint32_t count,
+                                             const char * namePtr);
+
+/* Casos somente do host, auxiliares estáticos sem acesso no firmware */
+static const microbenchCase_t hostCases[] = {
+  { "mac_string_hex_to_bytes", bench_mac_string_hex_to_bytes },
+  { "split_convert_to_number", bench_split_convert_to_number },
+  { "format_mac_only_numbers", bench_format_mac_only_numbers },
+};
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+int main(int argc, char ** argv)
+{
+  uint32_t minMs = DEFAULT_MIN_MS;
+  uint32_t repeats = DEFAULT_REPEATS;
+  double threshold = DEFAULT_THRESHOLD;
+  const char * outputPtr = NULL;
+  const char * baselinePtr = NULL;
+
+  int option;
+  while ((option = getopt(argc, argv, "t:r:o:B:x:")) != -1)
+  {
+    switch (option)
+    {
+      case 't': minMs = strtoul(optarg, NULL, 10); break;
+      case 'r': repeats = strtoul(optarg, NULL, 10); break;
+      case 'o': outputPtr = optarg; break;
+      case 'B': baselinePtr = optarg; break;
+      case 'x': threshold = strtod(optarg, NULL); break;
+      default:
+        fprintf(stderr, "uso: %s [-t ms] [-r repetições] [-o baseline] [-B baseline] [-x limite %%]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  baselineEntry_t baseline[MAX_CASES];
+  uint32_t baselineCount = 0;
+  if (baselinePtr != NULL)
+  {
+    baselineCount = baseline_load(baselinePtr, baseline, MAX_CASES);
+    if (baselineCount == 0)
+    {
+      fprintf(stderr, "baseline vazia ou inexistente: %s\n", baselinePtr);
+      return 2;
+    }
+  }
+
+  FILE * outputFile = NULL;
+  if (outputPtr != NULL)
+  {
+    outputFile = fopen(outputPtr, "w");
+    if (outputFile == NULL)
+    {
+      perror(outputPtr);
+      return 2;
+    }
+    baseline_header_write(outputFile);
+  }
+
+  const uint32_t sharedCount = microbench_case_count();
+  const uint32_t hostCount = sizeof(hostCases) / sizeof(hostCases[0]);
+  bool regression = false;
+
+  printf("%-26s %12s %10s %10s %10s\n", "caso", "iterações", "ns/op", "allocs/op", "baseline");
+  for (uint32_t idx = 0; idx < sharedCount + hostCount; idx++)
+  {
+    const microbenchCase_t * casePtr = idx < sharedCount ? microbench_case_get(idx)
+                                                         : &hostCases[idx - sharedCount];
+    microbenchResult_t result;
+    microbench_run(casePtr, clock_ns, (uint64_t)minMs * 1000000, &result);
+    for (uint32_t repeat = 1; repeat < repeats; repeat++)
+    {
+      microbenchResult_t again;
+      microbench_run(casePtr, clock_ns, (uint64_t)minMs * 1000000, &again);
+      if (again.perOp < result.perOp)
+      {
+        result = again;
+      }
+    }
+
+    printf("%-26s %12u %10.1f %10.2f", result.namePtr, result.iterations, result.perOp, result.allocsPerOp);
+
+    const baselineEntry_t * entryPtr = baseline_find(baseline, baselineCount, result.namePtr);
+    if (entryPtr != NULL)
+    {
+      const double delta = ((result.perOp - entryPtr->perOp) * 100.0) / entryPtr->perOp;
+      const bool slower = delta > threshold;
+      /* Mesma resolução da baseline, ignora alocações de preparação do caso */
+      const bool moreAllocs = result.allocsPerOp > (entryPtr->allocsPerOp + ALLOC_RESOLUTION);
+      printf(" %+9.1f%%%s", delta, (slower || moreAllocs) ? " REGRESSÃO" : "");
+      regression |= slower || moreAllocs;
+    }
+    if (result.leakedPerOp != 0)
+    {
+      printf(" vazamento %.2f/op", result.leakedPerOp);
+    }
+    printf("\n");
+
+    if (outputFile != NULL)
+    {
+      fprintf(outputFile, "%s %.2f %.2f\n", result.namePtr, result.perOp, result.allocsPerOp);
+    }
+  }
+
+  if (outputFile != NULL)
+  {
+    fclose(outputFile);
+  }
+
+  return regression ? 1 : 0;
+}
+
+/*
+ * Dependências dos módulos compilados, sem efeito no host
+ */
+void plc_uart_send(uint32_t port, const void *sendBufferPtr, uartPlcResponse_t * responsePtr)
+{
+  (void)port;
+  (void)sendBufferPtr;
+  responsePtr->result = false;
+}
+
+int32_t plc_topology_find_network(const uint8_t * macPtr)
+{
+  (void)macPtr;
+  return -1;
+}
+
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...)
+{
+  (void)level;
+  (void)tag;
+  (void)format;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+  return 0;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t * req, const char * buf, ssize_t len)
+{
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t * req, const char * buf, ssize_t len)
+{
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t * req, const char * status)
+{
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t * req, const char * type)
+{
+  return ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t * req, char * buf, size_t len)
+{
+  return 0;
+}
+
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char * buf, size_t buf_len, int flags)
+{
+  return buf_len;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+static uint64_t clock_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * MAC da resposta AT+TOPOINFO para bytes
+ * 
+ * @param iterations  repetições
+ */
+static void bench_mac_string_hex_to_bytes(uint32_t iterations)
+{
+  uint8_t mac[6];
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    mac_string_hex_to_bytes(macCompact, mac);
+    hostSink += mac[5];
+  }
+}
+
+/**
+ * Decodificação dos 7 campos numéricos de uma linha AT+TOPOINFO, como em
+ * plc_uart_model_get_topology
+ * 
+ * @param iterations  repetições
+ */
+static void bench_split_convert_to_number(uint32_t iterations)
+{
+  char line[sizeof(topoinfoData)];
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    /* strtok altera a linha, restaura a cada operação */
+    memcpy(line, topoinfoData, sizeof(line));
+    hostSink += strtok(line, ",") != NULL;
+    for (uint32_t field = 1; field < 8; field++)
+    {
+      hostSink += split_convert_to_number(NULL, ",", 10);
+    }
+  }
+}
+
+/**
+ * MAC recebido pela API, "XX:XX:..." para somente dígitos
+ * 
+ * @param iterations  repetições
+ */
+static void bench_format_mac_only_numbers(uint32_t iterations)
+{
+  char mac[sizeof(macColon)];
+  for (uint32_t idx = 0; idx < iterations; idx++)
+  {
+    memcpy(mac, macColon, sizeof(mac));
+    format_mac_only_numbers(mac);
+    hostSink += mac[0];
+  }
+}
+
+/**
+ * Grava ambiente da medida no início da baseline, resultados só são
+ * comparáveis com a mesma CPU, compilador e cJSON
+ * 
+ * @param file  baseline aberta para escrita
+ */
+static void baseline_header_write(FILE * file)
+{
+  char cpu[128] = "desconhecida";
+  char line[256];
+  FILE * cpuinfo = fopen("/proc/cpuinfo", "r");
+  while ((cpuinfo != NULL) && (fgets(line, sizeof(line), cpuinfo) != NULL))
+  {
+    const char * valuePtr = strchr(line, ':');
+    if ((strncmp(line, "model name", 10) == 0) && (valuePtr != NULL))
+    {
+      snprintf(cpu, sizeof(cpu), "%.*s", (int)strcspn(valuePtr + 2, "\n"), valuePtr + 2);
+      break;
+    }
+  }
+  if (cpuinfo != NULL)
+  {
+    fclose(cpuinfo);
+  }
+
+  fprintf(file, "# cpu: %s, %ld CPUs\n", cpu, sysconf(_SC_NPROCESSORS_ONLN));
+  fprintf(file, "# compilador: %s\n", __VERSION__);
+#ifdef CJSON_VERSION_MAJOR
+  fprintf(file, "# cJSON: %d.%d.%d\n", CJSON_VERSION_MAJOR, CJSON_VERSION_MINOR, CJSON_VERSION_PATCH);
+#else
+  fprintf(file, "# cJSON: sem versão, não é a biblioteca cJSON\n");
+#endif
+}
+
+/**
+ * Carrega baseline gravada com -o, linhas iniciadas por '#' são comentários
+ * 
+ * @param pathPtr     arquivo
+ * @param entriesPtr  entradas de saída
+ * @param maxEntries  capacidade de entriesPtr
+ * @return uint32_t   quantidade de entradas lidas
+ */
+static uint32_t baseline_load(const char * pathPtr, baselineEntry_t * entriesPtr, uint32_t maxEntries)
+{
+  FILE * file = fopen(pathPtr, "r");
+  if (file == NULL)
+  {
+    return 0;
+  }
+
+  uint32_t count = 0;
+  char line[256];
+  while ((count < maxEntries) && (fgets(line, sizeof(line), file) != NULL))
+  {
+    if ((line[0] != '#') &&
+        (sscanf(line, "%47s %lf %lf", entriesPtr[count].name, &entriesPtr[count].perOp,
+                &entriesPtr[count].allocsPerOp) == 3))
+    {
+      count++;
+    }
+  }
+
+  fclose(file);
+  return count;
+}
+
+static const baselineEntry_t * baseline_find(const baselineEntry_t * entriesPtr, uint32_t count,
+                                             const char * namePtr)
+{
+  for (uint32_t idx = 0; idx < count; idx++)
+  {
+    if (strcmp(entriesPtr[idx].name, namePtr) == 0)
+    {
+      return &entriesPtr[idx];
+    }
+  }
+  return NULL;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
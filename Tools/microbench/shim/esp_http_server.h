@@ -0,0 +1,53 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_HTTP_SERVER_H
+#define SHIM_ESP_HTTP_SERVER_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+#include "esp_err.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Subconjunto usado por http_util.c, respostas descartadas no host */
+#define HTTPD_200               "200 OK"
+#define HTTPD_400               "400 Bad Request"
+#define HTTPD_500               "500 Internal Server Error"
+#define HTTPD_TYPE_JSON         "application/json"
+#define HTTPD_RESP_USE_STRLEN   -1
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef struct httpd_req
+{
+  const char uri[513];
+  size_t content_len;
+} httpd_req_t;
+
+typedef void * httpd_handle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+esp_err_t httpd_resp_send(httpd_req_t * req, const char * buf, ssize_t len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t * req, const char * buf, ssize_t len);
+esp_err_t httpd_resp_set_status(httpd_req_t * req, const char * status);
+esp_err_t httpd_resp_set_type(httpd_req_t * req, const char * type);
+int httpd_req_recv(httpd_req_t * req, char * buf, size_t len);
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char * buf, size_t buf_len, int flags);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,552 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Replay determinístico do Service PLC no host (Linux). Tráfego AT sintético
+ * ou gravado (arquivo PLCU de GET /debug/uart/capture) passa pelo parser,
+ * modelo e topologia reais; FreeRTOS, timer, log e partições são substituídos
+ * pelos shims deste diretório.
+ * 
+ * Build, a partir da raiz do repositório:
+ *   gcc -O2 -IService -ITools/plc_replay -ITools/plc_replay/shim \
+ *       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc \
+ *       Tools/plc_replay/plc_replay.c Tools/plc_replay/plc_replay_shim.c \
+ *       Service/plc_uart_parser.c Service/plc_uart_model.c Service/plc_topology.c \
+ *       Service/plc_history.c Service/plc_telemetry.c Service/plc_stats.c \
+ *       Service/plc_events.c -o plc_replay
+ * 
+ * Uso:
+ *   plc_replay [-n atualizações] [-s estações] [-i comandos IO por atualização]
+ *              [-r semente] [-c captura.plcu [-p porta UART]] [-v]
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "plc_replay_shim.h"
+#include "plc_uart.h"
+#include "plc_uart_parser.h"
+#include "plc_uart_model.h"
+#include "plc_topology.h"
+#include "plc_events.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define DEFAULT_REFRESHES   10000
+#define DEFAULT_STATIONS    12
+#define MAX_STATIONS        64
+/* Mesmos tamanhos de plc_uart.c */
+#define BLOCK_SIZE          1024
+#define LINE_SIZE           128
+/* Linhas comportadas por uartPlcResponse_t */
+#define RESPONSE_LINES      (sizeof(((uartPlcResponse_t *)0)->data) / sizeof(((uartPlcResponse_t *)0)->data[0]))
+/* Intervalo virtual entre atualizações da topologia */
+#define REFRESH_PERIOD_US   1000000
+/* Base dos MACs sintéticos, estação somada ao último byte */
+#define SYNTHETIC_MAC_BASE  0x001122330000ULL
+
+/* Etapas medidas */
+typedef enum replayStage_t
+{
+  STAGE_PARSE = 0,
+  STAGE_MODEL,
+  STAGE_TOPOLOGY,
+  STAGE_IO,
+  STAGE_COUNT,
+} replayStage_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Registro do arquivo de captura */
+typedef struct captureRecord_t
+{
+  bool rx;
+  uint32_t length;
+  const uint8_t * dataPtr;
+} captureRecord_t;
+
+/* Contadores do replay */
+typedef struct replayStats_t
+{
+  uint64_t stageNs[STAGE_COUNT];
+  /* Geração ou leitura do tráfego, descontada das etapas */
+  uint64_t sourceNs;
+  uint64_t lines;
+  uint64_t commands;
+  uint64_t timeouts;
+  uint64_t droppedLines;
+} replayStats_t;
+
+/* Gera próximo bloco recebido para um comando, 0 = sem resposta */
+typedef size_t (*nextBlock_t)(const char * commandPtr, uint32_t blockIndex, char * blockPtr, size_t blockSize);
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const stageNames[STAGE_COUNT] = {
+  [STAGE_PARSE] = "parse",
+  [STAGE_MODEL] = "model",
+  [STAGE_TOPOLOGY] = "topology",
+  [STAGE_IO] = "io",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static replayStats_t stats;
+static nextBlock_t nextBlock;
+/* Fonte sintética */
+static uint32_t stationCount = DEFAULT_STATIONS;
+static uint32_t seed = 1;
+static uint32_t randomState;
+/* Fonte gravada */
+static uint8_t * captureDataPtr;
+static captureRecord_t * captureRecords;
+static uint32_t captureRecordCount;
+static uint32_t captureCursor;
+/* Porta UART reproduzida de capturas com várias portas */
+static uint32_t capturePort;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static bool parse_block(char * blockPtr, uartPlcResponse_t * responsePtr);
+static uint32_t random_next(void);
+static void source_reset(void);
+static size_t synthetic_block(const char * commandPtr, uint32_t blockIndex, char * blockPtr, size_t blockSize);
+static size_t capture_block(const char * commandPtr, uint32_t blockIndex, char * blockPtr, size_t blockSize);
+static bool capture_load(const char * pathPtr);
+static void run_phase(replayStage_t stage, uint32_t refreshes, uint32_t ioPerRefresh,
+                      uint64_t * totalNsPtr, uint64_t * parseNsPtr);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+int main(int argc, char * argv[])
+{
+  uint32_t refreshes = DEFAULT_REFRESHES;
+  uint32_t ioPerRefresh = 0;
+  const char * capturePathPtr = NULL;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:s:i:r:c:p:v")) != -1)
+  {
+    switch (option)
+    {
+      case 'n': refreshes = strtoul(optarg, NULL, 10); break;
+      case 's': stationCount = strtoul(optarg, NULL, 10); break;
+      case 'i': ioPerRefresh = strtoul(optarg, NULL, 10); break;
+      case 'r': seed = strtoul(optarg, NULL, 10); break;
+      case 'c': capturePathPtr = optarg; break;
+      case 'p': capturePort = strtoul(optarg, NULL, 10); break;
+      case 'v': shim_log_enable(true); break;
+      default:
+        fprintf(stderr, "usage: %s [-n refreshes] [-s stations] [-i io per refresh] [-r seed] "
+                        "[-c capture.plcu [-p port]] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if ((stationCount < 1) || (stationCount > MAX_STATIONS) || (refreshes == 0))
+  {
+    fprintf(stderr, "stations must be 1..%u and refreshes > 0\n", MAX_STATIONS);
+    return 1;
+  }
+
+  nextBlock = synthetic_block;
+  if (capturePathPtr != NULL)
+  {
+    if (capture_load(capturePathPtr) == false)
+    {
+      return 1;
+    }
+    nextBlock = capture_block;
+  }
+
+  shim_init();
+  plc_events_init();
+  plc_topology_init();
+
+  /* Cada fase recomeça a mesma sequência de tráfego */
+  uint64_t totalNs[STAGE_COUNT] = {0};
+  uint64_t parseNs[STAGE_COUNT] = {0};
+  shim_alloc_reset();
+  run_phase(STAGE_MODEL, refreshes, 0, &totalNs[STAGE_MODEL], &parseNs[STAGE_MODEL]);
+  run_phase(STAGE_TOPOLOGY, refreshes, 0, &totalNs[STAGE_TOPOLOGY], &parseNs[STAGE_TOPOLOGY]);
+  if (ioPerRefresh != 0)
+  {
+    run_phase(STAGE_IO, refreshes, ioPerRefresh, &totalNs[STAGE_IO], &parseNs[STAGE_IO]);
+  }
+  shimAllocStats_t allocs;
+  shim_alloc_get(&allocs);
+
+  /* Tempo de cada etapa sem as etapas internas */
+  const double modelNs = (double)(totalNs[STAGE_MODEL] - parseNs[STAGE_MODEL]) / refreshes;
+  const double topologyNs = (double)(totalNs[STAGE_TOPOLOGY] - parseNs[STAGE_TOPOLOGY]) / refreshes - modelNs;
+  stats.stageNs[STAGE_MODEL] = totalNs[STAGE_MODEL] - parseNs[STAGE_MODEL];
+  stats.stageNs[STAGE_TOPOLOGY] = topologyNs > 0 ? topologyNs * refreshes : 0;
+  stats.stageNs[STAGE_IO] = totalNs[STAGE_IO] - parseNs[STAGE_IO];
+
+  printf("source:      %s", capturePathPtr != NULL ? capturePathPtr : "synthetic");
+  if (capturePathPtr == NULL)
+  {
+    printf(", %u stations, seed %u", stationCount, seed);
+  }
+  printf("\nrefreshes:   %u per phase, io %u per refresh\n", refreshes, ioPerRefresh);
+  printf("commands:    %llu, timeouts %llu\n", (unsigned long long)stats.commands,
+         (unsigned long long)stats.timeouts);
+  printf("lines:       %llu, dropped %llu, %.2f M lines/s\n", (unsigned long long)stats.lines,
+         (unsigned long long)stats.droppedLines,
+         stats.stageNs[STAGE_PARSE] != 0 ? stats.lines * 1e3 / stats.stageNs[STAGE_PARSE] : 0.0);
+  printf("%-12s %10.1f ns/line\n", stageNames[STAGE_PARSE],
+         stats.lines != 0 ? (double)stats.stageNs[STAGE_PARSE] / stats.lines : 0.0);
+  printf("%-12s %10.1f ns/refresh\n", stageNames[STAGE_MODEL], (double)stats.stageNs[STAGE_MODEL] / refreshes);
+  printf("%-12s %10.1f ns/refresh\n", stageNames[STAGE_TOPOLOGY], (double)stats.stageNs[STAGE_TOPOLOGY] / refreshes);
+  if (ioPerRefresh != 0)
+  {
+    printf("%-12s %10.1f ns/command\n", stageNames[STAGE_IO],
+           (double)stats.stageNs[STAGE_IO] / ((uint64_t)refreshes * ioPerRefresh));
+  }
+  printf("allocations: %llu calls, %llu bytes\n", (unsigned long long)allocs.calls,
+         (unsigned long long)allocs.bytes);
+
+  return stats.timeouts != 0 ? 2 : 0;
+}
+
+/**
+ * Substitui plc_uart_send: entrega os blocos da fonte ao parser, como a
+ * task UART faz a cada evento UART_DATA
+ * 
+ * @param port              porta do módulo, uma única fonte de tráfego
+ * @param sendBufferPtr     comando enviado
+ * @param responsePtr       estrutura de preenchimento da resposta
+ */
+void plc_uart_send(uint32_t port, const void * sendBufferPtr, uartPlcResponse_t * responsePtr)
+{
+  (void)port;
+  char block[BLOCK_SIZE];
+  stats.commands++;
+
+  for (uint32_t blockIndex = 0; ; blockIndex++)
+  {
+    const uint64_t sourceStartNs = shim_now_ns();
+    const size_t length = nextBlock(sendBufferPtr, blockIndex, block, sizeof(block) - 1);
+    stats.sourceNs += shim_now_ns() - sourceStartNs;
+    if (length == 0)
+    {
+      /* Sem resultado, equivalente às tentativas esgotadas */
+      responsePtr->result = false;
+      stats.timeouts++;
+      return;
+    }
+    block[length] = '\0';
+
+    const uint64_t startNs = shim_now_ns();
+    const bool finished = parse_block(block, responsePtr);
+    stats.stageNs[STAGE_PARSE] += shim_now_ns() - startNs;
+
+    if (finished)
+    {
+      return;
+    }
+  }
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Trata um bloco recebido, mesma sequência de parse_uart_data
+ * 
+ * @param blockPtr      bloco terminado em '\0', alterado por strtok
+ * @param responsePtr   resposta em andamento
+ * @return true         resultado recebido, resposta finalizada
+ * @return false        aguarda próximo bloco
+ */
+static bool parse_block(char * blockPtr, uartPlcResponse_t * responsePtr)
+{
+  char * data = strtok(blockPtr, "\r\n");
+  char cmdData[LINE_SIZE];
+  for (;data != NULL && data[0] != '\0';)
+  {
+    bzero(cmdData, sizeof(cmdData));
+    strncpy(cmdData, data, sizeof(cmdData) - 1);
+    stats.lines++;
+
+    if ((responsePtr->lineCounter >= RESPONSE_LINES) && (strchr(cmdData, ':') != NULL) &&
+        (strstr(cmdData, "OK") == NULL) && (strstr(cmdData, "ERROR") == NULL) && (strstr(cmdData, "FAIL") == NULL))
+    {
+      /* Resposta maior que data[], firmware entrega a linha somente ao lineSink */
+      stats.droppedLines++;
+      data = strtok(NULL, "\r\n");
+      continue;
+    }
+
+    const plcUartLine_t line = plc_uart_parser_line(&cmdData[0], responsePtr);
+    if (line == PLC_UART_LINE_RESULT)
+    {
+      return true;
+    }
+
+    data = strtok(NULL, "\r\n");
+  }
+
+  return false;
+}
+
+/**
+ * Gerador pseudoaleatório xorshift32, determinístico pela semente
+ * 
+ * @return uint32_t   próximo valor
+ */
+static uint32_t random_next(void)
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+/**
+ * Reinicia fonte de tráfego, repetindo a mesma sequência
+ * 
+ */
+static void source_reset(void)
+{
+  randomState = seed != 0 ? seed : 1;
+  captureCursor = 0;
+}
+
+/**
+ * Fonte sintética: CCO sempre presente e estações alternando entre atualizações,
+ * limitadas às linhas comportadas pela resposta
+ * 
+ * @param commandPtr    comando enviado
+ * @param blockIndex    índice do bloco na resposta
+ * @param blockPtr      buffer de escrita
+ * @param blockSize     tamanho do buffer
+ * @return size_t       tamanho do bloco, 0 = fim da resposta
+ */
+static size_t synthetic_block(const char * commandPtr, uint32_t blockIndex, char * blockPtr, size_t blockSize)
+{
+  if (blockIndex != 0)
+  {
+    return 0;
+  }
+
+  if (strncmp(commandPtr, "AT+TOPOINFO", 11) != 0)
+  {
+    /* AT+IOCTRL, AT+MODE e "++" respondem somente o resultado */
+    return snprintf(blockPtr, blockSize, "OK\r\n");
+  }
+
+  /* Página AT+TOPOINFO=<início>,<quantidade>, início em 1 */
+  uint32_t first = 1;
+  uint32_t count = RESPONSE_LINES;
+  sscanf(&commandPtr[11], "=%u,%u", &first, &count);
+  first = (first != 0) ? first : 1;
+
+  /* Estações presentes sorteadas na primeira página, mantidas nas seguintes */
+  static uint32_t offset;
+  if (first == 1)
+  {
+    offset = stationCount > 1 ? random_next() % (stationCount - 1) : 0;
+  }
+
+  size_t length = 0;
+  const uint32_t present = (stationCount - 1) < (RESPONSE_LINES - 1) ? (stationCount - 1) : (RESPONSE_LINES - 1);
+  for (uint32_t idx = first - 1; (idx <= present) && (idx < (first - 1 + count)); idx++)
+  {
+    /* Estação 0 = CCO */
+    const uint32_t station = idx == 0 ? 0 : 1 + ((offset + idx - 1) % (stationCount - 1));
+    length += snprintf(&blockPtr[length], blockSize - length, "+TOPOINFO:%012llX,%u,0,0,%u,%u,%u,%u\r\n",
+                       SYNTHETIC_MAC_BASE + station, station + 1, station == 0 ? NODE_ROLE_CCO : NODE_ROLE_STA,
+                       10 + random_next() % 40, 20 + random_next() % 60, 1 + random_next() % 3);
+  }
+
+  length += snprintf(&blockPtr[length], blockSize - length, "OK\r\n");
+  return length;
+}
+
+/**
+ * Fonte gravada: localiza o próximo envio do mesmo comando na captura e
+ * entrega os blocos RX seguintes, com a fragmentação original
+ * 
+ * @param commandPtr    comando enviado
+ * @param blockIndex    índice do bloco na resposta
+ * @param blockPtr      buffer de escrita
+ * @param blockSize     tamanho do buffer
+ * @return size_t       tamanho do bloco, 0 = fim da resposta
+ */
+static size_t capture_block(const char * commandPtr, uint32_t blockIndex, char * blockPtr, size_t blockSize)
+{
+  if (blockIndex == 0)
+  {
+    /* Compara somente o nome do comando, parâmetros variam entre execuções */
+    const size_t nameLength = strcspn(commandPtr, "=\r\n");
+    uint32_t found = captureRecordCount;
+
+    for (uint32_t step = 0; step < captureRecordCount; step++)
+    {
+      const uint32_t idx = (captureCursor + step) % captureRecordCount;
+      const captureRecord_t * recordPtr = &captureRecords[idx];
+      if ((recordPtr->rx == false) && (recordPtr->length >= nameLength) &&
+          (memcmp(recordPtr->dataPtr, commandPtr, nameLength) == 0))
+      {
+        found = idx;
+        break;
+      }
+    }
+
+    if (found == captureRecordCount)
+    {
+      return 0;
+    }
+    captureCursor = found + 1;
+  }
+
+  if ((captureCursor >= captureRecordCount) || (captureRecords[captureCursor].rx == false))
+  {
+    /* Próximo comando da captura, resposta encerrada sem resultado */
+    return 0;
+  }
+
+  const captureRecord_t * recordPtr = &captureRecords[captureCursor++];
+  const size_t length = recordPtr->length < blockSize ? recordPtr->length : blockSize;
+  memcpy(blockPtr, recordPtr->dataPtr, length);
+  return length;
+}
+
+/**
+ * Carrega arquivo de captura, formato em Service/plc_uart_capture.h
+ * 
+ * @param pathPtr   caminho do arquivo
+ * @return true     captura carregada
+ * @return false    arquivo inválido
+ */
+static bool capture_load(const char * pathPtr)
+{
+  FILE * file = fopen(pathPtr, "rb");
+  if (file == NULL)
+  {
+    perror(pathPtr);
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  captureDataPtr = malloc(size > 0 ? size : 1);
+  const bool readOk = (size >= 16) && (fread(captureDataPtr, 1, size, file) == (size_t)size);
+  fclose(file);
+
+  if ((readOk == false) || (memcmp(captureDataPtr, "PLCU", 4) != 0) || (captureDataPtr[4] != 1))
+  {
+    fprintf(stderr, "%s: not a PLCU v1 capture\n", pathPtr);
+    return false;
+  }
+
+  /* Registros de no mínimo 8 bytes limitam a quantidade */
+  captureRecords = calloc(size / 8 + 1, sizeof(captureRecord_t));
+  for (long offset = 16; offset + 8 <= size;)
+  {
+    const uint8_t * headerPtr = &captureDataPtr[offset];
+    const uint32_t length = headerPtr[6] | (headerPtr[7] << 8);
+    if ((unsigned long)offset + 8 + length > (unsigned long)size)
+    {
+      fprintf(stderr, "%s: truncated record at offset %ld\n", pathPtr, offset);
+      break;
+    }
+
+    if (headerPtr[5] != capturePort)
+    {
+      /* Tráfego de outra porta UART */
+      offset += 8 + length;
+      continue;
+    }
+
+    captureRecords[captureRecordCount++] = (captureRecord_t) {
+      .rx = headerPtr[4] == 1,
+      .length = length,
+      .dataPtr = &headerPtr[8],
+    };
+    offset += 8 + length;
+  }
+
+  if (captureRecordCount == 0)
+  {
+    fprintf(stderr, "%s: no records\n", pathPtr);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Executa uma fase do replay
+ * 
+ * @param stage         etapa exercitada
+ * @param refreshes     quantidade de atualizações
+ * @param ioPerRefresh  comandos IO por atualização, somente STAGE_IO
+ * @param totalNsPtr    tempo total da fase, sem a fonte de tráfego
+ * @param parseNsPtr    tempo de parse contido na fase
+ */
+static void run_phase(replayStage_t stage, uint32_t refreshes, uint32_t ioPerRefresh,
+                      uint64_t * totalNsPtr, uint64_t * parseNsPtr)
+{
+  node_t nodes[MAX_CCO_NUM + MAX_STA_NUM];
+  char mac[18];
+
+  source_reset();
+  const uint64_t parseStartNs = stats.stageNs[STAGE_PARSE];
+  const uint64_t sourceStartNs = stats.sourceNs;
+  const uint64_t startNs = shim_now_ns();
+
+  for (uint32_t refresh = 0; refresh < refreshes; refresh++)
+  {
+    switch (stage)
+    {
+      case STAGE_MODEL:
+        plc_uart_model_get_topology(PLC_UART_PORT_DEFAULT, nodes, sizeof(nodes));
+        break;
+      case STAGE_TOPOLOGY:
+        plc_topology_refresh();
+        break;
+      case STAGE_IO:
+        for (uint32_t idx = 0; idx < ioPerRefresh; idx++)
+        {
+          /* MAC reescrito a cada comando, plc_uart_model_resolve_network remove os ":" */
+          const uint64_t address = SYNTHETIC_MAC_BASE + 1 + (idx % stationCount);
+          snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+                   (unsigned)(address >> 40) & 0xFF, (unsigned)(address >> 32) & 0xFF,
+                   (unsigned)(address >> 24) & 0xFF, (unsigned)(address >> 16) & 0xFF,
+                   (unsigned)(address >> 8) & 0xFF, (unsigned)address & 0xFF);
+          const uint32_t port = plc_uart_model_resolve_network(PLC_UART_MODEL_NETWORK_AUTO, mac);
+          plc_uart_model_io(port, mac, refresh & 1, 0, NULL);
+        }
+        break;
+      default:
+        break;
+    }
+
+    shim_clock_advance(REFRESH_PERIOD_US);
+  }
+
+  *totalNsPtr = shim_now_ns() - startNs - (stats.sourceNs - sourceStartNs);
+  *parseNsPtr = stats.stageNs[STAGE_PARSE] - parseStartNs;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,245 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "plc_replay_shim.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Partições conhecidas pelo Service */
+#define PARTITION_COUNT     2
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+/* Relógio virtual, determinístico entre execuções */
+static int64_t virtualClockUs;
+static bool logEnabled;
+static shimAllocStats_t allocStats;
+static esp_partition_t partitions[PARTITION_COUNT] = {
+  { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .size = SHIM_PARTITION_SIZE, .label = "telemetry" },
+  { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x41, .size = SHIM_PARTITION_SIZE, .label = "uartcap" },
+};
+static uint8_t partitionData[PARTITION_COUNT][SHIM_PARTITION_SIZE];
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+static uint8_t * partition_data(const esp_partition_t * partition, size_t offset, size_t size);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+/**
+ * Inicializa partições simuladas como flash apagada
+ * 
+ */
+void shim_init(void)
+{
+  memset(partitionData, 0xFF, sizeof(partitionData));
+}
+
+/**
+ * Avança relógio virtual retornado por esp_timer_get_time
+ * 
+ * @param elapsedUs   tempo decorrido em microssegundos
+ */
+void shim_clock_advance(int64_t elapsedUs)
+{
+  virtualClockUs += elapsedUs;
+}
+
+/**
+ * Relógio monotônico real, para medições do replay
+ * 
+ * @return uint64_t   nanossegundos
+ */
+uint64_t shim_now_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Habilita escrita dos logs do Service em stderr
+ * 
+ * @param enable  true = logs escritos
+ */
+void shim_log_enable(bool enable)
+{
+  logEnabled = enable;
+}
+
+/**
+ * Zera contagem de alocações
+ * 
+ */
+void shim_alloc_reset(void)
+{
+  memset(&allocStats, 0, sizeof(allocStats));
+}
+
+/**
+ * Recupera contagem de alocações desde o último reset
+ * 
+ * @param statsPtr  estrutura de escrita
+ */
+void shim_alloc_get(shimAllocStats_t * statsPtr)
+{
+  *statsPtr = allocStats;
+}
+
+int64_t esp_timer_get_time(void)
+{
+  return virtualClockUs;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+  return virtualClockUs / 1000;
+}
+
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...)
+{
+  (void)level;
+  if (logEnabled == false)
+  {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "%s: ", tag);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                 const char * label)
+{
+  (void)subtype;
+  for (uint32_t idx = 0; idx < PARTITION_COUNT; idx++)
+  {
+    if ((partitions[idx].type == type) && (strcmp(partitions[idx].label, label) == 0))
+    {
+      return &partitions[idx];
+    }
+  }
+
+  return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t * partition, size_t offset, void * dst, size_t size)
+{
+  const uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  memcpy(dst, dataPtr, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t * partition, size_t offset, const void * src, size_t size)
+{
+  uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  /* Escrita em flash somente limpa bits */
+  for (size_t idx = 0; idx < size; idx++)
+  {
+    dataPtr[idx] &= ((const uint8_t *)src)[idx];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t * partition, size_t offset, size_t size)
+{
+  uint8_t * dataPtr = partition_data(partition, offset, size);
+  if (dataPtr == NULL)
+  {
+    return ESP_FAIL;
+  }
+
+  memset(dataPtr, 0xFF, size);
+  return ESP_OK;
+}
+
+/* Alocações contabilizadas via -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc */
+void * __wrap_malloc(size_t size)
+{
+  allocStats.calls++;
+  allocStats.bytes += size;
+  return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size)
+{
+  allocStats.calls++;
+  allocStats.bytes += count * size;
+  return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size)
+{
+  allocStats.calls++;
+  allocStats.bytes += size;
+  return __real_realloc(ptr, size);
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Valida intervalo e recupera memória de uma partição simulada
+ * 
+ * @param partition   partição retornada por esp_partition_find_first
+ * @param offset      início do intervalo
+ * @param size        tamanho do intervalo
+ * @return uint8_t*   memória do intervalo, NULL = fora da partição
+ */
+static uint8_t * partition_data(const esp_partition_t * partition, size_t offset, size_t size)
+{
+  const uint32_t idx = partition - partitions;
+  if ((idx >= PARTITION_COUNT) || (offset + size > partition->size))
+  {
+    return NULL;
+  }
+
+  return &partitionData[idx][offset];
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
@@ -0,0 +1,45 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef PLC_REPLAY_SHIM_H
+#define PLC_REPLAY_SHIM_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+/* Tamanho das partições simuladas em RAM */
+#define SHIM_PARTITION_SIZE     (256 * 1024)
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Alocações do heap contabilizadas desde o último reset */
+typedef struct shimAllocStats_t
+{
+  uint64_t calls;
+  uint64_t bytes;
+} shimAllocStats_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void shim_init(void);
+void shim_clock_advance(int64_t elapsedUs);
+uint64_t shim_now_ns(void);
+void shim_log_enable(bool enable);
+void shim_alloc_reset(void);
+void shim_alloc_get(shimAllocStats_t * statsPtr);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
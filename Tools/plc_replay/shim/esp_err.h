@@ -0,0 +1,25 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_ERR_H
+#define SHIM_ESP_ERR_H
+
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define ESP_OK      0
+#define ESP_FAIL    -1
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef int esp_err_t;
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,42 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_ESP_LOG_H
+#define SHIM_ESP_LOG_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+typedef enum
+{
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/* Logs escritos em stderr somente com replay verboso (-v) */
+#define ESP_LOGE(tag, format, ...)  esp_log_write(ESP_LOG_ERROR, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  esp_log_write(ESP_LOG_WARN, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  esp_log_write(ESP_LOG_INFO, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  esp_log_write(ESP_LOG_DEBUG, tag, format "\n", ##__VA_ARGS__)
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...);
+uint32_t esp_log_timestamp(void);
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
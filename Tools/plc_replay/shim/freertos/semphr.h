@@ -0,0 +1,51 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+#ifndef SHIM_SEMPHR_H
+#define SHIM_SEMPHR_H
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#include "freertos/FreeRTOS.h"
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+typedef void * SemaphoreHandle_t;
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+/* Replay executa em uma única tarefa, semáforos sempre disponíveis. Funções
+   e não macros: resultado ignorado pelo chamador não gera -Wunused-value */
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  return (SemaphoreHandle_t)1;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+  return (SemaphoreHandle_t)1;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks)
+{
+  (void)handle;
+  (void)ticks;
+  return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+  (void)handle;
+  return pdTRUE;
+}
+
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/
+#endif
@@ -0,0 +1,908 @@
+/*******************************************************************************
+* Leonardo Mudrek de Almeida
+* UTFPR - CT
+*
+*
+* License : CC BY NC SA 4.0
+*******************************************************************************/
+
+/*
+ * Simulador do módulo PLC 3121N-H no host (Linux), exposto em um
+ * pseudo-terminal. Responde ao dialeto AT usado por plc_uart.c,
+ * plc_config.c e plc_uart_model.c:
+ *   "++"                          -> OK, entra em modo AT
+ *   AT                            -> OK (heartbeat)
+ *   AT+MODE=<modo>                -> OK
+ *   AT+TOPOINFO=<início>,<qtd>    -> +TOPOINFO:<mac>,<id>,0,0,<papel>,<snr>,<aten>,<fase> ... OK
+ *   AT+IOCTRL=<mac>,<gpio>,<valor>-> OK | ERROR (MAC desconhecido)
+ * e gera notificações espontâneas (+JOIN <mac> / +LEAVE <mac>) com a
+ * entrada e saída de estações. Um reinício do módulo (-R ou SIGUSR2)
+ * descarta respostas pendentes, fica mudo durante o boot, emite +READY e
+ * ignora comandos até receber "++", como fora do modo AT.
+ * 
+ * Build:
+ *   gcc -O2 Tools/plc_simulator/plc_sim.c -o plc_sim -lm
+ * 
+ * Uso:
+ *   plc_sim [-n estações] [-l link] [-s semente] [-b baud]
+ *           [-L comando=distribuição] [-D descarte] [-F fragmentação]
+ *           [-N ruído] [-C churn_ms] [-R reinício_ms] [-p relatório_s]
+ * 
+ *   distribuição de latência (ms), por comando plus|at|mode|topoinfo|ioctrl:
+ *     fixed:<ms> | uniform:<min>:<max> | exp:<média> | lognormal:<mediana>:<sigma>
+ *   -D, -F, -N: probabilidades de 0 a 1 por resposta
+ *   -C: intervalo médio entre entrada/saída de estações, 0 = rede estável
+ *   -R: intervalo médio entre reinícios do módulo, 0 = somente SIGUSR2
+ * 
+ * O caminho do escravo do pty é escrito em stdout (e no link, com -l).
+ * SIGUSR1 escreve as estatísticas, SIGUSR2 reinicia o módulo, SIGINT encerra.
+ */
+
+/*******************************************************************************
+* INCLUDES
+*******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+/*******************************************************************************
+* DEFINES E ENUMS
+*******************************************************************************/
+#define MAX_STATIONS        4096
+#define DEFAULT_STATIONS    8
+#define DEFAULT_BAUD        115200
+/* 8E1: start + 8 dados + paridade + stop */
+#define BITS_PER_BYTE       11
+#define INPUT_SIZE          512
+#define OUTPUT_SIZE         (64 * 1024)
+/* Respostas e fragmentos aguardando a latência simulada */
+#define MAX_SCHEDULED       256
+#define REPLY_SIZE          8192
+/* Intervalo entre fragmentos de uma resposta */
+#define FRAGMENT_GAP_US     2000
+/* Base dos MACs simulados, estação somada aos bytes finais */
+#define MAC_BASE            0x001122330000ULL
+/* Boot do módulo após um reinício, sem resposta a comandos */
+#define BOOT_TIME_US        500000
+
+typedef enum simCommand_t
+{
+  CMD_PLUS = 0,
+  CMD_AT,
+  CMD_MODE,
+  CMD_TOPOINFO,
+  CMD_IOCTRL,
+  CMD_UNKNOWN,
+  CMD_COUNT,
+} simCommand_t;
+
+typedef enum latencyKind_t
+{
+  LATENCY_FIXED = 0,
+  LATENCY_UNIFORM,
+  LATENCY_EXP,
+  LATENCY_LOGNORMAL,
+} latencyKind_t;
+
+/*******************************************************************************
+* TYPEDEFS
+*******************************************************************************/
+/* Distribuição de latência de um comando, em ms */
+typedef struct latency_t
+{
+  latencyKind_t kind;
+  double a;
+  double b;
+} latency_t;
+
+typedef struct station_t
+{
+  uint64_t mac;
+  bool online;
+  uint8_t snr;
+  uint8_t atenuation;
+  uint8_t phase;
+  uint8_t gpio;
+} station_t;
+
+/* Texto a ser escrito no pty a partir de um instante */
+typedef struct scheduled_t
+{
+  int64_t dueUs;
+  uint32_t length;
+  char * textPtr;
+} scheduled_t;
+
+typedef struct simStats_t
+{
+  uint64_t received[CMD_COUNT];
+  uint64_t replies;
+  uint64_t dropped;
+  uint64_t fragmented;
+  uint64_t noisy;
+  uint64_t notifications;
+  uint64_t resets;
+  uint64_t ignored;
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+} simStats_t;
+
+/*******************************************************************************
+* CONSTANTES
+*******************************************************************************/
+static const char * const commandNames[CMD_COUNT] = {
+  [CMD_PLUS] = "plus",
+  [CMD_AT] = "at",
+  [CMD_MODE] = "mode",
+  [CMD_TOPOINFO] = "topoinfo",
+  [CMD_IOCTRL] = "ioctrl",
+  [CMD_UNKNOWN] = "unknown",
+};
+
+/*******************************************************************************
+* VARIÁVEIS
+*******************************************************************************/
+static station_t stations[MAX_STATIONS];
+static uint32_t stationCount = DEFAULT_STATIONS;
+static latency_t latencies[CMD_COUNT] = {
+  [CMD_PLUS] = { LATENCY_FIXED, 5, 0 },
+  [CMD_AT] = { LATENCY_FIXED, 2, 0 },
+  [CMD_MODE] = { LATENCY_FIXED, 5, 0 },
+  [CMD_TOPOINFO] = { LATENCY_LOGNORMAL, 40, 0.4 },
+  [CMD_IOCTRL] = { LATENCY_LOGNORMAL, 25, 0.5 },
+  [CMD_UNKNOWN] = { LATENCY_FIXED, 1, 0 },
+};
+static double dropProbability;
+static double fragmentProbability;
+static double noiseProbability;
+static double churnMs;
+static double resetMs;
+/* Modo AT ativo, perdido a cada reinício até "++" */
+static bool atMode = true;
+static int64_t bootUntilUs;
+static uint32_t baud = DEFAULT_BAUD;
+static uint64_t randomState = 1;
+
+static scheduled_t scheduled[MAX_SCHEDULED];
+static uint32_t scheduledCount;
+/* Módulo trata um comando por vez, respostas saem em ordem */
+static int64_t busyUntilUs;
+
+static char output[OUTPUT_SIZE];
+static uint32_t outputHead;
+static uint32_t outputTail;
+static int64_t lastWriteUs;
+
+static simStats_t stats;
+static volatile sig_atomic_t reportRequested;
+static volatile sig_atomic_t resetRequested;
+static volatile sig_atomic_t exitRequested;
+
+/*******************************************************************************
+* PROTÓTIPOS DE FUNÇÕES
+*******************************************************************************/
+static int64_t now_us(void);
+static double random_uniform(void);
+static double latency_sample_ms(const latency_t * latencyPtr);
+static bool latency_parse(const char * specPtr);
+static void network_init(void);
+static void handle_input(char * bufferPtr, uint32_t * lengthPtr);
+static void handle_command(const char * linePtr);
+static size_t reply_topoinfo(const char * argsPtr, char * replyPtr, size_t replySize);
+static size_t reply_ioctrl(const char * argsPtr, char * replyPtr, size_t replySize);
+static void schedule_reply(simCommand_t command, char * replyPtr, size_t length);
+static void schedule_text(int64_t dueUs, const char * textPtr, size_t length);
+static void churn_step(void);
+static void module_reset(void);
+static void flush_due(int masterFd);
+static int64_t next_wakeup_us(void);
+static void report(void);
+static void on_signal(int signal);
+
+/*******************************************************************************
+* FUNÇÕES EXPORTADAS
+*******************************************************************************/
+
+int main(int argc, char * argv[])
+{
+  const char * linkPathPtr = NULL;
+  double reportSeconds = 0;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:l:s:b:L:D:F:N:C:R:p:")) != -1)
+  {
+    switch (option)
+    {
+      case 'n': stationCount = strtoul(optarg, NULL, 10); break;
+      case 'l': linkPathPtr = optarg; break;
+      case 's': randomState = strtoull(optarg, NULL, 10) | 1; break;
+      case 'b': baud = strtoul(optarg, NULL, 10); break;
+      case 'D': dropProbability = atof(optarg); break;
+      case 'F': fragmentProbability = atof(optarg); break;
+      case 'N': noiseProbability = atof(optarg); break;
+      case 'C': churnMs = atof(optarg); break;
+      case 'R': resetMs = atof(optarg); break;
+      case 'p': reportSeconds = atof(optarg); break;
+      case 'L':
+        if (latency_parse(optarg) == false)
+        {
+          fprintf(stderr, "invalid latency '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n stations] [-l link] [-s seed] [-b baud] [-L cmd=dist] "
+                        "[-D drop] [-F fragment] [-N noise] [-C churn_ms] [-R reset_ms] [-p report_s]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if ((stationCount < 1) || (stationCount > MAX_STATIONS))
+  {
+    fprintf(stderr, "stations must be 1..%u\n", MAX_STATIONS);
+    return 1;
+  }
+
+  /* Pseudo-terminal em modo raw, como a UART do ESP32 */
+  int masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((masterFd < 0) || (grantpt(masterFd) != 0) || (unlockpt(masterFd) != 0))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  struct termios attributes;
+  tcgetattr(masterFd, &attributes);
+  cfmakeraw(&attributes);
+  tcsetattr(masterFd, TCSANOW, &attributes);
+  fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+  const char * slavePathPtr = ptsname(masterFd);
+  if (linkPathPtr != NULL)
+  {
+    unlink(linkPathPtr);
+    if (symlink(slavePathPtr, linkPathPtr) != 0)
+    {
+      perror(linkPathPtr);
+      return 1;
+    }
+  }
+  printf("%s\n", slavePathPtr);
+  fflush(stdout);
+
+  /* Mantém o escravo aberto: sem cliente, escritas não geram EIO */
+  int holdFd = open(slavePathPtr, O_RDWR | O_NOCTTY);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGUSR1, on_signal);
+  signal(SIGUSR2, on_signal);
+
+  network_init();
+
+  char input[INPUT_SIZE];
+  uint32_t inputLength = 0;
+  int64_t nextChurnUs = churnMs > 0 ? now_us() + (int64_t)(-log(1 - random_uniform()) * churnMs * 1000) : INT64_MAX;
+  int64_t nextResetUs = resetMs > 0 ? now_us() + (int64_t)(-log(1 - random_uniform()) * resetMs * 1000) : INT64_MAX;
+  int64_t nextReportUs = reportSeconds > 0 ? now_us() + (int64_t)(reportSeconds * 1e6) : INT64_MAX;
+  lastWriteUs = now_us();
+
+  while (exitRequested == 0)
+  {
+    int64_t wakeupUs = next_wakeup_us();
+    wakeupUs = wakeupUs < nextChurnUs ? wakeupUs : nextChurnUs;
+    wakeupUs = wakeupUs < nextResetUs ? wakeupUs : nextResetUs;
+    wakeupUs = wakeupUs < nextReportUs ? wakeupUs : nextReportUs;
+    int64_t waitUs = wakeupUs - now_us();
+    int timeoutMs = wakeupUs == INT64_MAX ? -1 : (waitUs <= 0 ? 0 : (int)((waitUs + 999) / 1000));
+
+    struct pollfd descriptor = { .fd = masterFd, .events = POLLIN };
+    if ((poll(&descriptor, 1, timeoutMs) > 0) && (descriptor.revents & POLLIN))
+    {
+      ssize_t bytesRead = read(masterFd, &input[inputLength], sizeof(input) - 1 - inputLength);
+      if (bytesRead > 0)
+      {
+        stats.bytesIn += bytesRead;
+        inputLength += bytesRead;
+        handle_input(input, &inputLength);
+      }
+    }
+
+    const int64_t nowUs = now_us();
+    if (nowUs >= nextChurnUs)
+    {
+      churn_step();
+      nextChurnUs = nowUs + (int64_t)(-log(1 - random_uniform()) * churnMs * 1000);
+    }
+
+    if ((nowUs >= nextResetUs) || resetRequested)
+    {
+      module_reset();
+      resetRequested = 0;
+      nextResetUs = resetMs > 0 ? nowUs + (int64_t)(-log(1 - random_uniform()) * resetMs * 1000) : INT64_MAX;
+    }
+
+    if ((nowUs >= nextReportUs) || reportRequested)
+    {
+      report();
+      reportRequested = 0;
+      nextReportUs = reportSeconds > 0 ? nowUs + (int64_t)(reportSeconds * 1e6) : INT64_MAX;
+    }
+
+    flush_due(masterFd);
+  }
+
+  report();
+  if (linkPathPtr != NULL)
+  {
+    unlink(linkPathPtr);
+  }
+  close(holdFd);
+  close(masterFd);
+  return 0;
+}
+
+/*******************************************************************************
+* FUNÇÕES LOCAIS
+*******************************************************************************/
+
+/**
+ * Relógio monotônico
+ * 
+ * @return int64_t  microssegundos
+ */
+static int64_t now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Gerador xorshift64*, determinístico pela semente
+ * 
+ * @return double   valor em [0, 1)
+ */
+static double random_uniform(void)
+{
+  randomState ^= randomState >> 12;
+  randomState ^= randomState << 25;
+  randomState ^= randomState >> 27;
+  return ((randomState * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Sorteia latência de uma distribuição
+ * 
+ * @param latencyPtr  distribuição
+ * @return double     latência em ms, nunca negativa
+ */
+static double latency_sample_ms(const latency_t * latencyPtr)
+{
+  double value;
+  switch (latencyPtr->kind)
+  {
+    case LATENCY_UNIFORM:
+      value = latencyPtr->a + (latencyPtr->b - latencyPtr->a) * random_uniform();
+      break;
+    case LATENCY_EXP:
+      value = -log(1 - random_uniform()) * latencyPtr->a;
+      break;
+    case LATENCY_LOGNORMAL:
+    {
+      /* Box-Muller, mediana * e^(sigma * normal) */
+      const double normal = sqrt(-2 * log(1 - random_uniform())) * cos(2 * M_PI * random_uniform());
+      value = latencyPtr->a * exp(latencyPtr->b * normal);
+      break;
+    }
+    default:
+      value = latencyPtr->a;
+      break;
+  }
+
+  return value > 0 ? value : 0;
+}
+
+/**
+ * Interpreta "-L comando=tipo:a[:b]"
+ * 
+ * @param specPtr   especificação
+ * @return true     distribuição aplicada
+ * @return false    especificação inválida
+ */
+static bool latency_parse(const char * specPtr)
+{
+  char name[16];
+  char kind[16];
+  double a = 0;
+  double b = 0;
+
+  if (sscanf(specPtr, "%15[^=]=%15[^:]:%lf:%lf", name, kind, &a, &b) < 3)
+  {
+    return false;
+  }
+
+  latency_t latency = { .a = a, .b = b };
+  if (strcmp(kind, "fixed") == 0) latency.kind = LATENCY_FIXED;
+  else if (strcmp(kind, "uniform") == 0) latency.kind = LATENCY_UNIFORM;
+  else if (strcmp(kind, "exp") == 0) latency.kind = LATENCY_EXP;
+  else if (strcmp(kind, "lognormal") == 0) latency.kind = LATENCY_LOGNORMAL;
+  else return false;
+
+  for (uint32_t command = 0; command < CMD_COUNT; command++)
+  {
+    if (strcmp(name, commandNames[command]) == 0)
+    {
+      latencies[command] = latency;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Cria rede: estação 0 é o CCO, todas inicialmente presentes
+ * 
+ */
+static void network_init(void)
+{
+  for (uint32_t idx = 0; idx < stationCount; idx++)
+  {
+    stations[idx] = (station_t) {
+      .mac = MAC_BASE + idx,
+      .online = true,
+      .snr = 10 + (uint8_t)(random_uniform() * 40),
+      .atenuation = 20 + (uint8_t)(random_uniform() * 60),
+      .phase = 1 + (uint8_t)(random_uniform() * 3),
+    };
+  }
+}
+
+/**
+ * Separa comandos recebidos. "++" não tem terminador, demais terminam em CR/LF
+ * 
+ * @param bufferPtr   bytes acumulados
+ * @param lengthPtr   quantidade acumulada, atualizada com o restante
+ */
+static void handle_input(char * bufferPtr, uint32_t * lengthPtr)
+{
+  uint32_t start = 0;
+
+  while (start < *lengthPtr)
+  {
+    const uint32_t remaining = *lengthPtr - start;
+    char * linePtr = &bufferPtr[start];
+
+    if ((linePtr[0] == '\r') || (linePtr[0] == '\n') || (linePtr[0] == '\0'))
+    {
+      start++;
+      continue;
+    }
+
+    if ((remaining >= 2) && (linePtr[0] == '+') && (linePtr[1] == '+'))
+    {
+      handle_command("++");
+      start += 2;
+      continue;
+    }
+
+    uint32_t end = 0;
+    while ((end < remaining) && (linePtr[end] != '\r') && (linePtr[end] != '\n'))
+    {
+      end++;
+    }
+
+    if (end == remaining)
+    {
+      /* Comando incompleto, aguarda próximos bytes */
+      break;
+    }
+
+    linePtr[end] = '\0';
+    handle_command(linePtr);
+    start += end + 1;
+  }
+
+  *lengthPtr -= start;
+  memmove(bufferPtr, &bufferPtr[start], *lengthPtr);
+
+  if (*lengthPtr == INPUT_SIZE - 1)
+  {
+    /* Linha sem terminador ocupando todo o buffer, descarta */
+    *lengthPtr = 0;
+  }
+}
+
+/**
+ * Trata um comando e agenda a resposta
+ * 
+ * @param linePtr   comando sem terminador
+ */
+static void handle_command(const char * linePtr)
+{
+  static char reply[REPLY_SIZE];
+  simCommand_t command = CMD_UNKNOWN;
+  size_t length;
+
+  if ((now_us() < bootUntilUs) || ((atMode == false) && (strcmp(linePtr, "++") != 0)))
+  {
+    /* Em boot ou fora do modo AT, comando segue para a rede sem resposta */
+    stats.ignored++;
+    return;
+  }
+
+  if (strcmp(linePtr, "++") == 0)
+  {
+    command = CMD_PLUS;
+    atMode = true;
+    length = snprintf(reply, sizeof(reply), "OK\r\n");
+  }
+  else if (strcmp(linePtr, "AT") == 0)
+  {
+    command = CMD_AT;
+    length = snprintf(reply, sizeof(reply), "OK\r\n");
+  }
+  else if (strncmp(linePtr, "AT+MODE=", 8) == 0)
+  {
+    command = CMD_MODE;
+    length = snprintf(reply, sizeof(reply), "OK\r\n");
+  }
+  else if (strncmp(linePtr, "AT+TOPOINFO=", 12) == 0)
+  {
+    command = CMD_TOPOINFO;
+    length = reply_topoinfo(&linePtr[12], reply, sizeof(reply));
+  }
+  else if (strncmp(linePtr, "AT+IOCTRL=", 10) == 0)
+  {
+    command = CMD_IOCTRL;
+    length = reply_ioctrl(&linePtr[10], reply, sizeof(reply));
+  }
+  else
+  {
+    length = snprintf(reply, sizeof(reply), "ERROR\r\n");
+  }
+
+  stats.received[command]++;
+  schedule_reply(command, reply, length);
+}
+
+/**
+ * Monta resposta AT+TOPOINFO=<início>,<quantidade>, início em 1 sobre as
+ * estações presentes
+ * 
+ * @param argsPtr     argumentos do comando
+ * @param replyPtr    buffer de escrita
+ * @param replySize   tamanho do buffer
+ * @return size_t     tamanho da resposta
+ */
+static size_t reply_topoinfo(const char * argsPtr, char * replyPtr, size_t replySize)
+{
+  uint32_t first;
+  uint32_t count;
+  if ((sscanf(argsPtr, "%u,%u", &first, &count) != 2) || (first == 0))
+  {
+    return snprintf(replyPtr, replySize, "ERROR\r\n");
+  }
+
+  size_t length = 0;
+  uint32_t position = 0;
+  for (uint32_t idx = 0; (idx < stationCount) && (count != 0); idx++)
+  {
+    station_t * stationPtr = &stations[idx];
+    if ((stationPtr->online == false) || (++position < first))
+    {
+      continue;
+    }
+
+    /* Qualidade do enlace varia levemente entre leituras */
+    stationPtr->snr = stationPtr->snr + (int)(random_uniform() * 3) - 1;
+    stationPtr->atenuation = stationPtr->atenuation + (int)(random_uniform() * 3) - 1;
+
+    const size_t needed = length + 64;
+    if (needed >= replySize)
+    {
+      break;
+    }
+    length += snprintf(&replyPtr[length], replySize - length, "+TOPOINFO:%012llX,%u,0,0,%u,%u,%u,%u\r\n",
+                       (unsigned long long)stationPtr->mac, idx + 1, idx == 0 ? 4 : 1,
+                       stationPtr->snr, stationPtr->atenuation, stationPtr->phase);
+    count--;
+  }
+
+  length += snprintf(&replyPtr[length], replySize - length, "OK\r\n");
+  return length;
+}
+
+/**
+ * Monta resposta AT+IOCTRL=<mac>,<gpio>,<valor>
+ * 
+ * @param argsPtr     argumentos do comando
+ * @param replyPtr    buffer de escrita
+ * @param replySize   tamanho do buffer
+ * @return size_t     tamanho da resposta
+ */
+static size_t reply_ioctrl(const char * argsPtr, char * replyPtr, size_t replySize)
+{
+  unsigned long long mac;
+  uint32_t gpio;
+  uint32_t value;
+  if (sscanf(argsPtr, "%llx,%u,%u", &mac, &gpio, &value) != 3)
+  {
+    return snprintf(replyPtr, replySize, "ERROR\r\n");
+  }
+
+  const uint64_t idx = mac - MAC_BASE;
+  if ((mac < MAC_BASE) || (idx >= stationCount) || (stations[idx].online == false))
+  {
+    /* Estação desconhecida ou fora da rede */
+    return snprintf(replyPtr, replySize, "ERROR\r\n");
+  }
+
+  stations[idx].gpio = value != 0;
+  return snprintf(replyPtr, replySize, "OK\r\n");
+}
+
+/**
+ * Aplica latência, descarte, ruído e fragmentação à resposta
+ * 
+ * @param command   comando respondido
+ * @param replyPtr  resposta, pode ser alterada pelo ruído
+ * @param length    tamanho da resposta
+ */
+static void schedule_reply(simCommand_t command, char * replyPtr, size_t length)
+{
+  const int64_t nowUs = now_us();
+  const int64_t startUs = busyUntilUs > nowUs ? busyUntilUs : nowUs;
+  int64_t dueUs = startUs + (int64_t)(latency_sample_ms(&latencies[command]) * 1000);
+  busyUntilUs = dueUs;
+
+  if (random_uniform() < dropProbability)
+  {
+    stats.dropped++;
+    return;
+  }
+
+  if (random_uniform() < noiseProbability)
+  {
+    /* Troca um byte por lixo da linha */
+    replyPtr[(size_t)(random_uniform() * length)] = (char)(0x80 | (uint8_t)(random_uniform() * 0x7F));
+    stats.noisy++;
+  }
+
+  stats.replies++;
+  if ((length < 2) || (random_uniform() >= fragmentProbability))
+  {
+    schedule_text(dueUs, replyPtr, length);
+    return;
+  }
+
+  /* Corta a resposta em 2 a 4 pedaços com pausas entre eles */
+  stats.fragmented++;
+  const uint32_t pieces = 2 + (uint32_t)(random_uniform() * 3);
+  size_t offset = 0;
+  for (uint32_t piece = 0; piece < pieces; piece++)
+  {
+    size_t size = piece + 1 == pieces ? length - offset : 1 + (size_t)(random_uniform() * (length - offset - 1));
+    if (size == 0)
+    {
+      break;
+    }
+    schedule_text(dueUs, &replyPtr[offset], size);
+    offset += size;
+    dueUs += FRAGMENT_GAP_US;
+    if (offset == length)
+    {
+      break;
+    }
+  }
+  busyUntilUs = dueUs;
+}
+
+/**
+ * Agenda texto para escrita no pty
+ * 
+ * @param dueUs     instante de escrita
+ * @param textPtr   texto, copiado
+ * @param length    tamanho
+ */
+static void schedule_text(int64_t dueUs, const char * textPtr, size_t length)
+{
+  if (scheduledCount == MAX_SCHEDULED)
+  {
+    /* Cliente não está lendo, descarta como o módulo faria */
+    stats.dropped++;
+    return;
+  }
+
+  scheduled_t * entryPtr = &scheduled[scheduledCount++];
+  entryPtr->dueUs = dueUs;
+  entryPtr->length = length;
+  entryPtr->textPtr = malloc(length);
+  memcpy(entryPtr->textPtr, textPtr, length);
+}
+
+/**
+ * Alterna presença de uma estação e notifica, CCO sempre presente
+ * 
+ */
+static void churn_step(void)
+{
+  if (stationCount < 2)
+  {
+    return;
+  }
+
+  station_t * stationPtr = &stations[1 + (uint32_t)(random_uniform() * (stationCount - 1))];
+  stationPtr->online = !stationPtr->online;
+
+  char notification[48];
+  const size_t length = snprintf(notification, sizeof(notification), "+%s %012llX\r\n",
+                                 stationPtr->online ? "JOIN" : "LEAVE", (unsigned long long)stationPtr->mac);
+  schedule_text(now_us(), notification, length);
+  stats.notifications++;
+}
+
+/**
+ * Reinicia o módulo: respostas pendentes descartadas, +READY ao fim do boot
+ * e modo AT perdido
+ * 
+ */
+static void module_reset(void)
+{
+  for (uint32_t idx = 0; idx < scheduledCount; idx++)
+  {
+    free(scheduled[idx].textPtr);
+  }
+  scheduledCount = 0;
+  busyUntilUs = 0;
+
+  atMode = false;
+  bootUntilUs = now_us() + BOOT_TIME_US;
+  schedule_text(bootUntilUs, "+READY\r\n", 8);
+  stats.resets++;
+}
+
+/**
+ * Move textos vencidos para a saída e escreve respeitando o baud rate
+ * 
+ * @param masterFd  lado mestre do pty
+ */
+static void flush_due(int masterFd)
+{
+  const int64_t nowUs = now_us();
+
+  for (uint32_t idx = 0; idx < scheduledCount;)
+  {
+    scheduled_t * entryPtr = &scheduled[idx];
+    if ((entryPtr->dueUs > nowUs) || ((OUTPUT_SIZE - (outputHead - outputTail)) < entryPtr->length))
+    {
+      idx++;
+      continue;
+    }
+
+    for (uint32_t byte = 0; byte < entryPtr->length; byte++)
+    {
+      output[(outputHead++) % OUTPUT_SIZE] = entryPtr->textPtr[byte];
+    }
+    free(entryPtr->textPtr);
+    /* Mantém ordem de agendamento */
+    memmove(entryPtr, entryPtr + 1, (--scheduledCount - idx) * sizeof(scheduled_t));
+  }
+
+  if (outputHead == outputTail)
+  {
+    lastWriteUs = nowUs;
+    return;
+  }
+
+  /* Bytes liberados pelo tempo decorrido na velocidade da UART */
+  uint64_t allowed = outputHead - outputTail;
+  if (baud != 0)
+  {
+    allowed = (uint64_t)(nowUs - lastWriteUs) * baud / BITS_PER_BYTE / 1000000;
+    if (allowed == 0)
+    {
+      return;
+    }
+    allowed = allowed < (outputHead - outputTail) ? allowed : (outputHead - outputTail);
+  }
+
+  while (allowed != 0)
+  {
+    const uint32_t index = outputTail % OUTPUT_SIZE;
+    size_t chunk = OUTPUT_SIZE - index;
+    chunk = chunk < allowed ? chunk : allowed;
+    ssize_t written = write(masterFd, &output[index], chunk);
+    if (written <= 0)
+    {
+      break;
+    }
+    outputTail += written;
+    stats.bytesOut += written;
+    allowed -= written;
+  }
+  lastWriteUs = nowUs;
+}
+
+/**
+ * Próximo instante com escrita pendente
+ * 
+ * @return int64_t  microssegundos, INT64_MAX = nada pendente
+ */
+static int64_t next_wakeup_us(void)
+{
+  if (outputHead != outputTail)
+  {
+    /* Saída limitada pelo baud rate, verifica a cada ms */
+    return now_us() + 1000;
+  }
+
+  int64_t wakeupUs = INT64_MAX;
+  for (uint32_t idx = 0; idx < scheduledCount; idx++)
+  {
+    wakeupUs = scheduled[idx].dueUs < wakeupUs ? scheduled[idx].dueUs : wakeupUs;
+  }
+  return wakeupUs;
+}
+
+/**
+ * Escreve estatísticas em stderr
+ * 
+ */
+static void report(void)
+{
+  uint32_t online = 0;
+  for (uint32_t idx = 0; idx < stationCount; idx++)
+  {
+    online += stations[idx].online;
+  }
+
+  fprintf(stderr, "stations %u/%u online | rx", online, stationCount);
+  for (uint32_t command = 0; command < CMD_COUNT; command++)
+  {
+    fprintf(stderr, " %s=%llu", commandNames[command], (unsigned long long)stats.received[command]);
+  }
+  fprintf(stderr, " | replies %llu dropped %llu fragmented %llu noisy %llu notifications %llu"
+                  " | resets %llu ignored %llu | bytes in %llu out %llu\n",
+          (unsigned long long)stats.replies, (unsigned long long)stats.dropped,
+          (unsigned long long)stats.fragmented, (unsigned long long)stats.noisy,
+          (unsigned long long)stats.notifications, (unsigned long long)stats.resets,
+          (unsigned long long)stats.ignored, (unsigned long long)stats.bytesIn,
+          (unsigned long long)stats.bytesOut);
+}
+
+/**
+ * Tratamento de sinais: SIGUSR1 relatório, SIGUSR2 reinício, demais encerram
+ * 
+ * @param signal  sinal recebido
+ */
+static void on_signal(int signal)
+{
+  if (signal == SIGUSR1)
+  {
+    reportRequested = 1;
+    return;
+  }
+
+  if (signal == SIGUSR2)
+  {
+    resetRequested = 1;
+    return;
+  }
+
+  exitRequested = 1;
+}
+/*******************************************************************************
+* END OF FILE
+*******************************************************************************/